@@ -1,4 +1,11 @@
-﻿using System.Windows;
+﻿using System;
+using System.Collections.Generic;
+using System.ComponentModel;
+using System.Runtime.CompilerServices;
+using System.Runtime.InteropServices;
+using System.Threading;
+using System.Threading.Tasks;
+using System.Windows;
 using System.Windows.Media;
 using System.Windows.Media.Imaging;
 
@@ -6,18 +13,134 @@ namespace Yart.Client;
 
 public partial class MainWindow : Window
 {
+    private const int ScreenWidth = 400;
+    private const int ScreenHeight = 400;
+    private const uint PatchSize = 8;
+
+    private static long _sampledPixelCount;
+
+    private readonly float[] _pixelBuffer = new float[ScreenWidth * ScreenHeight * 4];
+    private readonly CancellationTokenSource _renderCancellation = new();
+    private Task? _renderTask;
+
     public MainWindow()
     {
         UpdateBitmap();
 
         InitializeComponent();
+
+        DataContext = this;
+        Loaded += (_, _) => _renderTask = Task.Run(() => Render(_renderCancellation.Token));
+    }
+
+    public WriteableBitmap Bitmap { get; } = new WriteableBitmap(ScreenWidth, ScreenHeight, 96, 96, PixelFormats.Bgr32, null);
+
+    protected override void OnClosing(CancelEventArgs e)
+    {
+        _renderCancellation.Cancel();
+
+        try
+        {
+            _renderTask?.Wait();
+        }
+        catch (AggregateException)
+        {
+        }
+
+        base.OnClosing(e);
     }
 
-    public WriteableBitmap Bitmap { get; } = new WriteableBitmap(400, 400, 96, 96, PixelFormats.Bgr32, null);
+    /// <summary>
+    /// Refines the image one pass at a time and shows it after every pass, until every pixel is done or the window closes.
+    /// </summary>
+    private unsafe void Render(CancellationToken cancellationToken)
+    {
+        void* sceneData = Native.CreateScene();
+
+        if (sceneData == null)
+        {
+            Dispatcher.InvokeAsync(() => Title = "The CPU does not support the instruction set Yart.Engine was compiled for.");
+            return;
+        }
+
+        void* renderSession = Native.CreateRenderSession(sceneData, new UIntVector2(ScreenWidth, ScreenHeight), &OnPassCompleted, null);
+
+        try
+        {
+            var patches = CreatePatches();
+            var parallelOptions = new ParallelOptions { CancellationToken = cancellationToken };
+
+            for (var pass = 1; ; pass++)
+            {
+                Interlocked.Exchange(ref _sampledPixelCount, 0);
+
+                Parallel.ForEach(patches, parallelOptions, patch =>
+                {
+                    Native.AdvanceRenderSession(renderSession, patch.Start, patch.End);
+                });
+
+                var sampledPixelCount = Interlocked.Read(ref _sampledPixelCount);
+
+                lock (_pixelBuffer)
+                {
+                    fixed (float* pixelBufferPointer = _pixelBuffer)
+                    {
+                        Native.ResolveRenderSession(renderSession, new UIntVector2(0, 0), new UIntVector2(ScreenWidth - 1, ScreenHeight - 1), pixelBufferPointer, null);
+                    }
+                }
+
+                var title = $"Yart - pass {pass}, {sampledPixelCount} pixels refined";
+                Dispatcher.InvokeAsync(() =>
+                {
+                    Title = title;
+                    UpdateBitmap();
+                });
+
+                if (sampledPixelCount == 0)
+                {
+                    break;
+                }
+            }
+        }
+        catch (OperationCanceledException)
+        {
+        }
+        finally
+        {
+            Native.DeleteRenderSession(renderSession);
+            Native.DeleteScene(sceneData);
+        }
+    }
+
+    [UnmanagedCallersOnly(CallConvs = new[] { typeof(CallConvCdecl) })]
+    private static unsafe void OnPassCompleted(void* userData, UIntVector2 inclusiveStartingPoint, UIntVector2 inclusiveEndingPoint, uint sampledPixelCount)
+    {
+        Interlocked.Add(ref _sampledPixelCount, sampledPixelCount);
+    }
+
+    private static List<Patch> CreatePatches()
+    {
+        var patches = new List<Patch>();
+
+        for (uint startY = 0; startY < ScreenHeight; startY += PatchSize)
+        {
+            uint endY = Math.Min(startY + PatchSize, ScreenHeight) - 1;
+
+            for (uint startX = 0; startX < ScreenWidth; startX += PatchSize)
+            {
+                uint endX = Math.Min(startX + PatchSize, ScreenWidth) - 1;
+
+                patches.Add(new Patch(new UIntVector2(startX, startY), new UIntVector2(endX, endY)));
+            }
+        }
+
+        return patches;
+    }
 
     public void UpdateBitmap()
     {
         lock (Bitmap)
+        lock (_pixelBuffer)
         {
             try
             {
@@ -28,15 +151,15 @@ public partial class MainWindow : Window
 
                 unsafe
                 {
-                    for (var y = 0; y < 400; y++)
+                    for (var y = 0; y < ScreenHeight; y++)
                     {
-                        for (var x = 0; x < 400; x++)
+                        for (var x = 0; x < ScreenWidth; x++)
                         {
                             var writeAddress = backBufferPointer + (y * backBufferStride) + (x * 4);
 
-                            var blue = 200;
-                            var green = 0;
-                            var red = 0;
+                            var red = ToByte(_pixelBuffer[((y * ScreenWidth) + x) * 4 + 0]);
+                            var green = ToByte(_pixelBuffer[((y * ScreenWidth) + x) * 4 + 1]);
+                            var blue = ToByte(_pixelBuffer[((y * ScreenWidth) + x) * 4 + 2]);
 
                             var color = blue | (green << 8) | (red << 16);
 
@@ -45,7 +168,7 @@ public partial class MainWindow : Window
                     }
                 }
 
-                Bitmap.AddDirtyRect(new Int32Rect(0, 0, 400, 400));
+                Bitmap.AddDirtyRect(new Int32Rect(0, 0, ScreenWidth, ScreenHeight));
             }
             finally
             {
@@ -53,4 +176,11 @@ public partial class MainWindow : Window
             }
         }
     }
+
+    private static int ToByte(float value)
+    {
+        return (int)(Math.Clamp(value, 0.0f, 1.0f) * 255.0f);
+    }
+
+    private record struct Patch(UIntVector2 Start, UIntVector2 End);
 }
\ No newline at end of file
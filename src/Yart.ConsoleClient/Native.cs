@@ -1,9 +1,51 @@
-﻿using System.Runtime.InteropServices;
+﻿using System.Reflection;
+using System.Runtime.InteropServices;
 
 namespace Yart.ConsoleClient;
 
 public static unsafe class Native
 {
+    /// <summary>
+    /// The builds of Yart.Engine from the widest instruction set to the narrowest, with the instrset_detect level each of
+    /// them needs. Yart.Engine.Sse2 runs on every x64 host and is the fallback.
+    /// </summary>
+    private static readonly (string LibraryName, int InstructionSet)[] EngineBuilds =
+    {
+        ("Yart.Engine.Avx512", 10),
+        ("Yart.Engine", 8),
+    };
+
+    static Native()
+    {
+        NativeLibrary.SetDllImportResolver(typeof(Native).Assembly, ResolveEngine);
+    }
+
+    /// <summary>
+    /// Loads the widest build of Yart.Engine the host supports. The SSE2 build is loaded first to ask it for the
+    /// instruction set of the host, loading a wider build could already run unsupported instructions.
+    /// </summary>
+    private static IntPtr ResolveEngine(string libraryName, Assembly assembly, DllImportSearchPath? searchPath)
+    {
+        if (libraryName != "Yart.Engine" || !NativeLibrary.TryLoad("Yart.Engine.Sse2", assembly, searchPath, out var fallbackHandle))
+        {
+            return IntPtr.Zero;
+        }
+
+        var getHostInstructionSet = (delegate* unmanaged[Cdecl]<int>)NativeLibrary.GetExport(fallbackHandle, "GetHostInstructionSet");
+        var hostInstructionSet = getHostInstructionSet();
+
+        foreach (var (buildLibraryName, instructionSet) in EngineBuilds)
+        {
+            if (hostInstructionSet >= instructionSet && NativeLibrary.TryLoad(buildLibraryName, assembly, searchPath, out var handle))
+            {
+                NativeLibrary.Free(fallbackHandle);
+                return handle;
+            }
+        }
+
+        return fallbackHandle;
+    }
+
     [DllImport("Yart.Engine", CallingConvention = CallingConvention.Cdecl)]
     public static extern void* CreateScene();
 
@@ -12,6 +54,38 @@ public static unsafe class Native
 
     [DllImport("Yart.Engine", CallingConvention = CallingConvention.Cdecl)]
     public static extern void TraceScene(UIntVector2 screenSize, UIntVector2 inclusiveStartingPoint, UIntVector2 inclusiveEndingPoint, void* sceneData, float* pixelBuffer);
+
+    [DllImport("Yart.Engine", CallingConvention = CallingConvention.Cdecl)]
+    public static extern void TraceSceneWithSampleCounts(UIntVector2 screenSize, UIntVector2 inclusiveStartingPoint, UIntVector2 inclusiveEndingPoint, void* sceneData, float* pixelBuffer, uint* sampleCountBuffer);
+
+    [DllImport("Yart.Engine", CallingConvention = CallingConvention.Cdecl)]
+    public static extern void* CreateRenderSession(void* sceneData, UIntVector2 screenSize, delegate* unmanaged[Cdecl]<void*, UIntVector2, UIntVector2, uint, void> callback, void* callbackUserData);
+
+    [DllImport("Yart.Engine", CallingConvention = CallingConvention.Cdecl)]
+    public static extern void DeleteRenderSession(void* renderSession);
+
+    [DllImport("Yart.Engine", CallingConvention = CallingConvention.Cdecl)]
+    public static extern void ResetRenderSession(void* renderSession);
+
+    [DllImport("Yart.Engine", CallingConvention = CallingConvention.Cdecl)]
+    public static extern uint AdvanceRenderSession(void* renderSession, UIntVector2 inclusiveStartingPoint, UIntVector2 inclusiveEndingPoint);
+
+    [DllImport("Yart.Engine", CallingConvention = CallingConvention.Cdecl)]
+    public static extern void ResolveRenderSession(void* renderSession, UIntVector2 inclusiveStartingPoint, UIntVector2 inclusiveEndingPoint, float* pixelBuffer, uint* sampleCountBuffer);
+
+    [DllImport("Yart.Engine", CallingConvention = CallingConvention.Cdecl)]
+    [return: MarshalAs(UnmanagedType.I1)]
+    public static extern bool UpdateMeshVertices(void* sceneData, [MarshalAs(UnmanagedType.LPStr)] string meshName, float* vertices, float* normals, uint vertexCount);
+
+    [DllImport("Yart.Engine", CallingConvention = CallingConvention.Cdecl)]
+    [return: MarshalAs(UnmanagedType.I1)]
+    public static extern bool UpdateMeshTransformation(void* sceneData, [MarshalAs(UnmanagedType.LPStr)] string meshName, float* transformation);
+
+    [DllImport("Yart.Engine", CallingConvention = CallingConvention.Cdecl)]
+    public static extern uint GetHierarchyReportCount(void* sceneData);
+
+    [DllImport("Yart.Engine", CallingConvention = CallingConvention.Cdecl)]
+    public static extern uint GetHierarchyReport(void* sceneData, uint index, byte* buffer, uint bufferSize);
 }
 
 [StructLayout(LayoutKind.Sequential, Pack = 1)]
@@ -4,6 +4,7 @@ using SixLabors.ImageSharp.Processing;
 using System.Numerics;
 using Yart.ConsoleClient;
 using System.Diagnostics;
+using System.Text;
 
 const int screenWidth = 1920;
 const int screenHeight = 1080;
@@ -13,11 +14,30 @@ var stopwatch = new Stopwatch();
 using (var image = new Image<Rgba32>(screenWidth, screenHeight))
 {
     var pixelBuffer = new float[screenWidth * screenHeight * 4];
+    var sampleCountBuffer = new uint[screenWidth * screenHeight];
 
     unsafe
     {
         void* sceneData = Native.CreateScene();
 
+        if (sceneData == null)
+        {
+            Console.WriteLine("The CPU does not support the instruction set Yart.Engine was compiled for.");
+            return;
+        }
+
+        for (uint i = 0; i < Native.GetHierarchyReportCount(sceneData); i++)
+        {
+            var report = new byte[Native.GetHierarchyReport(sceneData, i, null, 0)];
+
+            fixed (byte* reportPointer = report)
+            {
+                Native.GetHierarchyReport(sceneData, i, reportPointer, (uint)report.Length);
+            }
+
+            Console.Write(Encoding.UTF8.GetString(report, 0, report.Length - 1));
+        }
+
         //fixed (float* pixelBufferPointer = pixelBuffer)
         //{
         //    Native.TraceScene(new UIntVector2(screenWidth, screenHeight), new UIntVector2(566, 284), new UIntVector2(566, 284), sceneData, pixelBufferPointer);
@@ -56,8 +76,9 @@ using (var image = new Image<Rgba32>(screenWidth, screenHeight))
         //foreach (var patch in patches)
         {
             fixed (float* pixelBufferPointer = pixelBuffer)
+            fixed (uint* sampleCountBufferPointer = sampleCountBuffer)
             {
-                Native.TraceScene(new UIntVector2(screenWidth, screenHeight), patch.Start, patch.End, sceneData, pixelBufferPointer);
+                Native.TraceSceneWithSampleCounts(new UIntVector2(screenWidth, screenHeight), patch.Start, patch.End, sceneData, pixelBufferPointer, sampleCountBufferPointer);
             }
 
             var newCompleted = Interlocked.Increment(ref completed);
@@ -72,6 +93,8 @@ using (var image = new Image<Rgba32>(screenWidth, screenHeight))
         stopwatch.Stop();
     }
 
+    Console.WriteLine($"{sampleCountBuffer.Average(x => (double)x):F2} samples per pixel, {sampleCountBuffer.Max()} at most.");
+
     image.Mutate(c => c.ProcessPixelRowsAsVector4((Span<Vector4> row, Point point) =>
     {
         for (int x = 0; x < row.Length; x++)
@@ -2,19 +2,31 @@
 #include "nanobench.h"
 #include "Vcl.h"
 
+import <string>;
+import <vector>;
+
 //import Bench.SphereBench;
 //import Bench.PlaneBench;
 import Bench.AxisAlignedBoxBench;
+import Bench.BoundingBoxHierarchyBench;
 import Bench.Matrix3x3Bench;
 import Bench.Matrix4x4Bench;
+import Bench.TriangleBench;
 
+using namespace Yart;
 using namespace Yart::Bench;
 
-int main()
+/// @brief Runs every bench. The arguments are scene files whose hierarchy statistics are printed, for example
+/// Yart.Engine\scene.yaml.
+int main(int argc, char* argv[])
 {
+    std::vector<std::string> sceneFilenames(argv + 1, argv + argc);
+
     //RunSphereBench();
     //RunPlaneBench();
     RunAxisAlignedBoxBench();
+    RunBoundingBoxHierarchyBench(sceneFilenames);
     RunMatrix3x3Bench();
     RunMatrix4x4Bench();
+    RunTriangleBench();
 }
\ No newline at end of file
@@ -0,0 +1,210 @@
+module;
+
+#include "nanobench.h"
+#include "Vcl.h"
+
+export module Bench.BoundingBoxHierarchyBench;
+
+import <cstdint>;
+import <cstdio>;
+import <filesystem>;
+import <random>;
+import <string>;
+
+import "Common.h";
+
+import Bench.Config;
+import BoundingBoxHierarchy;
+import BoundingBoxHierarchyStatistics;
+import IntersectableGeometry;
+import LinearBoundingBoxHierarchy;
+import Math;
+import QuantizedBoundingBoxHierarchy;
+import Ray;
+import Triangle;
+import YamlLoader;
+
+namespace Yart::Bench
+{
+    constexpr size_t BuildTriangleCount = 500000;
+    constexpr int BuildEpochs = 5;
+    constexpr size_t TraversalRayCount = 4096;
+
+    std::vector<Triangle> CreateRandomTriangles(size_t count)
+    {
+        std::mt19937 generator{1234};
+        std::uniform_real_distribution<real> positionDistribution{real{-100}, real{100}};
+        std::uniform_real_distribution<real> offsetDistribution{real{-1}, real{1}};
+
+        std::vector<Triangle> triangles{};
+        triangles.reserve(count);
+
+        for (size_t i = 0; i < count; i++)
+        {
+            Vector3 center{positionDistribution(generator), positionDistribution(generator), positionDistribution(generator)};
+
+            triangles.emplace_back(
+                center + Vector3{offsetDistribution(generator), offsetDistribution(generator), offsetDistribution(generator)},
+                center + Vector3{offsetDistribution(generator), offsetDistribution(generator), offsetDistribution(generator)},
+                center + Vector3{offsetDistribution(generator), offsetDistribution(generator), offsetDistribution(generator)},
+                nullptr);
+        }
+
+        return triangles;
+    }
+
+    void RunBuildBench(const char* name, const BoundingBoxBuildParameters& parameters, const std::vector<const IntersectableGeometry*>& geometries)
+    {
+        ankerl::nanobench::Bench()
+            .epochs(BuildEpochs)
+            .epochIterations(1)
+            .run(name, [&]
+                {
+                    std::vector<const IntersectableGeometry*> inputGeometries{geometries};
+                    std::vector<std::shared_ptr<IntersectableGeometry>> geometryPointers{};
+
+                    auto hierarchy = BuildBoundingBoxHierarchy(parameters, inputGeometries, geometryPointers);
+                    ankerl::nanobench::doNotOptimizeAway(hierarchy);
+                });
+    }
+
+    std::vector<Ray> CreateRandomRays(size_t count)
+    {
+        std::mt19937 generator{5678};
+        std::uniform_real_distribution<real> positionDistribution{real{-100}, real{100}};
+        std::uniform_real_distribution<real> directionDistribution{real{-1}, real{1}};
+
+        std::vector<Ray> rays{};
+        rays.reserve(count);
+
+        for (size_t i = 0; i < count; i++)
+        {
+            Vector3 position{positionDistribution(generator), positionDistribution(generator), positionDistribution(generator)};
+            Vector3 direction{directionDistribution(generator), directionDistribution(generator), directionDistribution(generator)};
+
+            rays.emplace_back(position, direction.Normalize());
+        }
+
+        return rays;
+    }
+
+    size_t CountBoundingBoxHierarchyNodes(const BoundingBoxHierarchy* hierarchy)
+    {
+        size_t count = 1;
+
+        for (size_t i = 0; i < BoundingBoxHierarchy::NumberOfLeafs; i++)
+        {
+            if (auto childHierarchy = dynamic_cast<const BoundingBoxHierarchy*>(hierarchy->GetChild(i)))
+            {
+                count += CountBoundingBoxHierarchyNodes(childHierarchy);
+            }
+        }
+
+        return count;
+    }
+
+    void RunTraversalBench(const char* name, const IntersectableGeometry* hierarchy, size_t memoryUsage, size_t triangleCount, const std::vector<Ray>& rays)
+    {
+        std::printf("%s: %.2f bytes per triangle\n", name, static_cast<double>(memoryUsage) / static_cast<double>(triangleCount));
+
+        ankerl::nanobench::Bench()
+            .batch(rays.size())
+            .unit("ray")
+            .run(name, [&]
+                {
+                    for (const auto& ray : rays)
+                    {
+                        auto result = hierarchy->IntersectEntrance(ray);
+                        ankerl::nanobench::doNotOptimizeAway(result);
+                    }
+                });
+    }
+
+    void RunTraversalBenches(const std::vector<const IntersectableGeometry*>& geometries)
+    {
+        BoundingBoxBuildParameters parameters{};
+        parameters.Strategy = BoundingBoxBuildStrategy::BinnedSah;
+
+        std::vector<const IntersectableGeometry*> inputGeometries{geometries};
+        std::vector<std::shared_ptr<IntersectableGeometry>> geometryPointers{};
+
+        auto hierarchy = BuildBoundingBoxHierarchy(parameters, inputGeometries, geometryPointers);
+
+        LinearBoundingBoxHierarchy linearHierarchy{hierarchy};
+        QuantizedBoundingBoxHierarchy quantizedHierarchy{hierarchy};
+        QuantizedBoundingBoxHierarchyT<real, std::uint16_t> quantized16Hierarchy{hierarchy};
+
+        std::vector<Ray> rays = CreateRandomRays(TraversalRayCount);
+
+        // Only the nodes are counted, the SOA leafs are shared by every layout.
+        RunTraversalBench("BoundingBoxHierarchy.IntersectEntrance(Ray)", hierarchy, CountBoundingBoxHierarchyNodes(hierarchy) * sizeof(BoundingBoxHierarchy), geometries.size(), rays);
+        RunTraversalBench("LinearBoundingBoxHierarchy.IntersectEntrance(Ray)", &linearHierarchy, linearHierarchy.CalculateMemoryUsage(), geometries.size(), rays);
+        RunTraversalBench("QuantizedBoundingBoxHierarchy<uint8>.IntersectEntrance(Ray)", &quantizedHierarchy, quantizedHierarchy.CalculateMemoryUsage(), geometries.size(), rays);
+        RunTraversalBench("QuantizedBoundingBoxHierarchy<uint16>.IntersectEntrance(Ray)", &quantized16Hierarchy, quantized16Hierarchy.CalculateMemoryUsage(), geometries.size(), rays);
+
+        std::printf("%s", CalculateBoundingBoxHierarchyStatistics(hierarchy, parameters).Format("BinnedSah, BoundingBoxHierarchy").c_str());
+        std::printf("%s", CalculateBoundingBoxHierarchyStatistics(&linearHierarchy, parameters).Format("BinnedSah, LinearBoundingBoxHierarchy").c_str());
+        std::printf("%s", CalculateBoundingBoxHierarchyStatistics(&quantizedHierarchy, parameters).Format("BinnedSah, QuantizedBoundingBoxHierarchy<uint8>").c_str());
+        std::printf("%s", CalculateBoundingBoxHierarchyStatistics(&quantized16Hierarchy, parameters).Format("BinnedSah, QuantizedBoundingBoxHierarchy<uint16>").c_str());
+    }
+
+    /// @brief Prints the statistics of every hierarchy in the given scenes. Paths inside a scene, such as those of obj
+    /// files, are relative to the working directory, so the bench has to be started from the directory they were written
+    /// for.
+    void PrintSceneStatistics(const std::vector<std::string>& sceneFilenames)
+    {
+        if (sceneFilenames.empty())
+        {
+            std::printf("No scene files given, pass them as arguments to print the statistics of their hierarchies.\n");
+        }
+
+        for (const std::string& filename : sceneFilenames)
+        {
+            if (!std::filesystem::exists(filename))
+            {
+                std::printf("%s: not found, skipped\n", filename.c_str());
+                continue;
+            }
+
+            auto yamlData = Yaml::LoadYaml(filename);
+
+            for (const auto& hierarchyReport : yamlData->GeometryData->HierarchyReports)
+            {
+                auto statistics = CalculateBoundingBoxHierarchyStatistics(hierarchyReport.Root, hierarchyReport.Parameters);
+                std::printf("%s: %s", filename.c_str(), statistics.Format(hierarchyReport.Name).c_str());
+            }
+        }
+    }
+
+    /// @brief Benchmarks building and traversing hierarchies over random triangles, then prints the statistics of the
+    /// hierarchies in sceneFilenames.
+    export void RunBoundingBoxHierarchyBench(const std::vector<std::string>& sceneFilenames)
+    {
+        std::vector<Triangle> triangles = CreateRandomTriangles(BuildTriangleCount);
+
+        std::vector<const IntersectableGeometry*> geometries{};
+        geometries.reserve(triangles.size());
+
+        for (const auto& triangle : triangles)
+        {
+            geometries.push_back(&triangle);
+        }
+
+        BoundingBoxBuildParameters splitByLongAxisParameters{};
+        splitByLongAxisParameters.Strategy = BoundingBoxBuildStrategy::SplitByLongAxis;
+
+        BoundingBoxBuildParameters binnedSahParameters{};
+        binnedSahParameters.Strategy = BoundingBoxBuildStrategy::BinnedSah;
+        binnedSahParameters.ParallelSubtreeSize = 0;
+
+        BoundingBoxBuildParameters parallelBinnedSahParameters{};
+        parallelBinnedSahParameters.Strategy = BoundingBoxBuildStrategy::BinnedSah;
+
+        RunBuildBench("BuildBoundingBoxHierarchy(SplitByLongAxis)", splitByLongAxisParameters, geometries);
+        RunBuildBench("BuildBoundingBoxHierarchy(BinnedSah, single threaded)", binnedSahParameters, geometries);
+        RunBuildBench("BuildBoundingBoxHierarchy(BinnedSah, parallel)", parallelBinnedSahParameters, geometries);
+
+        RunTraversalBenches(geometries);
+        PrintSceneStatistics(sceneFilenames);
+    }
+}
\ No newline at end of file
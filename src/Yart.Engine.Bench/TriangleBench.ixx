@@ -0,0 +1,141 @@
+module;
+
+#include "nanobench.h"
+#include "Vcl.h"
+
+export module Bench.TriangleBench;
+
+import <format>;
+import <random>;
+
+import "Common.h";
+
+import Bench.Config;
+import GeometrySoa;
+import Math;
+import Ray;
+import Triangle;
+import TriangleSoa;
+
+namespace Yart::Bench
+{
+    constexpr size_t TriangleRayCount = 4096;
+    constexpr size_t SharedEdgeRayCount = 1000000;
+
+    std::vector<Ray> CreateTriangleRays(size_t count)
+    {
+        std::mt19937 generator{4321};
+        std::uniform_real_distribution<real> targetDistribution{real{-12}, real{12}};
+
+        std::vector<Ray> rays{};
+        rays.reserve(count);
+
+        // Roughly half of the rays hit one of the triangles.
+        for (size_t i = 0; i < count; i++)
+        {
+            Vector3 target{targetDistribution(generator), targetDistribution(generator), real{10}};
+            rays.emplace_back(Vector3{0, 0, 0}, target.Normalize());
+        }
+
+        return rays;
+    }
+
+    template <TriangleIntersectionKernel Kernel, SoaSize Size = SoaSize::_256>
+    void RunTriangleSoaBench(const char* name, const std::vector<Triangle>& triangles, const std::vector<Ray>& rays)
+    {
+        TriangleSoa<Size, Kernel> triangleSoa{};
+
+        for (size_t i = 0; i < triangles.size() && i < triangleSoa.Elements; i++)
+        {
+            triangleSoa.Insert(i, &triangles[i]);
+        }
+
+        ankerl::nanobench::Bench()
+            .batch(rays.size())
+            .unit("ray")
+            .run(name, [&]
+                {
+                    for (const auto& ray : rays)
+                    {
+                        auto result = triangleSoa.IntersectEntrance(ray);
+                        ankerl::nanobench::doNotOptimizeAway(result);
+                    }
+                });
+    }
+
+    /// @brief Times rays that aim straight at the edge shared by two triangles. The name of the result reports how many
+    /// of them pass between the triangles.
+    template <TriangleIntersectionKernel Kernel>
+    void RunSharedEdgeBench(const char* name)
+    {
+        Triangle lower{Vector3{-1, -1, 5}, Vector3{1, -1, 5}, Vector3{1, 1, 5}, nullptr};
+        Triangle upper{Vector3{-1, -1, 5}, Vector3{1, 1, 5}, Vector3{-1, 1, 5}, nullptr};
+
+        TriangleSoa<SoaSize::_256, Kernel> triangleSoa{&lower, &upper};
+
+        std::mt19937 generator{8765};
+        std::uniform_real_distribution<real> edgeDistribution{real{-0.99}, real{0.99}};
+        std::uniform_real_distribution<real> originDistribution{real{-3}, real{3}};
+
+        std::vector<Ray> rays{};
+        rays.reserve(SharedEdgeRayCount);
+
+        for (size_t i = 0; i < SharedEdgeRayCount; i++)
+        {
+            real edgePosition = edgeDistribution(generator);
+
+            Vector3 origin{originDistribution(generator), originDistribution(generator), real{0}};
+            Vector3 target{edgePosition, edgePosition, real{5}};
+
+            rays.emplace_back(origin, (target - origin).Normalize());
+        }
+
+        size_t misses = 0;
+
+        for (const auto& ray : rays)
+        {
+            if (triangleSoa.IntersectEntrance(ray).HitDistance == std::numeric_limits<real>::infinity())
+            {
+                misses++;
+            }
+        }
+
+        ankerl::nanobench::Bench()
+            .title("Rays aimed at a shared edge")
+            .batch(rays.size())
+            .unit("ray")
+            .run(std::format("{}: {} of {} missed both triangles", name, misses, rays.size()), [&]
+                {
+                    for (const auto& ray : rays)
+                    {
+                        auto result = triangleSoa.IntersectEntrance(ray);
+                        ankerl::nanobench::doNotOptimizeAway(result);
+                    }
+                });
+    }
+
+    export void RunTriangleBench()
+    {
+        std::vector<Triangle> triangles{
+            Triangle{Vector3{-9, -9, 10}, Vector3{-3, -9, 10}, Vector3{-9, -3, 10}, nullptr},
+            Triangle{Vector3{3, -9, 10}, Vector3{9, -9, 11}, Vector3{9, -3, 10}, nullptr},
+            Triangle{Vector3{-9, 3, 11}, Vector3{-3, 9, 10}, Vector3{-9, 9, 10}, nullptr},
+            Triangle{Vector3{3, 3, 10}, Vector3{9, 3, 10}, Vector3{3, 9, 12}, nullptr},
+            Triangle{Vector3{-2, -2, 9}, Vector3{2, -2, 9}, Vector3{0, 2, 9}, nullptr},
+            Triangle{Vector3{-6, 0, 10}, Vector3{-2, 0, 10}, Vector3{-4, 2, 10}, nullptr},
+            Triangle{Vector3{2, 0, 10}, Vector3{6, 0, 10}, Vector3{4, 2, 10}, nullptr},
+            Triangle{Vector3{-2, -8, 10}, Vector3{2, -8, 10}, Vector3{0, -4, 10}, nullptr},
+        };
+
+        std::vector<Ray> rays = CreateTriangleRays(TriangleRayCount);
+
+        RunTriangleSoaBench<TriangleIntersectionKernel::MollerTrumbore>("TriangleSoa<MollerTrumbore>.IntersectEntrance(Ray)", triangles, rays);
+        RunTriangleSoaBench<TriangleIntersectionKernel::PrecomputedEdges>("TriangleSoa<PrecomputedEdges>.IntersectEntrance(Ray)", triangles, rays);
+        RunTriangleSoaBench<TriangleIntersectionKernel::Watertight>("TriangleSoa<Watertight>.IntersectEntrance(Ray)", triangles, rays);
+        RunTriangleSoaBench<TriangleIntersectionKernel::Watertight, SoaSize::_512>("TriangleSoa<_512, Watertight>.IntersectEntrance(Ray)", triangles, rays);
+
+        RunSharedEdgeBench<TriangleIntersectionKernel::MollerTrumbore>("TriangleSoa<MollerTrumbore>");
+        RunSharedEdgeBench<TriangleIntersectionKernel::PrecomputedEdges>("TriangleSoa<PrecomputedEdges>");
+        RunSharedEdgeBench<TriangleIntersectionKernel::Watertight>("TriangleSoa<Watertight>");
+    }
+}
\ No newline at end of file
@@ -0,0 +1,91 @@
+#include "pch.h"
+
+import <span>;
+import <vector>;
+
+import AdaptiveSampling;
+import Math;
+
+using namespace Yart;
+
+namespace
+{
+    AdaptiveSamplingParameters CreateAdaptiveParameters()
+    {
+        return AdaptiveSamplingParameters{
+            .Iterations = 8,
+            .Enabled = true,
+            .ErrorThreshold = real{0.01},
+            .MinimumIterations = 2,
+            .MaximumIterations = 16,
+        };
+    }
+}
+
+TEST(AdaptiveSamplingTests, ConstantPixel_SampleAdaptively_StopsAtMinimumIterations)
+{
+    // Arrange
+    std::vector<PixelEstimate> estimates(1);
+    AdaptiveSamplingParameters parameters = CreateAdaptiveParameters();
+
+    // Act
+    SampleAdaptively(estimates, parameters, [&](std::span<const std::uint32_t> activePixels)
+    {
+        for (std::uint32_t pixelIndex : activePixels)
+        {
+            estimates[pixelIndex].Add(Color3{real{0.5}, real{0.5}, real{0.5}});
+        }
+    });
+
+    // Assert
+    EXPECT_EQ(estimates[0].Count, parameters.MinimumIterations);
+    EXPECT_TRUE(estimates[0].HasConverged(parameters.ErrorThreshold));
+    EXPECT_NEAR(estimates[0].GetMean().R, 0.5, 0.0001);
+}
+
+TEST(AdaptiveSamplingTests, NoisyPixelAmongConstantPixels_SampleAdaptively_ReceivesMaximumIterations)
+{
+    // Arrange
+    std::vector<PixelEstimate> estimates(4);
+    AdaptiveSamplingParameters parameters = CreateAdaptiveParameters();
+
+    constexpr std::uint32_t noisyPixelIndex = 3;
+
+    // Act
+    SampleAdaptively(estimates, parameters, [&](std::span<const std::uint32_t> activePixels)
+    {
+        for (std::uint32_t pixelIndex : activePixels)
+        {
+            // The noisy pixel alternates between black and white and never converges.
+            bool isWhite = pixelIndex != noisyPixelIndex || estimates[pixelIndex].Count % 2 == 0;
+            estimates[pixelIndex].Add(isWhite ? Color3{1, 1, 1} : Color3{});
+        }
+    });
+
+    // Assert
+    for (std::uint32_t i = 0; i < noisyPixelIndex; i++)
+    {
+        EXPECT_EQ(estimates[i].Count, parameters.MinimumIterations);
+    }
+
+    EXPECT_EQ(estimates[noisyPixelIndex].Count, parameters.MaximumIterations);
+    EXPECT_FALSE(estimates[noisyPixelIndex].HasConverged(parameters.ErrorThreshold));
+    EXPECT_NEAR(estimates[noisyPixelIndex].GetMean().R, 0.5, 0.0001);
+}
+
+TEST(AdaptiveSamplingTests, LargeConstantLuminance_Add_HasNoVariance)
+{
+    // Arrange
+    PixelEstimate estimate{};
+
+    // Act
+    for (int i = 0; i < 1000; i++)
+    {
+        estimate.Add(Color3{real{10000.1}, real{10000.1}, real{10000.1}});
+    }
+
+    // Assert
+    EXPECT_NEAR(estimate.LuminanceMean, 10000.1, 0.01);
+    EXPECT_GE(estimate.LuminanceSquaredDeviationSum, 0);
+    EXPECT_TRUE(estimate.HasConverged(real{1e-6}));
+}
\ No newline at end of file
@@ -0,0 +1,58 @@
+#include "pch.h"
+
+import <vector>;
+
+import AliasTable;
+import Math;
+import Random;
+
+using namespace Yart;
+
+TEST(AliasTableTests, WeightedTable_ManySamples_FrequenciesMatchProbabilities)
+{
+    // Arrange
+    AliasTable aliasTable{{1, 0, 3, 6, 0.5, 9.5}};
+    Random random{};
+
+    constexpr int sampleCount = 200000;
+    std::vector<int> counts(aliasTable.GetSize());
+
+    // Act
+    for (int i = 0; i < sampleCount; i++)
+    {
+        counts[aliasTable.Sample(random)]++;
+    }
+
+    // Assert
+    EXPECT_NEAR(aliasTable.GetProbability(0), 0.05, 0.0001);
+    EXPECT_EQ(aliasTable.GetProbability(1), 0);
+    EXPECT_EQ(counts[1], 0);
+
+    for (size_t i = 0; i < counts.size(); i++)
+    {
+        EXPECT_NEAR(static_cast<double>(counts[i]) / sampleCount, aliasTable.GetProbability(i), 0.005);
+    }
+}
+
+TEST(AliasTableTests, ZeroWeights_ManySamples_FallsBackToUniform)
+{
+    // Arrange
+    AliasTable aliasTable{{0, 0, 0, 0}};
+    Random random{};
+
+    constexpr int sampleCount = 100000;
+    std::vector<int> counts(aliasTable.GetSize());
+
+    // Act
+    for (int i = 0; i < sampleCount; i++)
+    {
+        counts[aliasTable.Sample(random)]++;
+    }
+
+    // Assert
+    for (size_t i = 0; i < counts.size(); i++)
+    {
+        EXPECT_NEAR(aliasTable.GetProbability(i), 0.25, 0.0001);
+        EXPECT_NEAR(static_cast<double>(counts[i]) / sampleCount, 0.25, 0.01);
+    }
+}
\ No newline at end of file
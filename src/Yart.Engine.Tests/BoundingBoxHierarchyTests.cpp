@@ -0,0 +1,75 @@
+#include "pch.h"
+
+import <cmath>;
+import <memory>;
+import <vector>;
+
+import BoundingBoxHierarchy;
+import IntersectableGeometry;
+import IntersectionResult;
+import Math;
+import Ray;
+import Sphere;
+
+using namespace Yart;
+
+namespace
+{
+    /// @brief Builds the same spheres on the calling thread and as parallel subtrees and compares the hierarchies by their
+    /// SAH cost, the number of geometries the builders created and the hits of a fan of rays.
+    void ExpectParallelBuildMatchesSerialBuild(BoundingBoxBuildStrategy strategy)
+    {
+        std::vector<std::shared_ptr<Sphere>> spheres{};
+        std::vector<const IntersectableGeometry*> geometries{};
+
+        for (int i = 0; i < 4096; i++)
+        {
+            // Deterministic but irregular positions on a wavy sheet.
+            real x = static_cast<real>(i % 64);
+            real y = static_cast<real>(i / 64);
+
+            spheres.push_back(std::make_shared<Sphere>(Vector3{x, y, std::sin(x * real{0.3}) + std::cos(y * real{0.7})}, real{0.4}, nullptr));
+            geometries.push_back(spheres.back().get());
+        }
+
+        BoundingBoxBuildParameters serialParameters{};
+        serialParameters.Strategy = strategy;
+        serialParameters.ParallelSubtreeSize = 0;
+
+        BoundingBoxBuildParameters parallelParameters = serialParameters;
+        parallelParameters.ParallelSubtreeSize = 64;
+        parallelParameters.ParallelDepth = 3;
+
+        std::vector<const IntersectableGeometry*> serialGeometries = geometries;
+        std::vector<std::shared_ptr<IntersectableGeometry>> serialPointers{};
+        auto serialHierarchy = BuildBoundingBoxHierarchy(serialParameters, serialGeometries, serialPointers);
+
+        std::vector<const IntersectableGeometry*> parallelGeometries = geometries;
+        std::vector<std::shared_ptr<IntersectableGeometry>> parallelPointers{};
+        auto parallelHierarchy = BuildBoundingBoxHierarchy(parallelParameters, parallelGeometries, parallelPointers);
+
+        EXPECT_EQ(CalculateSahCost(serialHierarchy, serialParameters), CalculateSahCost(parallelHierarchy, parallelParameters));
+        EXPECT_EQ(serialPointers.size(), parallelPointers.size());
+
+        for (int i = 0; i < 256; i++)
+        {
+            Ray ray{Vector3{static_cast<real>(i % 16) * real{4.0}, static_cast<real>(i / 16) * real{4.0}, real{10.0}}, Vector3{real{0.05}, real{0.02}, real{-1.0}}.Normalize()};
+
+            IntersectionResult serialResult = serialHierarchy->IntersectEntrance(ray);
+            IntersectionResult parallelResult = parallelHierarchy->IntersectEntrance(ray);
+
+            EXPECT_EQ(serialResult.HitDistance, parallelResult.HitDistance);
+            EXPECT_EQ(serialResult.HitGeometry, parallelResult.HitGeometry);
+        }
+    }
+}
+
+TEST(BoundingBoxHierarchyBuildTests, SplitByLongAxis_ParallelSubtrees_MatchesSerialBuild)
+{
+    ExpectParallelBuildMatchesSerialBuild(BoundingBoxBuildStrategy::SplitByLongAxis);
+}
+
+TEST(BoundingBoxHierarchyBuildTests, BinnedSah_ParallelSubtrees_MatchesSerialBuild)
+{
+    ExpectParallelBuildMatchesSerialBuild(BoundingBoxBuildStrategy::BinnedSah);
+}
\ No newline at end of file
@@ -0,0 +1,130 @@
+#include "pch.h"
+
+import <limits>;
+
+import Disc;
+import DiscSoa;
+import GeometrySoa;
+import IntersectionResult;
+import Math;
+import Ray;
+
+using namespace Yart;
+
+TEST(DiscSoaIntersectionTests, OneDisc_RayInFrontOfGeometry_Intersects_ReturnsNearestIntersection)
+{
+    // Arrange
+    Disc disc1{{10, 0, 0}, {-1, 0, 0}, 2, nullptr};
+    Ray ray{{2, 0, 0}, {1, 0, 0}};
+
+    DiscSoa<SoaSize::_256> discSoa{};
+    discSoa.Insert(0, &disc1);
+
+    // Act
+    IntersectionResult result = discSoa.IntersectEntrance(ray);
+
+    // Assert
+    EXPECT_NEAR(result.HitDistance, 8, 0.01f);
+    EXPECT_EQ(result.HitGeometry, &disc1);
+}
+
+TEST(DiscSoaIntersectionTests, OneDisc_RayInFrontOfGeometryAndPointingBackwards_Misses_ReturnsInfinity)
+{
+    // Arrange
+    Disc disc1{{10, 0, 0}, {-1, 0, 0}, 2, nullptr};
+    Ray ray{{2, 0, 0}, {-1, 0, 0}};
+
+    DiscSoa<SoaSize::_256> discSoa{};
+    discSoa.Insert(0, &disc1);
+
+    // Act
+    IntersectionResult result = discSoa.IntersectEntrance(ray);
+
+    // Assert
+    EXPECT_EQ(result.HitDistance, std::numeric_limits<real>::infinity());
+}
+
+TEST(DiscSoaIntersectionTests, OneDisc_RayOutsideRadius_Misses_ReturnsInfinity)
+{
+    // Arrange
+    Disc disc1{{10, 0, 0}, {-1, 0, 0}, 2, nullptr};
+    Ray ray{{2, 3, 0}, {1, 0, 0}};
+
+    DiscSoa<SoaSize::_256> discSoa{};
+    discSoa.Insert(0, &disc1);
+
+    // Act
+    IntersectionResult result = discSoa.IntersectEntrance(ray);
+
+    // Assert
+    EXPECT_EQ(result.HitDistance, std::numeric_limits<real>::infinity());
+}
+
+TEST(DiscSoaIntersectionTests, OneDisc_RayParallelToGeometry_Misses_ReturnsInfinity)
+{
+    // Arrange
+    Disc disc1{{10, 0, 0}, {-1, 0, 0}, 2, nullptr};
+    Ray ray{{2, 0, 0}, {0, 1, 0}};
+
+    DiscSoa<SoaSize::_256> discSoa{};
+    discSoa.Insert(0, &disc1);
+
+    // Act
+    IntersectionResult result = discSoa.IntersectEntrance(ray);
+
+    // Assert
+    EXPECT_EQ(result.HitDistance, std::numeric_limits<real>::infinity());
+}
+
+TEST(DiscSoaIntersectionTests, FullSoa_RayInFrontOfGeometries_Intersects_ReturnsNearestIntersection)
+{
+    // Arrange
+    Disc discs[8]{
+        {{12, 0, 0}, {-1, 0, 0}, 2, nullptr},
+        {{14, 0, 0}, {-1, 0, 0}, 2, nullptr},
+        {{16, 0, 0}, {-1, 0, 0}, 2, nullptr},
+        {{10, 0, 0}, {-1, 0, 0}, 2, nullptr}, // This is the disc that will be hit.
+        {{18, 0, 0}, {-1, 0, 0}, 2, nullptr},
+        {{20, 0, 0}, {-1, 0, 0}, 2, nullptr},
+        {{22, 0, 0}, {-1, 0, 0}, 2, nullptr},
+        {{24, 0, 0}, {-1, 0, 0}, 2, nullptr},
+    };
+
+    DiscSoa<SoaSize::_256> discSoa{};
+
+    // Without AVX-512 the SOA holds fewer than eight discs, so insert the hit disc first.
+    discSoa.Insert(0, &discs[3]);
+
+    for (size_t i = 1; i < discSoa.GetCapacity() && i < 8; i++)
+    {
+        discSoa.Insert(i, &discs[i == 3 ? 0 : i]);
+    }
+
+    Ray ray{{2, 0, 0}, {1, 0, 0}};
+
+    // Act
+    IntersectionResult result = discSoa.IntersectEntrance(ray);
+
+    // Assert
+    EXPECT_NEAR(result.HitDistance, 8, 0.01f);
+    EXPECT_EQ(result.HitGeometry, &discs[3]);
+}
+
+TEST(DiscSoaIntersectionTests, FullSoa_RayInFrontOfGeometries_Intersects_ReturnsOriginalDisc)
+{
+    // Arrange
+    Disc disc1{{10, 0, 0}, {-1, 0, 0}, 2, nullptr};
+    Disc disc2{{10, 5, 0}, {-1, 0, 0}, 2, nullptr};
+
+    DiscSoa<SoaSize::_256> discSoa{&disc1, &disc2};
+
+    Ray ray{{2, 5, 0}, {1, 0, 0}};
+
+    // Act
+    IntersectionResult result = discSoa.IntersectEntrance(ray);
+
+    // Assert
+    EXPECT_EQ(result.HitGeometry, &disc2);
+    EXPECT_EQ(discSoa.GetGeometry(0), &disc1);
+    EXPECT_EQ(discSoa.GetGeometry(1), &disc2);
+}
\ No newline at end of file
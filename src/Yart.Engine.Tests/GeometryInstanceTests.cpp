@@ -0,0 +1,38 @@
+#include "pch.h"
+
+import GeometryInstance;
+import IntersectionResult;
+import Math;
+import Ray;
+import Sphere;
+
+using namespace Yart;
+
+TEST(GeometryInstanceTests, TranslatedSphere_InstancedGeometryIntersectExit_MatchesSphereInWorldSpace)
+{
+    // Arrange
+    Sphere objectSphere{{0, 0, 0}, 2, nullptr};
+    Sphere worldSphere{{10, 0, 0}, 2, nullptr};
+
+    GeometryInstance instance{&objectSphere, Matrix4x4::CreateTranslation(10, 0, 0)};
+    InstancedGeometry instancedGeometry{&instance, &objectSphere};
+
+    // A refraction ray leaving from inside of the sphere, which a material traces in world space.
+    Ray ray{{10.5, 0.5, 0}, {1, 0, 0}};
+
+    // Act
+    IntersectionResult result = instancedGeometry.IntersectExit(ray);
+    IntersectionResult expectedResult = worldSphere.IntersectExit(ray);
+
+    Vector3 hitPosition = ray.Position + result.HitDistance * ray.Direction;
+    Vector3 normal = instancedGeometry.CalculateNormal(ray, hitPosition, result.AdditionalData, result.PrimitiveIndex);
+    Vector3 expectedNormal = worldSphere.CalculateNormal(ray, hitPosition, expectedResult.AdditionalData, expectedResult.PrimitiveIndex);
+
+    // Assert
+    EXPECT_NEAR(result.HitDistance, expectedResult.HitDistance, 0.01);
+    EXPECT_EQ(result.Instance, &instance);
+
+    EXPECT_NEAR(normal.X, expectedNormal.X, 0.01);
+    EXPECT_NEAR(normal.Y, expectedNormal.Y, 0.01);
+    EXPECT_NEAR(normal.Z, expectedNormal.Z, 0.01);
+}
\ No newline at end of file
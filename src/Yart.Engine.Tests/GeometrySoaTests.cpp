@@ -0,0 +1,79 @@
+#include "pch.h"
+
+import <algorithm>;
+import <vector>;
+
+import GeometrySoa;
+import IntersectableGeometry;
+import Math;
+import Plane;
+import Sphere;
+
+using namespace Yart;
+
+TEST(GeometrySoaTests, ScatteredSpheres_SortByMortonCode_KeepsEveryGeometryExactlyOnce)
+{
+    // Arrange
+    std::vector<Sphere> spheres{};
+    spheres.reserve(1000);
+
+    for (int i = 0; i < 1000; i++)
+    {
+        // Several spheres share a center, so their Morton codes are equal.
+        int cell = i % 700;
+        spheres.emplace_back(Vector3{static_cast<real>(cell % 10), static_cast<real>(cell / 10 % 10), static_cast<real>(cell / 100)}, real{0.5}, nullptr);
+    }
+
+    std::vector<const Sphere*> geometries{};
+
+    for (const Sphere& sphere : spheres)
+    {
+        geometries.push_back(&sphere);
+    }
+
+    std::vector<const Sphere*> expectedGeometries{geometries};
+
+    // Act
+    SortByMortonCode(geometries);
+
+    // Assert
+    ASSERT_EQ(geometries.size(), expectedGeometries.size());
+    EXPECT_NE(geometries, expectedGeometries);
+
+    std::sort(geometries.begin(), geometries.end());
+    std::sort(expectedGeometries.begin(), expectedGeometries.end());
+
+    EXPECT_EQ(geometries, expectedGeometries);
+}
+
+TEST(GeometrySoaTests, UnboundedGeometries_SortByMortonCode_MovesThemToTheEndInOrder)
+{
+    // Arrange
+    Sphere sphere1{{4, 4, 4}, 1, nullptr};
+    Sphere sphere2{{0, 0, 0}, 1, nullptr};
+    Plane plane1{{0, 1, 0}, 0, nullptr};
+    Plane plane2{{1, 0, 0}, 0, nullptr};
+
+    std::vector<const IntersectableGeometry*> geometries{&plane1, &sphere1, &plane2, &sphere2};
+
+    // Act
+    SortByMortonCode(geometries);
+
+    // Assert
+    std::vector<const IntersectableGeometry*> expectedGeometries{&sphere2, &sphere1, &plane1, &plane2};
+    EXPECT_EQ(geometries, expectedGeometries);
+}
+
+TEST(GeometrySoaTests, SingleGeometry_SortByMortonCode_KeepsIt)
+{
+    // Arrange
+    Sphere sphere1{{4, 4, 4}, 1, nullptr};
+    std::vector<const Sphere*> geometries{&sphere1};
+
+    // Act
+    SortByMortonCode(geometries);
+
+    // Assert
+    ASSERT_EQ(geometries.size(), 1);
+    EXPECT_EQ(geometries[0], &sphere1);
+}
\ No newline at end of file
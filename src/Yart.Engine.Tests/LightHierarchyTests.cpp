@@ -0,0 +1,80 @@
+#include "pch.h"
+
+import <vector>;
+
+import AreaLight;
+import Disc;
+import LightHierarchy;
+import Math;
+import Random;
+
+using namespace Yart;
+
+TEST(LightHierarchyTests, SixLights_ManySamples_FrequenciesMatchProbabilities)
+{
+    // Arrange
+    Disc disc1{{-4, 5, 0}, {0, -1, 0}, 1, nullptr};
+    Disc disc2{{-2, 5, 1}, {0, -1, 0}, 1, nullptr};
+    Disc disc3{{0, 6, -1}, Vector3{1, -1, 0}.Normalize(), 0.5, nullptr};
+    Disc disc4{{2, 4, 2}, {0, -1, 0}, 2, nullptr};
+    Disc disc5{{5, 5, 0}, {-1, 0, 0}, 1, nullptr};
+    Disc disc6{{8, 2, -3}, {0, 0, 1}, 1, nullptr};
+
+    LightHierarchy lightHierarchy{{&disc1, &disc2, &disc3, &disc4, &disc5, &disc6}, {1, 4, 2, 8, 3, 5}};
+    Random random{};
+    Vector3 position{0, 0, 0};
+
+    constexpr int sampleCount = 200000;
+    std::vector<int> counts(6);
+
+    // Act
+    for (int i = 0; i < sampleCount; i++)
+    {
+        size_t lightIndex{};
+        real probability{};
+
+        ASSERT_TRUE(lightHierarchy.Sample(random, position, lightIndex, probability));
+        ASSERT_NEAR(probability, lightHierarchy.CalculateProbability(lightIndex, position), 0.0001);
+
+        counts[lightIndex]++;
+    }
+
+    // Assert
+    real totalProbability{};
+
+    for (size_t i = 0; i < counts.size(); i++)
+    {
+        real probability = lightHierarchy.CalculateProbability(i, position);
+        totalProbability += probability;
+
+        EXPECT_NEAR(static_cast<double>(counts[i]) / sampleCount, probability, 0.005);
+    }
+
+    EXPECT_NEAR(totalProbability, 1, 0.0001);
+}
+
+TEST(LightHierarchyTests, TwoLights_CalculateProbability_MatchesHandComputedImportances)
+{
+    // Arrange
+    Disc facingDisc{{0, 4, 0}, {0, -1, 0}, 1, nullptr};
+    Disc edgeOnDisc{{6, 0, 0}, {0, -1, 0}, 1, nullptr};
+
+    LightHierarchy lightHierarchy{{&facingDisc, &edgeOnDisc}, {2, 8}};
+    Vector3 position{0, 0, 0};
+
+    // The bounds of both discs are cubes with a squared half diagonal of 3. The facing disc is straight above the
+    // position, so its importance is its power over its squared distance. The edge on disc's axis is perpendicular to
+    // the position, its bounds cover an angle of asin(sqrt(3 / 36)), which leaves a cosine of sqrt(3 / 36).
+    real facingImportance = real{2.0} / real{16.0};
+    real edgeOnImportance = real{8.0} * Math::sqrt(real{3.0} / real{36.0}) / real{36.0};
+    real totalImportance = facingImportance + edgeOnImportance;
+
+    // Act
+    real facingProbability = lightHierarchy.CalculateProbability(0, position);
+    real edgeOnProbability = lightHierarchy.CalculateProbability(1, position);
+
+    // Assert
+    EXPECT_NEAR(facingProbability, facingImportance / totalImportance, 0.0001);
+    EXPECT_NEAR(edgeOnProbability, edgeOnImportance / totalImportance, 0.0001);
+    EXPECT_NEAR(facingProbability, 0.66085, 0.0001);
+}
\ No newline at end of file
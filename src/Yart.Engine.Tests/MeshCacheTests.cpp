@@ -0,0 +1,297 @@
+#include "pch.h"
+
+import <cmath>;
+import <cstdint>;
+import <filesystem>;
+import <fstream>;
+import <limits>;
+import <memory>;
+import <string>;
+import <vector>;
+
+import BoundingBoxHierarchy;
+import IntersectableGeometry;
+import IntersectionResult;
+import LinearBoundingBoxHierarchy;
+import Math;
+import MeshCache;
+import QuantizedBoundingBoxHierarchy;
+import Ray;
+import Triangle;
+
+using namespace Yart;
+
+namespace
+{
+    constexpr std::uint64_t TestKey = 0x0123456789ABCDEFull;
+
+    /// @brief A bumpy square of 2 * size * size triangles with tilted vertex normals.
+    std::vector<std::shared_ptr<Triangle>> CreateTriangles(int size)
+    {
+        std::vector<std::shared_ptr<Triangle>> triangles{};
+
+        auto vertex = [](int x, int y)
+        {
+            return Vector3{static_cast<real>(x), static_cast<real>(y), static_cast<real>(std::sin(x * 0.7) * std::cos(y * 0.4))};
+        };
+
+        auto normal = [](int x, int y)
+        {
+            return Vector3{static_cast<real>(std::cos(x * 0.7) * 0.3), static_cast<real>(std::sin(y * 0.4) * 0.3), real{1}}.Normalize();
+        };
+
+        for (int y = 0; y < size; y++)
+        {
+            for (int x = 0; x < size; x++)
+            {
+                triangles.push_back(std::make_shared<Triangle>(
+                    vertex(x, y), vertex(x + 1, y), vertex(x, y + 1),
+                    normal(x, y), normal(x + 1, y), normal(x, y + 1),
+                    nullptr));
+
+                triangles.push_back(std::make_shared<Triangle>(
+                    vertex(x + 1, y), vertex(x + 1, y + 1), vertex(x, y + 1),
+                    normal(x + 1, y), normal(x + 1, y + 1), normal(x, y + 1),
+                    nullptr));
+            }
+        }
+
+        return triangles;
+    }
+
+    /// @brief Builds a hierarchy of the given flattened type over the triangles and writes it to a cache file.
+    template <typename THierarchy>
+    bool SaveTestMeshCache(const std::string& filename, const std::vector<std::shared_ptr<Triangle>>& triangles, std::vector<std::shared_ptr<IntersectableGeometry>>& geometryPointers, const IntersectableGeometry*& root)
+    {
+        std::vector<const IntersectableGeometry*> inputGeometries{};
+        std::vector<const Triangle*> cachedTriangles{};
+
+        for (const auto& triangle : triangles)
+        {
+            inputGeometries.push_back(triangle.get());
+            cachedTriangles.push_back(triangle.get());
+        }
+
+        BoundingBoxBuildParameters parameters{};
+        auto hierarchy = BuildBoundingBoxHierarchy(parameters, inputGeometries, geometryPointers);
+
+        auto flattenedHierarchy = std::make_shared<THierarchy>(hierarchy);
+        geometryPointers.push_back(flattenedHierarchy);
+        root = flattenedHierarchy.get();
+
+        return SaveMeshCache(filename, TestKey, cachedTriangles, root, CalculateSahCost(hierarchy, parameters));
+    }
+
+    std::string GetTestFilename(const char* name)
+    {
+        return (std::filesystem::temp_directory_path() / name).string();
+    }
+
+    /// @brief Traces rays down onto the mesh, some of them past its edges, and counts those whose hit differs between the
+    /// built and the loaded hierarchy.
+    int CountMismatchedHits(const IntersectableGeometry* builtRoot, const IntersectableGeometry* loadedRoot, int size)
+    {
+        int mismatches = 0;
+
+        for (int y = -2; y < size * 4 + 2; y++)
+        {
+            for (int x = -2; x < size * 4 + 2; x++)
+            {
+                Ray ray{
+                    Vector3{static_cast<real>(x * 0.25 + 0.1), static_cast<real>(y * 0.25 + 0.05), real{5}},
+                    Vector3{static_cast<real>(std::sin(x * 0.3) * 0.2), static_cast<real>(std::cos(y * 0.3) * 0.2), real{-1}}.Normalize(),
+                };
+
+                IntersectionResult builtResult = builtRoot->IntersectEntrance(ray);
+                IntersectionResult loadedResult = loadedRoot->IntersectEntrance(ray);
+
+                if (builtResult.HitDistance == std::numeric_limits<real>::infinity() || loadedResult.HitDistance == std::numeric_limits<real>::infinity())
+                {
+                    mismatches += builtResult.HitDistance != loadedResult.HitDistance ? 1 : 0;
+                    continue;
+                }
+
+                // Lone triangles of the built hierarchy are tested on their own rather than with the SOA kernel the cached
+                // blocks use, so distances only agree up to rounding.
+                if (Math::abs(builtResult.HitDistance - loadedResult.HitDistance) > builtResult.HitDistance * real{0.0001})
+                {
+                    mismatches++;
+                    continue;
+                }
+
+                Vector3 hitPosition = ray.Position + ray.Direction * builtResult.HitDistance;
+
+                Vector3 builtNormal = builtResult.HitGeometry->CalculateNormal(ray, hitPosition, builtResult.AdditionalData, builtResult.PrimitiveIndex);
+                Vector3 loadedNormal = loadedResult.HitGeometry->CalculateNormal(ray, hitPosition, loadedResult.AdditionalData, loadedResult.PrimitiveIndex);
+
+                if ((builtNormal - loadedNormal).Length() > real{0.001} ||
+                    !loadedRoot->IntersectAny(ray, builtResult.HitDistance * real{1.01}) ||
+                    loadedRoot->IntersectAny(ray, builtResult.HitDistance * real{0.99}))
+                {
+                    mismatches++;
+                }
+            }
+        }
+
+        return mismatches;
+    }
+
+    template <typename THierarchy>
+    int CountRoundTripMismatches(const char* name)
+    {
+        std::string filename = GetTestFilename(name);
+        auto triangles = CreateTriangles(24);
+
+        std::vector<std::shared_ptr<IntersectableGeometry>> builtPointers{};
+        const IntersectableGeometry* builtRoot{};
+
+        if (!SaveTestMeshCache<THierarchy>(filename, triangles, builtPointers, builtRoot))
+        {
+            return -1;
+        }
+
+        int mismatches = -1;
+
+        {
+            // The loaded geometries keep the file mapped, they have to be gone before it can be removed.
+            std::vector<std::shared_ptr<IntersectableGeometry>> loadedPointers{};
+            auto [loadedRoot, sahCost] = LoadMeshCache(filename, TestKey, nullptr, loadedPointers);
+
+            if (loadedRoot)
+            {
+                mismatches = CountMismatchedHits(builtRoot, loadedRoot, 24);
+            }
+        }
+
+        std::filesystem::remove(filename);
+
+        return mismatches;
+    }
+
+    /// @brief Writes a cache, lets corrupt change the file and tries to load it again.
+    template <typename TCorrupt>
+    bool LoadsCorruptedMeshCache(const char* name, TCorrupt corrupt, std::vector<std::shared_ptr<IntersectableGeometry>>& loadedPointers)
+    {
+        std::string filename = GetTestFilename(name);
+        auto triangles = CreateTriangles(8);
+
+        std::vector<std::shared_ptr<IntersectableGeometry>> builtPointers{};
+        const IntersectableGeometry* builtRoot{};
+
+        if (!SaveTestMeshCache<LinearBoundingBoxHierarchy>(filename, triangles, builtPointers, builtRoot))
+        {
+            return true;
+        }
+
+        corrupt(filename);
+
+        auto [loadedRoot, sahCost] = LoadMeshCache(filename, TestKey, nullptr, loadedPointers);
+        bool isLoaded = loadedRoot != nullptr;
+
+        loadedPointers.clear();
+        std::filesystem::remove(filename);
+
+        return isLoaded;
+    }
+}
+
+TEST(MeshCacheTests, LinearHierarchy_SaveAndLoadMeshCache_HitsMatchBuiltHierarchy)
+{
+    // Act
+    int mismatches = CountRoundTripMismatches<LinearBoundingBoxHierarchy>("MeshCacheTests-Linear.yartcache");
+
+    // Assert
+    EXPECT_EQ(mismatches, 0);
+}
+
+TEST(MeshCacheTests, QuantizedHierarchy_SaveAndLoadMeshCache_HitsMatchBuiltHierarchy)
+{
+    // Act
+    int mismatches = CountRoundTripMismatches<QuantizedBoundingBoxHierarchy>("MeshCacheTests-Quantized.yartcache");
+
+    // Assert
+    EXPECT_EQ(mismatches, 0);
+}
+
+TEST(MeshCacheTests, DifferentKey_LoadMeshCache_IsRejected)
+{
+    // Arrange
+    std::string filename = GetTestFilename("MeshCacheTests-Key.yartcache");
+    auto triangles = CreateTriangles(4);
+
+    std::vector<std::shared_ptr<IntersectableGeometry>> builtPointers{};
+    const IntersectableGeometry* builtRoot{};
+
+    ASSERT_TRUE(SaveTestMeshCache<LinearBoundingBoxHierarchy>(filename, triangles, builtPointers, builtRoot));
+
+    // Act
+    std::vector<std::shared_ptr<IntersectableGeometry>> loadedPointers{};
+    auto [loadedRoot, sahCost] = LoadMeshCache(filename, TestKey + 1, nullptr, loadedPointers);
+
+    // Assert
+    EXPECT_EQ(loadedRoot, nullptr);
+    EXPECT_TRUE(loadedPointers.empty());
+
+    std::filesystem::remove(filename);
+}
+
+TEST(MeshCacheTests, TruncatedFile_LoadMeshCache_IsRejected)
+{
+    // Arrange
+    auto truncate = [](const std::string& filename)
+    {
+        std::filesystem::resize_file(filename, std::filesystem::file_size(filename) / 2);
+    };
+
+    std::vector<std::shared_ptr<IntersectableGeometry>> loadedPointers{};
+
+    // Act
+    bool isLoaded = LoadsCorruptedMeshCache("MeshCacheTests-Truncated.yartcache", truncate, loadedPointers);
+
+    // Assert
+    EXPECT_FALSE(isLoaded);
+}
+
+TEST(MeshCacheTests, OverwrittenBlocks_LoadMeshCache_IsRejected)
+{
+    // Arrange
+    auto overwriteBlocks = [](const std::string& filename)
+    {
+        // The SOA blocks are the last section of the file, the triangle indices they hold no longer refer to triangles.
+        auto fileSize = std::filesystem::file_size(filename);
+        std::vector<char> garbage(static_cast<size_t>(fileSize / 4), static_cast<char>(0x7F));
+
+        std::fstream stream{filename, std::ios::binary | std::ios::in | std::ios::out};
+        stream.seekp(static_cast<std::streamoff>(fileSize - garbage.size()));
+        stream.write(garbage.data(), static_cast<std::streamsize>(garbage.size()));
+    };
+
+    std::vector<std::shared_ptr<IntersectableGeometry>> loadedPointers{};
+
+    // Act
+    bool isLoaded = LoadsCorruptedMeshCache("MeshCacheTests-Blocks.yartcache", overwriteBlocks, loadedPointers);
+
+    // Assert
+    EXPECT_FALSE(isLoaded);
+}
+
+TEST(MeshCacheTests, OverwrittenHeader_LoadMeshCache_IsRejected)
+{
+    // Arrange
+    auto overwriteHeader = [](const std::string& filename)
+    {
+        std::vector<char> garbage(16, static_cast<char>(0x7F));
+
+        std::fstream stream{filename, std::ios::binary | std::ios::in | std::ios::out};
+        stream.seekp(4);
+        stream.write(garbage.data(), static_cast<std::streamsize>(garbage.size()));
+    };
+
+    std::vector<std::shared_ptr<IntersectableGeometry>> loadedPointers{};
+
+    // Act
+    bool isLoaded = LoadsCorruptedMeshCache("MeshCacheTests-Header.yartcache", overwriteHeader, loadedPointers);
+
+    // Assert
+    EXPECT_FALSE(isLoaded);
+}
\ No newline at end of file
@@ -0,0 +1,137 @@
+#include "pch.h"
+
+import <cmath>;
+import <cstdint>;
+import <vector>;
+
+import BoundingBox;
+import Math;
+import QuantizedBoundingBoxHierarchy;
+
+using namespace Yart;
+
+namespace
+{
+    /// @brief Quantizes a set of awkward child bounds, far from the origin and partly flat, and counts the decoded
+    /// boxes that do not enclose the exact ones.
+    template <real_number T, QuantizedCoordinate TQuantized>
+    int CountNonConservativeChildBoundingBoxes()
+    {
+        using Node = QuantizedBoundingBoxNodeT<T, TQuantized>;
+
+        int failures = 0;
+
+        for (int nodeIndex = 0; nodeIndex < 64; nodeIndex++)
+        {
+            Node node{};
+            std::vector<BoundingBoxT<T>> boundingBoxes(Node::NumberOfLeafs);
+
+            for (size_t i = 0; i < Node::NumberOfLeafs; i++)
+            {
+                // Deterministic but irregular positions, they rarely fall on a grid step.
+                T seed = static_cast<T>(nodeIndex * 7 + static_cast<int>(i) * 13);
+
+                Vector3T<T> minimum{
+                    static_cast<T>(1000.0 + nodeIndex * 0.37 + std::sin(seed) * 3.1),
+                    static_cast<T>(-250.0 + std::cos(seed * 1.3) * 0.7),
+                    static_cast<T>(std::sin(seed * 0.7) * 0.001),
+                };
+
+                Vector3T<T> size{
+                    static_cast<T>(std::abs(std::cos(seed)) * 1.7),
+                    static_cast<T>(std::abs(std::sin(seed * 2.1)) * 0.05),
+                    i % 3 == 0 ? T{0} : static_cast<T>(std::abs(std::sin(seed * 0.3)) * 0.002),
+                };
+
+                boundingBoxes[i] = BoundingBoxT<T>{minimum, minimum + size};
+                node.Children[i] = static_cast<std::uint32_t>(i);
+            }
+
+            node.SetChildBoundingBoxes(boundingBoxes.data());
+
+            for (size_t i = 0; i < Node::NumberOfLeafs; i++)
+            {
+                BoundingBoxT<T> decoded = node.GetChildBoundingBox(i);
+
+                bool isConservative =
+                    decoded.Minimum.X <= boundingBoxes[i].Minimum.X &&
+                    decoded.Minimum.Y <= boundingBoxes[i].Minimum.Y &&
+                    decoded.Minimum.Z <= boundingBoxes[i].Minimum.Z &&
+                    decoded.Maximum.X >= boundingBoxes[i].Maximum.X &&
+                    decoded.Maximum.Y >= boundingBoxes[i].Maximum.Y &&
+                    decoded.Maximum.Z >= boundingBoxes[i].Maximum.Z;
+
+                if (!isConservative)
+                {
+                    failures++;
+                }
+            }
+        }
+
+        return failures;
+    }
+}
+
+TEST(QuantizedBoundingBoxNodeTests, EightBitSingleNode_SetChildBoundingBoxes_DecodedBoxesEncloseChildren)
+{
+    // Act
+    int failures = CountNonConservativeChildBoundingBoxes<float, std::uint8_t>();
+
+    // Assert
+    EXPECT_EQ(failures, 0);
+}
+
+TEST(QuantizedBoundingBoxNodeTests, EightBitDoubleNode_SetChildBoundingBoxes_DecodedBoxesEncloseChildren)
+{
+    // Act
+    int failures = CountNonConservativeChildBoundingBoxes<double, std::uint8_t>();
+
+    // Assert
+    EXPECT_EQ(failures, 0);
+}
+
+TEST(QuantizedBoundingBoxNodeTests, SixteenBitSingleNode_SetChildBoundingBoxes_DecodedBoxesEncloseChildren)
+{
+    // Act
+    int failures = CountNonConservativeChildBoundingBoxes<float, std::uint16_t>();
+
+    // Assert
+    EXPECT_EQ(failures, 0);
+}
+
+TEST(QuantizedBoundingBoxNodeTests, SixteenBitDoubleNode_SetChildBoundingBoxes_DecodedBoxesEncloseChildren)
+{
+    // Act
+    int failures = CountNonConservativeChildBoundingBoxes<double, std::uint16_t>();
+
+    // Assert
+    EXPECT_EQ(failures, 0);
+}
+
+TEST(QuantizedBoundingBoxNodeTests, EightBitNode_SetChildBoundingBoxes_DecodedBoxesStayTight)
+{
+    // Arrange
+    using Node = QuantizedBoundingBoxNodeT<real, std::uint8_t>;
+
+    Node node{};
+    std::vector<BoundingBox> boundingBoxes(Node::NumberOfLeafs);
+
+    for (size_t i = 0; i < Node::NumberOfLeafs; i++)
+    {
+        boundingBoxes[i] = BoundingBox{{static_cast<real>(i), 0, 0}, {static_cast<real>(i) + 1, 1, 1}};
+        node.Children[i] = static_cast<std::uint32_t>(i);
+    }
+
+    // Act
+    node.SetChildBoundingBoxes(boundingBoxes.data());
+
+    // Assert
+    for (size_t i = 0; i < Node::NumberOfLeafs; i++)
+    {
+        BoundingBox decoded = node.GetChildBoundingBox(i);
+
+        // Rounding outwards may add a grid step on either side, one step along x is a 255th of the node.
+        EXPECT_NEAR(decoded.Minimum.X, boundingBoxes[i].Minimum.X, Node::NumberOfLeafs / real{100.0});
+        EXPECT_NEAR(decoded.Maximum.X, boundingBoxes[i].Maximum.X, Node::NumberOfLeafs / real{100.0});
+    }
+}
\ No newline at end of file
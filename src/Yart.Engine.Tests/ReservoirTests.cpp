@@ -0,0 +1,60 @@
+#include "pch.h"
+
+import <vector>;
+
+import Math;
+import Random;
+import Reservoir;
+
+using namespace Yart;
+
+TEST(ReservoirTests, WeightedCandidates_ManyTrials_SelectionFrequenciesAreProportionalToWeights)
+{
+    // Arrange
+    std::vector<real> weights{2, 0, 5, 1, 8, 4};
+    Random random{};
+
+    constexpr int trialCount = 200000;
+    std::vector<int> counts(weights.size());
+
+    // Act
+    for (int trial = 0; trial < trialCount; trial++)
+    {
+        Reservoir<size_t> reservoir{};
+
+        for (size_t i = 0; i < weights.size(); i++)
+        {
+            reservoir.Update(i, weights[i], random);
+        }
+
+        ASSERT_TRUE(reservoir.HasSample());
+        ASSERT_EQ(reservoir.GetCount(), weights.size());
+        ASSERT_NEAR(reservoir.GetWeightSum(), 20, 0.0001);
+
+        counts[reservoir.GetSample()]++;
+    }
+
+    // Assert
+    EXPECT_EQ(counts[1], 0);
+
+    for (size_t i = 0; i < weights.size(); i++)
+    {
+        EXPECT_NEAR(static_cast<double>(counts[i]) / trialCount, weights[i] / 20, 0.005);
+    }
+}
+
+TEST(ReservoirTests, ZeroWeightCandidates_Update_HasNoSample)
+{
+    // Arrange
+    Reservoir<size_t> reservoir{};
+    Random random{};
+
+    // Act
+    reservoir.Update(0, 0, random);
+    reservoir.Update(1, -1, random);
+
+    // Assert
+    EXPECT_FALSE(reservoir.HasSample());
+    EXPECT_EQ(reservoir.GetCount(), 2);
+    EXPECT_EQ(reservoir.GetWeightSum(), 0);
+}
\ No newline at end of file
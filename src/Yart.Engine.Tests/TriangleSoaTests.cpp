@@ -0,0 +1,134 @@
+#include "pch.h"
+
+import <algorithm>;
+import <limits>;
+
+import GeometrySoa;
+import IntersectionResult;
+import Ray;
+import Triangle;
+import TriangleSoa;
+import Math;
+
+using namespace Yart;
+
+TEST(TriangleSoaIntersectionTests, TwoTrianglesSharingAnEdge_RaysAimedAtTheEdge_NeverMiss)
+{
+    // Arrange
+    Triangle lower{{-1, -1, 5}, {1, -1, 5}, {1, 1, 5}, nullptr};
+    Triangle upper{{-1, -1, 5}, {1, 1, 5}, {-1, 1, 5}, nullptr};
+
+    TriangleSoa<SoaSize::_256, TriangleIntersectionKernel::Watertight> triangleSoa{&lower, &upper};
+
+    int misses = 0;
+
+    // Act
+    for (int edgeStep = -9; edgeStep <= 9; edgeStep++)
+    {
+        for (int originStepX = -6; originStepX <= 6; originStepX++)
+        {
+            for (int originStepY = -6; originStepY <= 6; originStepY++)
+            {
+                real edgePosition = static_cast<real>(edgeStep) * real{0.11};
+
+                Vector3 origin{static_cast<real>(originStepX) * real{0.5}, static_cast<real>(originStepY) * real{0.5}, 0};
+                Vector3 target{edgePosition, edgePosition, 5};
+
+                IntersectionResult result = triangleSoa.IntersectEntrance(Ray{origin, (target - origin).Normalize()});
+                if (result.HitDistance == std::numeric_limits<real>::infinity())
+                {
+                    misses++;
+                }
+            }
+        }
+    }
+
+    // Assert
+    EXPECT_EQ(misses, 0);
+}
+
+TEST(TriangleSoaIntersectionTests, OneTriangle_RayParallelToTriangle_Misses_ReturnsInfinity)
+{
+    // Arrange
+    Triangle triangle{{-1, -1, 5}, {1, -1, 5}, {1, 1, 5}, nullptr};
+    Ray ray{{-2, 0, 5}, {1, 0, 0}};
+
+    TriangleSoa<SoaSize::_256, TriangleIntersectionKernel::Watertight> triangleSoa{&triangle};
+
+    // Act
+    IntersectionResult result = triangleSoa.IntersectEntrance(ray);
+
+    // Assert
+    EXPECT_EQ(result.HitDistance, std::numeric_limits<real>::infinity());
+}
+
+TEST(TriangleSoaIntersectionTests, OneTriangle_RayParallelAboveTriangle_Misses_ReturnsInfinity)
+{
+    // Arrange
+    Triangle triangle{{-1, -1, 5}, {1, -1, 5}, {1, 1, 5}, nullptr};
+    Ray ray{{-2, 0, 4}, {1, 0, 0}};
+
+    TriangleSoa<SoaSize::_256, TriangleIntersectionKernel::Watertight> triangleSoa{&triangle};
+
+    // Act
+    IntersectionResult result = triangleSoa.IntersectEntrance(ray);
+
+    // Assert
+    EXPECT_EQ(result.HitDistance, std::numeric_limits<real>::infinity());
+}
+
+TEST(TriangleSoaIntersectionTests, FullSoa_RaysInManyDirections_HitDistancesMatchTriangle)
+{
+    // Arrange
+    Triangle triangles[]{
+        {{-1, -1, 5}, {1, -1, 5}, {0, 1, 5}, nullptr},
+        {{-2, -1, 7}, {0, -2, 8}, {-1, 2, 6}, nullptr},
+        {{1, 0, 4}, {3, 1, 5}, {2, 3, 4}, nullptr},
+        {{-3, -3, 9}, {3, -3, 9}, {0, 3, 9}, nullptr},
+        {{-1, 1, 3}, {1, 2, 3}, {0, 3, 4}, nullptr},
+        {{2, -3, 6}, {4, -2, 6}, {3, -1, 7}, nullptr},
+        {{-4, 0, 5}, {-2, 1, 6}, {-3, 2, 5}, nullptr},
+        {{0, 0, 10}, {2, 0, 10}, {1, 2, 11}, nullptr},
+    };
+
+    TriangleSoa<SoaSize::_256, TriangleIntersectionKernel::Watertight> triangleSoa{};
+    size_t triangleCount = std::min(triangleSoa.GetCapacity(), std::size(triangles));
+
+    for (size_t i = 0; i < triangleCount; i++)
+    {
+        triangleSoa.Insert(i, &triangles[i]);
+    }
+
+    int hits = 0;
+
+    // Act and assert
+    for (int stepX = -6; stepX <= 6; stepX++)
+    {
+        for (int stepY = -6; stepY <= 6; stepY++)
+        {
+            // The odd offsets keep the rays away from the edges, where the two tests may disagree by design.
+            Vector3 direction{static_cast<real>(stepX) * real{0.093} + real{0.0123}, static_cast<real>(stepY) * real{0.093} + real{0.0071}, 1};
+            Ray ray{{0, 0, 0}, direction.Normalize()};
+
+            real expectedDistance = std::numeric_limits<real>::infinity();
+            for (size_t i = 0; i < triangleCount; i++)
+            {
+                expectedDistance = std::min(expectedDistance, triangles[i].IntersectEntrance(ray).HitDistance);
+            }
+
+            IntersectionResult result = triangleSoa.IntersectEntrance(ray);
+
+            if (expectedDistance == std::numeric_limits<real>::infinity())
+            {
+                EXPECT_EQ(result.HitDistance, std::numeric_limits<real>::infinity());
+            }
+            else
+            {
+                EXPECT_NEAR(result.HitDistance, expectedDistance, expectedDistance * 0.001);
+                hits++;
+            }
+        }
+    }
+
+    EXPECT_GT(hits, 0);
+}
\ No newline at end of file
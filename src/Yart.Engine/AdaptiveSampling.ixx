@@ -0,0 +1,123 @@
+export module AdaptiveSampling;
+
+import <span>;
+
+import "Common.h";
+
+import Math;
+
+namespace Yart
+{
+    /// @brief How many samples the pixels of an image receive, see PixelEstimate::NeedsSample.
+    export class AdaptiveSamplingParameters
+    {
+    public:
+        /// @brief The number of samples every pixel receives, or receives on average with Enabled.
+        unsigned int Iterations{};
+
+        /// @brief Whether pixels stop receiving samples once their estimate has converged, which frees their share of the
+        /// Iterations for the pixels that are still noisy.
+        bool Enabled{};
+
+        /// @brief The standard error of a pixel's mean luminance, relative to the mean, below which the pixel counts as
+        /// converged.
+        real ErrorThreshold{real{0.01}};
+
+        /// @brief The number of samples every pixel receives before it may count as converged.
+        unsigned int MinimumIterations{2};
+
+        /// @brief The number of samples a noisy pixel may receive at most. Values below Iterations are raised to it.
+        unsigned int MaximumIterations{};
+    };
+
+    /// @brief The samples a pixel has received. Keeps the mean of the luminance and the sum of its squared deviations
+    /// with Welford's algorithm, which are enough to estimate the variance of the pixel's mean without the cancellation
+    /// of a running sum of squares.
+    export class PixelEstimate
+    {
+    public:
+        Color3 ColorSum{};
+        real LuminanceMean{};
+        real LuminanceSquaredDeviationSum{};
+        unsigned int Count{};
+
+        void Add(const Color3& color)
+        {
+            real luminance = color.Luminance();
+
+            ColorSum += color;
+            Count++;
+
+            real delta = luminance - LuminanceMean;
+            LuminanceMean += delta / static_cast<real>(Count);
+            LuminanceSquaredDeviationSum += delta * (luminance - LuminanceMean);
+        }
+
+        Color3 GetMean() const
+        {
+            return Count > 0 ? ColorSum / static_cast<real>(Count) : Color3{};
+        }
+
+        /// @brief Whether the standard error of the mean luminance is within errorThreshold of the mean. Dark pixels are
+        /// measured against a small floor instead of their mean, otherwise black pixels would never converge.
+        bool HasConverged(real errorThreshold) const
+        {
+            if (Count < 2)
+            {
+                return false;
+            }
+
+            real count = static_cast<real>(Count);
+            real variance = LuminanceSquaredDeviationSum / (count - real{1.0});
+
+            return Math::sqrt(variance / count) <= errorThreshold * Math::max(LuminanceMean, real{0.01});
+        }
+
+        /// @brief Whether the pixel should receive another sample. Pixels receive Iterations samples, adaptive sampling
+        /// stops them early once they have converged or goes on up to MaximumIterations if they have not.
+        bool NeedsSample(const AdaptiveSamplingParameters& parameters) const
+        {
+            if (!parameters.Enabled)
+            {
+                return Count < parameters.Iterations;
+            }
+
+            if (Count >= Math::max(parameters.Iterations, parameters.MaximumIterations))
+            {
+                return false;
+            }
+
+            return Count < parameters.MinimumIterations || !HasConverged(parameters.ErrorThreshold);
+        }
+    };
+
+    /// @brief Samples every estimate until it no longer needs a sample or the image has used up Iterations samples per
+    /// pixel. Pixels that converge early leave their share of the samples to the ones that are still noisy.
+    /// @param sample Called once per pass with the indices of the estimates that still receive samples, adds one sample
+    /// to each of them.
+    export template <typename TSample>
+    void SampleAdaptively(std::span<PixelEstimate> estimates, const AdaptiveSamplingParameters& parameters, TSample&& sample)
+    {
+        // The indices of the pixels that still receive samples.
+        std::vector<std::uint32_t> activePixels(estimates.size());
+        for (size_t i = 0; i < estimates.size(); i++)
+        {
+            activePixels[i] = static_cast<std::uint32_t>(i);
+        }
+
+        size_t sampleBudget = static_cast<size_t>(parameters.Iterations) * estimates.size();
+        size_t sampleCount = 0;
+
+        // Every pass samples each active pixel once, the last pass may overshoot the budget slightly.
+        while (!activePixels.empty() && sampleCount < sampleBudget)
+        {
+            sample(std::span<const std::uint32_t>{activePixels});
+            sampleCount += activePixels.size();
+
+            std::erase_if(activePixels, [&](std::uint32_t pixelIndex)
+            {
+                return !estimates[pixelIndex].NeedsSample(parameters);
+            });
+        }
+    }
+}
\ No newline at end of file
@@ -0,0 +1,104 @@
+export module AliasTable;
+
+import <cstdint>;
+import <vector>;
+
+import "Common.h";
+
+import Math;
+import Random;
+
+namespace Yart
+{
+    /// @brief Picks an index with a probability proportional to its weight in constant time, using Vose's alias method.
+    /// Every bucket holds its own index and an alias, a sample picks a bucket uniformly and then one of the two.
+    export class AliasTable
+    {
+    private:
+        std::vector<real> _acceptanceProbabilities{};
+        std::vector<std::uint32_t> _aliases{};
+        std::vector<real> _probabilities{};
+
+    public:
+        AliasTable() = default;
+
+        /// @param weights Non negative weights. If none of them is positive every index is equally likely.
+        explicit AliasTable(const std::vector<real>& weights)
+            : _acceptanceProbabilities(weights.size()), _aliases(weights.size()), _probabilities(weights.size())
+        {
+            size_t size = weights.size();
+
+            real totalWeight{};
+            for (real weight : weights)
+            {
+                totalWeight += Math::max(real{0.0}, weight);
+            }
+
+            bool uniform = !(totalWeight > real{0.0}) || !Math::isfinite(totalWeight);
+
+            std::vector<real> scaledProbabilities(size);
+            std::vector<std::uint32_t> smallBuckets{};
+            std::vector<std::uint32_t> largeBuckets{};
+
+            for (size_t i = 0; i < size; i++)
+            {
+                _probabilities[i] = uniform ? real{1.0} / static_cast<real>(size) : Math::max(real{0.0}, weights[i]) / totalWeight;
+                scaledProbabilities[i] = _probabilities[i] * static_cast<real>(size);
+
+                (scaledProbabilities[i] < real{1.0} ? smallBuckets : largeBuckets).push_back(static_cast<std::uint32_t>(i));
+            }
+
+            // Fill the unused part of every small bucket with an alias to a large one, which makes the large one smaller.
+            while (!smallBuckets.empty() && !largeBuckets.empty())
+            {
+                std::uint32_t small = smallBuckets.back();
+                smallBuckets.pop_back();
+
+                std::uint32_t large = largeBuckets.back();
+                largeBuckets.pop_back();
+
+                _acceptanceProbabilities[small] = scaledProbabilities[small];
+                _aliases[small] = large;
+
+                scaledProbabilities[large] -= real{1.0} - scaledProbabilities[small];
+                (scaledProbabilities[large] < real{1.0} ? smallBuckets : largeBuckets).push_back(large);
+            }
+
+            // Whatever is left is full up to rounding errors.
+            for (std::uint32_t bucket : largeBuckets)
+            {
+                _acceptanceProbabilities[bucket] = real{1.0};
+                _aliases[bucket] = bucket;
+            }
+
+            for (std::uint32_t bucket : smallBuckets)
+            {
+                _acceptanceProbabilities[bucket] = real{1.0};
+                _aliases[bucket] = bucket;
+            }
+        }
+
+        size_t GetSize() const
+        {
+            return _probabilities.size();
+        }
+
+        /// @brief Picks an index. The table must not be empty.
+        size_t Sample(const Random& random) const
+        {
+            size_t size = _probabilities.size();
+
+            real scaledRandom = random.GetNormalized() * static_cast<real>(size);
+            size_t bucket = Math::min(static_cast<size_t>(scaledRandom), size - 1);
+
+            // The fractional part of the same number decides between the bucket and its alias.
+            return scaledRandom - static_cast<real>(bucket) < _acceptanceProbabilities[bucket] ? bucket : _aliases[bucket];
+        }
+
+        /// @brief Gets the probability with which Sample picks index.
+        real GetProbability(size_t index) const
+        {
+            return _probabilities[index];
+        }
+    };
+}
\ No newline at end of file
@@ -18,5 +18,28 @@ namespace Yart
         virtual bool IsInShadow(const Scene& scene, const Vector3& hitPosition, const Vector3& hitNormal, const Vector3& positionOnLight) const = 0;
 
         virtual real CalculateInversePdf(const Random& random, const Vector3& hitPosition, const Vector3& hitNormal, const Vector3& incomingDirection, const Vector3& outgoingDirection) const = 0;
+
+        /// @brief Gets the surface area of the light. GetPointOnLight picks points uniformly over it.
+        virtual real GetArea() const = 0;
+
+        /// @brief Gets the normal of the light at a point on its surface, facing either side.
+        virtual Vector3 GetNormalOnLight(const Vector3& positionOnLight) const = 0;
+
+        /// @brief Calculates the solid angle pdf with which GetPointOnLight produces the direction from hitPosition to
+        /// positionOnLight.
+        /// @return Zero if the light is seen edge on.
+        real CalculateSolidAnglePdf(const Vector3& hitPosition, const Vector3& positionOnLight) const
+        {
+            Vector3 directionToLight = positionOnLight - hitPosition;
+            real distanceSquared = directionToLight.LengthSquared();
+
+            real cosineOnLight = Math::abs(GetNormalOnLight(positionOnLight) * directionToLight) / Math::sqrt(distanceSquared);
+            if (!(cosineOnLight > real{0.0}))
+            {
+                return real{0.0};
+            }
+
+            return distanceSquared / (cosineOnLight * GetArea());
+        }
     };
 }
\ No newline at end of file
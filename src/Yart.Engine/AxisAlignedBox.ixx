@@ -4,10 +4,13 @@ module;
 
 export module AxisAlignedBox;
 
+import <cstdint>;
+
 import "Common.h";
 
 import BoundingBox;
 import Geometry;
+import GeometryVisitor;
 import IntersectionResult;
 import IntersectionResultType;
 import Material;
@@ -52,7 +55,7 @@ namespace Yart
             return AppliedMaterial;
         }
 
-        virtual Vector3 CalculateNormal(const Ray& ray, const Vector3& hitPosition, real additionalData) const override
+        virtual Vector3 CalculateNormal(const Ray& ray, const Vector3& hitPosition, real additionalData, std::uint32_t primitiveIndex) const override
         {
             Vector3 distanceMinimum = (hitPosition - Minimum).Abs();
             Vector3 distanceMaxmimum = (hitPosition - Maximum).Abs();
@@ -98,6 +101,11 @@ namespace Yart
             return normal;
         }
 
+        virtual void Accept(GeometryVisitor& visitor) const override
+        {
+            visitor.Visit(this);
+        }
+
         virtual IntersectionResult IntersectEntrance(const Ray& ray) const override
         {
             return {this, Intersect<IntersectionResultType::Entrance>(ray)};
@@ -12,6 +12,7 @@ import "Common.h";
 import Alignment;
 import AxisAlignedBox;
 import BoundingBox;
+import Geometry;
 import GeometrySoa;
 import IntersectionResult;
 import IntersectionResultType;
@@ -26,10 +27,10 @@ namespace Yart
         class __declspec(dllexport) alignas(64) AxisAlignedBoxSoa : public GeometrySoa<AxisAlignedBox>
     {
     public:
-        static constexpr size_t Elements = std::same_as<real, float> ? (Size == SoaSize::_256 ? 8 : 4) : (Size == SoaSize::_256 ? 4 : 2);
+        static constexpr size_t Elements = SoaElements<Size>;
 
     private:
-        using VclVec = std::conditional_t<std::same_as<real, float>, std::conditional_t<Size == SoaSize::_256, Vec8f, Vec4f>, std::conditional_t<Size == SoaSize::_256, Vec4d, Vec2d>>;
+        using VclVec = SoaVector<Size>;
 
         alignas(Elements * sizeof(real)) real _minimumX[Elements];
         alignas(Elements * sizeof(real)) real _minimumY[Elements];
@@ -89,6 +90,34 @@ namespace Yart
             _geometries[index] = geometry;
         }
 
+        virtual size_t GetCapacity() const override
+        {
+            return Elements;
+        }
+
+        virtual const Geometry* GetGeometry(size_t index) const override
+        {
+            assert(index >= 0 && index < Elements);
+
+            return _geometries[index];
+        }
+
+        virtual size_t CalculateMemoryUsage() const override
+        {
+            return sizeof(*this);
+        }
+
+        virtual void Refit() override
+        {
+            for (size_t i = 0; i < Elements; i++)
+            {
+                if (_geometries[i])
+                {
+                    Insert(i, _geometries[i]);
+                }
+            }
+        }
+
         virtual BoundingBoxT<real> CalculateBoundingBox() const override
         {
             BoundingBoxT<real> boundingBox = BoundingBoxT<real>::ReverseInfinity();
@@ -111,6 +140,11 @@ namespace Yart
             return Intersect<IntersectionResultType::Entrance>(ray);
         }
 
+        virtual bool IntersectAny(const Ray& ray, real maximumDistance) const override
+        {
+            return Intersect<IntersectionResultType::Entrance>(ray).HitDistance < maximumDistance;
+        }
+
         virtual IntersectionResult IntersectExit(const Ray& ray) const override
         {
             return Intersect<IntersectionResultType::Exit>(ray);
@@ -13,6 +13,8 @@ namespace Yart
         Vector3T<T> Minimum{};
         Vector3T<T> Maximum{};
 
+        constexpr BoundingBoxT() = default;
+
         constexpr BoundingBoxT(const Vector3T<T>& minimum, const Vector3T<T>& maximum)
             : Minimum{minimum}, Maximum{maximum}
         {
@@ -52,22 +54,91 @@ namespace Yart
             return Minimum + (Maximum - Minimum) * T { 0.5 };
         }
 
+        constexpr T CalculateSurfaceArea() const
+        {
+            Vector3T<T> size = Maximum - Minimum;
+            return T{2.0} * (size.X * size.Y + size.Y * size.Z + size.Z * size.X);
+        }
+
         constexpr BoundingBoxT Union(const Vector3T<T>& other) const
         {
             return BoundingBoxT{
-                Minimum.Min(other),
-                Maximum.Max(other),
+                Vector3T<T>::Min(Minimum, other),
+                Vector3T<T>::Max(Maximum, other),
             };
         }
 
         constexpr BoundingBoxT Union(const BoundingBoxT& other) const
         {
             return BoundingBoxT{
-                Vector3::Min(Minimum, other.Minimum),
-                Vector3::Max(Maximum, other.Maximum),
+                Vector3T<T>::Min(Minimum, other.Minimum),
+                Vector3T<T>::Max(Maximum, other.Maximum),
+            };
+        }
+
+        /// @brief Calculates the overlapping region of two bounding boxes. The result is empty if they do not overlap.
+        constexpr BoundingBoxT Intersection(const BoundingBoxT& other) const
+        {
+            return BoundingBoxT{
+                Vector3T<T>::Max(Minimum, other.Minimum),
+                Vector3T<T>::Min(Maximum, other.Maximum),
             };
         }
 
+        /// @brief Calculates the bounding box that encloses this bounding box after it has been transformed by an affine
+        /// transformation. Uses the method from Graphics Gems "Transforming Axis-Aligned Bounding Boxes" by Jim Arvo.
+        constexpr BoundingBoxT Transform(const Matrix4x4T<T>& transformation) const
+        {
+            // Unbounded geometry stays unbounded, the products below would produce NaNs.
+            for (size_t i = 0; i < 3; i++)
+            {
+                if (!Math::isfinite(Minimum[i]) || !Math::isfinite(Maximum[i]))
+                {
+                    return Infinity();
+                }
+            }
+
+            // Vectors are transformed as rows so the translation lives in the last row of the matrix.
+            Vector3T<T> minimum{transformation[12], transformation[13], transformation[14]};
+            Vector3T<T> maximum{minimum};
+
+            for (size_t row = 0; row < 3; row++)
+            {
+                for (size_t column = 0; column < 3; column++)
+                {
+                    T a = transformation[row * 4 + column] * Minimum[row];
+                    T b = transformation[row * 4 + column] * Maximum[row];
+
+                    minimum[column] += Math::min(a, b);
+                    maximum[column] += Math::max(a, b);
+                }
+            }
+
+            return BoundingBoxT{minimum, maximum};
+        }
+
+        /// @brief Calculates the distance at which a ray enters the bounding box, zero if the ray starts inside of it and
+        /// infinity if the ray misses it. Rays that produce nans, for example by running exactly along one of the faces, are
+        /// treated as hits.
+        constexpr T CalculateEntranceDistance(const Vector3T<T>& rayPosition, const Vector3T<T>& rayInverseDirection) const
+        {
+            Vector3T<T> distance1 = Vector3T<T>::ComponentwiseMultiply(Minimum - rayPosition, rayInverseDirection);
+            Vector3T<T> distance2 = Vector3T<T>::ComponentwiseMultiply(Maximum - rayPosition, rayInverseDirection);
+
+            Vector3T<T> nearDistance = Vector3T<T>::Min(distance1, distance2);
+            Vector3T<T> farDistance = Vector3T<T>::Max(distance1, distance2);
+
+            T entranceDistance = Math::max(T{0}, Math::max(nearDistance.X, Math::max(nearDistance.Y, nearDistance.Z)));
+            T exitDistance = Math::min(farDistance.X, Math::min(farDistance.Y, farDistance.Z));
+
+            return exitDistance < entranceDistance ? std::numeric_limits<T>::infinity() : entranceDistance;
+        }
+
+        constexpr bool IsEmpty() const
+        {
+            return !(Minimum.X <= Maximum.X && Minimum.Y <= Maximum.Y && Minimum.Z <= Maximum.Z);
+        }
+
         constexpr bool Intersects(const Vector3T<T>& other) const
         {
             return
@@ -6,18 +6,28 @@ module;
 
 export module BoundingBoxHierarchy;
 
+import <algorithm>;
+import <bit>;
 import <cassert>;
+import <cstdint>;
+import <execution>;
+import <initializer_list>;
+import <numeric>;
 
 import "Common.h";
 
 import BoundingBox;
 import Geometry;
 import GeometryCollection;
+import GeometrySoa;
 import GeometrySoaUtilities;
+import IndexedTriangleMesh;
 import IntersectableGeometry;
 import IntersectionResult;
 import IntersectionResultType;
 import Math;
+import RayPacket;
+import RefittableGeometry;
 import Triangle;
 
 using namespace vcl;
@@ -25,7 +35,7 @@ using namespace vcl;
 namespace Yart
 {
     export template <real_number T>
-        class alignas(64) BoundingBoxHierarchyT : public IntersectableGeometry
+        class alignas(64) BoundingBoxHierarchyT : public IntersectableGeometry, public RefittableGeometry
     {
     private:
         using VclVec = typename std::conditional<std::same_as<T, float>, Vec8f, Vec4d>::type;
@@ -63,7 +73,6 @@ namespace Yart
 
         void SetChild(size_t leafIndex, const IntersectableGeometry* child)
         {
-            static_assert(leafIndex < NumberOfLeafs);
             assert(leafIndex < NumberOfLeafs);
 
             auto boundingBox = child->CalculateBoundingBox();
@@ -94,17 +103,50 @@ namespace Yart
             Children[leafIndex] = child;
         }
 
+        const IntersectableGeometry* GetChild(size_t leafIndex) const
+        {
+            assert(leafIndex < NumberOfLeafs);
+
+            return Children[leafIndex];
+        }
+
+        /// @brief Recalculates the bounding boxes of the children. Must be called after the children have been modified.
+        virtual void Refit() override
+        {
+            for (size_t i = 0; i < NumberOfLeafs; i++)
+            {
+                if (Children[i])
+                {
+                    SetChild(i, Children[i]);
+                }
+            }
+        }
+
+        BoundingBoxT<T> GetChildBoundingBox(size_t leafIndex) const
+        {
+            assert(leafIndex < NumberOfLeafs);
+
+            return BoundingBoxT<T>{
+                Vector3T<T>{MinimumX[leafIndex], MinimumY[leafIndex], MinimumZ[leafIndex]},
+                Vector3T<T>{MaximumX[leafIndex], MaximumY[leafIndex], MaximumZ[leafIndex]},
+            };
+        }
+
         virtual BoundingBox CalculateBoundingBox() const override
         {
             static_assert(NumberOfLeafs > 0);
 
-            BoundingBox boundingBox{
-                Vector3{MinimumX[0], MinimumY[0], MinimumZ[0]},
-                Vector3{MaximumX[0], MaximumY[0], MaximumZ[0]},
-            };
+            // Empty leafs keep their default infinite bounds so they must be skipped, otherwise a partially filled node
+            // would report an infinite bounding box.
+            BoundingBox boundingBox = BoundingBox::ReverseInfinity();
 
-            for (int i = 1; i < NumberOfLeafs; i++)
+            for (int i = 0; i < NumberOfLeafs; i++)
             {
+                if (!Children[i])
+                {
+                    continue;
+                }
+
                 BoundingBox newBoundingBox{
                     Vector3{MinimumX[i], MinimumY[i], MinimumZ[i]},
                     Vector3{MaximumX[i], MaximumY[i], MaximumZ[i]},
@@ -118,44 +160,101 @@ namespace Yart
 
         virtual IntersectionResult IntersectEntrance(const Ray& ray) const override
         {
-            return Intersect<IntersectionResultType::Entrance>(ray);
+            return Intersect<IntersectionResultType::Entrance>(ray, std::numeric_limits<real>::infinity());
+        }
+
+        virtual IntersectionResult IntersectEntrance(const Ray& ray, real maximumDistance) const override
+        {
+            return Intersect<IntersectionResultType::Entrance>(ray, maximumDistance);
         }
 
         virtual IntersectionResult IntersectExit(const Ray& ray) const override
         {
-            return Intersect<IntersectionResultType::Exit>(ray);
+            return Intersect<IntersectionResultType::Exit>(ray, std::numeric_limits<real>::infinity());
         }
 
-    private:
-        template <IntersectionResultType TIntersectionResultType>
-        force_inline constexpr IntersectionResult Intersect(const Ray& ray) const
+        virtual bool IntersectAny(const Ray& ray, real maximumDistance) const override
         {
-            //if (std::is_constant_evaluated())
-            //{
-            //    float closestDistance = std::numeric_limits<float>::infinity();
-            //    const Sphere* closestGeometry = nullptr;
+            alignas(sizeof(T) * 4) T distances[NumberOfLeafs];
+            CalculateChildEntranceDistances(ray, distances);
 
-            //    for (int i = 0; i < NumberOfLeafs; i++)
-            //    {
-            //        auto geometry = _geometries[i];
+            for (size_t i = 0; i < NumberOfLeafs; i++)
+            {
+                if (distances[i] < maximumDistance && Children[i] && Children[i]->IntersectAny(ray, maximumDistance))
+                {
+                    return true;
+                }
+            }
 
-            //        if (geometry == nullptr)
-            //        {
-            //            continue;
-            //        }
+            return false;
+        }
 
-            //        float distance = geometry->Intersect<TIntersectionResultType>(ray);
+        virtual void IntersectPacketEntrance(const RayPacket& packet, std::uint32_t laneMask, IntersectionResult* results) const override
+        {
+            alignas(64) real maximumDistances[RayPacket::Size]{};
+            for (size_t i = 0; i < RayPacket::Size; i++)
+            {
+                maximumDistances[i] = (laneMask & (1u << i)) ? results[i].HitDistance : real{0.0};
+            }
 
-            //        if (distance < closestDistance)
-            //        {
-            //            closestDistance = distance;
-            //            closestGeometry = geometry;
-            //        }
-            //    }
+            std::uint32_t childMasks[NumberOfLeafs];
+            real distances[NumberOfLeafs];
 
-            //    return {closestGeometry, closestDistance};
-            //}
+            // Visit the children entered by any lane nearest first, each with only the lanes that entered it.
+            size_t order[NumberOfLeafs];
+            size_t hitCount = 0;
+
+            for (size_t i = 0; i < NumberOfLeafs; i++)
+            {
+                if (!Children[i])
+                {
+                    continue;
+                }
+
+                childMasks[i] = packet.IntersectBoundingBox(BoundingBox{GetChildBoundingBox(i)}, maximumDistances, laneMask, distances[i]);
 
+                if (childMasks[i] != 0)
+                {
+                    size_t insertIndex = hitCount++;
+
+                    while (insertIndex > 0 && distances[order[insertIndex - 1]] > distances[i])
+                    {
+                        order[insertIndex] = order[insertIndex - 1];
+                        insertIndex--;
+                    }
+
+                    order[insertIndex] = i;
+                }
+            }
+
+            for (size_t i = 0; i < hitCount; i++)
+            {
+                size_t childIndex = order[i];
+                std::uint32_t childMask = childMasks[childIndex];
+
+                if (std::popcount(childMask) >= RayPacket::MinimumActiveLanes)
+                {
+                    Children[childIndex]->IntersectPacketEntrance(packet, childMask, results);
+                    continue;
+                }
+
+                // Too few rays entered the child for the packet to pay off.
+                for (std::uint32_t remaining = childMask; remaining != 0; remaining &= remaining - 1)
+                {
+                    size_t lane = std::countr_zero(remaining);
+
+                    IntersectionResult result = Children[childIndex]->IntersectEntrance(packet.GetRay(lane), results[lane].HitDistance);
+                    if (result.HitDistance < results[lane].HitDistance)
+                    {
+                        results[lane] = result;
+                    }
+                }
+            }
+        }
+
+    private:
+        force_inline void CalculateChildEntranceDistances(const Ray& ray, T* distances) const
+        {
             VclVec minimumX = VclVec{}.load_a(MinimumX);
             VclVec minimumY = VclVec{}.load_a(MinimumY);
             VclVec minimumZ = VclVec{}.load_a(MinimumZ);
@@ -185,29 +284,87 @@ namespace Yart
 
             VclVec clampedEntranceDistance = select(exitDistance >= VclVec{real{0.0}} &entranceDistance <= exitDistance, entranceDistance, VclVec{std::numeric_limits<real>::infinity()});
 
-            alignas(sizeof(T) * 4) T distances[NumberOfLeafs];
             clampedEntranceDistance.store_a(distances);
+        }
+
+        template <IntersectionResultType TIntersectionResultType>
+        force_inline constexpr IntersectionResult Intersect(const Ray& ray, real maximumDistance) const
+        {
+            //if (std::is_constant_evaluated())
+            //{
+            //    float closestDistance = std::numeric_limits<float>::infinity();
+            //    const Sphere* closestGeometry = nullptr;
+
+            //    for (int i = 0; i < NumberOfLeafs; i++)
+            //    {
+            //        auto geometry = _geometries[i];
+
+            //        if (geometry == nullptr)
+            //        {
+            //            continue;
+            //        }
+
+            //        float distance = geometry->Intersect<TIntersectionResultType>(ray);
+
+            //        if (distance < closestDistance)
+            //        {
+            //            closestDistance = distance;
+            //            closestGeometry = geometry;
+            //        }
+            //    }
+
+            //    return {closestGeometry, closestDistance};
+            //}
+
+            alignas(sizeof(T) * 4) T distances[NumberOfLeafs];
+            CalculateChildEntranceDistances(ray, distances);
+
+            // Visit the hit children nearest first. Once a hit is found every child whose box starts beyond it can be
+            // skipped.
+            size_t order[NumberOfLeafs];
+            size_t hitCount = 0;
 
-            IntersectionResult closestIntersection{nullptr, std::numeric_limits<float>::infinity()};
             for (size_t i = 0; i < NumberOfLeafs; i++)
             {
-                if (distances[i] != std::numeric_limits<float>::infinity() && Children[i])
+                if (distances[i] < maximumDistance && Children[i])
                 {
-                    IntersectionResult result;
+                    size_t insertIndex = hitCount++;
 
-                    if constexpr (TIntersectionResultType == IntersectionResultType::Entrance)
+                    while (insertIndex > 0 && distances[order[insertIndex - 1]] > distances[i])
                     {
-                        result = Children[i]->IntersectEntrance(ray);
-                    }
-                    else
-                    {
-                        result = Children[i]->IntersectExit(ray);
+                        order[insertIndex] = order[insertIndex - 1];
+                        insertIndex--;
                     }
 
-                    if (result.HitDistance < closestIntersection.HitDistance)
-                    {
-                        closestIntersection = result;
-                    }
+                    order[insertIndex] = i;
+                }
+            }
+
+            IntersectionResult closestIntersection{nullptr, std::numeric_limits<real>::infinity()};
+            for (size_t i = 0; i < hitCount; i++)
+            {
+                size_t childIndex = order[i];
+
+                if (distances[childIndex] >= maximumDistance)
+                {
+                    break;
+                }
+
+                IntersectionResult result;
+
+                if constexpr (TIntersectionResultType == IntersectionResultType::Entrance)
+                {
+                    result = Children[childIndex]->IntersectEntrance(ray, maximumDistance);
+                }
+                else
+                {
+                    result = Children[childIndex]->IntersectExit(ray);
+                }
+
+                if (result.HitDistance < closestIntersection.HitDistance)
+                {
+                    closestIntersection = result;
+                    maximumDistance = Math::min(maximumDistance, result.HitDistance);
                 }
             }
 
@@ -217,12 +374,51 @@ namespace Yart
 
     export using BoundingBoxHierarchy = BoundingBoxHierarchyT<real>;
 
+    export enum class BoundingBoxBuildStrategy
+    {
+        SplitByLongAxis,
+        Uniform,
+        BinnedSah,
+        SpatialSplit,
+    };
+
     export class BoundingBoxBuildParameters
     {
     public:
+        BoundingBoxBuildStrategy Strategy{BoundingBoxBuildStrategy::SplitByLongAxis};
         UIntVector2 PreferredNodeSize{16, 32};
         size_t MaxDepth{8};
 
+        /// @brief The number of bins per axis the binned SAH builder uses to evaluate split candidates.
+        size_t BinCount{16};
+
+        /// @brief The relative cost of testing a ray against a node versus testing a ray against a leaf geometry. Used by
+        /// the binned SAH builder and when calculating the SAH cost of a hierarchy.
+        real TraversalCost{1};
+        real IntersectionCost{1};
+
+        /// @brief Subtrees with at least this many geometries are built as separate tasks by the split by long axis and
+        /// binned SAH builders. Zero builds the whole hierarchy on the calling thread.
+        size_t ParallelSubtreeSize{8192};
+
+        /// @brief Only the subtrees of nodes down to this depth are built as separate tasks, deeper subtrees are built by
+        /// the task that reached them. The tasks share the thread pool of the standard library's parallel algorithms.
+        size_t ParallelDepth{3};
+
+        /// @brief The maximum number of duplicate primitive references the spatial split builder may create, as a fraction of
+        /// the number of input geometries.
+        real SpatialSplitBudget{0.3};
+
+        /// @brief The spatial split builder only evaluates spatial splits when the children of the best object split overlap
+        /// by more than this fraction of the root's surface area.
+        real SpatialSplitOverlapThreshold{0.00001};
+
+        /// @brief Whether the scene loader should flatten the built hierarchy into a LinearBoundingBoxHierarchy.
+        bool Flatten{true};
+
+        /// @brief Whether the flattened hierarchy stores its child bounds as 8 bit steps, see QuantizedBoundingBoxHierarchy.
+        bool Quantize{false};
+
         BoundingBoxBuildParameters() = default;
 
         BoundingBoxBuildParameters(
@@ -234,14 +430,83 @@ namespace Yart
         {
 
         }
+
+        BoundingBoxBuildParameters(
+            BoundingBoxBuildStrategy strategy,
+            UIntVector2 preferredNodeSize,
+            size_t maxDepth)
+            :
+            Strategy{strategy},
+            PreferredNodeSize{preferredNodeSize},
+            MaxDepth{maxDepth}
+        {
+
+        }
+    };
+
+    export class BoundingBoxHierarchyReport
+    {
+    public:
+        std::string Name{};
+        BoundingBoxBuildStrategy Strategy{};
+        real SahCost{};
+
+        /// @brief The geometry the hierarchy was turned into, see CalculateBoundingBoxHierarchyStatistics.
+        const IntersectableGeometry* Root{};
+        BoundingBoxBuildParameters Parameters{};
     };
 
+    /// @brief Packs the geometries of a leaf into SOA structures and returns a single geometry that represents the leaf.
+    export const IntersectableGeometry* CreateLeafGeometry(
+        const std::vector<const IntersectableGeometry*>& leafGeometries,
+        std::vector<std::shared_ptr<IntersectableGeometry>>& geometryPointers)
+    {
+        std::vector<const IntersectableGeometry*> finalIntersectedGeometries{};
+        CreateGeometrySoaStructures(leafGeometries, finalIntersectedGeometries, geometryPointers);
+
+        if (finalIntersectedGeometries.size() == 1)
+        {
+            return finalIntersectedGeometries[0];
+        }
+
+        // Each SOA structure keeps its own bounding box so that the ones the ray cannot hit are skipped.
+        auto geometryCollection = std::make_shared<BoundedGeometryCollection>(finalIntersectedGeometries);
+        geometryPointers.push_back(geometryCollection);
+
+        return geometryCollection.get();
+    }
+
+    /// @brief Whether a builder should build the subtree of a node at currentDepth that holds count geometries as a
+    /// separate task.
+    bool IsParallelSubtree(const BoundingBoxBuildParameters& parameters, size_t currentDepth, size_t count)
+    {
+        return parameters.ParallelSubtreeSize > 0 && count >= parameters.ParallelSubtreeSize && currentDepth <= parameters.ParallelDepth;
+    }
+
+    /// @brief Calls build(task, taskGeometryPointers) for every task in parallel. Each task gets its own geometry pointers,
+    /// they are appended to geometryPointers once every task has completed.
+    template <typename TBuild>
+    void RunParallelBuildTasks(size_t taskCount, TBuild build, std::vector<std::shared_ptr<IntersectableGeometry>>& geometryPointers)
+    {
+        std::vector<std::vector<std::shared_ptr<IntersectableGeometry>>> taskGeometryPointers(taskCount);
+
+        std::vector<size_t> tasks(taskCount);
+        std::iota(tasks.begin(), tasks.end(), 0);
+
+        std::for_each(std::execution::par, tasks.begin(), tasks.end(), [&](size_t task) { build(task, taskGeometryPointers[task]); });
+
+        for (const auto& pointers : taskGeometryPointers)
+        {
+            geometryPointers.insert(geometryPointers.end(), pointers.begin(), pointers.end());
+        }
+    }
+
     // TODO: Make this work for doubles.
     const BoundingBoxHierarchy* BuildUniformBoundingBoxHierarchy(
         size_t currentDepth,
         const BoundingBoxBuildParameters& parameters,
         std::vector<const IntersectableGeometry*>& inputGeometries,
-        std::vector<std::shared_ptr<const IntersectableGeometry>>& geometryPointers)
+        std::vector<std::shared_ptr<IntersectableGeometry>>& geometryPointers)
     {
         auto hierarchy = std::shared_ptr<BoundingBoxHierarchy>(new BoundingBoxHierarchy{});
         geometryPointers.push_back(hierarchy);
@@ -283,20 +548,7 @@ namespace Yart
             }
             else
             {
-                std::vector<const IntersectableGeometry*> finalIntersectedGeometries{};
-                CreateGeometrySoaStructures(intersectedGeometries, finalIntersectedGeometries, geometryPointers);
-
-                if (finalIntersectedGeometries.size() == 1)
-                {
-                    hierarchy->SetChild(i, splitRootBoundingBox, finalIntersectedGeometries[0]);
-                }
-                else
-                {
-                    auto geometryCollection = std::make_shared<const GeometryCollection>(finalIntersectedGeometries);
-                    geometryPointers.push_back(geometryCollection);
-
-                    hierarchy->SetChild(i, splitRootBoundingBox, geometryCollection.get());
-                }
+                hierarchy->SetChild(i, splitRootBoundingBox, CreateLeafGeometry(intersectedGeometries, geometryPointers));
             }
         }
 
@@ -306,7 +558,7 @@ namespace Yart
     export const BoundingBoxHierarchy* BuildUniformBoundingBoxHierarchy(
         const BoundingBoxBuildParameters& parameters,
         std::vector<const IntersectableGeometry*>& inputGeometries,
-        std::vector<std::shared_ptr<const IntersectableGeometry>>& geometryPointers)
+        std::vector<std::shared_ptr<IntersectableGeometry>>& geometryPointers)
     {
         return BuildUniformBoundingBoxHierarchy(1, parameters, inputGeometries, geometryPointers);
     }
@@ -316,7 +568,7 @@ namespace Yart
         size_t currentDepth,
         const BoundingBoxBuildParameters& parameters,
         std::vector<const IntersectableGeometry*>& inputGeometries,
-        std::vector<std::shared_ptr<const IntersectableGeometry>>& geometryPointers)
+        std::vector<std::shared_ptr<IntersectableGeometry>>& geometryPointers)
     {
         constexpr size_t Size = std::same_as<real, float> ? 8 : 4;
 
@@ -328,9 +580,14 @@ namespace Yart
             Vector3{-std::numeric_limits<T>::infinity()},
         };
 
+        // Calculate every bounding box once, they are needed for both the total bounding box and the sort below.
+        std::vector<BoundingBox> inputBoundingBoxes{};
+        inputBoundingBoxes.reserve(inputGeometries.size());
+
         for (const auto* inputGeometry : inputGeometries)
         {
-            totalBoundingBox = totalBoundingBox.Union(inputGeometry->CalculateBoundingBox());
+            inputBoundingBoxes.push_back(inputGeometry->CalculateBoundingBox());
+            totalBoundingBox = totalBoundingBox.Union(inputBoundingBoxes.back());
         }
 
         // Determine which axis is the longest.
@@ -341,8 +598,26 @@ namespace Yart
         longestAxis = longerLengthBetweenXAndY > axisLengths.Z ? longestAxis : 2;
 
         // Sort the input geometries by their longest axis and chunk them together.
+        std::vector<std::tuple<real, const IntersectableGeometry*>> sortKeys{};
+        sortKeys.reserve(inputGeometries.size());
+
+        for (size_t i = 0; i < inputGeometries.size(); i++)
+        {
+            sortKeys.emplace_back(inputBoundingBoxes[i].CalculateCenterPoint()[longestAxis], inputGeometries[i]);
+        }
+
+        std::sort(sortKeys.begin(), sortKeys.end(), [](const auto& left, const auto& right) { return std::get<0>(left) < std::get<0>(right); });
+
+        for (size_t i = 0; i < inputGeometries.size(); i++)
+        {
+            inputGeometries[i] = std::get<1>(sortKeys[i]);
+        }
+
         size_t geometriesPerNode = Math::max(static_cast<size_t>(1), static_cast<size_t>(Math::ceil(inputGeometries.size() / static_cast<real>(Size))));
-        auto geometryChunks = ranges::actions::sort(inputGeometries, {}, [&](const auto& x) { return x->CalculateBoundingBox().CalculateCenterPoint()[longestAxis]; }) | ranges::views::chunk(geometriesPerNode);
+        auto geometryChunks = inputGeometries | ranges::views::chunk(geometriesPerNode);
+
+        // Large subtrees are built as separate tasks once every other child is set, see RunParallelBuildTasks.
+        std::vector<std::tuple<size_t, BoundingBox, std::vector<const IntersectableGeometry*>>> parallelSubtrees{};
 
         for (size_t i = 0; i < Size; i++)
         {
@@ -369,28 +644,30 @@ namespace Yart
             }
             else if (currentDepth < parameters.MaxDepth && intersectedGeometries.size() > parameters.PreferredNodeSize.X)
             {
+                if (IsParallelSubtree(parameters, currentDepth, intersectedGeometries.size()))
+                {
+                    parallelSubtrees.emplace_back(i, nodeBoundingBox, std::move(intersectedGeometries));
+                    continue;
+                }
+
                 auto childHierarchy = BuildSplitByLongAxisBoundingBoxHierarchy<T>(currentDepth + 1, parameters, intersectedGeometries, geometryPointers);
                 hierarchy->SetChild(i, nodeBoundingBox, childHierarchy);
             }
             else
             {
-                std::vector<const IntersectableGeometry*> finalIntersectedGeometries{};
-                CreateGeometrySoaStructures(intersectedGeometries, finalIntersectedGeometries, geometryPointers);
-
-                if (finalIntersectedGeometries.size() == 1)
-                {
-                    hierarchy->SetChild(i, nodeBoundingBox, finalIntersectedGeometries[0]);
-                }
-                else
-                {
-                    auto geometryCollection = std::make_shared<const GeometryCollection>(finalIntersectedGeometries);
-                    geometryPointers.push_back(geometryCollection);
-
-                    hierarchy->SetChild(i, nodeBoundingBox, geometryCollection.get());
-                }
+                hierarchy->SetChild(i, nodeBoundingBox, CreateLeafGeometry(intersectedGeometries, geometryPointers));
             }
         }
 
+        RunParallelBuildTasks(parallelSubtrees.size(), [&](size_t task, std::vector<std::shared_ptr<IntersectableGeometry>>& taskGeometryPointers)
+        {
+            auto& [childIndex, nodeBoundingBox, subtreeGeometries] = parallelSubtrees[task];
+
+            // Every task sets a different child so the node can be shared between them.
+            auto childHierarchy = BuildSplitByLongAxisBoundingBoxHierarchy<T>(currentDepth + 1, parameters, subtreeGeometries, taskGeometryPointers);
+            hierarchy->SetChild(childIndex, nodeBoundingBox, childHierarchy);
+        }, geometryPointers);
+
         return hierarchy.get();
     }
 
@@ -398,8 +675,1075 @@ namespace Yart
         const BoundingBoxHierarchyT<T>* BuildSplitByLongAxisBoundingBoxHierarchy(
             const BoundingBoxBuildParameters& parameters,
             std::vector<const IntersectableGeometry*>& inputGeometries,
-            std::vector<std::shared_ptr<const IntersectableGeometry>>& geometryPointers)
+            std::vector<std::shared_ptr<IntersectableGeometry>>& geometryPointers)
     {
         return BuildSplitByLongAxisBoundingBoxHierarchy<T>(1, parameters, inputGeometries, geometryPointers);
     }
+
+    /// @brief The bounds and center points of the geometries being built into a hierarchy, calculated once up front and
+    /// stored as separate arrays so the binning loops only touch the components they need.
+    template <real_number T>
+    class BoundingBoxBuildPrimitives
+    {
+    public:
+        std::vector<const IntersectableGeometry*> Geometries{};
+
+        std::vector<T> MinimumX{};
+        std::vector<T> MinimumY{};
+        std::vector<T> MinimumZ{};
+
+        std::vector<T> MaximumX{};
+        std::vector<T> MaximumY{};
+        std::vector<T> MaximumZ{};
+
+        std::vector<T> CenterX{};
+        std::vector<T> CenterY{};
+        std::vector<T> CenterZ{};
+
+        BoundingBoxBuildPrimitives(const std::vector<const IntersectableGeometry*>& geometries, size_t taskSize)
+            :
+            Geometries{geometries},
+            MinimumX(geometries.size()),
+            MinimumY(geometries.size()),
+            MinimumZ(geometries.size()),
+            MaximumX(geometries.size()),
+            MaximumY(geometries.size()),
+            MaximumZ(geometries.size()),
+            CenterX(geometries.size()),
+            CenterY(geometries.size()),
+            CenterZ(geometries.size())
+        {
+            if (taskSize == 0 || geometries.size() <= taskSize)
+            {
+                CalculateBounds(0, geometries.size());
+                return;
+            }
+
+            std::vector<size_t> taskBegins{};
+            for (size_t begin = 0; begin < geometries.size(); begin += taskSize)
+            {
+                taskBegins.push_back(begin);
+            }
+
+            std::for_each(std::execution::par, taskBegins.begin(), taskBegins.end(), [&](size_t begin)
+            {
+                CalculateBounds(begin, Math::min(geometries.size(), begin + taskSize));
+            });
+        }
+
+        force_inline BoundingBoxT<T> GetBounds(size_t index) const
+        {
+            return BoundingBoxT<T>{
+                Vector3T<T>{MinimumX[index], MinimumY[index], MinimumZ[index]},
+                Vector3T<T>{MaximumX[index], MaximumY[index], MaximumZ[index]},
+            };
+        }
+
+        force_inline const std::vector<T>& GetCenters(size_t axis) const
+        {
+            return axis == 0 ? CenterX : (axis == 1 ? CenterY : CenterZ);
+        }
+
+    private:
+        void CalculateBounds(size_t begin, size_t end)
+        {
+            for (size_t i = begin; i < end; i++)
+            {
+                auto boundingBox = Geometries[i]->CalculateBoundingBox();
+
+                MinimumX[i] = static_cast<T>(boundingBox.Minimum.X);
+                MinimumY[i] = static_cast<T>(boundingBox.Minimum.Y);
+                MinimumZ[i] = static_cast<T>(boundingBox.Minimum.Z);
+
+                MaximumX[i] = static_cast<T>(boundingBox.Maximum.X);
+                MaximumY[i] = static_cast<T>(boundingBox.Maximum.Y);
+                MaximumZ[i] = static_cast<T>(boundingBox.Maximum.Z);
+
+                CenterX[i] = (MinimumX[i] + MaximumX[i]) * T{0.5};
+                CenterY[i] = (MinimumY[i] + MaximumY[i]) * T{0.5};
+                CenterZ[i] = (MinimumZ[i] + MaximumZ[i]) * T{0.5};
+            }
+        }
+    };
+
+    /// @brief A contiguous range of the primitive index array along with the bounds of the primitives in it.
+    template <real_number T>
+    class BoundingBoxBuildCluster
+    {
+    public:
+        size_t Begin{};
+        size_t End{};
+        BoundingBoxT<T> Bounds{BoundingBoxT<T>::ReverseInfinity()};
+    };
+
+    template <real_number T>
+    BoundingBoxBuildCluster<T> CreateBoundingBoxBuildCluster(
+        const BoundingBoxBuildPrimitives<T>& primitives,
+        const std::vector<std::uint32_t>& indices,
+        size_t begin,
+        size_t end)
+    {
+        BoundingBoxBuildCluster<T> cluster{begin, end};
+
+        for (size_t i = begin; i < end; i++)
+        {
+            cluster.Bounds = cluster.Bounds.Union(primitives.GetBounds(indices[i]));
+        }
+
+        return cluster;
+    }
+
+    /// @brief Finds the cheapest split of the cluster's primitives using binned SAH and partitions the primitive indices
+    /// around it. If no split can be found, for example because every center point is identical, the primitives are split
+    /// in half.
+    /// @return The index of the first primitive in the right half and the unnormalized SAH cost of the split, which is the
+    /// sum of the surface area of each half multiplied by its primitive count.
+    template <real_number T>
+    std::tuple<size_t, T> PartitionBinnedSah(
+        const BoundingBoxBuildParameters& parameters,
+        const BoundingBoxBuildPrimitives<T>& primitives,
+        std::vector<std::uint32_t>& indices,
+        const BoundingBoxBuildCluster<T>& cluster)
+    {
+        size_t count = cluster.End - cluster.Begin;
+        size_t binCount = Math::max(static_cast<size_t>(2), parameters.BinCount);
+
+        BoundingBoxT<T> centerPointBounds = BoundingBoxT<T>::ReverseInfinity();
+        for (size_t i = cluster.Begin; i < cluster.End; i++)
+        {
+            std::uint32_t index = indices[i];
+            centerPointBounds = centerPointBounds.Union(Vector3T<T>{primitives.CenterX[index], primitives.CenterY[index], primitives.CenterZ[index]});
+        }
+
+        std::vector<BoundingBoxT<T>> binBounds(binCount, BoundingBoxT<T>::ReverseInfinity());
+        std::vector<size_t> binCounts(binCount);
+        std::vector<BoundingBoxT<T>> rightBounds(binCount, BoundingBoxT<T>::ReverseInfinity());
+        std::vector<size_t> rightCounts(binCount);
+
+        T bestCost = std::numeric_limits<T>::infinity();
+        size_t bestAxis = 0;
+        size_t bestBin = 0;
+
+        auto calculateBinIndex = [&](T centerPoint, size_t axis)
+        {
+            T extent = centerPointBounds.Maximum[axis] - centerPointBounds.Minimum[axis];
+            T binIndex = (centerPoint - centerPointBounds.Minimum[axis]) * (static_cast<T>(binCount) / extent);
+
+            return Math::min(binCount - 1, static_cast<size_t>(Math::max(T{0}, binIndex)));
+        };
+
+        for (size_t axis = 0; axis < 3; axis++)
+        {
+            if (!(centerPointBounds.Maximum[axis] - centerPointBounds.Minimum[axis] > T{0}))
+            {
+                continue;
+            }
+
+            const std::vector<T>& centers = primitives.GetCenters(axis);
+
+            std::fill(binBounds.begin(), binBounds.end(), BoundingBoxT<T>::ReverseInfinity());
+            std::fill(binCounts.begin(), binCounts.end(), 0);
+
+            for (size_t i = cluster.Begin; i < cluster.End; i++)
+            {
+                std::uint32_t index = indices[i];
+                size_t binIndex = calculateBinIndex(centers[index], axis);
+
+                binBounds[binIndex] = binBounds[binIndex].Union(primitives.GetBounds(index));
+                binCounts[binIndex]++;
+            }
+
+            // Sweep from the right to accumulate the bounds to the right of every split plane.
+            rightBounds[binCount - 1] = binBounds[binCount - 1];
+            rightCounts[binCount - 1] = binCounts[binCount - 1];
+
+            for (size_t bin = binCount - 1; bin > 0; bin--)
+            {
+                rightBounds[bin - 1] = rightBounds[bin].Union(binBounds[bin - 1]);
+                rightCounts[bin - 1] = rightCounts[bin] + binCounts[bin - 1];
+            }
+
+            // Sweep from the left evaluating the split plane after each bin.
+            BoundingBoxT<T> leftBounds = BoundingBoxT<T>::ReverseInfinity();
+            size_t leftCount = 0;
+
+            for (size_t bin = 0; bin < binCount - 1; bin++)
+            {
+                leftBounds = leftBounds.Union(binBounds[bin]);
+                leftCount += binCounts[bin];
+
+                if (leftCount == 0 || rightCounts[bin + 1] == 0)
+                {
+                    continue;
+                }
+
+                T cost =
+                    leftBounds.CalculateSurfaceArea() * static_cast<T>(leftCount) +
+                    rightBounds[bin + 1].CalculateSurfaceArea() * static_cast<T>(rightCounts[bin + 1]);
+
+                if (cost < bestCost)
+                {
+                    bestCost = cost;
+                    bestAxis = axis;
+                    bestBin = bin;
+                }
+            }
+        }
+
+        if (bestCost == std::numeric_limits<T>::infinity())
+        {
+            size_t middle = cluster.Begin + count / 2;
+            return std::make_tuple(middle, cluster.Bounds.CalculateSurfaceArea() * static_cast<T>(count));
+        }
+
+        const std::vector<T>& bestCenters = primitives.GetCenters(bestAxis);
+
+        auto middle = std::partition(
+            indices.begin() + cluster.Begin,
+            indices.begin() + cluster.End,
+            [&](std::uint32_t index) { return calculateBinIndex(bestCenters[index], bestAxis) <= bestBin; });
+
+        return std::make_tuple(static_cast<size_t>(middle - indices.begin()), bestCost);
+    }
+
+    template <real_number T>
+    const IntersectableGeometry* CreateBinnedSahLeafGeometry(
+        const BoundingBoxBuildPrimitives<T>& primitives,
+        const std::vector<std::uint32_t>& indices,
+        const BoundingBoxBuildCluster<T>& cluster,
+        std::vector<std::shared_ptr<IntersectableGeometry>>& geometryPointers)
+    {
+        std::vector<const IntersectableGeometry*> leafGeometries{};
+        leafGeometries.reserve(cluster.End - cluster.Begin);
+
+        for (size_t i = cluster.Begin; i < cluster.End; i++)
+        {
+            leafGeometries.push_back(primitives.Geometries[indices[i]]);
+        }
+
+        return CreateLeafGeometry(leafGeometries, geometryPointers);
+    }
+
+    template <real_number T>
+    const BoundingBoxHierarchyT<T>* BuildBinnedSahBoundingBoxHierarchy(
+        size_t currentDepth,
+        const BoundingBoxBuildParameters& parameters,
+        const BoundingBoxBuildPrimitives<T>& primitives,
+        std::vector<std::uint32_t>& indices,
+        const BoundingBoxBuildCluster<T>& nodeCluster,
+        std::vector<std::shared_ptr<IntersectableGeometry>>& geometryPointers)
+    {
+        constexpr size_t Size = BoundingBoxHierarchyT<T>::NumberOfLeafs;
+
+        auto hierarchy = std::shared_ptr<BoundingBoxHierarchyT<T>>(new BoundingBoxHierarchyT<T>{});
+        geometryPointers.push_back(hierarchy);
+
+        // A wide node is built by repeatedly splitting the cluster with the largest surface area in two until every leaf
+        // of the node is used or there is nothing left to split.
+        std::vector<BoundingBoxBuildCluster<T>> clusters{nodeCluster};
+        clusters.reserve(Size);
+
+        while (clusters.size() < Size)
+        {
+            size_t largestCluster = clusters.size();
+            T largestSurfaceArea = -std::numeric_limits<T>::infinity();
+
+            for (size_t i = 0; i < clusters.size(); i++)
+            {
+                T surfaceArea = clusters[i].Bounds.CalculateSurfaceArea();
+
+                if (clusters[i].End - clusters[i].Begin > 1 && surfaceArea > largestSurfaceArea)
+                {
+                    largestCluster = i;
+                    largestSurfaceArea = surfaceArea;
+                }
+            }
+
+            if (largestCluster == clusters.size())
+            {
+                break;
+            }
+
+            BoundingBoxBuildCluster<T> cluster = clusters[largestCluster];
+            auto [middle, ignored] = PartitionBinnedSah(parameters, primitives, indices, cluster);
+
+            clusters[largestCluster] = CreateBoundingBoxBuildCluster(primitives, indices, cluster.Begin, middle);
+            clusters.push_back(CreateBoundingBoxBuildCluster(primitives, indices, middle, cluster.End));
+        }
+
+        // Large subtrees work on disjoint ranges of the index array so they are built as separate tasks once every other
+        // child is set, see RunParallelBuildTasks.
+        std::vector<size_t> parallelSubtrees{};
+
+        for (size_t i = 0; i < clusters.size(); i++)
+        {
+            const BoundingBoxBuildCluster<T>& cluster = clusters[i];
+            size_t count = cluster.End - cluster.Begin;
+
+            bool createLeaf = currentDepth >= parameters.MaxDepth || count <= parameters.PreferredNodeSize.X;
+
+            // Between the two preferred node sizes only keep splitting if the SAH says it is cheaper than a leaf.
+            if (!createLeaf && count <= parameters.PreferredNodeSize.Y)
+            {
+                auto [middle, splitCost] = PartitionBinnedSah(parameters, primitives, indices, cluster);
+
+                T surfaceArea = cluster.Bounds.CalculateSurfaceArea();
+                T leafCost = static_cast<T>(parameters.IntersectionCost) * surfaceArea * static_cast<T>(count);
+                T nodeCost = static_cast<T>(parameters.TraversalCost) * surfaceArea + static_cast<T>(parameters.IntersectionCost) * splitCost;
+
+                createLeaf = leafCost <= nodeCost;
+            }
+
+            if (createLeaf)
+            {
+                hierarchy->SetChild(i, cluster.Bounds, CreateBinnedSahLeafGeometry(primitives, indices, cluster, geometryPointers));
+            }
+            else if (IsParallelSubtree(parameters, currentDepth, count))
+            {
+                parallelSubtrees.push_back(i);
+            }
+            else
+            {
+                auto childHierarchy = BuildBinnedSahBoundingBoxHierarchy<T>(currentDepth + 1, parameters, primitives, indices, cluster, geometryPointers);
+                hierarchy->SetChild(i, cluster.Bounds, childHierarchy);
+            }
+        }
+
+        RunParallelBuildTasks(parallelSubtrees.size(), [&](size_t task, std::vector<std::shared_ptr<IntersectableGeometry>>& taskGeometryPointers)
+        {
+            const BoundingBoxBuildCluster<T>& cluster = clusters[parallelSubtrees[task]];
+
+            // Every task sets a different child so the node can be shared between them.
+            auto childHierarchy = BuildBinnedSahBoundingBoxHierarchy<T>(currentDepth + 1, parameters, primitives, indices, cluster, taskGeometryPointers);
+            hierarchy->SetChild(parallelSubtrees[task], cluster.Bounds, childHierarchy);
+        }, geometryPointers);
+
+        return hierarchy.get();
+    }
+
+    /// @brief Builds a hierarchy that splits the geometries using the surface area heuristic evaluated over a fixed number
+    /// of bins per axis. Each geometry's bounding box is calculated once up front rather than once per comparison and
+    /// subtrees larger than BoundingBoxBuildParameters::ParallelSubtreeSize are built concurrently, down to ParallelDepth.
+    export template<real_number T = real>
+        const BoundingBoxHierarchyT<T>* BuildBinnedSahBoundingBoxHierarchy(
+            const BoundingBoxBuildParameters& parameters,
+            std::vector<const IntersectableGeometry*>& inputGeometries,
+            std::vector<std::shared_ptr<IntersectableGeometry>>& geometryPointers)
+    {
+        BoundingBoxBuildPrimitives<T> primitives{inputGeometries, parameters.ParallelSubtreeSize};
+
+        std::vector<std::uint32_t> indices(inputGeometries.size());
+        std::iota(indices.begin(), indices.end(), 0);
+
+        auto rootCluster = CreateBoundingBoxBuildCluster(primitives, indices, 0, indices.size());
+        return BuildBinnedSahBoundingBoxHierarchy<T>(1, parameters, primitives, indices, rootCluster, geometryPointers);
+    }
+
+    /// @brief A reference to a primitive used by the spatial split builder. A primitive can be referenced more than once,
+    /// each reference having its own bounds clipped to the part of the primitive it covers.
+    template <real_number T>
+    class SpatialSplitReference
+    {
+    public:
+        std::uint32_t PrimitiveIndex{};
+        BoundingBoxT<T> Bounds{BoundingBoxT<T>::ReverseInfinity()};
+    };
+
+    template <real_number T>
+    class SpatialSplitCluster
+    {
+    public:
+        std::vector<SpatialSplitReference<T>> References{};
+        BoundingBoxT<T> Bounds{BoundingBoxT<T>::ReverseInfinity()};
+
+        void CalculateBounds()
+        {
+            Bounds = BoundingBoxT<T>::ReverseInfinity();
+
+            for (const auto& reference : References)
+            {
+                Bounds = Bounds.Union(reference.Bounds);
+            }
+        }
+    };
+
+    template <real_number T>
+    class SpatialSplitCandidate
+    {
+    public:
+        T Cost{std::numeric_limits<T>::infinity()};
+        bool IsSpatial{};
+        size_t Axis{};
+
+        // Object splits partition by the bin of each reference's center point, spatial splits by a plane position.
+        size_t Bin{};
+        T BinMinimum{};
+        T BinScale{};
+        T Position{};
+
+        size_t LeftCount{};
+        size_t RightCount{};
+        BoundingBoxT<T> LeftBounds{BoundingBoxT<T>::ReverseInfinity()};
+        BoundingBoxT<T> RightBounds{BoundingBoxT<T>::ReverseInfinity()};
+    };
+
+    template <real_number T>
+    class SpatialSplitBuildState
+    {
+    public:
+        const BoundingBoxBuildParameters& Parameters;
+        const BoundingBoxBuildPrimitives<T>& Primitives;
+
+        // Triangles are clipped exactly, every other geometry is clipped by its bounding box.
+        std::vector<const Triangle*> Triangles{};
+        std::vector<const IndexedTriangle*> IndexedTriangles{};
+
+        T RootSurfaceArea{};
+        size_t RemainingDuplicates{};
+
+        SpatialSplitBuildState(const BoundingBoxBuildParameters& parameters, const BoundingBoxBuildPrimitives<T>& primitives)
+            :
+            Parameters{parameters},
+            Primitives{primitives}
+        {
+            Triangles.reserve(primitives.Geometries.size());
+            IndexedTriangles.reserve(primitives.Geometries.size());
+
+            for (const auto* geometry : primitives.Geometries)
+            {
+                Triangles.push_back(dynamic_cast<const Triangle*>(geometry));
+                IndexedTriangles.push_back(dynamic_cast<const IndexedTriangle*>(geometry));
+            }
+        }
+    };
+
+    /// @brief Calculates the bounds of the part of a reference that lies between minimum and maximum along axis.
+    template <real_number T>
+    BoundingBoxT<T> ClipSpatialSplitReference(
+        const SpatialSplitBuildState<T>& state,
+        const SpatialSplitReference<T>& reference,
+        size_t axis,
+        T minimum,
+        T maximum)
+    {
+        BoundingBoxT<T> slab = BoundingBoxT<T>::Infinity();
+        slab.Minimum[axis] = minimum;
+        slab.Maximum[axis] = maximum;
+
+        Vector3T<T> vertices[3]{};
+
+        if (const Triangle* triangle = state.Triangles[reference.PrimitiveIndex])
+        {
+            vertices[0] = static_cast<Vector3T<T>>(triangle->Vertex0);
+            vertices[1] = static_cast<Vector3T<T>>(triangle->Vertex1);
+            vertices[2] = static_cast<Vector3T<T>>(triangle->Vertex2);
+        }
+        else if (const IndexedTriangle* indexedTriangle = state.IndexedTriangles[reference.PrimitiveIndex])
+        {
+            for (size_t i = 0; i < 3; i++)
+            {
+                vertices[i] = static_cast<Vector3T<T>>(indexedTriangle->Mesh->GetVertex(indexedTriangle->TriangleIndex, i));
+            }
+        }
+        else
+        {
+            return reference.Bounds.Intersection(slab);
+        }
+
+        // The clipped polygon is made up of the vertices inside the slab and the points where the edges cross the slab's
+        // planes.
+        BoundingBoxT<T> clippedBounds = BoundingBoxT<T>::ReverseInfinity();
+
+        for (size_t i = 0; i < 3; i++)
+        {
+            const Vector3T<T>& start = vertices[i];
+            const Vector3T<T>& end = vertices[(i + 1) % 3];
+
+            T startValue = start[axis];
+            T endValue = end[axis];
+
+            if (startValue >= minimum && startValue <= maximum)
+            {
+                clippedBounds = clippedBounds.Union(start);
+            }
+
+            for (T plane : {minimum, maximum})
+            {
+                if ((startValue < plane && endValue > plane) || (startValue > plane && endValue < plane))
+                {
+                    T t = (plane - startValue) / (endValue - startValue);
+
+                    Vector3T<T> point = start + (end - start) * t;
+                    point[axis] = plane;
+
+                    clippedBounds = clippedBounds.Union(point);
+                }
+            }
+        }
+
+        // The reference may already have been clipped by an earlier split.
+        return clippedBounds.Intersection(reference.Bounds).Intersection(slab);
+    }
+
+    template <real_number T>
+    SpatialSplitCandidate<T> FindObjectSplit(const SpatialSplitBuildState<T>& state, const SpatialSplitCluster<T>& cluster)
+    {
+        size_t binCount = Math::max(static_cast<size_t>(2), state.Parameters.BinCount);
+
+        BoundingBoxT<T> centerPointBounds = BoundingBoxT<T>::ReverseInfinity();
+        for (const auto& reference : cluster.References)
+        {
+            centerPointBounds = centerPointBounds.Union(reference.Bounds.CalculateCenterPoint());
+        }
+
+        std::vector<BoundingBoxT<T>> binBounds(binCount, BoundingBoxT<T>::ReverseInfinity());
+        std::vector<size_t> binCounts(binCount);
+        std::vector<BoundingBoxT<T>> rightBounds(binCount, BoundingBoxT<T>::ReverseInfinity());
+        std::vector<size_t> rightCounts(binCount);
+
+        SpatialSplitCandidate<T> best{};
+
+        for (size_t axis = 0; axis < 3; axis++)
+        {
+            T extent = centerPointBounds.Maximum[axis] - centerPointBounds.Minimum[axis];
+            if (!(extent > T{0}))
+            {
+                continue;
+            }
+
+            T binScale = static_cast<T>(binCount) / extent;
+
+            std::fill(binBounds.begin(), binBounds.end(), BoundingBoxT<T>::ReverseInfinity());
+            std::fill(binCounts.begin(), binCounts.end(), 0);
+
+            for (const auto& reference : cluster.References)
+            {
+                T binIndex = (reference.Bounds.CalculateCenterPoint()[axis] - centerPointBounds.Minimum[axis]) * binScale;
+                size_t bin = Math::min(binCount - 1, static_cast<size_t>(Math::max(T{0}, binIndex)));
+
+                binBounds[bin] = binBounds[bin].Union(reference.Bounds);
+                binCounts[bin]++;
+            }
+
+            rightBounds[binCount - 1] = binBounds[binCount - 1];
+            rightCounts[binCount - 1] = binCounts[binCount - 1];
+
+            for (size_t bin = binCount - 1; bin > 0; bin--)
+            {
+                rightBounds[bin - 1] = rightBounds[bin].Union(binBounds[bin - 1]);
+                rightCounts[bin - 1] = rightCounts[bin] + binCounts[bin - 1];
+            }
+
+            BoundingBoxT<T> leftBounds = BoundingBoxT<T>::ReverseInfinity();
+            size_t leftCount = 0;
+
+            for (size_t bin = 0; bin < binCount - 1; bin++)
+            {
+                leftBounds = leftBounds.Union(binBounds[bin]);
+                leftCount += binCounts[bin];
+
+                if (leftCount == 0 || rightCounts[bin + 1] == 0)
+                {
+                    continue;
+                }
+
+                T cost =
+                    leftBounds.CalculateSurfaceArea() * static_cast<T>(leftCount) +
+                    rightBounds[bin + 1].CalculateSurfaceArea() * static_cast<T>(rightCounts[bin + 1]);
+
+                if (cost < best.Cost)
+                {
+                    best = SpatialSplitCandidate<T>{
+                        .Cost = cost,
+                        .IsSpatial = false,
+                        .Axis = axis,
+                        .Bin = bin,
+                        .BinMinimum = centerPointBounds.Minimum[axis],
+                        .BinScale = binScale,
+                        .LeftCount = leftCount,
+                        .RightCount = rightCounts[bin + 1],
+                        .LeftBounds = leftBounds,
+                        .RightBounds = rightBounds[bin + 1],
+                    };
+                }
+            }
+        }
+
+        return best;
+    }
+
+    template <real_number T>
+    SpatialSplitCandidate<T> FindSpatialSplit(const SpatialSplitBuildState<T>& state, const SpatialSplitCluster<T>& cluster)
+    {
+        size_t binCount = Math::max(static_cast<size_t>(2), state.Parameters.BinCount);
+
+        std::vector<BoundingBoxT<T>> binBounds(binCount, BoundingBoxT<T>::ReverseInfinity());
+        std::vector<size_t> entryCounts(binCount);
+        std::vector<size_t> exitCounts(binCount);
+        std::vector<BoundingBoxT<T>> rightBounds(binCount, BoundingBoxT<T>::ReverseInfinity());
+        std::vector<size_t> rightCounts(binCount);
+
+        SpatialSplitCandidate<T> best{};
+
+        for (size_t axis = 0; axis < 3; axis++)
+        {
+            T nodeMinimum = cluster.Bounds.Minimum[axis];
+            T extent = cluster.Bounds.Maximum[axis] - nodeMinimum;
+
+            if (!(extent > T{0}))
+            {
+                continue;
+            }
+
+            T binWidth = extent / static_cast<T>(binCount);
+            auto calculateBin = [&](T value)
+            {
+                return Math::min(binCount - 1, static_cast<size_t>(Math::max(T{0}, (value - nodeMinimum) / binWidth)));
+            };
+
+            std::fill(binBounds.begin(), binBounds.end(), BoundingBoxT<T>::ReverseInfinity());
+            std::fill(entryCounts.begin(), entryCounts.end(), 0);
+            std::fill(exitCounts.begin(), exitCounts.end(), 0);
+
+            // Clip every reference into each bin it spans. References are counted where they enter and where they exit
+            // so that a reference spanning a split plane is counted on both sides of it.
+            for (const auto& reference : cluster.References)
+            {
+                size_t firstBin = calculateBin(reference.Bounds.Minimum[axis]);
+                size_t lastBin = calculateBin(reference.Bounds.Maximum[axis]);
+
+                for (size_t bin = firstBin; bin <= lastBin; bin++)
+                {
+                    T binMinimum = nodeMinimum + static_cast<T>(bin) * binWidth;
+                    T binMaximum = bin == binCount - 1 ? cluster.Bounds.Maximum[axis] : nodeMinimum + static_cast<T>(bin + 1) * binWidth;
+
+                    BoundingBoxT<T> clippedBounds = ClipSpatialSplitReference(state, reference, axis, binMinimum, binMaximum);
+                    if (!clippedBounds.IsEmpty())
+                    {
+                        binBounds[bin] = binBounds[bin].Union(clippedBounds);
+                    }
+                }
+
+                entryCounts[firstBin]++;
+                exitCounts[lastBin]++;
+            }
+
+            rightBounds[binCount - 1] = binBounds[binCount - 1];
+            rightCounts[binCount - 1] = exitCounts[binCount - 1];
+
+            for (size_t bin = binCount - 1; bin > 0; bin--)
+            {
+                rightBounds[bin - 1] = rightBounds[bin].Union(binBounds[bin - 1]);
+                rightCounts[bin - 1] = rightCounts[bin] + exitCounts[bin - 1];
+            }
+
+            BoundingBoxT<T> leftBounds = BoundingBoxT<T>::ReverseInfinity();
+            size_t leftCount = 0;
+
+            for (size_t bin = 0; bin < binCount - 1; bin++)
+            {
+                leftBounds = leftBounds.Union(binBounds[bin]);
+                leftCount += entryCounts[bin];
+
+                size_t rightCount = rightCounts[bin + 1];
+
+                // A split that keeps every reference on one side makes no progress.
+                if (leftCount == 0 || rightCount == 0 || leftCount == cluster.References.size() || rightCount == cluster.References.size())
+                {
+                    continue;
+                }
+
+                T cost =
+                    leftBounds.CalculateSurfaceArea() * static_cast<T>(leftCount) +
+                    rightBounds[bin + 1].CalculateSurfaceArea() * static_cast<T>(rightCount);
+
+                if (cost < best.Cost)
+                {
+                    best = SpatialSplitCandidate<T>{
+                        .Cost = cost,
+                        .IsSpatial = true,
+                        .Axis = axis,
+                        .Position = nodeMinimum + static_cast<T>(bin + 1) * binWidth,
+                        .LeftCount = leftCount,
+                        .RightCount = rightCount,
+                        .LeftBounds = leftBounds,
+                        .RightBounds = rightBounds[bin + 1],
+                    };
+                }
+            }
+        }
+
+        return best;
+    }
+
+    template <real_number T>
+    SpatialSplitCandidate<T> FindSpatialSplitBuildSplit(const SpatialSplitBuildState<T>& state, const SpatialSplitCluster<T>& cluster)
+    {
+        SpatialSplitCandidate<T> objectSplit = FindObjectSplit(state, cluster);
+
+        // Spatial splits are only worth evaluating when the children of the best object split overlap noticeably.
+        if (objectSplit.Cost != std::numeric_limits<T>::infinity())
+        {
+            BoundingBoxT<T> overlap = objectSplit.LeftBounds.Intersection(objectSplit.RightBounds);
+            T overlapSurfaceArea = overlap.IsEmpty() ? T{0} : overlap.CalculateSurfaceArea();
+
+            if (overlapSurfaceArea <= static_cast<T>(state.Parameters.SpatialSplitOverlapThreshold) * state.RootSurfaceArea)
+            {
+                return objectSplit;
+            }
+        }
+
+        if (state.RemainingDuplicates == 0)
+        {
+            return objectSplit;
+        }
+
+        SpatialSplitCandidate<T> spatialSplit = FindSpatialSplit(state, cluster);
+        size_t duplicates = spatialSplit.LeftCount + spatialSplit.RightCount - Math::min(spatialSplit.LeftCount + spatialSplit.RightCount, cluster.References.size());
+
+        if (spatialSplit.Cost < objectSplit.Cost && duplicates <= state.RemainingDuplicates)
+        {
+            return spatialSplit;
+        }
+
+        return objectSplit;
+    }
+
+    template <real_number T>
+    std::tuple<SpatialSplitCluster<T>, SpatialSplitCluster<T>> SplitSpatialSplitCluster(
+        SpatialSplitBuildState<T>& state,
+        SpatialSplitCluster<T>& cluster,
+        const SpatialSplitCandidate<T>& candidate)
+    {
+        SpatialSplitCluster<T> left{};
+        SpatialSplitCluster<T> right{};
+
+        if (candidate.Cost == std::numeric_limits<T>::infinity())
+        {
+            // No split was found so fall back to splitting the references in half.
+            size_t middle = cluster.References.size() / 2;
+
+            left.References.assign(cluster.References.begin(), cluster.References.begin() + middle);
+            right.References.assign(cluster.References.begin() + middle, cluster.References.end());
+        }
+        else if (!candidate.IsSpatial)
+        {
+            size_t binCount = Math::max(static_cast<size_t>(2), state.Parameters.BinCount);
+
+            for (const auto& reference : cluster.References)
+            {
+                T binIndex = (reference.Bounds.CalculateCenterPoint()[candidate.Axis] - candidate.BinMinimum) * candidate.BinScale;
+                size_t bin = Math::min(binCount - 1, static_cast<size_t>(Math::max(T{0}, binIndex)));
+
+                (bin <= candidate.Bin ? left : right).References.push_back(reference);
+            }
+        }
+        else
+        {
+            for (const auto& reference : cluster.References)
+            {
+                if (reference.Bounds.Maximum[candidate.Axis] <= candidate.Position)
+                {
+                    left.References.push_back(reference);
+                }
+                else if (reference.Bounds.Minimum[candidate.Axis] >= candidate.Position)
+                {
+                    right.References.push_back(reference);
+                }
+                else
+                {
+                    // The reference straddles the split plane so it is clipped into both children.
+                    auto leftBounds = ClipSpatialSplitReference(state, reference, candidate.Axis, -std::numeric_limits<T>::infinity(), candidate.Position);
+                    auto rightBounds = ClipSpatialSplitReference(state, reference, candidate.Axis, candidate.Position, std::numeric_limits<T>::infinity());
+
+                    if (!leftBounds.IsEmpty())
+                    {
+                        left.References.push_back(SpatialSplitReference<T>{reference.PrimitiveIndex, leftBounds});
+                    }
+
+                    if (!rightBounds.IsEmpty())
+                    {
+                        right.References.push_back(SpatialSplitReference<T>{reference.PrimitiveIndex, rightBounds});
+                    }
+                }
+            }
+
+            size_t duplicates = left.References.size() + right.References.size() - Math::min(left.References.size() + right.References.size(), cluster.References.size());
+            state.RemainingDuplicates -= Math::min(state.RemainingDuplicates, duplicates);
+        }
+
+        cluster.References.clear();
+        cluster.References.shrink_to_fit();
+
+        left.CalculateBounds();
+        right.CalculateBounds();
+
+        return std::make_tuple(std::move(left), std::move(right));
+    }
+
+    template <real_number T>
+    const IntersectableGeometry* CreateSpatialSplitLeafGeometry(
+        const SpatialSplitBuildState<T>& state,
+        const SpatialSplitCluster<T>& cluster,
+        std::vector<std::shared_ptr<IntersectableGeometry>>& geometryPointers)
+    {
+        // A primitive split by a plane can end up in the same leaf twice.
+        std::vector<std::uint32_t> primitiveIndices{};
+        primitiveIndices.reserve(cluster.References.size());
+
+        for (const auto& reference : cluster.References)
+        {
+            primitiveIndices.push_back(reference.PrimitiveIndex);
+        }
+
+        std::sort(primitiveIndices.begin(), primitiveIndices.end());
+        primitiveIndices.erase(std::unique(primitiveIndices.begin(), primitiveIndices.end()), primitiveIndices.end());
+
+        std::vector<const IntersectableGeometry*> leafGeometries{};
+        leafGeometries.reserve(primitiveIndices.size());
+
+        for (auto primitiveIndex : primitiveIndices)
+        {
+            leafGeometries.push_back(state.Primitives.Geometries[primitiveIndex]);
+        }
+
+        return CreateLeafGeometry(leafGeometries, geometryPointers);
+    }
+
+    template <real_number T>
+    const BoundingBoxHierarchyT<T>* BuildSpatialSplitBoundingBoxHierarchy(
+        size_t currentDepth,
+        SpatialSplitBuildState<T>& state,
+        SpatialSplitCluster<T> nodeCluster,
+        std::vector<std::shared_ptr<IntersectableGeometry>>& geometryPointers)
+    {
+        constexpr size_t Size = BoundingBoxHierarchyT<T>::NumberOfLeafs;
+        const BoundingBoxBuildParameters& parameters = state.Parameters;
+
+        auto hierarchy = std::shared_ptr<BoundingBoxHierarchyT<T>>(new BoundingBoxHierarchyT<T>{});
+        geometryPointers.push_back(hierarchy);
+
+        std::vector<SpatialSplitCluster<T>> clusters{};
+        clusters.reserve(Size);
+        clusters.push_back(std::move(nodeCluster));
+
+        while (clusters.size() < Size)
+        {
+            size_t largestCluster = clusters.size();
+            T largestSurfaceArea = -std::numeric_limits<T>::infinity();
+
+            for (size_t i = 0; i < clusters.size(); i++)
+            {
+                T surfaceArea = clusters[i].Bounds.CalculateSurfaceArea();
+
+                if (clusters[i].References.size() > 1 && surfaceArea > largestSurfaceArea)
+                {
+                    largestCluster = i;
+                    largestSurfaceArea = surfaceArea;
+                }
+            }
+
+            if (largestCluster == clusters.size())
+            {
+                break;
+            }
+
+            SpatialSplitCandidate<T> candidate = FindSpatialSplitBuildSplit(state, clusters[largestCluster]);
+            auto [left, right] = SplitSpatialSplitCluster(state, clusters[largestCluster], candidate);
+
+            clusters[largestCluster] = std::move(left);
+            clusters.push_back(std::move(right));
+        }
+
+        for (size_t i = 0; i < clusters.size(); i++)
+        {
+            SpatialSplitCluster<T>& cluster = clusters[i];
+            size_t count = cluster.References.size();
+
+            if (count == 0)
+            {
+                continue;
+            }
+
+            bool createLeaf = currentDepth >= parameters.MaxDepth || count <= parameters.PreferredNodeSize.X;
+
+            if (!createLeaf && count <= parameters.PreferredNodeSize.Y)
+            {
+                SpatialSplitCandidate<T> candidate = FindSpatialSplitBuildSplit(state, cluster);
+
+                T surfaceArea = cluster.Bounds.CalculateSurfaceArea();
+                T leafCost = static_cast<T>(parameters.IntersectionCost) * surfaceArea * static_cast<T>(count);
+                T nodeCost = static_cast<T>(parameters.TraversalCost) * surfaceArea + static_cast<T>(parameters.IntersectionCost) * candidate.Cost;
+
+                createLeaf = leafCost <= nodeCost;
+            }
+
+            BoundingBoxT<T> clusterBounds = cluster.Bounds;
+
+            if (createLeaf)
+            {
+                hierarchy->SetChild(i, clusterBounds, CreateSpatialSplitLeafGeometry(state, cluster, geometryPointers));
+            }
+            else
+            {
+                auto childHierarchy = BuildSpatialSplitBoundingBoxHierarchy<T>(currentDepth + 1, state, std::move(cluster), geometryPointers);
+                hierarchy->SetChild(i, clusterBounds, childHierarchy);
+            }
+        }
+
+        return hierarchy.get();
+    }
+
+    /// @brief Builds a hierarchy using binned SAH object splits combined with spatial splits that clip primitives which
+    /// straddle a split plane into both children (SBVH). This produces tighter, less overlapping nodes for long thin
+    /// triangles at the cost of a slower, single threaded build. The number of duplicate references is limited to
+    /// BoundingBoxBuildParameters::SpatialSplitBudget times the number of input geometries.
+    export template<real_number T = real>
+        const BoundingBoxHierarchyT<T>* BuildSpatialSplitBoundingBoxHierarchy(
+            const BoundingBoxBuildParameters& parameters,
+            std::vector<const IntersectableGeometry*>& inputGeometries,
+            std::vector<std::shared_ptr<IntersectableGeometry>>& geometryPointers)
+    {
+        BoundingBoxBuildPrimitives<T> primitives{inputGeometries, parameters.ParallelSubtreeSize};
+        SpatialSplitBuildState<T> state{parameters, primitives};
+
+        SpatialSplitCluster<T> rootCluster{};
+        rootCluster.References.reserve(inputGeometries.size());
+
+        for (size_t i = 0; i < inputGeometries.size(); i++)
+        {
+            rootCluster.References.push_back(SpatialSplitReference<T>{static_cast<std::uint32_t>(i), primitives.GetBounds(i)});
+        }
+
+        rootCluster.CalculateBounds();
+
+        state.RootSurfaceArea = rootCluster.Bounds.CalculateSurfaceArea();
+        state.RemainingDuplicates = static_cast<size_t>(Math::max(real{0}, parameters.SpatialSplitBudget) * static_cast<real>(inputGeometries.size()));
+
+        return BuildSpatialSplitBoundingBoxHierarchy<T>(1, state, std::move(rootCluster), geometryPointers);
+    }
+
+    export const BoundingBoxHierarchy* BuildBoundingBoxHierarchy(
+        const BoundingBoxBuildParameters& parameters,
+        std::vector<const IntersectableGeometry*>& inputGeometries,
+        std::vector<std::shared_ptr<IntersectableGeometry>>& geometryPointers)
+    {
+        switch (parameters.Strategy)
+        {
+            case BoundingBoxBuildStrategy::Uniform:
+                return BuildUniformBoundingBoxHierarchy(parameters, inputGeometries, geometryPointers);
+
+            case BoundingBoxBuildStrategy::BinnedSah:
+                return BuildBinnedSahBoundingBoxHierarchy(parameters, inputGeometries, geometryPointers);
+
+            case BoundingBoxBuildStrategy::SpatialSplit:
+                return BuildSpatialSplitBoundingBoxHierarchy(parameters, inputGeometries, geometryPointers);
+
+            default:
+                return BuildSplitByLongAxisBoundingBoxHierarchy(parameters, inputGeometries, geometryPointers);
+        }
+    }
+
+    /// @brief Counts the intersection tests a leaf created by one of the builders costs a ray.
+    export size_t CountLeafIntersections(const IntersectableGeometry* geometry)
+    {
+        // A SOA structure is tested with a single SIMD intersection so it only counts once.
+        if (auto geometryCollection = dynamic_cast<const GeometryCollection*>(geometry))
+        {
+            return geometryCollection->GetChildren().size();
+        }
+
+        return 1;
+    }
+
+    template <real_number T>
+    T CalculateSahCost(
+        const BoundingBoxHierarchyT<T>* hierarchy,
+        T rootSurfaceArea,
+        const BoundingBoxBuildParameters& parameters)
+    {
+        T nodeSurfaceArea = static_cast<T>(hierarchy->CalculateBoundingBox().CalculateSurfaceArea());
+        T cost = static_cast<T>(parameters.TraversalCost) * nodeSurfaceArea / rootSurfaceArea;
+
+        for (size_t i = 0; i < BoundingBoxHierarchyT<T>::NumberOfLeafs; i++)
+        {
+            const IntersectableGeometry* child = hierarchy->GetChild(i);
+
+            if (!child)
+            {
+                continue;
+            }
+
+            if (auto childHierarchy = dynamic_cast<const BoundingBoxHierarchyT<T>*>(child))
+            {
+                cost += CalculateSahCost<T>(childHierarchy, rootSurfaceArea, parameters);
+            }
+            else
+            {
+                T childSurfaceArea = hierarchy->GetChildBoundingBox(i).CalculateSurfaceArea();
+                cost += static_cast<T>(parameters.IntersectionCost) * static_cast<T>(CountLeafIntersections(child)) * childSurfaceArea / rootSurfaceArea;
+            }
+        }
+
+        return cost;
+    }
+
+    /// @brief Calculates the surface area heuristic cost of a built hierarchy: the expected cost of tracing a random ray
+    /// that hits the root bounding box, in units of TraversalCost and IntersectionCost. Lower is better.
+    export template<real_number T = real>
+        T CalculateSahCost(const BoundingBoxHierarchyT<T>* hierarchy, const BoundingBoxBuildParameters& parameters)
+    {
+        T rootSurfaceArea = static_cast<T>(hierarchy->CalculateBoundingBox().CalculateSurfaceArea());
+
+        if (!(rootSurfaceArea > T{0}) || !Math::isfinite(rootSurfaceArea))
+        {
+            return T{0};
+        }
+
+        return CalculateSahCost<T>(hierarchy, rootSurfaceArea, parameters);
+    }
+
+    template <real_number T>
+    void CollectRefittableNodes(const IntersectableGeometry* geometry, std::vector<const IntersectableGeometry*>& geometries)
+    {
+        if (auto hierarchy = dynamic_cast<const BoundingBoxHierarchyT<T>*>(geometry))
+        {
+            for (size_t i = 0; i < BoundingBoxHierarchyT<T>::NumberOfLeafs; i++)
+            {
+                if (const IntersectableGeometry* child = hierarchy->GetChild(i))
+                {
+                    CollectRefittableNodes<T>(child, geometries);
+                }
+            }
+        }
+        else if (auto geometryCollection = dynamic_cast<const GeometryCollection*>(geometry))
+        {
+            for (const IntersectableGeometry* child : geometryCollection->GetChildren())
+            {
+                CollectRefittableNodes<T>(child, geometries);
+            }
+        }
+
+        if (dynamic_cast<const RefittableGeometry*>(geometry))
+        {
+            geometries.push_back(geometry);
+        }
+    }
+
+    /// @brief Collects the nodes of a built hierarchy and the leafs its builder created, children before their parents,
+    /// from the owners the builder added to geometryPointers. Refitting them in order recalculates the bounds of every node
+    /// bottom up after the geometries of the hierarchy have moved; SOA structures copy their geometries when they are
+    /// created so they are refreshed along the way. The structure of the hierarchy is left untouched so its quality
+    /// degrades as the geometries move away from the positions it was built for; compare CalculateSahCost before and after
+    /// to decide when a full rebuild is due.
+    export template<real_number T = real>
+        std::vector<RefittableGeometry*> CollectRefittableGeometries(
+            const BoundingBoxHierarchyT<T>* hierarchy,
+            const std::vector<std::shared_ptr<IntersectableGeometry>>& geometryPointers)
+    {
+        std::vector<const IntersectableGeometry*> geometries{};
+        CollectRefittableNodes<T>(hierarchy, geometries);
+
+        return FindRefittableGeometries(geometries, geometryPointers);
+    }
 }
\ No newline at end of file
@@ -0,0 +1,321 @@
+export module BoundingBoxHierarchyStatistics;
+
+import <cstdint>;
+import <format>;
+
+import "Common.h";
+
+import BoundingBox;
+import BoundingBoxHierarchy;
+import DynamicMesh;
+import GeometryCollection;
+import GeometrySoa;
+import IntersectableGeometry;
+import LinearBoundingBoxHierarchy;
+import Math;
+import QuantizedBoundingBoxHierarchy;
+
+namespace Yart
+{
+    /// @brief Describes the shape of a built hierarchy, used to tune BoundingBoxBuildParameters from data.
+    export class BoundingBoxHierarchyStatistics
+    {
+    public:
+        std::string Layout{};
+
+        size_t NodeCount{};
+        size_t LeafCount{};
+
+        /// @brief The number of geometries referenced by the leafs. Spatial splits reference some geometries more than
+        /// once.
+        size_t PrimitiveCount{};
+
+        size_t ChildSlotsPerNode{};
+        size_t EmptyChildCount{};
+
+        /// @brief The number of nodes at each depth, the root is at depth zero.
+        std::vector<size_t> DepthHistogram{};
+
+        /// @brief The number of leafs by the number of geometries they hold.
+        std::vector<size_t> LeafSizeHistogram{};
+
+        /// @brief The number of nodes by the number of their child slots that are empty.
+        std::vector<size_t> EmptyChildHistogram{};
+
+        real SahCost{};
+
+        /// @brief Bytes used by the nodes of the hierarchy.
+        size_t NodeMemoryUsage{};
+
+        /// @brief Bytes used by the SOA structures and geometry collections the builder created for the leafs. The
+        /// geometries they were created from are not counted.
+        size_t LeafMemoryUsage{};
+
+        std::string Format(const std::string& name) const
+        {
+            std::string text = std::format("{} ({})\n", name, Layout);
+
+            text += std::format("  nodes: {}, leafs: {}, primitives: {}, max depth: {}\n", NodeCount, LeafCount, PrimitiveCount, DepthHistogram.empty() ? 0 : DepthHistogram.size() - 1);
+            text += std::format("  SAH cost: {:.3f}\n", static_cast<double>(SahCost));
+            text += std::format("  memory: {} bytes in nodes, {} bytes in leafs, {:.2f} bytes per primitive\n",
+                NodeMemoryUsage,
+                LeafMemoryUsage,
+                PrimitiveCount > 0 ? static_cast<double>(NodeMemoryUsage + LeafMemoryUsage) / static_cast<double>(PrimitiveCount) : 0.0);
+            text += std::format("  empty child slots: {} of {} ({:.1f}%)\n",
+                EmptyChildCount,
+                NodeCount * ChildSlotsPerNode,
+                NodeCount > 0 ? 100.0 * static_cast<double>(EmptyChildCount) / static_cast<double>(NodeCount * ChildSlotsPerNode) : 0.0);
+
+            text += FormatHistogram("  nodes per depth", DepthHistogram);
+            text += FormatHistogram("  leafs per size", LeafSizeHistogram);
+            text += FormatHistogram("  nodes per empty child slots", EmptyChildHistogram);
+
+            return text;
+        }
+
+    private:
+        static std::string FormatHistogram(const char* name, const std::vector<size_t>& histogram)
+        {
+            std::string text = std::format("{}:", name);
+
+            for (size_t i = 0; i < histogram.size(); i++)
+            {
+                if (histogram[i] > 0)
+                {
+                    text += std::format(" {}:{}", i, histogram[i]);
+                }
+            }
+
+            return text + "\n";
+        }
+    };
+
+    void AddToHistogram(std::vector<size_t>& histogram, size_t index)
+    {
+        if (histogram.size() <= index)
+        {
+            histogram.resize(index + 1);
+        }
+
+        histogram[index]++;
+    }
+
+    void AddLeaf(BoundingBoxHierarchyStatistics& statistics, const IntersectableGeometry* leaf, const BoundingBox& leafBoundingBox, real rootSurfaceArea, const BoundingBoxBuildParameters& parameters);
+
+    void AddNode(BoundingBoxHierarchyStatistics& statistics, size_t depth, size_t emptyChildCount, const BoundingBox& nodeBoundingBox, real rootSurfaceArea, const BoundingBoxBuildParameters& parameters)
+    {
+        statistics.NodeCount++;
+        statistics.EmptyChildCount += emptyChildCount;
+
+        AddToHistogram(statistics.DepthHistogram, depth);
+        AddToHistogram(statistics.EmptyChildHistogram, emptyChildCount);
+
+        statistics.SahCost += parameters.TraversalCost * nodeBoundingBox.CalculateSurfaceArea() / rootSurfaceArea;
+    }
+
+    void AddPointerNode(
+        BoundingBoxHierarchyStatistics& statistics,
+        const BoundingBoxHierarchy* hierarchy,
+        size_t depth,
+        real rootSurfaceArea,
+        const BoundingBoxBuildParameters& parameters)
+    {
+        size_t emptyChildCount = 0;
+
+        for (size_t i = 0; i < BoundingBoxHierarchy::NumberOfLeafs; i++)
+        {
+            const IntersectableGeometry* child = hierarchy->GetChild(i);
+
+            if (!child)
+            {
+                emptyChildCount++;
+            }
+            else if (auto childHierarchy = dynamic_cast<const BoundingBoxHierarchy*>(child))
+            {
+                AddPointerNode(statistics, childHierarchy, depth + 1, rootSurfaceArea, parameters);
+            }
+            else
+            {
+                AddLeaf(statistics, child, hierarchy->GetChildBoundingBox(i), rootSurfaceArea, parameters);
+            }
+        }
+
+        statistics.NodeMemoryUsage += sizeof(BoundingBoxHierarchy);
+        AddNode(statistics, depth, emptyChildCount, hierarchy->CalculateBoundingBox(), rootSurfaceArea, parameters);
+    }
+
+    template <typename TNode>
+    void AddLinearNode(
+        BoundingBoxHierarchyStatistics& statistics,
+        const LinearBoundingBoxHierarchyT<real, TNode>& hierarchy,
+        size_t nodeIndex,
+        size_t depth,
+        real rootSurfaceArea,
+        const BoundingBoxBuildParameters& parameters)
+    {
+        const TNode& node = hierarchy.GetNodes()[nodeIndex];
+
+        size_t emptyChildCount = 0;
+        BoundingBox nodeBoundingBox = BoundingBox::ReverseInfinity();
+
+        for (size_t i = 0; i < TNode::NumberOfLeafs; i++)
+        {
+            std::uint32_t child = node.Children[i];
+
+            if (child == TNode::EmptyChild)
+            {
+                emptyChildCount++;
+                continue;
+            }
+
+            BoundingBox childBoundingBox = node.GetChildBoundingBox(i);
+            nodeBoundingBox = nodeBoundingBox.Union(childBoundingBox);
+
+            if (!(child & TNode::LeafFlag))
+            {
+                AddLinearNode(statistics, hierarchy, child, depth + 1, rootSurfaceArea, parameters);
+                continue;
+            }
+
+            const IntersectableGeometry* leaf = hierarchy.GetLeafs()[child & ~TNode::LeafFlag];
+
+            // Subtrees too deep for the fixed traversal stack stay pointer based.
+            if (auto leafHierarchy = dynamic_cast<const BoundingBoxHierarchy*>(leaf))
+            {
+                AddPointerNode(statistics, leafHierarchy, depth + 1, rootSurfaceArea, parameters);
+            }
+            else
+            {
+                AddLeaf(statistics, leaf, childBoundingBox, rootSurfaceArea, parameters);
+            }
+        }
+
+        statistics.NodeMemoryUsage += sizeof(TNode);
+        AddNode(statistics, depth, emptyChildCount, nodeBoundingBox, rootSurfaceArea, parameters);
+    }
+
+    size_t CountLeafPrimitives(const IntersectableGeometry* leaf)
+    {
+        if (auto geometryCollection = dynamic_cast<const GeometryCollection*>(leaf))
+        {
+            size_t count = 0;
+
+            for (const IntersectableGeometry* child : geometryCollection->GetChildren())
+            {
+                count += CountLeafPrimitives(child);
+            }
+
+            return count;
+        }
+
+        if (auto geometrySoa = dynamic_cast<const GeometrySoaBase*>(leaf))
+        {
+            size_t count = 0;
+
+            for (size_t i = 0; i < geometrySoa->GetCapacity(); i++)
+            {
+                count += geometrySoa->GetGeometry(i) ? 1 : 0;
+            }
+
+            return count;
+        }
+
+        return 1;
+    }
+
+    size_t CalculateLeafMemoryUsage(const IntersectableGeometry* leaf)
+    {
+        if (auto geometryCollection = dynamic_cast<const GeometryCollection*>(leaf))
+        {
+            size_t memoryUsage = sizeof(GeometryCollection) + geometryCollection->GetChildren().capacity() * sizeof(const IntersectableGeometry*);
+
+            if (dynamic_cast<const BoundedGeometryCollection*>(leaf))
+            {
+                memoryUsage += sizeof(BoundedGeometryCollection) - sizeof(GeometryCollection) + geometryCollection->GetChildren().size() * sizeof(BoundingBox);
+            }
+
+            for (const IntersectableGeometry* child : geometryCollection->GetChildren())
+            {
+                memoryUsage += CalculateLeafMemoryUsage(child);
+            }
+
+            return memoryUsage;
+        }
+
+        if (auto geometrySoa = dynamic_cast<const GeometrySoaBase*>(leaf))
+        {
+            return geometrySoa->CalculateMemoryUsage();
+        }
+
+        return 0;
+    }
+
+    void AddLeaf(BoundingBoxHierarchyStatistics& statistics, const IntersectableGeometry* leaf, const BoundingBox& leafBoundingBox, real rootSurfaceArea, const BoundingBoxBuildParameters& parameters)
+    {
+        size_t primitiveCount = CountLeafPrimitives(leaf);
+
+        statistics.LeafCount++;
+        statistics.PrimitiveCount += primitiveCount;
+        statistics.LeafMemoryUsage += CalculateLeafMemoryUsage(leaf);
+
+        AddToHistogram(statistics.LeafSizeHistogram, primitiveCount);
+
+        statistics.SahCost += parameters.IntersectionCost * static_cast<real>(CountLeafIntersections(leaf)) * leafBoundingBox.CalculateSurfaceArea() / rootSurfaceArea;
+    }
+
+    BoundingBoxHierarchyStatistics ClearInvalidSahCost(BoundingBoxHierarchyStatistics& statistics)
+    {
+        // Unbounded or flat roots have no meaningful surface area to weigh the nodes by, CalculateSahCost reports zero too.
+        if (!Math::isfinite(statistics.SahCost))
+        {
+            statistics.SahCost = real{0};
+        }
+
+        return statistics;
+    }
+
+    template <typename TNode>
+    BoundingBoxHierarchyStatistics CalculateLinearStatistics(const char* layout, const LinearBoundingBoxHierarchyT<real, TNode>& hierarchy, const BoundingBoxBuildParameters& parameters)
+    {
+        BoundingBoxHierarchyStatistics statistics{};
+        statistics.Layout = layout;
+        statistics.ChildSlotsPerNode = TNode::NumberOfLeafs;
+
+        AddLinearNode(statistics, hierarchy, 0, 0, hierarchy.CalculateBoundingBox().CalculateSurfaceArea(), parameters);
+        statistics.NodeMemoryUsage += hierarchy.GetLeafCount() * sizeof(const IntersectableGeometry*);
+
+        return ClearInvalidSahCost(statistics);
+    }
+
+    /// @brief Walks a hierarchy built by BuildBoundingBoxHierarchy, flattened or not, and gathers its statistics. The SAH
+    /// cost uses the bounds stored in the nodes so it reflects quantization.
+    /// @param root A BoundingBoxHierarchy, a (quantized) LinearBoundingBoxHierarchy or a DynamicMesh.
+    export BoundingBoxHierarchyStatistics CalculateBoundingBoxHierarchyStatistics(const IntersectableGeometry* root, const BoundingBoxBuildParameters& parameters)
+    {
+        if (auto dynamicMesh = dynamic_cast<const DynamicMesh*>(root))
+        {
+            root = dynamicMesh->GetHierarchy();
+        }
+
+        if (auto linearHierarchy = dynamic_cast<const LinearBoundingBoxHierarchy*>(root))
+        {
+            return CalculateLinearStatistics("linear", *linearHierarchy, parameters);
+        }
+
+        if (auto quantizedHierarchy = dynamic_cast<const QuantizedBoundingBoxHierarchy*>(root))
+        {
+            return CalculateLinearStatistics("quantized", *quantizedHierarchy, parameters);
+        }
+
+        BoundingBoxHierarchyStatistics statistics{};
+        statistics.Layout = "pointer";
+        statistics.ChildSlotsPerNode = BoundingBoxHierarchy::NumberOfLeafs;
+
+        if (auto hierarchy = dynamic_cast<const BoundingBoxHierarchy*>(root))
+        {
+            AddPointerNode(statistics, hierarchy, 0, hierarchy->CalculateBoundingBox().CalculateSurfaceArea(), parameters);
+        }
+
+        return ClearInvalidSahCost(statistics);
+    }
+}
\ No newline at end of file
@@ -27,6 +27,11 @@ namespace Yart
 
         }
 
+        const IntersectableGeometry* GetChildGeometry() const
+        {
+            return ChildGeometry;
+        }
+
         virtual BoundingBox CalculateBoundingBox() const override
         {
             return BoundingVolume->CalculateBoundingBox();
@@ -34,17 +39,27 @@ namespace Yart
 
         virtual IntersectionResult IntersectEntrance(const Ray& ray) const override
         {
-            return Intersect<IntersectionResultType::Entrance>(ray);
+            return Intersect<IntersectionResultType::Entrance>(ray, std::numeric_limits<real>::infinity());
+        }
+
+        virtual IntersectionResult IntersectEntrance(const Ray& ray, real maximumDistance) const override
+        {
+            return Intersect<IntersectionResultType::Entrance>(ray, maximumDistance);
         }
 
         virtual IntersectionResult IntersectExit(const Ray& ray) const override
         {
-            return Intersect<IntersectionResultType::Exit>(ray);
+            return Intersect<IntersectionResultType::Exit>(ray, std::numeric_limits<real>::infinity());
+        }
+
+        virtual bool IntersectAny(const Ray& ray, real maximumDistance) const override
+        {
+            return Math::isfinite(BoundingVolume->IntersectExit(ray).HitDistance) && ChildGeometry->IntersectAny(ray, maximumDistance);
         }
 
     private:
         template <IntersectionResultType TIntersectionResultType>
-        force_inline IntersectionResult Intersect(const Ray& ray) const
+        force_inline IntersectionResult Intersect(const Ray& ray, real maximumDistance) const
         {
             IntersectionResult result = BoundingVolume->IntersectExit(ray);
             if (Math::isfinite(result.HitDistance))
@@ -52,7 +67,7 @@ namespace Yart
                 IntersectionResult childResult;
                 if constexpr (TIntersectionResultType == IntersectionResultType::Entrance)
                 {
-                    childResult = ChildGeometry->IntersectEntrance(ray);
+                    childResult = ChildGeometry->IntersectEntrance(ray, maximumDistance);
                 }
                 else
                 {
@@ -66,12 +81,12 @@ namespace Yart
         }
     };
 
-    export const BoundingGeometry* CreateBoundingGeometryFromGeometry(const IntersectableGeometry* geometry, std::vector<std::shared_ptr<const IntersectableGeometry>>& geometryPointers)
+    export const BoundingGeometry* CreateBoundingGeometryFromGeometry(const IntersectableGeometry* geometry, std::vector<std::shared_ptr<IntersectableGeometry>>& geometryPointers)
     {
         auto boundingBox = geometry->CalculateBoundingBox().AddMargin(Vector3{real{0.01}});
-        auto axisAlignedBox = std::make_shared<const AxisAlignedBox>(boundingBox, nullptr);
+        auto axisAlignedBox = std::make_shared<AxisAlignedBox>(boundingBox, nullptr);
 
-        auto boundingGeometry = std::make_shared<const BoundingGeometry>(axisAlignedBox.get(), geometry);
+        auto boundingGeometry = std::make_shared<BoundingGeometry>(axisAlignedBox.get(), geometry);
 
         geometryPointers.push_back(axisAlignedBox);
         geometryPointers.push_back(boundingGeometry);
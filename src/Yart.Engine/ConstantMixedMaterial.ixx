@@ -42,5 +42,34 @@ namespace Yart
             // Ignore the passed in mix amount and use our own mix amount passed in via the constructor.
             return leftColor * LeftAmount + rightColor * RightAmount;
         }
+
+        /// @brief Scatters off one of the two materials, picked in proportion to its amount. The result is scaled by the
+        /// sum of the amounts so it matches CalculateRenderingEquation on average.
+        virtual ScatterResult Scatter(
+            const Scene& scene,
+            const Random& random,
+            int currentDepth,
+            const Geometry* hitGeometry,
+            const Vector3& hitPosition,
+            const Vector3& hitNormal,
+            const Vector3& incomingDirection,
+            real mixAmount) const override
+        {
+            real totalAmount = LeftAmount + RightAmount;
+            if (totalAmount <= real{0})
+            {
+                return ScatterResult{};
+            }
+
+            bool chooseLeft = random.GetNormalized() * totalAmount < LeftAmount;
+
+            const Material* material = chooseLeft ? LeftMaterial : RightMaterial;
+            ScatterResult result = material->Scatter(scene, random, currentDepth, hitGeometry, hitPosition, hitNormal, incomingDirection, real{0});
+
+            result.Emitted *= totalAmount;
+            result.Attenuation *= totalAmount;
+
+            return result;
+        }
     };
 }
\ No newline at end of file
@@ -28,9 +28,7 @@ namespace Yart
         virtual bool IsInShadow(const Scene& scene, const Vector3& hitPosition, const Vector3& hitNormal, const Vector3& directionToLight) const override
         {
             Ray ray{hitPosition, Direction};
-            real distance = scene.CastRayDistance(ray);
-
-            return distance == std::numeric_limits<real>::infinity() ? false : true;
+            return scene.IsOccluded(ray, std::numeric_limits<real>::infinity());
         }
     };
 }
\ No newline at end of file
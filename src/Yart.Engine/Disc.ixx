@@ -1,8 +1,11 @@
 export module Disc;
 
+import <cstdint>;
+
 import "Common.h";
 
 import AreaLight;
+import GeometryVisitor;
 import IntersectionResult;
 import IntersectionResultType;
 import Material;
@@ -56,11 +59,16 @@ namespace Yart
             return AppliedMaterial;
         }
 
-        virtual Vector3 CalculateNormal(const Ray& ray, const Vector3& hitPosition, real additionalData) const override
+        virtual Vector3 CalculateNormal(const Ray& ray, const Vector3& hitPosition, real additionalData, std::uint32_t primitiveIndex) const override
         {
             return (ray.Direction * Normal) < real{0.0} ? Normal : -Normal;
         }
 
+        virtual void Accept(GeometryVisitor& visitor) const override
+        {
+            visitor.Visit(this);
+        }
+
         virtual IntersectionResult IntersectEntrance(const Ray& ray) const override
         {
             return {this, Intersect(ray)};
@@ -130,14 +138,22 @@ namespace Yart
             directionToLight.Normalize();
 
             Ray ray{hitPosition, directionToLight};
-            real distance = scene.CastRayDistance(ray);
-
-            return distance * distance >= distanceToLightSquared - real{0.01} ? false : true;
+            return scene.IsOccluded(ray, Math::sqrt(Math::max(real{0.0}, distanceToLightSquared - real{0.01})));
         }
 
         virtual real CalculateInversePdf(const Random& random, const Vector3& hitPosition, const Vector3& hitNormal, const Vector3& incomingDirection, const Vector3& outgoingDirection) const override
         {
             return Area;
         }
+
+        virtual real GetArea() const override
+        {
+            return Area;
+        }
+
+        virtual Vector3 GetNormalOnLight(const Vector3& positionOnLight) const override
+        {
+            return Normal;
+        }
     };
 }
\ No newline at end of file
@@ -0,0 +1,196 @@
+module;
+
+#include "Vcl.h"
+
+export module DiscSoa;
+
+import <cassert>;
+import <initializer_list>;
+import <limits>;
+
+import "Common.h";
+
+import Alignment;
+import BoundingBox;
+import Disc;
+import Geometry;
+import GeometrySoa;
+import IntersectionResult;
+import Math;
+import Ray;
+
+using namespace vcl;
+
+namespace Yart
+{
+    export template<SoaSize Size>
+        class alignas(64) DiscSoa : public GeometrySoa<Disc>
+    {
+    public:
+        static constexpr size_t Elements = SoaElements<Size>;
+
+    private:
+        using VclVec = SoaVector<Size>;
+
+        alignas(Elements * sizeof(real)) real _positionX[Elements];
+        alignas(Elements * sizeof(real)) real _positionY[Elements];
+        alignas(Elements * sizeof(real)) real _positionZ[Elements];
+
+        alignas(Elements * sizeof(real)) real _normalX[Elements];
+        alignas(Elements * sizeof(real)) real _normalY[Elements];
+        alignas(Elements * sizeof(real)) real _normalZ[Elements];
+
+        alignas(Elements * sizeof(real)) real _distance[Elements];
+        alignas(Elements * sizeof(real)) real _radiusSquared[Elements];
+
+        const Disc* _geometries[Elements];
+
+    public:
+        DiscSoa()
+        {
+            for (int i = 0; i < Elements; i++)
+            {
+                _positionX[i] = std::numeric_limits<real>::infinity();
+                _positionY[i] = std::numeric_limits<real>::infinity();
+                _positionZ[i] = std::numeric_limits<real>::infinity();
+
+                _normalX[i] = std::numeric_limits<real>::infinity();
+                _normalY[i] = std::numeric_limits<real>::infinity();
+                _normalZ[i] = std::numeric_limits<real>::infinity();
+
+                _distance[i] = std::numeric_limits<real>::infinity();
+                _radiusSquared[i] = std::numeric_limits<real>::infinity();
+
+                _geometries[i] = nullptr;
+            }
+        }
+
+        explicit DiscSoa(std::initializer_list<const Disc*> list)
+            : DiscSoa{}
+        {
+            size_t index = 0;
+
+            for (auto geometry : list)
+            {
+                if (index >= Elements)
+                {
+                    break;
+                }
+
+                Insert(index++, geometry);
+            }
+        }
+
+        virtual void Insert(size_t index, const Disc* geometry) override
+        {
+            assert(index >= 0 && index < Elements);
+
+            _positionX[index] = geometry->Position.X;
+            _positionY[index] = geometry->Position.Y;
+            _positionZ[index] = geometry->Position.Z;
+
+            _normalX[index] = geometry->Normal.X;
+            _normalY[index] = geometry->Normal.Y;
+            _normalZ[index] = geometry->Normal.Z;
+
+            _distance[index] = geometry->Distance;
+            _radiusSquared[index] = geometry->RadiusSquared;
+
+            _geometries[index] = geometry;
+        }
+
+        virtual size_t GetCapacity() const override
+        {
+            return Elements;
+        }
+
+        virtual const Geometry* GetGeometry(size_t index) const override
+        {
+            assert(index >= 0 && index < Elements);
+
+            return _geometries[index];
+        }
+
+        virtual size_t CalculateMemoryUsage() const override
+        {
+            return sizeof(*this);
+        }
+
+        virtual void Refit() override
+        {
+            for (size_t i = 0; i < Elements; i++)
+            {
+                if (_geometries[i])
+                {
+                    Insert(i, _geometries[i]);
+                }
+            }
+        }
+
+        virtual BoundingBox CalculateBoundingBox() const override
+        {
+            BoundingBox boundingBox = BoundingBox::ReverseInfinity();
+
+            for (int i = 0; i < Elements; i++)
+            {
+                if (!_geometries[i])
+                {
+                    break;
+                }
+
+                boundingBox = boundingBox.Union(_geometries[i]->CalculateBoundingBox());
+            }
+
+            return boundingBox;
+        }
+
+        virtual IntersectionResult IntersectEntrance(const Ray& ray) const override
+        {
+            return Intersect(ray);
+        }
+
+        virtual bool IntersectAny(const Ray& ray, real maximumDistance) const override
+        {
+            return Intersect(ray).HitDistance < maximumDistance;
+        }
+
+        virtual IntersectionResult IntersectExit(const Ray& ray) const override
+        {
+            return Intersect(ray);
+        }
+
+    private:
+        force_inline IntersectionResult Intersect(const Ray& ray) const
+        {
+            VectorVec3<VclVec> rayDirection{ray.Direction};
+            VectorVec3<VclVec> rayPosition{ray.Position};
+
+            VectorVec3<VclVec> position{_positionX, _positionY, _positionZ};
+            VectorVec3<VclVec> normal{_normalX, _normalY, _normalZ};
+
+            VclVec normalDotDirection = VectorVec3<VclVec>::Dot(normal, rayDirection);
+            VclVec normalDotRayPosition = VectorVec3<VclVec>::Dot(normal, rayPosition);
+
+            VclVec distance = VclVec{}.load_a(_distance);
+            VclVec entranceDistance = -(distance + normalDotRayPosition) * approx_recipr(normalDotDirection);
+
+            VectorVec3<VclVec> hitPosition = rayPosition + rayDirection * entranceDistance;
+            VclVec distanceToCenterSquared = VectorVec3<VclVec>::DistanceSquared(hitPosition, position);
+
+            auto comparison =
+                entranceDistance >= VclVec{real{0.0}} &&
+                distanceToCenterSquared <= VclVec{}.load_a(_radiusSquared);
+
+            // Make sure infinite8f() is second so nans are replaced with inf.
+            VclVec clampedEntranceDistance = select(comparison, entranceDistance, VclVec{std::numeric_limits<real>::infinity()});
+
+            real minimumEntranceDistance = horizontal_min1(clampedEntranceDistance);
+            int minimumIndex = horizontal_find_first(VclVec{minimumEntranceDistance} == clampedEntranceDistance);
+
+            return {
+                _geometries[minimumIndex == -1 ? 0 : minimumIndex],
+                minimumEntranceDistance,
+            };
+        }
+    };
+}
\ No newline at end of file
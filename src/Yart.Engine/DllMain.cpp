@@ -1,18 +1,39 @@
+import AdaptiveSampling;
 import AxisAlignedBox;
 import BoundingBox;
+import BoundingBoxHierarchy;
+import BoundingBoxHierarchyStatistics;
 import BoundingGeometry;
 import Camera;
+import DynamicMesh;
 import GeometryCollection;
+import GeometryInstance;
+import InstructionSet;
 import IntersectableGeometry;
 import LambertianMaterial;
 import Light;
+import LinearBoundingBoxHierarchy;
 import Math;
+import QuantizedBoundingBoxHierarchy;
 import Random;
+import Ray;
+import RayPacket;
+import RefittableGeometry;
 import Scene;
 import Triangle;
 import TriangleSoa;
+import WavefrontIntegrator;
 import YamlLoader;
 
+#include <algorithm>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
 #include "range/v3/view/chunk.hpp"
 
 #include "Vcl.h"
@@ -26,6 +47,10 @@ public:
     std::shared_ptr<Yaml::YamlData> YamlData{};
     std::shared_ptr<Scene> SavedScene{};
 
+    /// @brief The geometries that enclose a dynamic mesh, children before their parents, see
+    /// CollectDynamicMeshAncestors. Held through the mutable pointers of the loader that owns them.
+    std::vector<RefittableGeometry*> DynamicMeshAncestors{};
+
     SceneData(
         std::shared_ptr<Yaml::YamlData> yamlData,
         std::shared_ptr<Scene> savedScene)
@@ -37,10 +62,118 @@ public:
     }
 };
 
+/// @brief Collects the geometries between geometry and the dynamic meshes below it, children before their parents, so
+/// refitting them in order brings the whole scene up to date after a dynamic mesh has moved.
+/// @param visited Whether a dynamic mesh is below each geometry that was already walked. Meshes shared by many instances
+/// are only walked once.
+/// @return Whether there is a dynamic mesh below geometry.
+bool CollectDynamicMeshAncestors(
+    const IntersectableGeometry* geometry,
+    std::vector<const IntersectableGeometry*>& ancestors,
+    std::unordered_map<const IntersectableGeometry*, bool>& visited)
+{
+    if (!geometry)
+    {
+        return false;
+    }
+
+    if (dynamic_cast<const DynamicMesh*>(geometry))
+    {
+        return true;
+    }
+
+    if (auto iterator = visited.find(geometry); iterator != visited.end())
+    {
+        return iterator->second;
+    }
+
+    bool hasDynamicMesh = false;
+
+    auto collectChild = [&](const IntersectableGeometry* child)
+    {
+        hasDynamicMesh = CollectDynamicMeshAncestors(child, ancestors, visited) || hasDynamicMesh;
+    };
+
+    if (auto hierarchy = dynamic_cast<const BoundingBoxHierarchy*>(geometry))
+    {
+        for (size_t i = 0; i < BoundingBoxHierarchy::NumberOfLeafs; i++)
+        {
+            collectChild(hierarchy->GetChild(i));
+        }
+    }
+    else if (auto linearHierarchy = dynamic_cast<const LinearBoundingBoxHierarchy*>(geometry))
+    {
+        for (const IntersectableGeometry* leaf : linearHierarchy->GetLeafs())
+        {
+            collectChild(leaf);
+        }
+    }
+    else if (auto quantizedHierarchy = dynamic_cast<const QuantizedBoundingBoxHierarchy*>(geometry))
+    {
+        for (const IntersectableGeometry* leaf : quantizedHierarchy->GetLeafs())
+        {
+            collectChild(leaf);
+        }
+    }
+    else if (auto geometryCollection = dynamic_cast<const GeometryCollection*>(geometry))
+    {
+        for (const IntersectableGeometry* child : geometryCollection->GetChildren())
+        {
+            collectChild(child);
+        }
+    }
+    else if (auto geometryInstance = dynamic_cast<const GeometryInstance*>(geometry))
+    {
+        collectChild(geometryInstance->GetChildGeometry());
+    }
+    else if (auto boundingGeometry = dynamic_cast<const BoundingGeometry*>(geometry))
+    {
+        collectChild(boundingGeometry->GetChildGeometry());
+    }
+
+    if (hasDynamicMesh)
+    {
+        ancestors.push_back(geometry);
+    }
+
+    visited[geometry] = hasDynamicMesh;
+    return hasDynamicMesh;
+}
+
+/// @brief Recalculates the bounds each of the geometries enclosing the dynamic meshes keeps of its children. The volume of
+/// a BoundingGeometry is part of the scene description and is left as it is, it has to enclose every position of the
+/// meshes below it.
+void RefitDynamicMeshAncestors(const SceneData* sceneData)
+{
+    for (RefittableGeometry* refittableGeometry : sceneData->DynamicMeshAncestors)
+    {
+        refittableGeometry->Refit();
+    }
+}
+
+/// @brief Gets the instruction set level of the host as reported by VCL's instrset_detect. The clients call it on the
+/// SSE2 build, which loads on every x64 host, to pick the widest build the host can run.
+extern "C" __declspec(dllexport) int __cdecl GetHostInstructionSet()
+{
+    return Yart::GetHostInstructionSet();
+}
+
 extern "C" __declspec(dllexport) void* __cdecl CreateScene()
 {
+    // Every build of the engine is compiled for a single instruction set, running it on a host without it would crash on
+    // the first unsupported instruction. The clients pick the build through GetHostInstructionSet, see
+    // Yart.Engine.vcxproj, this only guards against a client loading the wrong one.
+    if (!IsHostInstructionSetSupported())
+    {
+        return nullptr;
+    }
+
     auto yamlData = Yaml::LoadYaml();
     auto scene = std::make_shared<Scene>(yamlData->GeometryData->Geometry, yamlData->MissShader.get());
+    scene->MaximumDepth = yamlData->Config->MaximumDepth;
+    scene->RouletteDepth = yamlData->Config->RouletteDepth;
+    scene->UseLightHierarchy = yamlData->Config->LightHierarchy;
+    scene->DirectLightCandidates = yamlData->Config->DirectLightCandidates;
 
     for (const auto light : yamlData->Lights)
     {
@@ -52,10 +185,21 @@ extern "C" __declspec(dllexport) void* __cdecl CreateScene()
         scene->AddAreaLight(areaLight);
     }
 
+    scene->BuildAreaLightSampling();
+
     auto sceneData = new SceneData{
         yamlData,
         scene};
 
+    if (!yamlData->GeometryData->DynamicMeshes.empty())
+    {
+        std::vector<const IntersectableGeometry*> ancestors{};
+        std::unordered_map<const IntersectableGeometry*, bool> visited{};
+        CollectDynamicMeshAncestors(yamlData->GeometryData->Geometry, ancestors, visited);
+
+        sceneData->DynamicMeshAncestors = FindRefittableGeometries(ancestors, yamlData->GeometryData->Geometries);
+    }
+
     return sceneData;
 }
 
@@ -64,56 +208,513 @@ extern "C" __declspec(dllexport) void __cdecl DeleteScene(SceneData * sceneData)
     delete sceneData;
 }
 
-extern "C" __declspec(dllexport) void __cdecl TraceScene(UIntVector2 screenSize, UIntVector2 inclusiveStartingPoint, UIntVector2 inclusiveEndingPoint, const SceneData * sceneData, float* pixelBuffer)
+DynamicMesh* FindDynamicMesh(SceneData* sceneData, const char* meshName)
 {
-    Random random{};
-    Camera& camera = *sceneData->YamlData->Camera;
+    for (const auto& dynamicMesh : sceneData->YamlData->GeometryData->DynamicMeshes)
+    {
+        if (dynamicMesh->Name == meshName)
+        {
+            return dynamicMesh.get();
+        }
+    }
 
-    int subpixelCountSquared = camera.SubpixelCount * camera.SubpixelCount;
-    Vector2 colorClamp = sceneData->YamlData->Config->ColorClamp;
+    return nullptr;
+}
 
-    // Execute ray tracing.
-    for (unsigned int count = 0; count < sceneData->YamlData->Config->Iterations; count++)
+/// @brief Replaces the vertices of a dynamic mesh for the next frame and refits (or rebuilds) its bounding box hierarchy,
+/// then refits the geometries enclosing it, see RefitDynamicMeshAncestors. Must not be called while the scene is being
+/// traced.
+/// @param vertices vertexCount positions as packed x, y, z floats.
+/// @param normals vertexCount normals as packed x, y, z floats or nullptr to keep the current normals.
+/// @return False if the mesh does not exist or vertexCount does not match the mesh.
+extern "C" __declspec(dllexport) bool __cdecl UpdateMeshVertices(SceneData * sceneData, const char* meshName, const float* vertices, const float* normals, unsigned int vertexCount)
+{
+    DynamicMesh* dynamicMesh = FindDynamicMesh(sceneData, meshName);
+
+    if (!dynamicMesh || dynamicMesh->GetVertexCount() != vertexCount)
+    {
+        return false;
+    }
+
+    std::vector<Vector3> meshVertices(vertexCount);
+    std::vector<Vector3> meshNormals(normals ? vertexCount : 0);
+
+    for (unsigned int i = 0; i < vertexCount; i++)
     {
-        for (unsigned int y = inclusiveStartingPoint.Y; y <= inclusiveEndingPoint.Y; y++)
+        meshVertices[i] = Vector3{vertices[i * 3 + 0], vertices[i * 3 + 1], vertices[i * 3 + 2]};
+
+        if (normals)
         {
-            for (unsigned int x = inclusiveStartingPoint.X; x <= inclusiveEndingPoint.X; x++)
+            meshNormals[i] = Vector3{normals[i * 3 + 0], normals[i * 3 + 1], normals[i * 3 + 2]};
+        }
+    }
+
+    dynamicMesh->SetVertices(meshVertices.data(), normals ? meshNormals.data() : nullptr);
+    dynamicMesh->Update();
+
+    RefitDynamicMeshAncestors(sceneData);
+
+    return true;
+}
+
+/// @brief Sets the transformation of a dynamic mesh for the next frame and refits (or rebuilds) its bounding box
+/// hierarchy, then refits the geometries enclosing it. Must not be called while the scene is being traced.
+/// @param transformation A row major 4x4 matrix as 16 floats.
+/// @return False if the mesh does not exist.
+extern "C" __declspec(dllexport) bool __cdecl UpdateMeshTransformation(SceneData * sceneData, const char* meshName, const float* transformation)
+{
+    DynamicMesh* dynamicMesh = FindDynamicMesh(sceneData, meshName);
+
+    if (!dynamicMesh)
+    {
+        return false;
+    }
+
+    dynamicMesh->SetTransformation(Matrix4x4{
+        transformation[0], transformation[1], transformation[2], transformation[3],
+        transformation[4], transformation[5], transformation[6], transformation[7],
+        transformation[8], transformation[9], transformation[10], transformation[11],
+        transformation[12], transformation[13], transformation[14], transformation[15]});
+
+    dynamicMesh->Update();
+
+    RefitDynamicMeshAncestors(sceneData);
+
+    return true;
+}
+
+/// @brief Gets the number of bounding box hierarchies that were built while loading the scene.
+extern "C" __declspec(dllexport) unsigned int __cdecl GetHierarchyReportCount(const SceneData * sceneData)
+{
+    return static_cast<unsigned int>(sceneData->YamlData->GeometryData->HierarchyReports.size());
+}
+
+/// @brief Writes a text report of the node count, depth, leaf size and empty child slot histograms, SAH cost and memory
+/// usage of one of the hierarchies built while loading the scene.
+/// @param buffer Receives the null terminated report, may be nullptr to query the length.
+/// @return The number of bytes of the report including the null terminator or 0 if index is out of range. Nothing is
+/// written unless the report fits in bufferSize.
+extern "C" __declspec(dllexport) unsigned int __cdecl GetHierarchyReport(const SceneData * sceneData, unsigned int index, char* buffer, unsigned int bufferSize)
+{
+    const auto& hierarchyReports = sceneData->YamlData->GeometryData->HierarchyReports;
+
+    if (index >= hierarchyReports.size())
+    {
+        return 0;
+    }
+
+    const auto& hierarchyReport = hierarchyReports[index];
+    std::string report = CalculateBoundingBoxHierarchyStatistics(hierarchyReport.Root, hierarchyReport.Parameters).Format(hierarchyReport.Name);
+
+    unsigned int length = static_cast<unsigned int>(report.size() + 1);
+    if (buffer && length <= bufferSize)
+    {
+        std::memcpy(buffer, report.c_str(), length);
+    }
+
+    return length;
+}
+
+Color3 ClampSampledColor(Color3 sampledColor, const Vector2& colorClamp)
+{
+    sampledColor.R = Math::max(colorClamp.X, Math::min(colorClamp.Y, std::isnan(sampledColor.R) ? real{0.0} : sampledColor.R));
+    sampledColor.G = Math::max(colorClamp.X, Math::min(colorClamp.Y, std::isnan(sampledColor.G) ? real{0.0} : sampledColor.G));
+    sampledColor.B = Math::max(colorClamp.X, Math::min(colorClamp.Y, std::isnan(sampledColor.B) ? real{0.0} : sampledColor.B));
+
+    return sampledColor;
+}
+
+/// @brief Gets the sampling parameters of the config, which every TraceScene call and RenderSession pass uses.
+AdaptiveSamplingParameters GetAdaptiveSamplingParameters(const Yaml::Config& config)
+{
+    return AdaptiveSamplingParameters{
+        .Iterations = config.Iterations,
+        .Enabled = config.AdaptiveSampling,
+        .ErrorThreshold = config.AdaptiveErrorThreshold,
+        .MinimumIterations = config.MinimumIterations,
+        .MaximumIterations = config.MaximumIterations,
+    };
+}
+
+/// @brief Takes samples of pixels with the tracing mode of the config. Holds the buffers reused from one pass to the
+/// next, so every thread needs its own sampler.
+class PixelSampler
+{
+private:
+    const SceneData* _sceneData{};
+    Random _random{};
+
+    std::vector<Ray> _subpixelRays{};
+
+    WavefrontIntegrator _integrator;
+    std::vector<Color3> _wavefrontColors{};
+
+public:
+    explicit PixelSampler(const SceneData* sceneData)
+        : _sceneData{sceneData}, _integrator{sceneData->SavedScene.get()}
+    {
+        _subpixelRays.reserve(sceneData->YamlData->Camera->SubpixelCount * sceneData->YamlData->Camera->SubpixelCount);
+    }
+
+    /// @brief Takes one sample of every pixel in pixels and adds it to the estimate at the same index in estimates.
+    void Sample(const std::vector<UIntVector2>& pixels, const std::vector<PixelEstimate*>& estimates)
+    {
+        if (_sceneData->YamlData->Config->WavefrontTracing)
+        {
+            SampleWavefront(pixels);
+
+            for (size_t i = 0; i < pixels.size(); i++)
             {
-                Color3 color{};
+                estimates[i]->Add(_wavefrontColors[i]);
+            }
+
+            return;
+        }
+
+        for (size_t i = 0; i < pixels.size(); i++)
+        {
+            estimates[i]->Add(SamplePixel(pixels[i]));
+        }
+    }
+
+private:
+    /// @brief Takes one sample of pixel, the average of a ray through each of its subpixels.
+    Color3 SamplePixel(UIntVector2 pixel)
+    {
+        Camera& camera = *_sceneData->YamlData->Camera;
 
-                for (unsigned int subpixelY = 0; subpixelY < camera.SubpixelCount; subpixelY++)
+        int subpixelCountSquared = camera.SubpixelCount * camera.SubpixelCount;
+        Vector2 colorClamp = _sceneData->YamlData->Config->ColorClamp;
+
+        Color3 color{};
+
+        if (_sceneData->YamlData->Config->PacketTracing)
+        {
+            // The subpixel rays of a pixel start at the same point and diverge very little, which makes them ideal
+            // packets.
+            _subpixelRays.clear();
+
+            for (unsigned int subpixelY = 0; subpixelY < camera.SubpixelCount; subpixelY++)
+            {
+                for (unsigned int subpixelX = 0; subpixelX < camera.SubpixelCount; subpixelX++)
                 {
-                    for (unsigned int subpixelX = 0; subpixelX < camera.SubpixelCount; subpixelX++)
-                    {
-                        Ray ray = camera.CreateRay({x, y}, {subpixelX, subpixelY}, random);
-                        Color3 sampledColor = sceneData->SavedScene->CastRayColor(ray, random);
+                    _subpixelRays.push_back(camera.CreateRay(pixel, {subpixelX, subpixelY}, _random));
+                }
+            }
 
-                        sampledColor.R = Math::max(colorClamp.X, Math::min(colorClamp.Y, std::isnan(sampledColor.R) ? real{0.0} : sampledColor.R));
-                        sampledColor.G = Math::max(colorClamp.X, Math::min(colorClamp.Y, std::isnan(sampledColor.G) ? real{0.0} : sampledColor.G));
-                        sampledColor.B = Math::max(colorClamp.X, Math::min(colorClamp.Y, std::isnan(sampledColor.G) ? real{0.0} : sampledColor.B));
+            for (size_t start = 0; start < _subpixelRays.size(); start += RayPacket::Size)
+            {
+                size_t packetCount = Math::min(RayPacket::Size, _subpixelRays.size() - start);
 
-                        color += sampledColor;
-                    }
+                Color3 sampledColors[RayPacket::Size];
+                _sceneData->SavedScene->CastRayPacketColor(&_subpixelRays[start], packetCount, sampledColors, _random);
+
+                for (size_t i = 0; i < packetCount; i++)
+                {
+                    color += ClampSampledColor(sampledColors[i], colorClamp);
                 }
+            }
+        }
+        else
+        {
+            bool iterativeTracing = _sceneData->YamlData->Config->IterativeTracing;
 
-                color /= static_cast<real>(subpixelCountSquared);
+            for (unsigned int subpixelY = 0; subpixelY < camera.SubpixelCount; subpixelY++)
+            {
+                for (unsigned int subpixelX = 0; subpixelX < camera.SubpixelCount; subpixelX++)
+                {
+                    Ray ray = camera.CreateRay(pixel, {subpixelX, subpixelY}, _random);
+                    Color3 sampledColor = iterativeTracing
+                        ? _sceneData->SavedScene->TracePath(ray, _random)
+                        : _sceneData->SavedScene->CastRayColor(ray, _random);
 
-                pixelBuffer[((y * screenSize.X) + x) * 4 + 0] += static_cast<float>(color.R);
-                pixelBuffer[((y * screenSize.X) + x) * 4 + 1] += static_cast<float>(color.G);
-                pixelBuffer[((y * screenSize.X) + x) * 4 + 2] += static_cast<float>(color.B);
-                pixelBuffer[((y * screenSize.X) + x) * 4 + 3] += 0.0f;
+                    color += ClampSampledColor(sampledColor, colorClamp);
+                }
             }
         }
+
+        return color / static_cast<real>(subpixelCountSquared);
     }
 
+    /// @brief Takes one sample of every pixel in pixels with the wavefront integrator and stores them in _wavefrontColors.
+    void SampleWavefront(const std::vector<UIntVector2>& pixels)
+    {
+        Camera& camera = *_sceneData->YamlData->Camera;
+
+        int subpixelCountSquared = camera.SubpixelCount * camera.SubpixelCount;
+        Vector2 colorClamp = _sceneData->YamlData->Config->ColorClamp;
+
+        _wavefrontColors.assign(pixels.size(), Color3{});
+
+        // Split the pixels into batches that fit in the queues of the integrator.
+        size_t pixelsPerBatch = Math::max(size_t{1}, WavefrontIntegrator::MaximumBatchSize / static_cast<size_t>(subpixelCountSquared));
+
+        for (size_t start = 0; start < pixels.size(); start += pixelsPerBatch)
+        {
+            size_t batchSize = Math::min(pixelsPerBatch, pixels.size() - start);
+
+            _integrator.Generate(camera, std::span{pixels}.subspan(start, batchSize), _random);
+            _integrator.Trace(_random);
+
+            for (size_t path = 0; path < _integrator.GetPathCount(); path++)
+            {
+                _wavefrontColors[start + _integrator.GetPathPixelIndex(path)] += ClampSampledColor(_integrator.GetPathRadiance(path), colorClamp) / static_cast<real>(subpixelCountSquared);
+            }
+        }
+    }
+};
+
+/// @brief Traces the pixels in the inclusive range and adds the average of their samples to pixelBuffer.
+///
+/// Every pixel receives Iterations samples. With Config::AdaptiveSampling pixels stop receiving samples once they have
+/// converged, and the samples they did not take go to the pixels that are still noisy, up to MaximumIterations each.
+/// @param sampleCountBuffer Receives the number of rays traced through every pixel, one value per pixel of screenSize.
+/// May be null.
+extern "C" __declspec(dllexport) void __cdecl TraceSceneWithSampleCounts(UIntVector2 screenSize, UIntVector2 inclusiveStartingPoint, UIntVector2 inclusiveEndingPoint, const SceneData * sceneData, float* pixelBuffer, unsigned int* sampleCountBuffer)
+{
+    Camera& camera = *sceneData->YamlData->Camera;
+
+    std::vector<UIntVector2> pixels{};
     for (unsigned int y = inclusiveStartingPoint.Y; y <= inclusiveEndingPoint.Y; y++)
     {
         for (unsigned int x = inclusiveStartingPoint.X; x <= inclusiveEndingPoint.X; x++)
         {
-            pixelBuffer[((y * screenSize.X) + x) * 4 + 0] /= static_cast<float>(sceneData->YamlData->Config->Iterations);
-            pixelBuffer[((y * screenSize.X) + x) * 4 + 1] /= static_cast<float>(sceneData->YamlData->Config->Iterations);
-            pixelBuffer[((y * screenSize.X) + x) * 4 + 2] /= static_cast<float>(sceneData->YamlData->Config->Iterations);
-            pixelBuffer[((y * screenSize.X) + x) * 4 + 3] /= static_cast<float>(sceneData->YamlData->Config->Iterations);
+            pixels.push_back({x, y});
+        }
+    }
+
+    std::vector<PixelEstimate> estimates(pixels.size());
+
+    PixelSampler sampler{sceneData};
+    std::vector<UIntVector2> passPixels{};
+    std::vector<PixelEstimate*> passEstimates{};
+
+    // Execute ray tracing.
+    SampleAdaptively(estimates, GetAdaptiveSamplingParameters(*sceneData->YamlData->Config), [&](std::span<const std::uint32_t> activePixels)
+    {
+        passPixels.clear();
+        passEstimates.clear();
+
+        for (std::uint32_t pixelIndex : activePixels)
+        {
+            passPixels.push_back(pixels[pixelIndex]);
+            passEstimates.push_back(&estimates[pixelIndex]);
+        }
+
+        sampler.Sample(passPixels, passEstimates);
+    });
+
+    for (size_t i = 0; i < pixels.size(); i++)
+    {
+        UIntVector2 pixel = pixels[i];
+        Color3 color = estimates[i].GetMean();
+
+        pixelBuffer[((pixel.Y * screenSize.X) + pixel.X) * 4 + 0] += static_cast<float>(color.R);
+        pixelBuffer[((pixel.Y * screenSize.X) + pixel.X) * 4 + 1] += static_cast<float>(color.G);
+        pixelBuffer[((pixel.Y * screenSize.X) + pixel.X) * 4 + 2] += static_cast<float>(color.B);
+        pixelBuffer[((pixel.Y * screenSize.X) + pixel.X) * 4 + 3] += 0.0f;
+
+        if (sampleCountBuffer)
+        {
+            sampleCountBuffer[(pixel.Y * screenSize.X) + pixel.X] = estimates[i].Count * camera.SubpixelCount * camera.SubpixelCount;
+        }
+    }
+}
+
+extern "C" __declspec(dllexport) void __cdecl TraceScene(UIntVector2 screenSize, UIntVector2 inclusiveStartingPoint, UIntVector2 inclusiveEndingPoint, const SceneData * sceneData, float* pixelBuffer)
+{
+    TraceSceneWithSampleCounts(screenSize, inclusiveStartingPoint, inclusiveEndingPoint, sceneData, pixelBuffer, nullptr);
+}
+
+/// @brief Called at the end of every AdvanceRenderSession call, on the thread that made it.
+/// @param sampledPixelCount The number of pixels of the range that received a sample.
+using RenderPassCallback = void (__cdecl*)(void* userData, UIntVector2 inclusiveStartingPoint, UIntVector2 inclusiveEndingPoint, unsigned int sampledPixelCount);
+
+/// @brief A progressive rendering of the whole screen. The session owns the estimate of every pixel, each pass adds one
+/// more sample to the pixels that need it, and the image can be resolved between any two passes.
+///
+/// The session also keeps a pool of samplers, so the random number generators and the queues of the wavefront integrator
+/// carry over from one pass to the next instead of being created for every AdvanceRenderSession call.
+class RenderSession
+{
+private:
+    std::mutex _samplersMutex{};
+    std::vector<std::unique_ptr<PixelSampler>> _samplers{};
+
+public:
+    const SceneData* Data{};
+    UIntVector2 ScreenSize{};
+
+    std::vector<PixelEstimate> Estimates{};
+
+    RenderPassCallback Callback{};
+    void* CallbackUserData{};
+
+    RenderSession(const SceneData* sceneData, UIntVector2 screenSize, RenderPassCallback callback, void* callbackUserData)
+        :
+        Data{sceneData},
+        ScreenSize{screenSize},
+        Estimates(static_cast<size_t>(screenSize.X) * screenSize.Y),
+        Callback{callback},
+        CallbackUserData{callbackUserData}
+    {
+        CreateSamplers();
+    }
+
+    /// @brief Takes a sampler out of the pool, or creates one when more threads advance the session than there are
+    /// samplers.
+    std::unique_ptr<PixelSampler> AcquireSampler()
+    {
+        {
+            std::lock_guard lock{_samplersMutex};
+
+            if (!_samplers.empty())
+            {
+                std::unique_ptr<PixelSampler> sampler = std::move(_samplers.back());
+                _samplers.pop_back();
+
+                return sampler;
+            }
+        }
+
+        return std::make_unique<PixelSampler>(Data);
+    }
+
+    void ReleaseSampler(std::unique_ptr<PixelSampler> sampler)
+    {
+        std::lock_guard lock{_samplersMutex};
+        _samplers.push_back(std::move(sampler));
+    }
+
+    /// @brief Replaces the samplers of the pool with new ones. Must not be called while the session is being advanced.
+    void CreateSamplers()
+    {
+        std::lock_guard lock{_samplersMutex};
+
+        _samplers.clear();
+
+        // One sampler per hardware thread covers clients that advance one range per thread.
+        unsigned int samplerCount = Math::max(1u, std::thread::hardware_concurrency());
+        for (unsigned int i = 0; i < samplerCount; i++)
+        {
+            _samplers.push_back(std::make_unique<PixelSampler>(Data));
+        }
+    }
+};
+
+/// @param callback Called after every pass, may be null.
+extern "C" __declspec(dllexport) RenderSession* __cdecl CreateRenderSession(const SceneData * sceneData, UIntVector2 screenSize, RenderPassCallback callback, void* callbackUserData)
+{
+    return new RenderSession{sceneData, screenSize, callback, callbackUserData};
+}
+
+extern "C" __declspec(dllexport) void __cdecl DeleteRenderSession(RenderSession * renderSession)
+{
+    delete renderSession;
+}
+
+/// @brief Discards every sample of the session and its samplers, for example after the scene has changed. Must not be
+/// called while the session is being advanced.
+extern "C" __declspec(dllexport) void __cdecl ResetRenderSession(RenderSession * renderSession)
+{
+    std::fill(renderSession->Estimates.begin(), renderSession->Estimates.end(), PixelEstimate{});
+    renderSession->CreateSamplers();
+}
+
+/// @brief Clamps the inclusive range to the screen of a session.
+/// @return Whether any pixel of the range is on the screen.
+bool ClampToScreen(UIntVector2 screenSize, UIntVector2& inclusiveStartingPoint, UIntVector2& inclusiveEndingPoint)
+{
+    if (inclusiveStartingPoint.X >= screenSize.X || inclusiveStartingPoint.Y >= screenSize.Y ||
+        inclusiveStartingPoint.X > inclusiveEndingPoint.X || inclusiveStartingPoint.Y > inclusiveEndingPoint.Y)
+    {
+        return false;
+    }
+
+    inclusiveEndingPoint.X = Math::min(inclusiveEndingPoint.X, screenSize.X - 1);
+    inclusiveEndingPoint.Y = Math::min(inclusiveEndingPoint.Y, screenSize.Y - 1);
+
+    return true;
+}
+
+/// @brief Adds one sample to every pixel in the inclusive range that needs one, see PixelEstimate::NeedsSample.
+/// Disjoint ranges of the same session can be advanced from different threads at the same time. The range is clamped to
+/// the session's screen.
+/// @return The number of pixels that received a sample, zero once the whole range is done or when it is off the screen.
+extern "C" __declspec(dllexport) unsigned int __cdecl AdvanceRenderSession(RenderSession * renderSession, UIntVector2 inclusiveStartingPoint, UIntVector2 inclusiveEndingPoint)
+{
+    if (!ClampToScreen(renderSession->ScreenSize, inclusiveStartingPoint, inclusiveEndingPoint))
+    {
+        return 0;
+    }
+
+    AdaptiveSamplingParameters parameters = GetAdaptiveSamplingParameters(*renderSession->Data->YamlData->Config);
+
+    std::vector<UIntVector2> pixels{};
+    std::vector<PixelEstimate*> estimates{};
+
+    for (unsigned int y = inclusiveStartingPoint.Y; y <= inclusiveEndingPoint.Y; y++)
+    {
+        for (unsigned int x = inclusiveStartingPoint.X; x <= inclusiveEndingPoint.X; x++)
+        {
+            PixelEstimate& estimate = renderSession->Estimates[(y * renderSession->ScreenSize.X) + x];
+
+            if (estimate.NeedsSample(parameters))
+            {
+                pixels.push_back({x, y});
+                estimates.push_back(&estimate);
+            }
+        }
+    }
+
+    if (!pixels.empty())
+    {
+        std::unique_ptr<PixelSampler> sampler = renderSession->AcquireSampler();
+        sampler->Sample(pixels, estimates);
+
+        renderSession->ReleaseSampler(std::move(sampler));
+    }
+
+    unsigned int sampledPixelCount = static_cast<unsigned int>(pixels.size());
+
+    if (renderSession->Callback)
+    {
+        renderSession->Callback(renderSession->CallbackUserData, inclusiveStartingPoint, inclusiveEndingPoint, sampledPixelCount);
+    }
+
+    return sampledPixelCount;
+}
+
+/// @brief Writes the current average of every pixel in the inclusive range to pixelBuffer, which has four floats per
+/// pixel of the session's screen. Pixels without samples are black. The range is clamped to the session's screen.
+/// @param sampleCountBuffer Receives the number of rays traced through every pixel, one value per pixel of the session's
+/// screen. May be null.
+extern "C" __declspec(dllexport) void __cdecl ResolveRenderSession(const RenderSession * renderSession, UIntVector2 inclusiveStartingPoint, UIntVector2 inclusiveEndingPoint, float* pixelBuffer, unsigned int* sampleCountBuffer)
+{
+    unsigned int subpixelCount = renderSession->Data->YamlData->Camera->SubpixelCount;
+    UIntVector2 screenSize = renderSession->ScreenSize;
+
+    if (!ClampToScreen(screenSize, inclusiveStartingPoint, inclusiveEndingPoint))
+    {
+        return;
+    }
+
+    for (unsigned int y = inclusiveStartingPoint.Y; y <= inclusiveEndingPoint.Y; y++)
+    {
+        for (unsigned int x = inclusiveStartingPoint.X; x <= inclusiveEndingPoint.X; x++)
+        {
+            const PixelEstimate& estimate = renderSession->Estimates[(y * screenSize.X) + x];
+            Color3 color = estimate.GetMean();
+
+            pixelBuffer[((y * screenSize.X) + x) * 4 + 0] = static_cast<float>(color.R);
+            pixelBuffer[((y * screenSize.X) + x) * 4 + 1] = static_cast<float>(color.G);
+            pixelBuffer[((y * screenSize.X) + x) * 4 + 2] = static_cast<float>(color.B);
+            pixelBuffer[((y * screenSize.X) + x) * 4 + 3] = 0.0f;
+
+            if (sampleCountBuffer)
+            {
+                sampleCountBuffer[(y * screenSize.X) + x] = estimate.Count * subpixelCount * subpixelCount;
+            }
         }
     }
 }
\ No newline at end of file
@@ -0,0 +1,234 @@
+export module DynamicMesh;
+
+import <cstdint>;
+
+import "Common.h";
+
+import BoundingBox;
+import BoundingBoxHierarchy;
+import IntersectableGeometry;
+import IntersectionResult;
+import LinearBoundingBoxHierarchy;
+import Math;
+import Ray;
+import RayPacket;
+import RefittableGeometry;
+import Triangle;
+
+namespace Yart
+{
+    /// @brief A triangle mesh whose vertices can change between frames. Every update refits the bounding box hierarchy of
+    /// the mesh in place and only rebuilds it from scratch once the refit hierarchy has degraded past RebuildThreshold.
+    ///
+    /// Updates must not run while the scene is being traced.
+    export class DynamicMesh : public IntersectableGeometry
+    {
+    protected:
+        BoundingBoxBuildParameters Parameters{};
+
+        std::vector<std::shared_ptr<Triangle>> Triangles{};
+        std::vector<Vector3> RestVertices{};
+        std::vector<Vector3> RestNormals{};
+        Matrix4x4 Transformation{Matrix4x4::CreateIdentity()};
+
+        std::vector<std::shared_ptr<IntersectableGeometry>> HierarchyPointers{};
+        const BoundingBoxHierarchy* Hierarchy{nullptr};
+        std::vector<RefittableGeometry*> RefittableGeometries{};
+        std::shared_ptr<LinearBoundingBoxHierarchy> LinearHierarchy{};
+        const IntersectableGeometry* Root{nullptr};
+
+        real BuildSahCost{};
+        real RefitSahCost{};
+        size_t RebuildCount{};
+
+    public:
+        std::string Name{};
+
+        /// @brief The hierarchy is rebuilt once the SAH cost of the refit hierarchy exceeds the cost it had right after
+        /// its last build by this factor.
+        real RebuildThreshold{1.5};
+
+        DynamicMesh(
+            const std::string& name,
+            const BoundingBoxBuildParameters& parameters,
+            const std::vector<std::shared_ptr<Triangle>>& triangles,
+            real rebuildThreshold)
+            :
+            Parameters{parameters},
+            Triangles{triangles},
+            Name{name},
+            RebuildThreshold{rebuildThreshold}
+        {
+            RestVertices.reserve(Triangles.size() * 3);
+            RestNormals.reserve(Triangles.size() * 3);
+
+            for (const auto& triangle : Triangles)
+            {
+                RestVertices.push_back(triangle->Vertex0);
+                RestVertices.push_back(triangle->Vertex1);
+                RestVertices.push_back(triangle->Vertex2);
+
+                RestNormals.push_back(triangle->Normal0);
+                RestNormals.push_back(triangle->Normal1);
+                RestNormals.push_back(triangle->Normal2);
+            }
+
+            Build();
+        }
+
+        /// @brief Gets the number of vertices expected by SetVertices. Every triangle has its own three vertices, in the
+        /// order the faces were read from the obj file.
+        size_t GetVertexCount() const
+        {
+            return RestVertices.size();
+        }
+
+        const BoundingBoxBuildParameters& GetParameters() const
+        {
+            return Parameters;
+        }
+
+        const BoundingBoxHierarchy* GetHierarchy() const
+        {
+            return Hierarchy;
+        }
+
+        real GetBuildSahCost() const
+        {
+            return BuildSahCost;
+        }
+
+        real GetRefitSahCost() const
+        {
+            return RefitSahCost;
+        }
+
+        size_t GetRebuildCount() const
+        {
+            return RebuildCount;
+        }
+
+        /// @brief Replaces the untransformed vertices of the mesh. Call Update afterwards to apply them.
+        /// @param vertices GetVertexCount vertex positions.
+        /// @param normals GetVertexCount vertex normals or nullptr to keep the current normals.
+        void SetVertices(const Vector3* vertices, const Vector3* normals)
+        {
+            for (size_t i = 0; i < RestVertices.size(); i++)
+            {
+                RestVertices[i] = vertices[i];
+
+                if (normals)
+                {
+                    RestNormals[i] = normals[i];
+                }
+            }
+        }
+
+        /// @brief Sets the transformation that is applied to the untransformed vertices of the mesh. Call Update afterwards
+        /// to apply it.
+        void SetTransformation(const Matrix4x4& transformation)
+        {
+            Transformation = transformation;
+        }
+
+        /// @brief Moves the triangles to their new positions and refits the hierarchy, rebuilding it instead when the
+        /// refit hierarchy has become too expensive to traverse.
+        /// @return True if the hierarchy was rebuilt.
+        bool Update()
+        {
+            Matrix4x4 normalTransformation = Transformation.InvertConst().TransposeConst();
+
+            for (size_t i = 0; i < Triangles.size(); i++)
+            {
+                Triangle& triangle = *Triangles[i];
+
+                triangle.Vertex0 = Matrix4x4::Multiply(RestVertices[i * 3 + 0], real{1.0}, Transformation);
+                triangle.Vertex1 = Matrix4x4::Multiply(RestVertices[i * 3 + 1], real{1.0}, Transformation);
+                triangle.Vertex2 = Matrix4x4::Multiply(RestVertices[i * 3 + 2], real{1.0}, Transformation);
+
+                triangle.Normal0 = Matrix4x4::Multiply(RestNormals[i * 3 + 0], real{0.0}, normalTransformation).Normalize();
+                triangle.Normal1 = Matrix4x4::Multiply(RestNormals[i * 3 + 1], real{0.0}, normalTransformation).Normalize();
+                triangle.Normal2 = Matrix4x4::Multiply(RestNormals[i * 3 + 2], real{0.0}, normalTransformation).Normalize();
+            }
+
+            for (RefittableGeometry* refittableGeometry : RefittableGeometries)
+            {
+                refittableGeometry->Refit();
+            }
+
+            RefitSahCost = CalculateSahCost(Hierarchy, Parameters);
+
+            if (RefitSahCost > BuildSahCost * RebuildThreshold)
+            {
+                Build();
+                RebuildCount++;
+
+                return true;
+            }
+
+            if (LinearHierarchy)
+            {
+                LinearHierarchy->Refit();
+            }
+
+            return false;
+        }
+
+        virtual BoundingBox CalculateBoundingBox() const override
+        {
+            return Root->CalculateBoundingBox();
+        }
+
+        virtual IntersectionResult IntersectEntrance(const Ray& ray) const override
+        {
+            return Root->IntersectEntrance(ray);
+        }
+
+        virtual IntersectionResult IntersectEntrance(const Ray& ray, real maximumDistance) const override
+        {
+            return Root->IntersectEntrance(ray, maximumDistance);
+        }
+
+        virtual IntersectionResult IntersectExit(const Ray& ray) const override
+        {
+            return Root->IntersectExit(ray);
+        }
+
+        virtual bool IntersectAny(const Ray& ray, real maximumDistance) const override
+        {
+            return Root->IntersectAny(ray, maximumDistance);
+        }
+
+        virtual void IntersectPacketEntrance(const RayPacket& packet, std::uint32_t laneMask, IntersectionResult* results) const override
+        {
+            Root->IntersectPacketEntrance(packet, laneMask, results);
+        }
+
+    private:
+        void Build()
+        {
+            // The previous hierarchy owns nothing the new one needs, the triangles themselves are owned by the mesh.
+            LinearHierarchy.reset();
+            HierarchyPointers.clear();
+
+            std::vector<const IntersectableGeometry*> geometries(Triangles.size());
+            for (size_t i = 0; i < Triangles.size(); i++)
+            {
+                geometries[i] = Triangles[i].get();
+            }
+
+            Hierarchy = BuildBoundingBoxHierarchy(Parameters, geometries, HierarchyPointers);
+            RefittableGeometries = CollectRefittableGeometries(Hierarchy, HierarchyPointers);
+            Root = Hierarchy;
+
+            BuildSahCost = CalculateSahCost(Hierarchy, Parameters);
+            RefitSahCost = BuildSahCost;
+
+            if (Parameters.Flatten)
+            {
+                LinearHierarchy = std::make_shared<LinearBoundingBoxHierarchy>(Hierarchy);
+                Root = LinearHierarchy.get();
+            }
+        }
+    };
+}
\ No newline at end of file
@@ -35,5 +35,26 @@ namespace Yart
         {
             return EmissiveColor;
         }
+
+        virtual ScatterResult Scatter(
+            const Scene& scene,
+            const Random& random,
+            int currentDepth,
+            const Geometry* hitGeometry,
+            const Vector3& hitPosition,
+            const Vector3& hitNormal,
+            const Vector3& incomingDirection,
+            real mixAmount) const override
+        {
+            ScatterResult result{};
+            result.Emitted = EmissiveColor;
+
+            return result;
+        }
+
+        virtual Color3 GetEmissiveColor() const override
+        {
+            return EmissiveColor;
+        }
     };
 }
\ No newline at end of file
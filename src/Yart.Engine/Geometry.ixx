@@ -1,5 +1,7 @@
 export module Geometry;
 
+import <cstdint>;
+
 import "Common.h";
 
 import GeometryDecl;
@@ -15,7 +17,7 @@ namespace Yart
     public:
         virtual const Material* GetMaterial() const = 0;
 
-        virtual Vector3 CalculateNormal(const Ray& ray, const Vector3& hitPosition, real additionalData) const = 0;
+        virtual Vector3 CalculateNormal(const Ray& ray, const Vector3& hitPosition, real additionalData, std::uint32_t primitiveIndex) const = 0;
     };
 
     export template<typename T>
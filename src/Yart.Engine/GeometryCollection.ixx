@@ -1,19 +1,25 @@
 export module GeometryCollection;
 
+import <bit>;
+import <cstdint>;
 import <initializer_list>;
 
 import "Common.h";
 
+import BoundingBox;
 import IntersectableGeometry;
 import IntersectionResult;
 import IntersectionResultType;
+import Math;
 import Ray;
+import RayPacket;
+import RefittableGeometry;
 
 namespace Yart
 {
 	export class GeometryCollection : public IntersectableGeometry
 	{
-    protected:
+	protected:
 		std::vector<const IntersectableGeometry*> Children{};
 
 	public:
@@ -23,37 +29,68 @@ namespace Yart
 
 		}
 
-        explicit GeometryCollection(std::vector<const IntersectableGeometry*> childGeometries)
-            : Children{childGeometries}
-        {
+		explicit GeometryCollection(std::vector<const IntersectableGeometry*> childGeometries)
+			: Children{childGeometries}
+		{
+
+		}
+
+		const std::vector<const IntersectableGeometry*>& GetChildren() const
+		{
+			return Children;
+		}
 
-        }
+		virtual BoundingBoxT<real> CalculateBoundingBox() const override
+		{
+			BoundingBoxT<real> boundingBox = BoundingBoxT<real>::ReverseInfinity();
+
+			for (const auto& child : Children)
+			{
+				boundingBox = boundingBox.Union(child->CalculateBoundingBox());
+			}
+
+			return boundingBox;
+		}
 
-        virtual BoundingBoxT<real> CalculateBoundingBox() const override
-        {
-            BoundingBoxT<real> boundingBox = BoundingBoxT<real>::ReverseInfinity();
+		virtual IntersectionResult IntersectEntrance(const Ray& ray) const override
+		{
+			return Intersect<IntersectionResultType::Entrance>(ray, std::numeric_limits<real>::infinity());
+		}
 
-            for (const auto& child : Children)
-            {
-                boundingBox = boundingBox.Union(child->CalculateBoundingBox());
-            }
+		virtual IntersectionResult IntersectEntrance(const Ray& ray, real maximumDistance) const override
+		{
+			return Intersect<IntersectionResultType::Entrance>(ray, maximumDistance);
+		}
 
-            return boundingBox;
-        }
+		virtual IntersectionResult IntersectExit(const Ray& ray) const override
+		{
+			return Intersect<IntersectionResultType::Exit>(ray, std::numeric_limits<real>::infinity());
+		}
 
-        virtual IntersectionResult IntersectEntrance(const Ray& ray) const override
+		virtual bool IntersectAny(const Ray& ray, real maximumDistance) const override
 		{
-			return Intersect<IntersectionResultType::Entrance>(ray);
+			for (auto geometry : Children)
+			{
+				if (geometry->IntersectAny(ray, maximumDistance))
+				{
+					return true;
+				}
+			}
+
+			return false;
 		}
 
-        virtual IntersectionResult IntersectExit(const Ray& ray) const override
+		virtual void IntersectPacketEntrance(const RayPacket& packet, std::uint32_t laneMask, IntersectionResult* results) const override
 		{
-			return Intersect<IntersectionResultType::Exit>(ray);
+			for (auto geometry : Children)
+			{
+				geometry->IntersectPacketEntrance(packet, laneMask, results);
+			}
 		}
 
 	private:
 		template <IntersectionResultType TIntersectionResultType>
-		force_inline IntersectionResult Intersect(const Ray& ray) const
+		force_inline IntersectionResult Intersect(const Ray& ray, real maximumDistance) const
 		{
 			IntersectionResult closestResult{nullptr, std::numeric_limits<real>::infinity()};
 
@@ -62,7 +99,8 @@ namespace Yart
 				IntersectionResult result;
 				if constexpr (TIntersectionResultType == IntersectionResultType::Entrance)
 				{
-					result = geometry->IntersectEntrance(ray);
+					// Children only need to report hits that are closer than the closest one found so far.
+					result = geometry->IntersectEntrance(ray, Math::min(maximumDistance, closestResult.HitDistance));
 				}
 				else
 				{
@@ -78,4 +116,135 @@ namespace Yart
 			return closestResult;
 		}
 	};
+
+	/// @brief A geometry collection that skips every child whose bounding box the ray misses or enters beyond the closest
+	/// hit found so far. Used for leafs that hold more than one SOA structure, each of which covers a compact part of the
+	/// leaf.
+	export class BoundedGeometryCollection : public GeometryCollection, public RefittableGeometry
+	{
+	protected:
+		std::vector<BoundingBox> ChildBoundingBoxes{};
+
+	public:
+		explicit BoundedGeometryCollection(std::vector<const IntersectableGeometry*> childGeometries)
+			: GeometryCollection{std::move(childGeometries)}
+		{
+			Refit();
+		}
+
+		/// @brief Recalculates the bounding boxes of the children. Must be called after the children have been modified.
+		virtual void Refit() override
+		{
+			ChildBoundingBoxes.clear();
+			ChildBoundingBoxes.reserve(Children.size());
+
+			for (const auto* child : Children)
+			{
+				ChildBoundingBoxes.push_back(child->CalculateBoundingBox());
+			}
+		}
+
+		virtual BoundingBox CalculateBoundingBox() const override
+		{
+			BoundingBox boundingBox = BoundingBox::ReverseInfinity();
+
+			for (const auto& childBoundingBox : ChildBoundingBoxes)
+			{
+				boundingBox = boundingBox.Union(childBoundingBox);
+			}
+
+			return boundingBox;
+		}
+
+		virtual IntersectionResult IntersectEntrance(const Ray& ray) const override
+		{
+			return Intersect<IntersectionResultType::Entrance>(ray, std::numeric_limits<real>::infinity());
+		}
+
+		virtual IntersectionResult IntersectEntrance(const Ray& ray, real maximumDistance) const override
+		{
+			return Intersect<IntersectionResultType::Entrance>(ray, maximumDistance);
+		}
+
+		virtual IntersectionResult IntersectExit(const Ray& ray) const override
+		{
+			return Intersect<IntersectionResultType::Exit>(ray, std::numeric_limits<real>::infinity());
+		}
+
+		virtual bool IntersectAny(const Ray& ray, real maximumDistance) const override
+		{
+			for (size_t i = 0; i < Children.size(); i++)
+			{
+				if (ChildBoundingBoxes[i].CalculateEntranceDistance(ray.Position, ray.InverseDirection) < maximumDistance &&
+					Children[i]->IntersectAny(ray, maximumDistance))
+				{
+					return true;
+				}
+			}
+
+			return false;
+		}
+
+		virtual void IntersectPacketEntrance(const RayPacket& packet, std::uint32_t laneMask, IntersectionResult* results) const override
+		{
+			alignas(64) real maximumDistances[RayPacket::Size]{};
+
+			for (size_t i = 0; i < Children.size(); i++)
+			{
+				for (size_t lane = 0; lane < RayPacket::Size; lane++)
+				{
+					maximumDistances[lane] = (laneMask & (1u << lane)) ? results[lane].HitDistance : real{0.0};
+				}
+
+				real entranceDistance;
+				std::uint32_t childMask = packet.IntersectBoundingBox(ChildBoundingBoxes[i], maximumDistances, laneMask, entranceDistance);
+
+				if (childMask != 0)
+				{
+					Children[i]->IntersectPacketEntrance(packet, childMask, results);
+				}
+			}
+		}
+
+	private:
+		template <IntersectionResultType TIntersectionResultType>
+		force_inline IntersectionResult Intersect(const Ray& ray, real maximumDistance) const
+		{
+			IntersectionResult closestResult{nullptr, std::numeric_limits<real>::infinity()};
+
+			for (size_t i = 0; i < Children.size(); i++)
+			{
+				real entranceDistance = ChildBoundingBoxes[i].CalculateEntranceDistance(ray.Position, ray.InverseDirection);
+
+				IntersectionResult result;
+				if constexpr (TIntersectionResultType == IntersectionResultType::Entrance)
+				{
+					real closestDistance = Math::min(maximumDistance, closestResult.HitDistance);
+
+					if (!(entranceDistance < closestDistance))
+					{
+						continue;
+					}
+
+					result = Children[i]->IntersectEntrance(ray, closestDistance);
+				}
+				else
+				{
+					if (entranceDistance == std::numeric_limits<real>::infinity())
+					{
+						continue;
+					}
+
+					result = Children[i]->IntersectExit(ray);
+				}
+
+				if (result.HitDistance < closestResult.HitDistance)
+				{
+					closestResult = result;
+				}
+			}
+
+			return closestResult;
+		}
+	};
 }
\ No newline at end of file
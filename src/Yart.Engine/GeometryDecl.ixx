@@ -4,5 +4,15 @@ import "Common.h";
 
 namespace Yart
 {
+    export class IntersectableGeometry;
     export class Geometry;
+    export class GeometryInstance;
+
+    export class AxisAlignedBox;
+    export class Disc;
+    export class IndexedTriangle;
+    export class Parallelogram;
+    export class Plane;
+    export class Sphere;
+    export class Triangle;
 }
\ No newline at end of file
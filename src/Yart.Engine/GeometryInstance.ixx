@@ -0,0 +1,167 @@
+export module GeometryInstance;
+
+import <cstdint>;
+
+import "Common.h";
+
+import BoundingBox;
+import Geometry;
+import GeometryDecl;
+import IntersectableGeometry;
+import IntersectionResult;
+import Math;
+import Ray;
+import RefittableGeometry;
+
+namespace Yart
+{
+    /// @brief Places a shared geometry, usually the bounding box hierarchy of a mesh, in the scene with an affine
+    /// transformation. Rays are moved into the object space of the geometry instead of copying it so any number of
+    /// instances can share a single copy of the triangles and their hierarchy.
+    ///
+    /// Hits report the geometry of the shared mesh together with the instance that has to transform its normal back into
+    /// world space. Instances can not be nested.
+    export class GeometryInstance : public IntersectableGeometry, public RefittableGeometry
+    {
+    protected:
+        const IntersectableGeometry* ChildGeometry{nullptr};
+        Matrix4x4 Transformation{};
+        Matrix4x4 InverseTransformation{};
+        Matrix4x4 InverseTransposedTransformation{};
+        BoundingBox WorldBoundingBox;
+
+    public:
+        GeometryInstance(const IntersectableGeometry* childGeometry, const Matrix4x4& transformation)
+            :
+            ChildGeometry{childGeometry},
+            Transformation{transformation},
+            InverseTransformation{transformation.InvertConst()},
+            InverseTransposedTransformation{transformation.InvertConst().TransposeConst()},
+            WorldBoundingBox{childGeometry->CalculateBoundingBox().Transform(transformation)}
+        {
+
+        }
+
+        const IntersectableGeometry* GetChildGeometry() const
+        {
+            return ChildGeometry;
+        }
+
+        const Matrix4x4& GetTransformation() const
+        {
+            return Transformation;
+        }
+
+        /// @brief Recalculates the world space bounding box after the child geometry has changed.
+        virtual void Refit() override
+        {
+            WorldBoundingBox = ChildGeometry->CalculateBoundingBox().Transform(Transformation);
+        }
+
+        /// @brief Moves a world space ray into the object space of the child geometry.
+        force_inline Ray TransformRay(const Ray& ray) const
+        {
+            // The direction is deliberately not normalized so hit distances along the object space ray are the same as
+            // the distances along the world space ray.
+            return Ray{
+                Matrix4x4::Multiply(ray.Position, real{1.0}, InverseTransformation),
+                Matrix4x4::Multiply(ray.Direction, real{0.0}, InverseTransformation),
+            };
+        }
+
+        /// @brief Calculates the world space normal of a hit reported by this instance.
+        Vector3 CalculateNormal(const Geometry* hitGeometry, const Ray& ray, const Vector3& hitPosition, real additionalData, std::uint32_t primitiveIndex) const
+        {
+            Vector3 objectHitPosition = Matrix4x4::Multiply(hitPosition, real{1.0}, InverseTransformation);
+            Vector3 objectNormal = hitGeometry->CalculateNormal(TransformRay(ray), objectHitPosition, additionalData, primitiveIndex);
+
+            return Matrix4x4::Multiply(objectNormal, real{0.0}, InverseTransposedTransformation).Normalize();
+        }
+
+        virtual BoundingBox CalculateBoundingBox() const override
+        {
+            return WorldBoundingBox;
+        }
+
+        virtual IntersectionResult IntersectEntrance(const Ray& ray) const override
+        {
+            return AttachInstance(ChildGeometry->IntersectEntrance(TransformRay(ray)));
+        }
+
+        virtual IntersectionResult IntersectEntrance(const Ray& ray, real maximumDistance) const override
+        {
+            return AttachInstance(ChildGeometry->IntersectEntrance(TransformRay(ray), maximumDistance));
+        }
+
+        virtual IntersectionResult IntersectExit(const Ray& ray) const override
+        {
+            return AttachInstance(ChildGeometry->IntersectExit(TransformRay(ray)));
+        }
+
+        virtual bool IntersectAny(const Ray& ray, real maximumDistance) const override
+        {
+            return ChildGeometry->IntersectAny(TransformRay(ray), maximumDistance);
+        }
+
+    private:
+        force_inline IntersectionResult AttachInstance(IntersectionResult result) const
+        {
+            result.Instance = this;
+            return result;
+        }
+    };
+
+    /// @brief A geometry hit inside of an instance as seen from world space. The scene passes it to materials in place of
+    /// the shared geometry, so the rays materials such as RefractiveMaterial trace through the geometry they hit and the
+    /// normals they calculate are transformed by the instance.
+    export class InstancedGeometry : public Geometry
+    {
+    protected:
+        const GeometryInstance* Instance{nullptr};
+        const Geometry* HitGeometry{nullptr};
+
+    public:
+        InstancedGeometry(const GeometryInstance* instance, const Geometry* hitGeometry)
+            : Instance{instance}, HitGeometry{hitGeometry}
+        {
+
+        }
+
+        virtual const Material* GetMaterial() const override
+        {
+            return HitGeometry->GetMaterial();
+        }
+
+        virtual Vector3 CalculateNormal(const Ray& ray, const Vector3& hitPosition, real additionalData, std::uint32_t primitiveIndex) const override
+        {
+            return Instance->CalculateNormal(HitGeometry, ray, hitPosition, additionalData, primitiveIndex);
+        }
+
+        virtual BoundingBox CalculateBoundingBox() const override
+        {
+            return HitGeometry->CalculateBoundingBox().Transform(Instance->GetTransformation());
+        }
+
+        virtual IntersectionResult IntersectEntrance(const Ray& ray) const override
+        {
+            return AttachInstance(HitGeometry->IntersectEntrance(Instance->TransformRay(ray)));
+        }
+
+        virtual IntersectionResult IntersectExit(const Ray& ray) const override
+        {
+            return AttachInstance(HitGeometry->IntersectExit(Instance->TransformRay(ray)));
+        }
+
+        virtual bool IntersectAny(const Ray& ray, real maximumDistance) const override
+        {
+            return HitGeometry->IntersectAny(Instance->TransformRay(ray), maximumDistance);
+        }
+
+    private:
+        force_inline IntersectionResult AttachInstance(IntersectionResult result) const
+        {
+            result.Instance = Instance;
+            return result;
+        }
+    };
+}
\ No newline at end of file
@@ -1,13 +1,20 @@
 module;
 
 #include "range/v3/view/chunk.hpp"
+#include "Vcl.h"
 
 export module GeometrySoa;
 
+import <algorithm>;
+import <cstdint>;
+
 import "Common.h";
 
+import BoundingBox;
 import Geometry;
 import IntersectableGeometry;
+import Math;
+import RefittableGeometry;
 
 namespace Yart
 {
@@ -15,24 +22,131 @@ namespace Yart
     {
         _128,
         _256,
+
+        /// @brief Only used by the AVX-512 build of the engine, see SelectMaximumSoaSize. Other builds emulate the 512 bit
+        /// vectors with narrower halves.
+        _512,
+    };
+
+    /// @brief The number of geometries a SOA structure of the given size holds.
+    export template <SoaSize Size>
+        constexpr size_t SoaElements = (Size == SoaSize::_512 ? 64 : Size == SoaSize::_256 ? 32 : 16) / sizeof(real);
+
+    /// @brief The VCL vector type a SOA structure of the given size intersects its geometries with.
+    export template <SoaSize Size>
+        using SoaVector = std::conditional_t<std::same_as<real, float>,
+            std::conditional_t<Size == SoaSize::_512, vcl::Vec16f, std::conditional_t<Size == SoaSize::_256, vcl::Vec8f, vcl::Vec4f>>,
+            std::conditional_t<Size == SoaSize::_512, vcl::Vec8d, std::conditional_t<Size == SoaSize::_256, vcl::Vec4d, vcl::Vec2d>>>;
+
+    /// @brief The part of a geometry SOA structure that does not depend on the type of geometry it holds.
+    export class GeometrySoaBase : public IntersectableGeometry, public RefittableGeometry
+    {
+    public:
+        /// @brief Gets the number of geometries the structure can hold.
+        virtual size_t GetCapacity() const = 0;
+
+        /// @brief Gets the geometry inserted at index or nullptr if nothing was inserted there.
+        virtual const Geometry* GetGeometry(size_t index) const = 0;
+
+        /// @brief Gets the number of bytes used by the structure itself, not counting the geometries it was created from.
+        virtual size_t CalculateMemoryUsage() const = 0;
+
+        /// @brief Copies the current state of every inserted geometry back into the structure. Must be called after the
+        /// inserted geometries have been modified.
+        virtual void Refit() override = 0;
     };
 
     export template<GeometryConcept TGeometry>
-        class GeometrySoa : public IntersectableGeometry
+        class GeometrySoa : public GeometrySoaBase
     {
     public:
         virtual void Insert(size_t index, const TGeometry* geometry) = 0;
     };
 
+    /// @brief Spreads the lower 10 bits of value out so that there are two zero bits between each of them.
+    std::uint32_t SpreadMortonBits(std::uint32_t value)
+    {
+        value = (value * 0x00010001u) & 0xFF0000FFu;
+        value = (value * 0x00000101u) & 0x0F00F00Fu;
+        value = (value * 0x00000011u) & 0xC30C30C3u;
+        value = (value * 0x00000005u) & 0x49249249u;
+
+        return value;
+    }
+
+    /// @brief Sorts geometries along a 30 bit Morton curve through the centers of their bounding boxes so that
+    /// neighbouring geometries end up in the same SOA structure. Geometries with unbounded bounding boxes, such as planes,
+    /// keep their relative order and are moved to the end.
+    export template <IntersectableGeometryConcept TGeometry>
+    void SortByMortonCode(std::vector<const TGeometry*>& geometries)
+    {
+        std::vector<std::tuple<std::uint32_t, const TGeometry*>> keyedGeometries{};
+        keyedGeometries.reserve(geometries.size());
+
+        BoundingBox centerBoundingBox = BoundingBox::ReverseInfinity();
+
+        for (const TGeometry* geometry : geometries)
+        {
+            Vector3 center = geometry->CalculateBoundingBox().CalculateCenterPoint();
+
+            if (Math::isfinite(center.X) && Math::isfinite(center.Y) && Math::isfinite(center.Z))
+            {
+                centerBoundingBox = centerBoundingBox.Union(center);
+            }
+        }
+
+        Vector3 size = centerBoundingBox.Maximum - centerBoundingBox.Minimum;
+        Vector3 scale{
+            size.X > real{0} ? real{1023} / size.X : real{0},
+            size.Y > real{0} ? real{1023} / size.Y : real{0},
+            size.Z > real{0} ? real{1023} / size.Z : real{0},
+        };
+
+        for (const TGeometry* geometry : geometries)
+        {
+            Vector3 center = geometry->CalculateBoundingBox().CalculateCenterPoint();
+            std::uint32_t code = std::numeric_limits<std::uint32_t>::max();
+
+            if (Math::isfinite(center.X) && Math::isfinite(center.Y) && Math::isfinite(center.Z))
+            {
+                code =
+                    (SpreadMortonBits(static_cast<std::uint32_t>((center.X - centerBoundingBox.Minimum.X) * scale.X)) << 2) |
+                    (SpreadMortonBits(static_cast<std::uint32_t>((center.Y - centerBoundingBox.Minimum.Y) * scale.Y)) << 1) |
+                    SpreadMortonBits(static_cast<std::uint32_t>((center.Z - centerBoundingBox.Minimum.Z) * scale.Z));
+            }
+
+            keyedGeometries.emplace_back(code, geometry);
+        }
+
+        std::stable_sort(keyedGeometries.begin(), keyedGeometries.end(), [](const auto& left, const auto& right)
+            {
+                return std::get<0>(left) < std::get<0>(right);
+            });
+
+        for (size_t i = 0; i < geometries.size(); i++)
+        {
+            geometries[i] = std::get<1>(keyedGeometries[i]);
+        }
+    }
+
     export template <IntersectableGeometryConcept TGeometry, typename TGeometrySoa>
         requires std::derived_from<TGeometrySoa, GeometrySoa<TGeometry>>
     void CreateGeometrySoaStructure(
         const std::vector<const TGeometry*>& inputGeometries,
         std::vector<const IntersectableGeometry*>& outputGeometries,
-        std::vector<std::shared_ptr<const IntersectableGeometry>>& geometryPointers,
+        std::vector<std::shared_ptr<IntersectableGeometry>>& geometryPointers,
         size_t chunkSize = 8)
     {
-        auto chunks = inputGeometries | ranges::views::chunk(chunkSize);
+        // Packing in arrival order can put geometries from opposite ends of a leaf into one structure, its bounding box
+        // then covers most of the leaf and a ray can rarely skip it.
+        std::vector<const TGeometry*> sortedGeometries{inputGeometries};
+
+        if (sortedGeometries.size() > chunkSize)
+        {
+            SortByMortonCode(sortedGeometries);
+        }
+
+        auto chunks = sortedGeometries | ranges::views::chunk(chunkSize);
         for (const auto& chunk : chunks)
         {
             if (chunk.size() == 1)
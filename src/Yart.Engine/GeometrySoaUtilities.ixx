@@ -10,7 +10,13 @@ import "Common.h";
 
 import AxisAlignedBox;
 import AxisAlignedBoxSoa;
+import Disc;
+import DiscSoa;
 import GeometrySoa;
+import GeometryVisitor;
+import IndexedTriangleMesh;
+import IndexedTriangleSoa;
+import InstructionSet;
 import IntersectableGeometry;
 import Parallelogram;
 import ParallelogramSoa;
@@ -23,98 +29,214 @@ import TriangleSoa;
 
 namespace Yart
 {
-    export void CreateGeometrySoaStructures(
-        const std::vector<const IntersectableGeometry*>& inputGeometries,
+    template <typename TIndexedTriangleSoa>
+    void CreateIndexedTriangleSoaStructures(
+        const std::vector<const IndexedTriangle*>& inputTriangles,
         std::vector<const IntersectableGeometry*>& outputGeometries,
-        std::vector<std::shared_ptr<const IntersectableGeometry>>& geometryPointers)
+        std::vector<std::shared_ptr<IntersectableGeometry>>& geometryPointers)
     {
-        std::vector<const AxisAlignedBox*> axisAlignedBoxes{};
-        std::vector<const Parallelogram*> parallelograms{};
-        std::vector<const Plane*> planes{};
-        std::vector<const Sphere*> spheres{};
-        std::vector<const Triangle*> triangles{};
+        // Unlike the other geometries a lone indexed triangle is packed as well, the IndexedTriangle objects only live
+        // while the hierarchy is being built. Every structure holds the triangles of a single mesh.
+        std::vector<const IndexedTriangle*> meshTriangles{};
+        std::vector<const IndexedTriangle*> remainingTriangles{inputTriangles};
 
-        for (const auto* inputGeometry : inputGeometries)
+        while (!remainingTriangles.empty())
         {
-            if (auto axisAlignedBox = dynamic_cast<const AxisAlignedBox*>(inputGeometry))
-            {
-                axisAlignedBoxes.push_back(axisAlignedBox);
-            }
-            else if (auto parallelogram = dynamic_cast<const Parallelogram*>(inputGeometry))
-            {
-                parallelograms.push_back(parallelogram);
-            }
-            else if (auto plane = dynamic_cast<const Plane*>(inputGeometry))
-            {
-                planes.push_back(plane);
-            }
-            else if (auto sphere = dynamic_cast<const Sphere*>(inputGeometry))
+            const IndexedTriangleMesh* mesh = remainingTriangles[0]->Mesh;
+
+            meshTriangles.clear();
+            std::erase_if(remainingTriangles, [&](const IndexedTriangle* triangle)
+                {
+                    if (triangle->Mesh != mesh)
+                    {
+                        return false;
+                    }
+
+                    meshTriangles.push_back(triangle);
+                    return true;
+                });
+
+            if (meshTriangles.size() > TIndexedTriangleSoa::Elements)
             {
-                spheres.push_back(sphere);
+                SortByMortonCode(meshTriangles);
             }
-            else if (auto triangle = dynamic_cast<const Triangle*>(inputGeometry))
+
+            for (size_t start = 0; start < meshTriangles.size(); start += TIndexedTriangleSoa::Elements)
             {
-                triangles.push_back(triangle);
+                auto soa = std::shared_ptr<TIndexedTriangleSoa>{new TIndexedTriangleSoa{}};
+
+                geometryPointers.push_back(soa);
+                outputGeometries.push_back(soa.get());
+
+                for (size_t index = 0; index < TIndexedTriangleSoa::Elements && start + index < meshTriangles.size(); index++)
+                {
+                    soa->Insert(index, mesh, meshTriangles[start + index]->TriangleIndex);
+                }
             }
         }
+    }
+
+    /// @brief Picks the narrowest SOA structure that holds all of the geometries at once, limited to the widest one the
+    /// host supports.
+    SoaSize SelectSoaSize(size_t geometryCount)
+    {
+        SoaSize maximumSoaSize = GetMaximumSoaSize();
 
-        if (axisAlignedBoxes.size() > 0)
+        if (geometryCount <= SoaElements<SoaSize::_128> || maximumSoaSize == SoaSize::_128)
         {
-            if (axisAlignedBoxes.size() <= AxisAlignedBoxSoa<SoaSize::_128>::Elements)
-            {
-                CreateGeometrySoaStructure<AxisAlignedBox, AxisAlignedBoxSoa<SoaSize::_128>>(axisAlignedBoxes, outputGeometries, geometryPointers, AxisAlignedBoxSoa<SoaSize::_128>::Elements);
-            }
-            else
-            {
-                CreateGeometrySoaStructure<AxisAlignedBox, AxisAlignedBoxSoa<SoaSize::_256>>(axisAlignedBoxes, outputGeometries, geometryPointers, AxisAlignedBoxSoa<SoaSize::_256>::Elements);
-            }
+            return SoaSize::_128;
+        }
+        else if (geometryCount <= SoaElements<SoaSize::_256> || maximumSoaSize == SoaSize::_256)
+        {
+            return SoaSize::_256;
+        }
+        else
+        {
+            return SoaSize::_512;
         }
+    }
+
+    template <IntersectableGeometryConcept TGeometry, typename TGeometrySoa128, typename TGeometrySoa256, typename TGeometrySoa512>
+    void CreateSizedGeometrySoaStructures(
+        const std::vector<const TGeometry*>& inputGeometries,
+        std::vector<const IntersectableGeometry*>& outputGeometries,
+        std::vector<std::shared_ptr<IntersectableGeometry>>& geometryPointers)
+    {
+        SoaSize soaSize = SelectSoaSize(inputGeometries.size());
 
-        if (parallelograms.size() > 0)
+        if (soaSize == SoaSize::_128)
         {
-            if (parallelograms.size() <= ParallelogramSoa<SoaSize::_128>::Elements)
-            {
-                CreateGeometrySoaStructure<Parallelogram, ParallelogramSoa<SoaSize::_128>>(parallelograms, outputGeometries, geometryPointers, ParallelogramSoa<SoaSize::_128>::Elements);
-            }
-            else
-            {
-                CreateGeometrySoaStructure<Parallelogram, ParallelogramSoa<SoaSize::_256>>(parallelograms, outputGeometries, geometryPointers, ParallelogramSoa<SoaSize::_256>::Elements);
-            }
+            CreateGeometrySoaStructure<TGeometry, TGeometrySoa128>(inputGeometries, outputGeometries, geometryPointers, TGeometrySoa128::Elements);
+        }
+        else if (soaSize == SoaSize::_256)
+        {
+            CreateGeometrySoaStructure<TGeometry, TGeometrySoa256>(inputGeometries, outputGeometries, geometryPointers, TGeometrySoa256::Elements);
+        }
+        else
+        {
+            CreateGeometrySoaStructure<TGeometry, TGeometrySoa512>(inputGeometries, outputGeometries, geometryPointers, TGeometrySoa512::Elements);
         }
+    }
+
+    /// @brief Sorts the geometries of a leaf by the SOA structure they are packed into. Geometries that have no SOA
+    /// structure are passed through to the output untouched.
+    class GeometrySoaClassifier : public GeometryVisitor
+    {
+    public:
+        std::vector<const IntersectableGeometry*>& OutputGeometries;
+
+        std::vector<const AxisAlignedBox*> AxisAlignedBoxes{};
+        std::vector<const Disc*> Discs{};
+        std::vector<const IndexedTriangle*> IndexedTriangles{};
+        std::vector<const Parallelogram*> Parallelograms{};
+        std::vector<const Plane*> Planes{};
+        std::vector<const Sphere*> Spheres{};
+        std::vector<const Triangle*> Triangles{};
 
-        if (planes.size() > 0)
+        explicit GeometrySoaClassifier(std::vector<const IntersectableGeometry*>& outputGeometries)
+            : OutputGeometries{outputGeometries}
         {
-            if (planes.size() <= PlaneSoa<SoaSize::_128>::Elements)
-            {
-                CreateGeometrySoaStructure<Plane, PlaneSoa<SoaSize::_128>>(planes, outputGeometries, geometryPointers, PlaneSoa<SoaSize::_128>::Elements);
-            }
-            else
-            {
-                CreateGeometrySoaStructure<Plane, PlaneSoa<SoaSize::_256>>(planes, outputGeometries, geometryPointers, PlaneSoa<SoaSize::_256>::Elements);
-            }
+
         }
 
-        if (spheres.size() > 0)
+        virtual void Visit(const IntersectableGeometry* geometry) override
         {
-            if (spheres.size() <= SphereSoa<SoaSize::_128>::Elements)
-            {
-                CreateGeometrySoaStructure<Sphere, SphereSoa<SoaSize::_128>>(spheres, outputGeometries, geometryPointers, SphereSoa<SoaSize::_128>::Elements);
-            }
-            else
-            {
-                CreateGeometrySoaStructure<Sphere, SphereSoa<SoaSize::_256>>(spheres, outputGeometries, geometryPointers, SphereSoa<SoaSize::_256>::Elements);
-            }
+            OutputGeometries.push_back(geometry);
+        }
+
+        virtual void Visit(const AxisAlignedBox* geometry) override
+        {
+            AxisAlignedBoxes.push_back(geometry);
+        }
+
+        virtual void Visit(const Disc* geometry) override
+        {
+            Discs.push_back(geometry);
+        }
+
+        virtual void Visit(const IndexedTriangle* geometry) override
+        {
+            IndexedTriangles.push_back(geometry);
+        }
+
+        virtual void Visit(const Parallelogram* geometry) override
+        {
+            Parallelograms.push_back(geometry);
         }
 
-        if (triangles.size() > 0)
+        virtual void Visit(const Plane* geometry) override
         {
-            if (triangles.size() <= TriangleSoa<SoaSize::_128>::Elements)
+            Planes.push_back(geometry);
+        }
+
+        virtual void Visit(const Sphere* geometry) override
+        {
+            Spheres.push_back(geometry);
+        }
+
+        virtual void Visit(const Triangle* geometry) override
+        {
+            Triangles.push_back(geometry);
+        }
+    };
+
+    export void CreateGeometrySoaStructures(
+        const std::vector<const IntersectableGeometry*>& inputGeometries,
+        std::vector<const IntersectableGeometry*>& outputGeometries,
+        std::vector<std::shared_ptr<IntersectableGeometry>>& geometryPointers)
+    {
+        GeometrySoaClassifier classifier{outputGeometries};
+
+        for (const auto* inputGeometry : inputGeometries)
+        {
+            inputGeometry->Accept(classifier);
+        }
+
+        if (classifier.AxisAlignedBoxes.size() > 0)
+        {
+            CreateSizedGeometrySoaStructures<AxisAlignedBox, AxisAlignedBoxSoa<SoaSize::_128>, AxisAlignedBoxSoa<SoaSize::_256>, AxisAlignedBoxSoa<SoaSize::_512>>(classifier.AxisAlignedBoxes, outputGeometries, geometryPointers);
+        }
+
+        if (classifier.Discs.size() > 0)
+        {
+            CreateSizedGeometrySoaStructures<Disc, DiscSoa<SoaSize::_128>, DiscSoa<SoaSize::_256>, DiscSoa<SoaSize::_512>>(classifier.Discs, outputGeometries, geometryPointers);
+        }
+
+        if (classifier.Parallelograms.size() > 0)
+        {
+            CreateSizedGeometrySoaStructures<Parallelogram, ParallelogramSoa<SoaSize::_128>, ParallelogramSoa<SoaSize::_256>, ParallelogramSoa<SoaSize::_512>>(classifier.Parallelograms, outputGeometries, geometryPointers);
+        }
+
+        if (classifier.Planes.size() > 0)
+        {
+            CreateSizedGeometrySoaStructures<Plane, PlaneSoa<SoaSize::_128>, PlaneSoa<SoaSize::_256>, PlaneSoa<SoaSize::_512>>(classifier.Planes, outputGeometries, geometryPointers);
+        }
+
+        if (classifier.Spheres.size() > 0)
+        {
+            CreateSizedGeometrySoaStructures<Sphere, SphereSoa<SoaSize::_128>, SphereSoa<SoaSize::_256>, SphereSoa<SoaSize::_512>>(classifier.Spheres, outputGeometries, geometryPointers);
+        }
+
+        if (classifier.Triangles.size() > 0)
+        {
+            CreateSizedGeometrySoaStructures<Triangle, TriangleSoa<SoaSize::_128>, TriangleSoa<SoaSize::_256>, TriangleSoa<SoaSize::_512>>(classifier.Triangles, outputGeometries, geometryPointers);
+        }
+
+        if (classifier.IndexedTriangles.size() > 0)
+        {
+            SoaSize soaSize = SelectSoaSize(classifier.IndexedTriangles.size());
+
+            if (soaSize == SoaSize::_128)
+            {
+                CreateIndexedTriangleSoaStructures<IndexedTriangleSoa<SoaSize::_128>>(classifier.IndexedTriangles, outputGeometries, geometryPointers);
+            }
+            else if (soaSize == SoaSize::_256)
             {
-                CreateGeometrySoaStructure<Triangle, TriangleSoa<SoaSize::_128>>(triangles, outputGeometries, geometryPointers, TriangleSoa<SoaSize::_128>::Elements);
+                CreateIndexedTriangleSoaStructures<IndexedTriangleSoa<SoaSize::_256>>(classifier.IndexedTriangles, outputGeometries, geometryPointers);
             }
             else
             {
-                CreateGeometrySoaStructure<Triangle, TriangleSoa<SoaSize::_256>>(triangles, outputGeometries, geometryPointers, TriangleSoa<SoaSize::_256>::Elements);
+                CreateIndexedTriangleSoaStructures<IndexedTriangleSoa<SoaSize::_512>>(classifier.IndexedTriangles, outputGeometries, geometryPointers);
             }
         }
     }
@@ -0,0 +1,24 @@
+export module GeometryVisitor;
+
+import "Common.h";
+
+import GeometryDecl;
+
+namespace Yart
+{
+    /// @brief Dispatches on the concrete type of a geometry without walking its RTTI, see IntersectableGeometry::Accept.
+    /// Geometries without an overload of their own are visited as an IntersectableGeometry.
+    export class GeometryVisitor
+    {
+    public:
+        virtual void Visit(const IntersectableGeometry* geometry) = 0;
+
+        virtual void Visit(const AxisAlignedBox* geometry) = 0;
+        virtual void Visit(const Disc* geometry) = 0;
+        virtual void Visit(const IndexedTriangle* geometry) = 0;
+        virtual void Visit(const Parallelogram* geometry) = 0;
+        virtual void Visit(const Plane* geometry) = 0;
+        virtual void Visit(const Sphere* geometry) = 0;
+        virtual void Visit(const Triangle* geometry) = 0;
+    };
+}
\ No newline at end of file
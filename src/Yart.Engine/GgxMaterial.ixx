@@ -35,6 +35,19 @@ namespace Yart
 		}
 
         virtual Color3 CalculateRenderingEquation(
+            const Scene& scene,
+            const Random& random,
+            int currentDepth,
+            const Geometry* hitGeometry,
+            const Vector3& hitPosition,
+            const Vector3& hitNormal,
+            const Vector3& incomingDirection,
+            real mixAmount) const override
+		{
+            return scene.CastScatterColor(Scatter(scene, random, currentDepth, hitGeometry, hitPosition, hitNormal, incomingDirection, mixAmount), currentDepth, random);
+		}
+
+        virtual ScatterResult Scatter(
             const Scene& scene,
             const Random& random,
             int currentDepth,
@@ -47,25 +60,24 @@ namespace Yart
 			Vector3 V = -incomingDirection;
 			real NdotV = hitNormal * V;
 
-
-
-
-
-
+			Color3 directLight = scene.EstimateDirectLight(*this, random, hitPosition, hitNormal, incomingDirection);
 
 			real probDiffuse = ProbabilityToSampleDiffuse();
 			bool chooseDiffuse = random.GetNormalized() < probDiffuse;
 
+            ScatterResult result{};
+            result.Emitted = directLight;
+            result.Continues = true;
+
 			if (chooseDiffuse)
 			{
 				// Shoot a randomly selected cosine-sampled diffuse ray.
 				Vector3 L = GenerateCosineWeightedHemisphereSample(random, hitNormal);
-                Color3 bounceColor = scene.CastRayColor({hitPosition, L}, currentDepth + 1, random);
 
 				// Accumulate the color: (NdotL * incomingLight * dif / pi)
 				// Probability of sampling this ray:  (NdotL / pi) * probDiffuse
-                Color3 outputColor = bounceColor * DiffuseColor / probDiffuse;
-				return outputColor;
+                result.Attenuation = DiffuseColor / probDiffuse;
+                result.OutgoingRay = Ray{hitPosition, L};
 			}
 			else
 			{
@@ -74,9 +86,6 @@ namespace Yart
 				// Compute outgoing direction based on this (perfectly reflective) facet
                 Vector3 L = (real{2.0} *(V * H) * H - V).Normalize();
 
-				// Compute our color by tracing a ray in this direction
-                Color3 bounceColor = scene.CastRayColor({hitPosition, L}, currentDepth + 1, random);
-
 				// Compute some dot products needed for shading
 				real NdotL = Math::max(real{0.0}, hitNormal * L);
 				real NdotH = Math::max(real{0.0}, hitNormal * H);
@@ -90,9 +99,50 @@ namespace Yart
 
                 real pdf = D * NdotH / (real{4.0} *LdotH);
 
-                Color3 outputColor = bounceColor * ggxTerm /** NdotL*/ / (pdf * (real{1.0} - probDiffuse));
-				return outputColor;
+				// The color is found by tracing a ray in this direction.
+                result.Attenuation = ggxTerm /** NdotL*/ / (pdf * (real{1.0} - probDiffuse));
+                result.OutgoingRay = Ray{hitPosition, L};
 			}
+
+			// Either lobe could have produced the direction, the light the ray finds is weighed with the pdf of both.
+			EvaluateScattering(hitNormal, incomingDirection, result.OutgoingRay.Direction, result.Pdf);
+
+			return result;
+		}
+
+        virtual Color3 EvaluateScattering(
+            const Vector3& hitNormal,
+            const Vector3& incomingDirection,
+            const Vector3& outgoingDirection,
+            real& pdf) const override
+		{
+			Vector3 V = -incomingDirection;
+			Vector3 H = (V + outgoingDirection).Normalize();
+
+			real NdotV = hitNormal * V;
+			real NdotL = hitNormal * outgoingDirection;
+
+			if (NdotV <= real{0.0} || NdotL <= real{0.0})
+			{
+				pdf = real{0.0};
+				return Color3{};
+			}
+
+			real NdotH = Math::max(real{0.0}, hitNormal * H);
+			real LdotH = Math::max(real{0.0}, outgoingDirection * H);
+
+			real probDiffuse = ProbabilityToSampleDiffuse();
+			real D = NormalDistribution(NdotH);
+
+			// Same terms as Scatter, the NdotL of the cosine term cancels the one in the denominator of the BRDF.
+			Color3 diffuseTerm = DiffuseColor * (NdotL * OneOverPi);
+			Color3 ggxTerm = D * SchlickMaskingTerm(NdotL, NdotV) * SchlickFresnel(SpecularColor, LdotH) / (real{4.0} * NdotV);
+
+			real diffusePdf = NdotL * OneOverPi;
+			real specularPdf = LdotH > real{0.0} ? D * NdotH / (real{4.0} * LdotH) : real{0.0};
+
+			pdf = probDiffuse * diffusePdf + (real{1.0} - probDiffuse) * specularPdf;
+			return diffuseTerm + ggxTerm;
 		}
 
 		real NormalDistribution(real nDotH) const
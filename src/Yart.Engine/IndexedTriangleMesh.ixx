@@ -0,0 +1,250 @@
+export module IndexedTriangleMesh;
+
+import <cassert>;
+import <cstdint>;
+import <limits>;
+
+import "Common.h";
+
+import BoundingBox;
+import Geometry;
+import GeometryVisitor;
+import IntersectableGeometry;
+import IntersectionResult;
+import Material;
+import Math;
+import Ray;
+
+namespace Yart
+{
+    /// @brief A triangle mesh stored as a shared vertex buffer, a matching normal buffer and a 32 bit index buffer with
+    /// three indices per triangle. The mesh is the geometry reported for every hit on one of its triangles, the index of
+    /// the triangle is passed along as the primitive index of the hit.
+    ///
+    /// Triangles are intersected through the hierarchy built over them, see SetHierarchy.
+    export class IndexedTriangleMesh : public Geometry
+    {
+    protected:
+        std::vector<Vector3> Vertices{};
+        std::vector<Vector3> Normals{};
+        std::vector<std::uint32_t> Indices{};
+
+        const Material* AppliedMaterial{nullptr};
+        const IntersectableGeometry* Hierarchy{nullptr};
+
+    public:
+        IndexedTriangleMesh(
+            std::vector<Vector3> vertices,
+            std::vector<Vector3> normals,
+            std::vector<std::uint32_t> indices,
+            const Material* appliedMaterial)
+            :
+            Vertices{std::move(vertices)},
+            Normals{std::move(normals)},
+            Indices{std::move(indices)},
+            AppliedMaterial{appliedMaterial}
+        {
+            assert(Vertices.size() == Normals.size());
+            assert(Indices.size() % 3 == 0);
+        }
+
+        size_t GetTriangleCount() const
+        {
+            return Indices.size() / 3;
+        }
+
+        force_inline const Vector3& GetVertex(size_t triangleIndex, size_t corner) const
+        {
+            return Vertices[Indices[triangleIndex * 3 + corner]];
+        }
+
+        force_inline const Vector3& GetNormal(size_t triangleIndex, size_t corner) const
+        {
+            return Normals[Indices[triangleIndex * 3 + corner]];
+        }
+
+        /// @brief Gets the number of bytes used by the vertex, normal and index buffers.
+        size_t CalculateMemoryUsage() const
+        {
+            return Vertices.size() * sizeof(Vector3) + Normals.size() * sizeof(Vector3) + Indices.size() * sizeof(std::uint32_t);
+        }
+
+        /// @brief Sets the hierarchy built over the triangles of the mesh. Intersecting the mesh itself forwards to it,
+        /// which materials such as RefractiveMaterial rely on when they trace rays through the geometry they hit.
+        void SetHierarchy(const IntersectableGeometry* hierarchy)
+        {
+            Hierarchy = hierarchy;
+        }
+
+        BoundingBox CalculateTriangleBoundingBox(size_t triangleIndex) const
+        {
+            const Vector3& vertex0 = GetVertex(triangleIndex, 0);
+            const Vector3& vertex1 = GetVertex(triangleIndex, 1);
+            const Vector3& vertex2 = GetVertex(triangleIndex, 2);
+
+            return BoundingBox{
+                Vector3::Min(vertex0, Vector3::Min(vertex1, vertex2)),
+                Vector3::Max(vertex0, Vector3::Max(vertex1, vertex2)),
+            };
+        }
+
+        virtual BoundingBox CalculateBoundingBox() const override
+        {
+            BoundingBox boundingBox = BoundingBox::ReverseInfinity();
+
+            for (std::uint32_t index : Indices)
+            {
+                boundingBox = boundingBox.Union(Vertices[index]);
+            }
+
+            return boundingBox;
+        }
+
+        virtual const Material* GetMaterial() const override
+        {
+            return AppliedMaterial;
+        }
+
+        virtual Vector3 CalculateNormal(const Ray& ray, const Vector3& hitPosition, real additionalData, std::uint32_t primitiveIndex) const override
+        {
+            size_t triangleIndex = primitiveIndex;
+
+            const Vector3& vertex0 = GetVertex(triangleIndex, 0);
+
+            // Barycentric coordinate calculations from: https://gamedev.stackexchange.com/a/23745
+            Vector3 v0 = GetVertex(triangleIndex, 1) - vertex0;
+            Vector3 v1 = GetVertex(triangleIndex, 2) - vertex0;
+            Vector3 v2 = hitPosition - vertex0;
+
+            real d00 = v0 * v0;
+            real d01 = v0 * v1;
+            real d11 = v1 * v1;
+            real d20 = v2 * v0;
+            real d21 = v2 * v1;
+
+            real inverseDenom = Math::rcp(d00 * d11 - d01 * d01);
+
+            real v = (d11 * d20 - d01 * d21) * inverseDenom;
+            real w = (d00 * d21 - d01 * d20) * inverseDenom;
+            real u = real{1.0} - v - w;
+
+            Vector3 normal = (GetNormal(triangleIndex, 0) * u + GetNormal(triangleIndex, 1) * v + GetNormal(triangleIndex, 2) * w).Normalize();
+
+            return (ray.Direction * normal) < real{0.0} ? normal : -normal;
+        }
+
+        virtual IntersectionResult IntersectEntrance(const Ray& ray) const override
+        {
+            return Hierarchy ? Hierarchy->IntersectEntrance(ray) : IntersectionResult{nullptr, std::numeric_limits<real>::infinity()};
+        }
+
+        virtual IntersectionResult IntersectEntrance(const Ray& ray, real maximumDistance) const override
+        {
+            return Hierarchy ? Hierarchy->IntersectEntrance(ray, maximumDistance) : IntersectionResult{nullptr, std::numeric_limits<real>::infinity()};
+        }
+
+        virtual IntersectionResult IntersectExit(const Ray& ray) const override
+        {
+            return Hierarchy ? Hierarchy->IntersectExit(ray) : IntersectionResult{nullptr, std::numeric_limits<real>::infinity()};
+        }
+
+        virtual bool IntersectAny(const Ray& ray, real maximumDistance) const override
+        {
+            return Hierarchy && Hierarchy->IntersectAny(ray, maximumDistance);
+        }
+
+        force_inline real IntersectTriangle(size_t triangleIndex, const Ray& ray) const
+        {
+            const Vector3& vertex0 = GetVertex(triangleIndex, 0);
+
+            // From: https://en.wikipedia.org/wiki/M%C3%B6ller%E2%80%93Trumbore_intersection_algorithm
+            Vector3 edge1 = GetVertex(triangleIndex, 1) - vertex0;
+            Vector3 edge2 = GetVertex(triangleIndex, 2) - vertex0;
+
+            Vector3 h = ray.Direction % edge2;
+            real a = edge1 * h;
+
+            if (a == real{0.0})
+            {
+                return std::numeric_limits<real>::infinity();
+            }
+
+            real f = real{1.0} / a;
+            Vector3 s = ray.Position - vertex0;
+            real u = f * (s * h);
+
+            if (u < real{0.0} || u > real{1.0})
+            {
+                return std::numeric_limits<real>::infinity();
+            }
+
+            Vector3 q = s % edge1;
+            real v = f * (ray.Direction * q);
+
+            if (v < real{0.0} || u + v > real{1.0})
+            {
+                return std::numeric_limits<real>::infinity();
+            }
+
+            real entranceDistance = f * (edge2 * q);
+            return entranceDistance >= real{0.0} ? entranceDistance : std::numeric_limits<real>::infinity();
+        }
+    };
+
+    /// @brief A single triangle of an IndexedTriangleMesh. These only exist while a hierarchy is built over the mesh, the
+    /// leafs of the hierarchy are packed into IndexedTriangleSoa structures that refer to the mesh directly.
+    export class IndexedTriangle : public IntersectableGeometry
+    {
+    public:
+        const IndexedTriangleMesh* Mesh{nullptr};
+        std::uint32_t TriangleIndex{};
+
+        IndexedTriangle(const IndexedTriangleMesh* mesh, std::uint32_t triangleIndex)
+            : Mesh{mesh}, TriangleIndex{triangleIndex}
+        {
+
+        }
+
+        virtual BoundingBox CalculateBoundingBox() const override
+        {
+            return Mesh->CalculateTriangleBoundingBox(TriangleIndex);
+        }
+
+        virtual void Accept(GeometryVisitor& visitor) const override
+        {
+            visitor.Visit(this);
+        }
+
+        virtual IntersectionResult IntersectEntrance(const Ray& ray) const override
+        {
+            return Intersect(ray);
+        }
+
+        virtual IntersectionResult IntersectExit(const Ray& ray) const override
+        {
+            return Intersect(ray);
+        }
+
+    private:
+        IntersectionResult Intersect(const Ray& ray) const
+        {
+            IntersectionResult result{Mesh, Mesh->IntersectTriangle(TriangleIndex, ray)};
+            result.PrimitiveIndex = TriangleIndex;
+
+            return result;
+        }
+    };
+
+    export std::vector<IndexedTriangle> CreateIndexedTriangles(const IndexedTriangleMesh* mesh)
+    {
+        std::vector<IndexedTriangle> triangles{};
+        triangles.reserve(mesh->GetTriangleCount());
+
+        for (size_t i = 0; i < mesh->GetTriangleCount(); i++)
+        {
+            triangles.emplace_back(mesh, static_cast<std::uint32_t>(i));
+        }
+
+        return triangles;
+    }
+}
\ No newline at end of file
@@ -0,0 +1,144 @@
+module;
+
+#include "Vcl.h"
+
+export module IndexedTriangleSoa;
+
+import <cassert>;
+import <cstdint>;
+import <limits>;
+
+import "Common.h";
+
+import BoundingBox;
+import Geometry;
+import GeometrySoa;
+import IndexedTriangleMesh;
+import IntersectionResult;
+import Math;
+import Ray;
+import TriangleSoa;
+
+using namespace vcl;
+
+namespace Yart
+{
+    /// @brief Packs up to Elements triangles of a single IndexedTriangleMesh. Only the vertex data needed by the
+    /// intersection kernel is duplicated, the triangles are referred to by their index in the mesh.
+    export template<SoaSize Size, TriangleIntersectionKernel Kernel = DefaultTriangleIntersectionKernel>
+        class alignas(64) IndexedTriangleSoa : public GeometrySoaBase
+    {
+    public:
+        static constexpr size_t Elements = TriangleSoaVertices<Size, Kernel>::Elements;
+        static constexpr std::uint32_t EmptyTriangle = std::numeric_limits<std::uint32_t>::max();
+
+    private:
+        TriangleSoaVertices<Size, Kernel> _vertices{};
+        const IndexedTriangleMesh* _mesh{nullptr};
+        std::uint32_t _triangleIndices[Elements];
+
+    public:
+        IndexedTriangleSoa()
+        {
+            for (size_t i = 0; i < Elements; i++)
+            {
+                _triangleIndices[i] = EmptyTriangle;
+            }
+        }
+
+        void Insert(size_t index, const IndexedTriangleMesh* mesh, std::uint32_t triangleIndex)
+        {
+            assert(index >= 0 && index < Elements);
+            assert(!_mesh || _mesh == mesh);
+
+            _mesh = mesh;
+            _triangleIndices[index] = triangleIndex;
+
+            _vertices.Set(index, mesh->GetVertex(triangleIndex, 0), mesh->GetVertex(triangleIndex, 1), mesh->GetVertex(triangleIndex, 2));
+        }
+
+        const IndexedTriangleMesh* GetMesh() const
+        {
+            return _mesh;
+        }
+
+        std::uint32_t GetTriangleIndex(size_t index) const
+        {
+            assert(index >= 0 && index < Elements);
+
+            return _triangleIndices[index];
+        }
+
+        virtual size_t GetCapacity() const override
+        {
+            return Elements;
+        }
+
+        /// @brief Gets the mesh if a triangle was inserted at index, the triangle itself has no geometry of its own.
+        virtual const Geometry* GetGeometry(size_t index) const override
+        {
+            assert(index >= 0 && index < Elements);
+
+            return _triangleIndices[index] != EmptyTriangle ? _mesh : nullptr;
+        }
+
+        virtual size_t CalculateMemoryUsage() const override
+        {
+            return sizeof(*this);
+        }
+
+        virtual void Refit() override
+        {
+            for (size_t i = 0; i < Elements; i++)
+            {
+                if (_triangleIndices[i] != EmptyTriangle)
+                {
+                    Insert(i, _mesh, _triangleIndices[i]);
+                }
+            }
+        }
+
+        virtual BoundingBox CalculateBoundingBox() const override
+        {
+            BoundingBox boundingBox = BoundingBox::ReverseInfinity();
+
+            for (size_t i = 0; i < Elements; i++)
+            {
+                if (_triangleIndices[i] == EmptyTriangle)
+                {
+                    break;
+                }
+
+                boundingBox = boundingBox.Union(_mesh->CalculateTriangleBoundingBox(_triangleIndices[i]));
+            }
+
+            return boundingBox;
+        }
+
+        virtual IntersectionResult IntersectEntrance(const Ray& ray) const override
+        {
+            return Intersect(ray);
+        }
+
+        virtual bool IntersectAny(const Ray& ray, real maximumDistance) const override
+        {
+            return Intersect(ray).HitDistance < maximumDistance;
+        }
+
+        virtual IntersectionResult IntersectExit(const Ray& ray) const override
+        {
+            return Intersect(ray);
+        }
+
+    private:
+        force_inline IntersectionResult Intersect(const Ray& ray) const
+        {
+            auto [minimumEntranceDistance, minimumIndex] = _vertices.Intersect(ray);
+
+            IntersectionResult result{_mesh, minimumEntranceDistance};
+            result.PrimitiveIndex = _triangleIndices[minimumIndex == -1 ? 0 : minimumIndex];
+
+            return result;
+        }
+    };
+}
\ No newline at end of file
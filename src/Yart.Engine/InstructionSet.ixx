@@ -0,0 +1,73 @@
+module;
+
+#include "Vcl.h"
+
+export module InstructionSet;
+
+import "Common.h";
+
+import GeometrySoa;
+import Math;
+
+namespace Yart
+{
+    /// @brief The instruction set levels reported by VCL's instrset_detect.
+    export enum class InstructionSet
+    {
+        Sse2 = 2,
+        Sse41 = 5,
+        Avx = 7,
+        Avx2 = 8,
+        Avx512 = 9,
+
+        /// @brief AVX-512 with the BW, DQ and VL extensions, the level of builds compiled with /arch:AVX512.
+        Avx512BwDqVl = 10,
+    };
+
+    /// @brief Gets the instruction set level the engine was compiled for. The host must support at least this level.
+    export int GetCompiledInstructionSet()
+    {
+        return INSTRSET;
+    }
+
+    /// @brief Gets the highest instruction set level supported by the host.
+    export int GetHostInstructionSet()
+    {
+        static int hostInstructionSet = vcl::instrset_detect();
+        return hostInstructionSet;
+    }
+
+    export bool IsHostInstructionSetSupported()
+    {
+        return GetHostInstructionSet() >= GetCompiledInstructionSet();
+    }
+
+    /// @brief Picks the widest SOA structure the engine can intersect natively on the host.
+    export SoaSize SelectMaximumSoaSize()
+    {
+        // VCL emulates vectors wider than the compiled instruction set with several narrower ones, so a host that supports
+        // more than the engine was compiled for gains nothing from wider structures.
+        int instructionSet = Math::min(GetHostInstructionSet(), GetCompiledInstructionSet());
+
+        if (instructionSet >= static_cast<int>(InstructionSet::Avx512))
+        {
+            return SoaSize::_512;
+        }
+        else if (instructionSet >= static_cast<int>(InstructionSet::Avx))
+        {
+            return SoaSize::_256;
+        }
+        else
+        {
+            return SoaSize::_128;
+        }
+    }
+
+    /// @brief Gets the widest SOA structure the geometry builders create. Neither the host nor the build change while the
+    /// engine runs, so it is selected once and shared by every scene.
+    export SoaSize GetMaximumSoaSize()
+    {
+        static const SoaSize maximumSoaSize = SelectMaximumSoaSize();
+        return maximumSoaSize;
+    }
+}
\ No newline at end of file
@@ -1,11 +1,16 @@
 export module IntersectableGeometry;
 
+import <bit>;
+import <cstdint>;
+
 import "Common.h";
 
 import BoundingBox;
+import GeometryVisitor;
 import IntersectionResult;
 import Math;
 import Ray;
+import RayPacket;
 
 namespace Yart
 {
@@ -15,6 +20,38 @@ namespace Yart
         virtual IntersectionResult IntersectEntrance(const Ray& ray) const = 0;
         virtual IntersectionResult IntersectExit(const Ray& ray) const = 0;
 
+        /// @brief Finds the closest entrance intersection that is nearer than maximumDistance. Geometries that contain
+        /// other geometries override this so that children which start beyond maximumDistance are never visited.
+        virtual IntersectionResult IntersectEntrance(const Ray& ray, real maximumDistance) const
+        {
+            IntersectionResult result = IntersectEntrance(ray);
+            return result.HitDistance < maximumDistance ? result : IntersectionResult{nullptr, std::numeric_limits<real>::infinity()};
+        }
+
+        /// @brief Determines whether anything is hit closer than maximumDistance. Unlike IntersectEntrance this is free
+        /// to return as soon as any hit is found which makes it the cheaper choice for occlusion and shadow rays.
+        virtual bool IntersectAny(const Ray& ray, real maximumDistance) const
+        {
+            return IntersectEntrance(ray, maximumDistance).HitDistance < maximumDistance;
+        }
+
+        /// @brief Finds the closest entrance intersection of every ray of the packet whose lane is set in laneMask. results
+        /// holds an entry per lane, its HitDistance is the maximum distance of the ray on input and is only replaced by
+        /// closer hits. Hierarchies override this to traverse their nodes with the whole packet at once.
+        virtual void IntersectPacketEntrance(const RayPacket& packet, std::uint32_t laneMask, IntersectionResult* results) const
+        {
+            for (std::uint32_t mask = laneMask; mask != 0; mask &= mask - 1)
+            {
+                size_t lane = std::countr_zero(mask);
+
+                IntersectionResult result = IntersectEntrance(packet.GetRay(lane), results[lane].HitDistance);
+                if (result.HitDistance < results[lane].HitDistance)
+                {
+                    results[lane] = result;
+                }
+            }
+        }
+
         virtual BoundingBox CalculateBoundingBox() const
         {
             return BoundingBox{
@@ -22,6 +59,12 @@ namespace Yart
                 Vector3{std::numeric_limits<real>::infinity()},
             };
         }
+
+        /// @brief Calls the overload of GeometryVisitor::Visit that matches the concrete type of the geometry.
+        virtual void Accept(GeometryVisitor& visitor) const
+        {
+            visitor.Visit(this);
+        }
     };
 
     export template<typename T>
@@ -1,5 +1,7 @@
 export module IntersectionResult;
 
+import <cstdint>;
+
 import "Common.h";
 
 import GeometryDecl;
@@ -16,6 +18,13 @@ namespace Yart
         T AdditionalData{};
         const Material* MaterialOverride{};
 
+        // Identifies the hit within geometries made of many primitives, such as the triangle of an IndexedTriangleMesh.
+        // Kept apart from AdditionalData because a float can not hold every 32 bit index exactly.
+        std::uint32_t PrimitiveIndex{};
+
+        // Set when HitGeometry was hit in the object space of an instance. The instance transforms it back to world space.
+        const GeometryInstance* Instance{};
+
 		IntersectionResultT() = default;
 
         IntersectionResultT(const Geometry* hitGeometry, T hitDistance, T additionalData = {}, const Material* materialOverride = nullptr)
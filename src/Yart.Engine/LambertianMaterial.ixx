@@ -23,6 +23,19 @@ namespace Yart
 		}
 
         virtual Color3 CalculateRenderingEquation(
+            const Scene& scene,
+            const Random& random,
+            int currentDepth,
+            const Geometry* hitGeometry,
+            const Vector3& hitPosition,
+            const Vector3& hitNormal,
+            const Vector3& incomingDirection,
+            real mixAmount) const override
+		{
+            return scene.CastScatterColor(Scatter(scene, random, currentDepth, hitGeometry, hitPosition, hitNormal, incomingDirection, mixAmount), currentDepth, random);
+		}
+
+        virtual ScatterResult Scatter(
             const Scene& scene,
             const Random& random,
             int currentDepth,
@@ -42,7 +55,7 @@ namespace Yart
 					real stoppingProbability = random.GetNormalized();
 					if (stoppingProbability > stoppingCutoff)
 					{
-						return {};
+						return ScatterResult{};
 					}
 					else
 					{
@@ -51,38 +64,32 @@ namespace Yart
 				}
 			}
 
-			real whereToShootRay = random.GetNormalized();
-            real probabilityFactor = scene.AreaLights.size() == 0 ? real{1.0} : real{2.0};
+			// Direct light from a light sample, the indirect light and the light the cosine weighted ray finds on a light
+			// are weighed against it.
+			Color3 directLight = scene.EstimateDirectLight(*this, random, hitPosition, hitNormal, incomingDirection);
+			Vector3 outgoingDirection = GenerateCosineWeightedHemisphereSample(random, hitNormal);
 
-            if (scene.AreaLights.size() == 0 || whereToShootRay > real{0.5})
-			{
-				// Indirect light sample according to material.
-				Vector3 outgoingDirection = GenerateCosineWeightedHemisphereSample(random, hitNormal);
-				Ray outgoingRay = Ray{hitPosition, outgoingDirection};
+			// The cosine and the pdf cancel out: (DiffuseColor / pi * cos) / (cos / pi).
+            ScatterResult result{};
+            result.Emitted = directLight * roulettePower;
+            result.Attenuation = DiffuseColor * roulettePower;
+            result.OutgoingRay = Ray{hitPosition, outgoingDirection};
+            result.Continues = true;
+            result.Pdf = Math::max(real{0.0}, hitNormal * outgoingDirection) * OneOverPi;
 
-                Color3 colorSample = scene.CastRayColor(outgoingRay, currentDepth + 1, random);
-                Color3 outputColor = DiffuseColor * colorSample * roulettePower * probabilityFactor;
-
-				return outputColor;
-			}
-			else
-			{
-				int indexOfLightToSample = random.GetInteger(0, static_cast<int>(scene.AreaLights.size()) - 1);
-				auto& light = scene.AreaLights[indexOfLightToSample];
-
-				// Direct light sample to a random light.
-				Vector3 outgoingDirection = light->GetDirectionTowardsLight(random, hitPosition, hitNormal);
-				Ray outgoingRay = Ray{hitPosition, outgoingDirection};
-
-                Color3 colorSample = scene.CastRayColor(outgoingRay, currentDepth + 1, random);
+			return result;
+		}
 
-				real brdf = OneOverPi;
-				real inversePdf = light->CalculateInversePdf(random, hitPosition, hitNormal, incomingDirection, outgoingDirection);
-				real cosineTheta = Math::max(real{0.0}, hitNormal * outgoingDirection);
+        virtual Color3 EvaluateScattering(
+            const Vector3& hitNormal,
+            const Vector3& incomingDirection,
+            const Vector3& outgoingDirection,
+            real& pdf) const override
+		{
+			real cosineTheta = Math::max(real{0.0}, hitNormal * outgoingDirection);
+			pdf = cosineTheta * OneOverPi;
 
-                Color3 outputColor = brdf * DiffuseColor * colorSample * inversePdf * cosineTheta * roulettePower * probabilityFactor;
-				return outputColor;
-			}
+			return DiffuseColor * (cosineTheta * OneOverPi);
 		}
 
 		real CalculateInversePdf(const Vector3& hitNormal, const Vector3& outgoingDirection) const
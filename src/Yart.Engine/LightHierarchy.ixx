@@ -0,0 +1,294 @@
+export module LightHierarchy;
+
+import <algorithm>;
+import <cstdint>;
+import <limits>;
+import <vector>;
+
+import "Common.h";
+
+import AreaLight;
+import BoundingBox;
+import Math;
+import Random;
+
+namespace Yart
+{
+    export class LightHierarchyNode
+    {
+    public:
+        static constexpr std::uint32_t EmptyIndex = std::numeric_limits<std::uint32_t>::max();
+
+        BoundingBox Bounds{};
+
+        /// @brief Bounds the normals of the lights below the node with a cone around Axis. Area lights emit from both of
+        /// their sides, so the cone is two sided and ConeAngle never exceeds half pi.
+        Vector3 Axis{};
+        real ConeAngle{};
+
+        real Power{};
+
+        std::uint32_t Parent{EmptyIndex};
+        std::uint32_t Children[2]{EmptyIndex, EmptyIndex};
+
+        /// @brief The index of the light in a leaf, EmptyIndex for inner nodes.
+        std::uint32_t LightIndex{EmptyIndex};
+    };
+
+    /// @brief A binary hierarchy over area lights for picking a light by its estimated contribution to a position. Each
+    /// node stores the bounds, the total power and an orientation cone of the lights below it. Sampling walks down from
+    /// the root and picks a child in proportion to its importance, the power of the child reduced by its distance and by
+    /// how far its lights face away from the position.
+    ///
+    /// The lights are assumed to be flat, a light's normal at its center is its orientation.
+    export class LightHierarchy
+    {
+    private:
+        class BuildLight
+        {
+        public:
+            std::uint32_t Index{};
+            BoundingBox Bounds{};
+            Vector3 Center{};
+            Vector3 Axis{};
+            real Power{};
+        };
+
+        std::vector<LightHierarchyNode> _nodes{};
+
+        /// @brief The leaf of every light, by the index of the light.
+        std::vector<std::uint32_t> _leafs{};
+
+    public:
+        LightHierarchy() = default;
+
+        /// @param powers The power of every light, in the order of areaLights.
+        LightHierarchy(const std::vector<const AreaLight*>& areaLights, const std::vector<real>& powers)
+            : _leafs(areaLights.size(), LightHierarchyNode::EmptyIndex)
+        {
+            if (areaLights.empty())
+            {
+                return;
+            }
+
+            std::vector<BuildLight> buildLights(areaLights.size());
+
+            for (size_t i = 0; i < areaLights.size(); i++)
+            {
+                BoundingBox bounds = areaLights[i]->CalculateBoundingBox();
+                Vector3 center = bounds.CalculateCenterPoint();
+
+                buildLights[i] = BuildLight{
+                    static_cast<std::uint32_t>(i),
+                    bounds,
+                    center,
+                    areaLights[i]->GetNormalOnLight(center),
+                    Math::max(real{0.0}, powers[i]),
+                };
+            }
+
+            _nodes.reserve(2 * areaLights.size() - 1);
+            Build(buildLights, 0, buildLights.size(), LightHierarchyNode::EmptyIndex);
+        }
+
+        const std::vector<LightHierarchyNode>& GetNodes() const
+        {
+            return _nodes;
+        }
+
+        /// @brief Picks a light for position.
+        /// @param lightIndex Receives the index of the picked light.
+        /// @param probability Receives the probability of picking it, the same as CalculateProbability.
+        /// @return False if no light can contribute to position.
+        bool Sample(const Random& random, const Vector3& position, size_t& lightIndex, real& probability) const
+        {
+            if (_nodes.empty())
+            {
+                return false;
+            }
+
+            std::uint32_t nodeIndex = 0;
+            probability = real{1.0};
+
+            while (_nodes[nodeIndex].LightIndex == LightHierarchyNode::EmptyIndex)
+            {
+                const LightHierarchyNode& node = _nodes[nodeIndex];
+
+                real leftImportance = CalculateImportance(_nodes[node.Children[0]], position);
+                real rightImportance = CalculateImportance(_nodes[node.Children[1]], position);
+                real totalImportance = leftImportance + rightImportance;
+
+                if (!(totalImportance > real{0.0}))
+                {
+                    return false;
+                }
+
+                real leftProbability = leftImportance / totalImportance;
+
+                if (random.GetNormalized() < leftProbability)
+                {
+                    nodeIndex = node.Children[0];
+                    probability *= leftProbability;
+                }
+                else
+                {
+                    nodeIndex = node.Children[1];
+                    probability *= real{1.0} - leftProbability;
+                }
+            }
+
+            lightIndex = _nodes[nodeIndex].LightIndex;
+            return probability > real{0.0};
+        }
+
+        /// @brief Calculates the probability with which Sample picks the light at lightIndex for position, by walking up
+        /// from the leaf of the light.
+        real CalculateProbability(size_t lightIndex, const Vector3& position) const
+        {
+            real probability{real{1.0}};
+
+            for (std::uint32_t nodeIndex = _leafs[lightIndex]; _nodes[nodeIndex].Parent != LightHierarchyNode::EmptyIndex;)
+            {
+                const LightHierarchyNode& parent = _nodes[_nodes[nodeIndex].Parent];
+                std::uint32_t siblingIndex = parent.Children[0] == nodeIndex ? parent.Children[1] : parent.Children[0];
+
+                real importance = CalculateImportance(_nodes[nodeIndex], position);
+                real totalImportance = importance + CalculateImportance(_nodes[siblingIndex], position);
+
+                if (!(totalImportance > real{0.0}))
+                {
+                    return real{0.0};
+                }
+
+                probability *= importance / totalImportance;
+                nodeIndex = _nodes[nodeIndex].Parent;
+            }
+
+            return probability;
+        }
+
+    private:
+        /// @brief Estimates how much the lights below node contribute to position. The angle between the cone and the
+        /// direction to position is reduced by the angle the bounds cover, so the estimate is an upper bound on the
+        /// cosine at the lights.
+        static real CalculateImportance(const LightHierarchyNode& node, const Vector3& position)
+        {
+            Vector3 toPosition = position - node.Bounds.CalculateCenterPoint();
+
+            real distanceSquared = toPosition.LengthSquared();
+            real radiusSquared = (node.Bounds.Maximum - node.Bounds.Minimum).LengthSquared() * real{0.25};
+
+            real boundsAngle = distanceSquared > radiusSquared ? Math::asin(Math::sqrt(radiusSquared / distanceSquared)) : Pi;
+            real cosineToAxis = distanceSquared > real{0.0} ? Math::abs(node.Axis * toPosition) / Math::sqrt(distanceSquared) : real{1.0};
+
+            real angle = Math::max(real{0.0}, Math::acos(Math::min(real{1.0}, cosineToAxis)) - node.ConeAngle - boundsAngle);
+            if (angle >= Pi * real{0.5})
+            {
+                return real{0.0};
+            }
+
+            // Positions inside of or right next to the bounds are treated as if they were at half the radius.
+            return node.Power * Math::cos(angle) / Math::max(distanceSquared, radiusSquared * real{0.25});
+        }
+
+        /// @brief Calculates the two sided cone bounding the cones of two nodes.
+        static void UnionCones(Vector3 axisA, real angleA, Vector3 axisB, real angleB, Vector3& axis, real& angle)
+        {
+            if (axisA * axisB < real{0.0})
+            {
+                axisB = -axisB;
+            }
+
+            if (angleA < angleB)
+            {
+                std::swap(axisA, axisB);
+                std::swap(angleA, angleB);
+            }
+
+            real angleBetween = Math::acos(Math::min(real{1.0}, axisA * axisB));
+
+            if (angleBetween + angleB <= angleA)
+            {
+                axis = axisA;
+                angle = angleA;
+
+                return;
+            }
+
+            // A two sided cone with an angle of half pi covers every direction.
+            real unionAngle = (angleA + angleBetween + angleB) * real{0.5};
+            if (unionAngle >= Pi * real{0.5})
+            {
+                axis = axisA;
+                angle = Pi * real{0.5};
+
+                return;
+            }
+
+            // Rotate the axis of a towards b until the cone touches the far side of b.
+            real rotation = unionAngle - angleA;
+            Vector3 perpendicular = (axisB - axisA * (axisA * axisB)).Normalize();
+
+            axis = (axisA * Math::cos(rotation) + perpendicular * Math::sin(rotation)).Normalize();
+            angle = unionAngle;
+        }
+
+        std::uint32_t Build(std::vector<BuildLight>& buildLights, size_t start, size_t end, std::uint32_t parent)
+        {
+            std::uint32_t nodeIndex = static_cast<std::uint32_t>(_nodes.size());
+
+            _nodes.emplace_back();
+            _nodes[nodeIndex].Parent = parent;
+
+            if (end - start == 1)
+            {
+                const BuildLight& buildLight = buildLights[start];
+
+                _nodes[nodeIndex].Bounds = buildLight.Bounds;
+                _nodes[nodeIndex].Axis = buildLight.Axis;
+                _nodes[nodeIndex].Power = buildLight.Power;
+                _nodes[nodeIndex].LightIndex = buildLight.Index;
+
+                _leafs[buildLight.Index] = nodeIndex;
+                return nodeIndex;
+            }
+
+            // Split at the median of the light centers along the axis in which they spread the most.
+            BoundingBox centerBounds = BoundingBox::ReverseInfinity();
+            for (size_t i = start; i < end; i++)
+            {
+                centerBounds = centerBounds.Union(buildLights[i].Center);
+            }
+
+            Vector3 extent = centerBounds.Maximum - centerBounds.Minimum;
+            size_t splitAxis = extent.X > extent.Y ? (extent.X > extent.Z ? 0 : 2) : (extent.Y > extent.Z ? 1 : 2);
+            size_t middle = start + (end - start) / 2;
+
+            std::nth_element(
+                buildLights.begin() + start,
+                buildLights.begin() + middle,
+                buildLights.begin() + end,
+                [splitAxis](const BuildLight& left, const BuildLight& right)
+                {
+                    return left.Center[splitAxis] < right.Center[splitAxis];
+                });
+
+            std::uint32_t left = Build(buildLights, start, middle, nodeIndex);
+            std::uint32_t right = Build(buildLights, middle, end, nodeIndex);
+
+            // The children were appended after the node, so it has to be indexed again.
+            LightHierarchyNode& node = _nodes[nodeIndex];
+            const LightHierarchyNode& leftNode = _nodes[left];
+            const LightHierarchyNode& rightNode = _nodes[right];
+
+            node.Children[0] = left;
+            node.Children[1] = right;
+            node.Bounds = leftNode.Bounds.Union(rightNode.Bounds);
+            node.Power = leftNode.Power + rightNode.Power;
+
+            UnionCones(leftNode.Axis, leftNode.ConeAngle, rightNode.Axis, rightNode.ConeAngle, node.Axis, node.ConeAngle);
+
+            return nodeIndex;
+        }
+    };
+}
\ No newline at end of file
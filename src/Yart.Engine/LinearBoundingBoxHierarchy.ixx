@@ -0,0 +1,532 @@
+module;
+
+#include "Vcl.h"
+
+export module LinearBoundingBoxHierarchy;
+
+import <bit>;
+import <cassert>;
+import <cstdint>;
+
+import "Common.h";
+
+import Alignment;
+import BoundingBox;
+import BoundingBoxHierarchy;
+import IntersectableGeometry;
+import IntersectionResult;
+import IntersectionResultType;
+import Math;
+import Ray;
+import RayPacket;
+import RefittableGeometry;
+
+using namespace vcl;
+
+namespace Yart
+{
+    export template <real_number T>
+        class alignas(64) LinearBoundingBoxNodeT
+    {
+    public:
+        using VclVec = typename std::conditional<std::same_as<T, float>, Vec8f, Vec4d>::type;
+
+        static constexpr size_t NumberOfLeafs = BoundingBoxHierarchyT<T>::NumberOfLeafs;
+
+        // A child index either refers to another node in the node array or, when LeafFlag is set, to a geometry in the
+        // leaf array.
+        static constexpr std::uint32_t LeafFlag = 0x80000000u;
+        static constexpr std::uint32_t EmptyChild = 0xFFFFFFFFu;
+
+        alignas(sizeof(T) * 4) T MinimumX[NumberOfLeafs];
+        alignas(sizeof(T) * 4) T MinimumY[NumberOfLeafs];
+        alignas(sizeof(T) * 4) T MinimumZ[NumberOfLeafs];
+
+        alignas(sizeof(T) * 4) T MaximumX[NumberOfLeafs];
+        alignas(sizeof(T) * 4) T MaximumY[NumberOfLeafs];
+        alignas(sizeof(T) * 4) T MaximumZ[NumberOfLeafs];
+
+        std::uint32_t Children[NumberOfLeafs];
+
+        LinearBoundingBoxNodeT()
+        {
+            for (size_t i = 0; i < NumberOfLeafs; i++)
+            {
+                MinimumX[i] = -std::numeric_limits<T>::infinity();
+                MinimumY[i] = -std::numeric_limits<T>::infinity();
+                MinimumZ[i] = -std::numeric_limits<T>::infinity();
+
+                MaximumX[i] = std::numeric_limits<T>::infinity();
+                MaximumY[i] = std::numeric_limits<T>::infinity();
+                MaximumZ[i] = std::numeric_limits<T>::infinity();
+
+                Children[i] = EmptyChild;
+            }
+        }
+
+        /// @brief Stores the bounds of every child of the node. The children must be assigned first, the bounds of empty
+        /// children are ignored.
+        void SetChildBoundingBoxes(const BoundingBoxT<T>* boundingBoxes)
+        {
+            for (size_t i = 0; i < NumberOfLeafs; i++)
+            {
+                if (Children[i] == EmptyChild)
+                {
+                    continue;
+                }
+
+                MinimumX[i] = boundingBoxes[i].Minimum.X;
+                MinimumY[i] = boundingBoxes[i].Minimum.Y;
+                MinimumZ[i] = boundingBoxes[i].Minimum.Z;
+
+                MaximumX[i] = boundingBoxes[i].Maximum.X;
+                MaximumY[i] = boundingBoxes[i].Maximum.Y;
+                MaximumZ[i] = boundingBoxes[i].Maximum.Z;
+            }
+        }
+
+        BoundingBoxT<T> GetChildBoundingBox(size_t leafIndex) const
+        {
+            return BoundingBoxT<T>{
+                Vector3T<T>{MinimumX[leafIndex], MinimumY[leafIndex], MinimumZ[leafIndex]},
+                Vector3T<T>{MaximumX[leafIndex], MaximumY[leafIndex], MaximumZ[leafIndex]},
+            };
+        }
+
+        force_inline void CalculateChildEntranceDistances(
+            const VectorVec3<VclVec>& rayPosition,
+            const VectorVec3<VclVec>& rayInverseDirection,
+            T* distances) const
+        {
+            VclVec minX = ConvertNanToInf((VclVec{}.load_a(MinimumX) - rayPosition.X) * rayInverseDirection.X);
+            VclVec minY = ConvertNanToInf((VclVec{}.load_a(MinimumY) - rayPosition.Y) * rayInverseDirection.Y);
+            VclVec minZ = ConvertNanToInf((VclVec{}.load_a(MinimumZ) - rayPosition.Z) * rayInverseDirection.Z);
+
+            VclVec maxX = ConvertNanToInf((VclVec{}.load_a(MaximumX) - rayPosition.X) * rayInverseDirection.X);
+            VclVec maxY = ConvertNanToInf((VclVec{}.load_a(MaximumY) - rayPosition.Y) * rayInverseDirection.Y);
+            VclVec maxZ = ConvertNanToInf((VclVec{}.load_a(MaximumZ) - rayPosition.Z) * rayInverseDirection.Z);
+
+            VclVec exitDistance = vcl::min(vcl::min(vcl::max(minX, maxX), vcl::max(minY, maxY)), vcl::max(minZ, maxZ));
+            VclVec entranceDistance = vcl::max(vcl::max(vcl::min(minX, maxX), vcl::min(minY, maxY)), vcl::min(minZ, maxZ));
+
+            VclVec clampedEntranceDistance = select(exitDistance >= VclVec{T{0.0}} & entranceDistance <= exitDistance, entranceDistance, VclVec{std::numeric_limits<T>::infinity()});
+
+            clampedEntranceDistance.store_a(distances);
+        }
+    };
+
+    /// @brief A bounding box hierarchy stored as a single contiguous array of wide nodes. Nodes refer to their children by
+    /// index and are traversed with an explicit stack so that only the leaf geometries are reached through a virtual call.
+    ///
+    /// The node type decides how child bounds are stored, see LinearBoundingBoxNodeT for the full precision layout.
+    export template <real_number T, typename TNode = LinearBoundingBoxNodeT<T>>
+        class LinearBoundingBoxHierarchyT : public IntersectableGeometry, public RefittableGeometry
+    {
+    public:
+        using Node = TNode;
+
+    private:
+        using VclVec = typename Node::VclVec;
+
+    public:
+        static constexpr size_t NumberOfLeafs = Node::NumberOfLeafs;
+
+        // Every level of the traversal can push at most NumberOfLeafs - 1 more entries than it pops. Sub-hierarchies deeper
+        // than MaxTraversalDepth are kept as pointer based leafs so the fixed size stack can never overflow.
+        static constexpr size_t StackSize = 128;
+        static constexpr size_t MaxTraversalDepth = (StackSize - 1) / (NumberOfLeafs - 1);
+
+    protected:
+        std::vector<Node, AlignedAllocator<Node, 64>> Nodes{};
+        std::vector<const IntersectableGeometry*> Leafs{};
+
+    public:
+        explicit LinearBoundingBoxHierarchyT(const BoundingBoxHierarchyT<T>* root)
+        {
+            assert(root);
+
+            FlattenNode(root, 1);
+        }
+
+        /// @brief Creates a hierarchy from nodes and leafs that were flattened earlier, for example by a mesh cache.
+        LinearBoundingBoxHierarchyT(const Node* nodes, size_t nodeCount, std::vector<const IntersectableGeometry*> leafs)
+            : Nodes(nodes, nodes + nodeCount), Leafs{std::move(leafs)}
+        {
+            assert(nodeCount > 0);
+        }
+
+        const Node* GetNodes() const
+        {
+            return Nodes.data();
+        }
+
+        const std::vector<const IntersectableGeometry*>& GetLeafs() const
+        {
+            return Leafs;
+        }
+
+        size_t GetNodeCount() const
+        {
+            return Nodes.size();
+        }
+
+        size_t GetLeafCount() const
+        {
+            return Leafs.size();
+        }
+
+        /// @brief Gets the number of bytes used by the nodes and the leaf array, not counting the leaf geometries.
+        size_t CalculateMemoryUsage() const
+        {
+            return Nodes.size() * sizeof(Node) + Leafs.size() * sizeof(const IntersectableGeometry*);
+        }
+
+        /// @brief Recalculates the bounds of every node after the leaf geometries have moved without changing the structure
+        /// of the hierarchy. The leafs must already be up to date, see CollectRefittableGeometries.
+        virtual void Refit() override
+        {
+            // Children are always stored after their parent so walking the array backwards visits them first.
+            for (size_t nodeIndex = Nodes.size(); nodeIndex > 0; nodeIndex--)
+            {
+                Node& node = Nodes[nodeIndex - 1];
+                BoundingBoxT<T> childBoundingBoxes[NumberOfLeafs]{};
+
+                for (size_t i = 0; i < NumberOfLeafs; i++)
+                {
+                    std::uint32_t child = node.Children[i];
+
+                    if (child == Node::EmptyChild)
+                    {
+                        continue;
+                    }
+
+                    childBoundingBoxes[i] = (child & Node::LeafFlag)
+                        ? BoundingBoxT<T>{Leafs[child & ~Node::LeafFlag]->CalculateBoundingBox()}
+                        : CalculateNodeBoundingBox(Nodes[child]);
+                }
+
+                node.SetChildBoundingBoxes(childBoundingBoxes);
+            }
+        }
+
+        virtual BoundingBox CalculateBoundingBox() const override
+        {
+            return CalculateNodeBoundingBox(Nodes[0]);
+        }
+
+        virtual IntersectionResult IntersectEntrance(const Ray& ray) const override
+        {
+            return Intersect<IntersectionResultType::Entrance>(ray, std::numeric_limits<real>::infinity());
+        }
+
+        virtual IntersectionResult IntersectEntrance(const Ray& ray, real maximumDistance) const override
+        {
+            return Intersect<IntersectionResultType::Entrance>(ray, maximumDistance);
+        }
+
+        virtual IntersectionResult IntersectExit(const Ray& ray) const override
+        {
+            return Intersect<IntersectionResultType::Exit>(ray, std::numeric_limits<real>::infinity());
+        }
+
+        virtual bool IntersectAny(const Ray& ray, real maximumDistance) const override
+        {
+            VectorVec3<VclVec> rayPosition{ray.Position};
+            VectorVec3<VclVec> rayInverseDirection{ray.InverseDirection};
+
+            // Any hit ends the query so children are visited in whatever order they are stored.
+            std::uint32_t stack[StackSize];
+            size_t stackSize = 0;
+
+            stack[stackSize++] = 0;
+
+            while (stackSize > 0)
+            {
+                const Node& node = Nodes[stack[--stackSize]];
+
+                alignas(sizeof(T) * 4) T distances[NumberOfLeafs];
+                node.CalculateChildEntranceDistances(rayPosition, rayInverseDirection, distances);
+
+                for (size_t i = 0; i < NumberOfLeafs; i++)
+                {
+                    std::uint32_t child = node.Children[i];
+
+                    if (!(distances[i] < maximumDistance) || child == Node::EmptyChild)
+                    {
+                        continue;
+                    }
+
+                    if (!(child & Node::LeafFlag))
+                    {
+                        stack[stackSize++] = child;
+                    }
+                    else if (Leafs[child & ~Node::LeafFlag]->IntersectAny(ray, maximumDistance))
+                    {
+                        return true;
+                    }
+                }
+            }
+
+            return false;
+        }
+
+        virtual void IntersectPacketEntrance(const RayPacket& packet, std::uint32_t laneMask, IntersectionResult* results) const override
+        {
+            alignas(64) real maximumDistances[RayPacket::Size]{};
+            for (size_t i = 0; i < RayPacket::Size; i++)
+            {
+                maximumDistances[i] = (laneMask & (1u << i)) ? results[i].HitDistance : real{0.0};
+            }
+
+            // Every entry carries the lanes that entered its box. A node only pushes the children that at least one of
+            // its lanes enters, with just those lanes.
+            std::uint32_t stackChildren[StackSize];
+            std::uint32_t stackMasks[StackSize];
+            real stackDistances[StackSize];
+            size_t stackSize = 0;
+
+            stackChildren[stackSize] = 0;
+            stackMasks[stackSize] = laneMask;
+            stackDistances[stackSize++] = -std::numeric_limits<real>::infinity();
+
+            while (stackSize > 0)
+            {
+                stackSize--;
+
+                std::uint32_t child = stackChildren[stackSize];
+                std::uint32_t mask = stackMasks[stackSize];
+
+                // Drop the lanes that found a hit nearer than the box since it was pushed.
+                for (std::uint32_t remaining = mask; remaining != 0; remaining &= remaining - 1)
+                {
+                    size_t lane = std::countr_zero(remaining);
+
+                    if (stackDistances[stackSize] >= maximumDistances[lane])
+                    {
+                        mask &= ~(1u << lane);
+                    }
+                }
+
+                if (mask == 0)
+                {
+                    continue;
+                }
+
+                if ((child & Node::LeafFlag) || std::popcount(mask) < RayPacket::MinimumActiveLanes)
+                {
+                    if (child & Node::LeafFlag)
+                    {
+                        Leafs[child & ~Node::LeafFlag]->IntersectPacketEntrance(packet, mask, results);
+                    }
+                    else
+                    {
+                        // Too few rays are left for the packet to pay off, each of them finishes the subtree on its own.
+                        for (std::uint32_t remaining = mask; remaining != 0; remaining &= remaining - 1)
+                        {
+                            size_t lane = std::countr_zero(remaining);
+
+                            IntersectionResult result = Intersect<IntersectionResultType::Entrance>(packet.GetRay(lane), maximumDistances[lane], child);
+                            if (result.HitDistance < results[lane].HitDistance)
+                            {
+                                results[lane] = result;
+                            }
+                        }
+                    }
+
+                    for (std::uint32_t remaining = mask; remaining != 0; remaining &= remaining - 1)
+                    {
+                        size_t lane = std::countr_zero(remaining);
+                        maximumDistances[lane] = Math::min(maximumDistances[lane], results[lane].HitDistance);
+                    }
+
+                    continue;
+                }
+
+                const Node& node = Nodes[child];
+
+                std::uint32_t childMasks[NumberOfLeafs];
+                real distances[NumberOfLeafs];
+
+                // Sort the hit children nearest first by the nearest of their lanes and push them in reverse so the
+                // nearest child is popped next.
+                size_t order[NumberOfLeafs];
+                size_t hitCount = 0;
+
+                for (size_t i = 0; i < NumberOfLeafs; i++)
+                {
+                    if (node.Children[i] == Node::EmptyChild)
+                    {
+                        continue;
+                    }
+
+                    childMasks[i] = packet.IntersectBoundingBox(BoundingBox{node.GetChildBoundingBox(i)}, maximumDistances, mask, distances[i]);
+
+                    if (childMasks[i] != 0)
+                    {
+                        size_t insertIndex = hitCount++;
+
+                        while (insertIndex > 0 && distances[order[insertIndex - 1]] > distances[i])
+                        {
+                            order[insertIndex] = order[insertIndex - 1];
+                            insertIndex--;
+                        }
+
+                        order[insertIndex] = i;
+                    }
+                }
+
+                for (size_t i = hitCount; i > 0; i--)
+                {
+                    stackChildren[stackSize] = node.Children[order[i - 1]];
+                    stackMasks[stackSize] = childMasks[order[i - 1]];
+                    stackDistances[stackSize++] = distances[order[i - 1]];
+                }
+            }
+        }
+
+    private:
+        static BoundingBoxT<T> CalculateNodeBoundingBox(const Node& node)
+        {
+            BoundingBoxT<T> boundingBox = BoundingBoxT<T>::ReverseInfinity();
+
+            for (size_t i = 0; i < NumberOfLeafs; i++)
+            {
+                if (node.Children[i] == Node::EmptyChild)
+                {
+                    continue;
+                }
+
+                boundingBox = boundingBox.Union(node.GetChildBoundingBox(i));
+            }
+
+            return boundingBox;
+        }
+
+        std::uint32_t FlattenNode(const BoundingBoxHierarchyT<T>* hierarchy, size_t depth)
+        {
+            // Children are appended after their parent which keeps every subtree contiguous in memory.
+            std::uint32_t nodeIndex = static_cast<std::uint32_t>(Nodes.size());
+            Nodes.emplace_back();
+
+            BoundingBoxT<T> childBoundingBoxes[NumberOfLeafs]{};
+
+            for (size_t i = 0; i < NumberOfLeafs; i++)
+            {
+                const IntersectableGeometry* child = hierarchy->GetChild(i);
+
+                if (!child)
+                {
+                    continue;
+                }
+
+                std::uint32_t childIndex;
+                auto childHierarchy = dynamic_cast<const BoundingBoxHierarchyT<T>*>(child);
+
+                if (childHierarchy && depth < MaxTraversalDepth)
+                {
+                    childIndex = FlattenNode(childHierarchy, depth + 1);
+                }
+                else
+                {
+                    childIndex = static_cast<std::uint32_t>(Leafs.size()) | Node::LeafFlag;
+                    Leafs.push_back(child);
+                }
+
+                // The node array may have been reallocated by the recursion so the node is looked up again.
+                Nodes[nodeIndex].Children[i] = childIndex;
+                childBoundingBoxes[i] = hierarchy->GetChildBoundingBox(i);
+            }
+
+            Nodes[nodeIndex].SetChildBoundingBoxes(childBoundingBoxes);
+
+            return nodeIndex;
+        }
+
+        /// @param rootChild The node, or leaf if LeafFlag is set, to start the traversal from.
+        template <IntersectionResultType TIntersectionResultType>
+        force_inline IntersectionResult Intersect(const Ray& ray, real maximumDistance, std::uint32_t rootChild = 0) const
+        {
+            VectorVec3<VclVec> rayPosition{ray.Position};
+            VectorVec3<VclVec> rayInverseDirection{ray.InverseDirection};
+
+            // Each entry remembers the entrance distance of its box so entries that start beyond the closest hit found
+            // since they were pushed can be discarded without touching their memory.
+            std::uint32_t stackChildren[StackSize];
+            T stackDistances[StackSize];
+            size_t stackSize = 0;
+
+            stackChildren[stackSize] = rootChild;
+            stackDistances[stackSize++] = -std::numeric_limits<T>::infinity();
+
+            IntersectionResult closestIntersection{nullptr, std::numeric_limits<real>::infinity()};
+            while (stackSize > 0)
+            {
+                stackSize--;
+
+                std::uint32_t child = stackChildren[stackSize];
+                if (stackDistances[stackSize] >= maximumDistance)
+                {
+                    continue;
+                }
+
+                if (child & Node::LeafFlag)
+                {
+                    const IntersectableGeometry* leaf = Leafs[child & ~Node::LeafFlag];
+                    IntersectionResult result;
+
+                    if constexpr (TIntersectionResultType == IntersectionResultType::Entrance)
+                    {
+                        result = leaf->IntersectEntrance(ray, maximumDistance);
+                    }
+                    else
+                    {
+                        result = leaf->IntersectExit(ray);
+                    }
+
+                    if (result.HitDistance < closestIntersection.HitDistance)
+                    {
+                        closestIntersection = result;
+                        maximumDistance = Math::min(maximumDistance, result.HitDistance);
+                    }
+
+                    continue;
+                }
+
+                const Node& node = Nodes[child];
+
+                alignas(sizeof(T) * 4) T distances[NumberOfLeafs];
+                node.CalculateChildEntranceDistances(rayPosition, rayInverseDirection, distances);
+
+                // Sort the hit children nearest first and push them in reverse so the nearest child is popped next.
+                size_t order[NumberOfLeafs];
+                size_t hitCount = 0;
+
+                for (size_t i = 0; i < NumberOfLeafs; i++)
+                {
+                    if (distances[i] < maximumDistance && node.Children[i] != Node::EmptyChild)
+                    {
+                        size_t insertIndex = hitCount++;
+
+                        while (insertIndex > 0 && distances[order[insertIndex - 1]] > distances[i])
+                        {
+                            order[insertIndex] = order[insertIndex - 1];
+                            insertIndex--;
+                        }
+
+                        order[insertIndex] = i;
+                    }
+                }
+
+                for (size_t i = hitCount; i > 0; i--)
+                {
+                    stackChildren[stackSize] = node.Children[order[i - 1]];
+                    stackDistances[stackSize++] = distances[order[i - 1]];
+                }
+            }
+
+            return closestIntersection;
+        }
+    };
+
+    export using LinearBoundingBoxHierarchy = LinearBoundingBoxHierarchyT<real>;
+}
\ No newline at end of file
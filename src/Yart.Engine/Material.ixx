@@ -4,12 +4,32 @@ import "Common.h";
 
 import Math;
 import Random;
+import Ray;
 
 namespace Yart
 {
     export class Scene;
     export class Geometry;
 
+    /// @brief How a path continues from a hit, see Material::Scatter.
+    export class ScatterResult
+    {
+    public:
+        /// @brief Light added at the hit, before the attenuation of the outgoing ray is applied.
+        Color3 Emitted{};
+
+        /// @brief Multiplies the light arriving along OutgoingRay. Only meaningful when Continues is set.
+        Color3 Attenuation{};
+
+        Ray OutgoingRay{Vector3{}, Vector3{}};
+        bool Continues{};
+
+        /// @brief The solid angle pdf OutgoingRay was sampled with, if the material also lit the hit with next event
+        /// estimation. Emission that OutgoingRay finds on an area light is then weighed against next event estimation
+        /// with it. Zero if the material did not sample the lights.
+        real Pdf{};
+    };
+
     export class Material
     {
     public:
@@ -22,5 +42,43 @@ namespace Yart
             const Vector3& hitNormal,
             const Vector3& incomingDirection,
             real mixAmount) const = 0;
+
+        /// @brief Samples a single continuation of the path instead of tracing it, so the caller decides when the
+        /// outgoing ray is traced. Materials that do not override this evaluate CalculateRenderingEquation and end the
+        /// path.
+        virtual ScatterResult Scatter(
+            const Scene& scene,
+            const Random& random,
+            int currentDepth,
+            const Geometry* hitGeometry,
+            const Vector3& hitPosition,
+            const Vector3& hitNormal,
+            const Vector3& incomingDirection,
+            real mixAmount) const
+        {
+            ScatterResult result{};
+            result.Emitted = CalculateRenderingEquation(scene, random, currentDepth, hitGeometry, hitPosition, hitNormal, incomingDirection, mixAmount);
+
+            return result;
+        }
+
+        /// @brief Evaluates the BSDF times the cosine term for light arriving from outgoingDirection, used by next event
+        /// estimation. Materials that do not override this are not lit by next event estimation.
+        /// @param pdf Receives the solid angle pdf with which Scatter samples outgoingDirection.
+        virtual Color3 EvaluateScattering(
+            const Vector3& hitNormal,
+            const Vector3& incomingDirection,
+            const Vector3& outgoingDirection,
+            real& pdf) const
+        {
+            pdf = real{0.0};
+            return Color3{};
+        }
+
+        /// @brief Gets the light the material emits by itself. Area lights are sampled with it by next event estimation.
+        virtual Color3 GetEmissiveColor() const
+        {
+            return Color3{};
+        }
     };
 }
\ No newline at end of file
@@ -293,6 +293,32 @@ namespace Yart
             }
         }
 
+        export template <real_number T>
+            inline constexpr T acos(T value)
+        {
+            if (std::is_constant_evaluated())
+            {
+                return gcem::acos(value);
+            }
+            else
+            {
+                return std::acos(value);
+            }
+        }
+
+        export template <real_number T>
+            inline constexpr T asin(T value)
+        {
+            if (std::is_constant_evaluated())
+            {
+                return gcem::asin(value);
+            }
+            else
+            {
+                return std::asin(value);
+            }
+        }
+
         export template <real_number T>
             inline constexpr T tan(T radians)
         {
@@ -338,4 +364,14 @@ namespace Yart
     {
         return min(max(value, -infinite4d()), infinite4d());
     }
+
+    export inline Vec16f ConvertNanToInf(Vec16f const value)
+    {
+        return min(max(value, -infinite16f()), infinite16f());
+    }
+
+    export inline Vec8d ConvertNanToInf(Vec8d const value)
+    {
+        return min(max(value, -infinite8d()), infinite8d());
+    }
 }
\ No newline at end of file
@@ -32,70 +32,70 @@ namespace Yart
         }
 
         inline VectorVec3(float value)
-            requires std::same_as<vcl::Vec4f, T> || std::same_as<vcl::Vec8f, T>
+            requires std::same_as<vcl::Vec4f, T> || std::same_as<vcl::Vec8f, T> || std::same_as<vcl::Vec16f, T>
         : X{value}, Y{value}, Z{value}
         {
 
         }
 
         inline VectorVec3(float x, float y, float z)
-            requires std::same_as<vcl::Vec4f, T> || std::same_as<vcl::Vec8f, T>
+            requires std::same_as<vcl::Vec4f, T> || std::same_as<vcl::Vec8f, T> || std::same_as<vcl::Vec16f, T>
         : X{x}, Y{y}, Z{z}
         {
 
         }
 
         inline VectorVec3(const float* x, const float* y, const float* z)
-            requires std::same_as<vcl::Vec4f, T> || std::same_as<vcl::Vec8f, T>
+            requires std::same_as<vcl::Vec4f, T> || std::same_as<vcl::Vec8f, T> || std::same_as<vcl::Vec16f, T>
         : X{T{}.load(x)}, Y{T{}.load(y)}, Z{T{}.load(z)}
         {
 
         }
 
         inline VectorVec3(Vector3T<float> value)
-            requires std::same_as<vcl::Vec4f, T> || std::same_as<vcl::Vec8f, T>
+            requires std::same_as<vcl::Vec4f, T> || std::same_as<vcl::Vec8f, T> || std::same_as<vcl::Vec16f, T>
         : X{value.X}, Y{value.Y}, Z{value.Z}
         {
 
         }
 
         inline VectorVec3(Color3T<float> value)
-            requires std::same_as<vcl::Vec4f, T> || std::same_as<vcl::Vec8f, T>
+            requires std::same_as<vcl::Vec4f, T> || std::same_as<vcl::Vec8f, T> || std::same_as<vcl::Vec16f, T>
         : X{value.R}, Y{value.G}, Z{value.B}
         {
 
         }
 
         inline VectorVec3(double value)
-            requires std::same_as<vcl::Vec2d, T> || std::same_as<vcl::Vec4d, T>
+            requires std::same_as<vcl::Vec2d, T> || std::same_as<vcl::Vec4d, T> || std::same_as<vcl::Vec8d, T>
         : X{value}, Y{value}, Z{value}
         {
 
         }
 
         inline VectorVec3(double x, double y, double z)
-            requires std::same_as<vcl::Vec2d, T> || std::same_as<vcl::Vec4d, T>
+            requires std::same_as<vcl::Vec2d, T> || std::same_as<vcl::Vec4d, T> || std::same_as<vcl::Vec8d, T>
         : X{x}, Y{y}, Z{z}
         {
 
         }
 
         inline VectorVec3(const double* x, const double* y, const double* z)
-            requires std::same_as<vcl::Vec2d, T> || std::same_as<vcl::Vec4d, T>
+            requires std::same_as<vcl::Vec2d, T> || std::same_as<vcl::Vec4d, T> || std::same_as<vcl::Vec8d, T>
         : X{T{}.load(x)}, Y{T{}.load(y)}, Z{T{}.load(z)}
         {
 
         }
 
         inline VectorVec3(Vector3T<double> value)
-            requires std::same_as<vcl::Vec2d, T> || std::same_as<vcl::Vec4d, T>
+            requires std::same_as<vcl::Vec2d, T> || std::same_as<vcl::Vec4d, T> || std::same_as<vcl::Vec8d, T>
         : X{value.X}, Y{value.Y}, Z{value.Z}
         {
 
         }
 
         inline VectorVec3(Color3T<double> value)
-            requires std::same_as<vcl::Vec2d, T> || std::same_as<vcl::Vec4d, T>
+            requires std::same_as<vcl::Vec2d, T> || std::same_as<vcl::Vec4d, T> || std::same_as<vcl::Vec8d, T>
         : X{value.R}, Y{value.G}, Z{value.B}
         {
             
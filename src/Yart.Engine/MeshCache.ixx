@@ -0,0 +1,959 @@
+module;
+
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <Windows.h>
+
+export module MeshCache;
+
+import <cassert>;
+import <cstdint>;
+import <cstdio>;
+import <cstring>;
+import <filesystem>;
+import <deque>;
+import <fstream>;
+import <limits>;
+import <memory>;
+import <tuple>;
+import <unordered_map>;
+
+import "Common.h";
+
+import BoundingBox;
+import BoundingBoxHierarchy;
+import Geometry;
+import GeometryCollection;
+import GeometrySoa;
+import InstructionSet;
+import IntersectableGeometry;
+import IntersectionResult;
+import LinearBoundingBoxHierarchy;
+import Material;
+import Math;
+import QuantizedBoundingBoxHierarchy;
+import Ray;
+import Triangle;
+import TriangleSoa;
+
+namespace Yart
+{
+    /// @brief A read only view of a whole file mapped into memory.
+    class MappedFile
+    {
+    private:
+        HANDLE _file{INVALID_HANDLE_VALUE};
+        HANDLE _mapping{nullptr};
+        const std::byte* _data{nullptr};
+        size_t _size{0};
+
+    public:
+        explicit MappedFile(const std::string& filename)
+        {
+            _file = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+            if (_file == INVALID_HANDLE_VALUE)
+            {
+                return;
+            }
+
+            LARGE_INTEGER fileSize{};
+            if (!GetFileSizeEx(_file, &fileSize) || fileSize.QuadPart == 0)
+            {
+                return;
+            }
+
+            _mapping = CreateFileMappingA(_file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+            if (!_mapping)
+            {
+                return;
+            }
+
+            _data = static_cast<const std::byte*>(MapViewOfFile(_mapping, FILE_MAP_READ, 0, 0, 0));
+            _size = _data ? static_cast<size_t>(fileSize.QuadPart) : 0;
+        }
+
+        MappedFile(const MappedFile&) = delete;
+        MappedFile& operator=(const MappedFile&) = delete;
+
+        ~MappedFile()
+        {
+            if (_data)
+            {
+                UnmapViewOfFile(_data);
+            }
+
+            if (_mapping)
+            {
+                CloseHandle(_mapping);
+            }
+
+            if (_file != INVALID_HANDLE_VALUE)
+            {
+                CloseHandle(_file);
+            }
+        }
+
+        const std::byte* GetData() const
+        {
+            return _data;
+        }
+
+        size_t GetSize() const
+        {
+            return _size;
+        }
+    };
+
+    // FNV-1a, used to detect changes of the source files and build parameters rather than for any kind of security.
+    constexpr std::uint64_t HashOffsetBasis = 0xCBF29CE484222325ull;
+    constexpr std::uint64_t HashPrime = 0x00000100000001B3ull;
+
+    std::uint64_t HashBytes(std::uint64_t hash, const void* data, size_t size)
+    {
+        const auto* bytes = static_cast<const std::uint8_t*>(data);
+
+        for (size_t i = 0; i < size; i++)
+        {
+            hash = (hash ^ bytes[i]) * HashPrime;
+        }
+
+        return hash;
+    }
+
+    template <typename T>
+    std::uint64_t HashValue(std::uint64_t hash, const T& value)
+    {
+        static_assert(std::is_trivially_copyable_v<T>);
+        return HashBytes(hash, &value, sizeof(T));
+    }
+
+    constexpr std::uint64_t MeshCacheMagic = 0x48534D5452415959ull; // "YYARTMSH"
+    constexpr std::uint32_t MeshCacheVersion = 2;
+
+    enum class MeshCacheNodeFormat : std::uint32_t
+    {
+        Linear,
+        Quantized,
+    };
+
+    class MeshCacheHeader
+    {
+    public:
+        std::uint64_t Magic{MeshCacheMagic};
+        std::uint32_t Version{MeshCacheVersion};
+        std::uint32_t RealSize{sizeof(real)};
+        std::uint64_t Key{};
+
+        MeshCacheNodeFormat NodeFormat{};
+        std::uint32_t NodeSize{};
+        TriangleIntersectionKernel Kernel{DefaultTriangleIntersectionKernel};
+
+        std::uint64_t TriangleCount{};
+        std::uint64_t NodeCount{};
+        std::uint64_t LeafCount{};
+        std::uint64_t BlockDataSize{};
+
+        // Offsets from the start of the file. Every section is aligned to 64 bytes so it can be used straight out of the
+        // view.
+        std::uint64_t TrianglesOffset{};
+        std::uint64_t NodesOffset{};
+        std::uint64_t LeafsOffset{};
+        std::uint64_t BlocksOffset{};
+
+        real SahCost{};
+    };
+
+    /// @brief The SOA blocks of a single leaf of the hierarchy. BlockOffset is relative to the start of the block section.
+    class MeshCacheLeaf
+    {
+    public:
+        std::uint64_t BlockOffset{};
+        std::uint32_t BlockCount{};
+        SoaSize Size{};
+    };
+
+    /// @brief The vertices of up to Elements triangles in the layout of the SOA intersection kernels, together with the
+    /// index of every triangle in the mesh. Blocks are written to the cache file as they are and intersected straight out
+    /// of the mapped view.
+    template <SoaSize Size>
+    class alignas(64) MeshCacheBlock
+    {
+    public:
+        static constexpr size_t Elements = SoaElements<Size>;
+        static constexpr std::uint32_t EmptyTriangle = std::numeric_limits<std::uint32_t>::max();
+
+        TriangleSoaVertices<Size, DefaultTriangleIntersectionKernel> Vertices{};
+        std::uint32_t TriangleIndices[Elements];
+
+        MeshCacheBlock()
+        {
+            for (size_t i = 0; i < Elements; i++)
+            {
+                TriangleIndices[i] = EmptyTriangle;
+            }
+        }
+    };
+
+    /// @brief Gets the number of bytes of a block of the given size, or zero if size is not a SOA size.
+    size_t GetMeshCacheBlockSize(SoaSize size)
+    {
+        if (size == SoaSize::_128)
+        {
+            return sizeof(MeshCacheBlock<SoaSize::_128>);
+        }
+        else if (size == SoaSize::_256)
+        {
+            return sizeof(MeshCacheBlock<SoaSize::_256>);
+        }
+        else if (size == SoaSize::_512)
+        {
+            return sizeof(MeshCacheBlock<SoaSize::_512>);
+        }
+
+        return 0;
+    }
+
+    // Each cached triangle is stored as its three vertices followed by its three normals.
+    constexpr size_t CachedTriangleReals = 18;
+
+    Vector3 GetCachedTriangleVector(const real* triangles, size_t triangleIndex, size_t vectorIndex)
+    {
+        const real* values = triangles + triangleIndex * CachedTriangleReals + vectorIndex * 3;
+        return Vector3{values[0], values[1], values[2]};
+    }
+
+    BoundingBox CalculateCachedTriangleBoundingBox(const real* triangles, size_t triangleIndex)
+    {
+        Vector3 vertex0 = GetCachedTriangleVector(triangles, triangleIndex, 0);
+        Vector3 vertex1 = GetCachedTriangleVector(triangles, triangleIndex, 1);
+        Vector3 vertex2 = GetCachedTriangleVector(triangles, triangleIndex, 2);
+
+        return BoundingBox{
+            Vector3::Min(vertex0, Vector3::Min(vertex1, vertex2)),
+            Vector3::Max(vertex0, Vector3::Max(vertex1, vertex2)),
+        };
+    }
+
+    constexpr std::uint64_t AlignCacheOffset(std::uint64_t offset)
+    {
+        return (offset + 63) & ~std::uint64_t{63};
+    }
+
+    /// @brief A leaf of a cached mesh. Intersects the SOA blocks of the leaf one after the other, straight out of the
+    /// mapped cache file.
+    template <SoaSize Size>
+    class CachedTriangleLeaf : public GeometrySoaBase
+    {
+    private:
+        using Block = MeshCacheBlock<Size>;
+
+        const Geometry* _mesh{nullptr};
+        const real* _triangles{nullptr};
+        const Block* _blocks{nullptr};
+        size_t _blockCount{0};
+
+    public:
+        CachedTriangleLeaf(const Geometry* mesh, const real* triangles, const Block* blocks, size_t blockCount)
+            : _mesh{mesh}, _triangles{triangles}, _blocks{blocks}, _blockCount{blockCount}
+        {
+
+        }
+
+        virtual size_t GetCapacity() const override
+        {
+            return _blockCount * Block::Elements;
+        }
+
+        /// @brief Gets the mesh if a triangle is stored at index, the triangle itself has no geometry of its own.
+        virtual const Geometry* GetGeometry(size_t index) const override
+        {
+            assert(index < GetCapacity());
+
+            return GetTriangleIndex(index) != Block::EmptyTriangle ? _mesh : nullptr;
+        }
+
+        /// @brief Gets the size of the leaf and its blocks, even though the blocks are part of the mapped file.
+        virtual size_t CalculateMemoryUsage() const override
+        {
+            return sizeof(*this) + _blockCount * sizeof(Block);
+        }
+
+        /// @brief Does nothing, cached meshes are static.
+        virtual void Refit() override
+        {
+
+        }
+
+        virtual BoundingBox CalculateBoundingBox() const override
+        {
+            BoundingBox boundingBox = BoundingBox::ReverseInfinity();
+
+            for (size_t i = 0; i < GetCapacity(); i++)
+            {
+                std::uint32_t triangleIndex = GetTriangleIndex(i);
+
+                if (triangleIndex != Block::EmptyTriangle)
+                {
+                    boundingBox = boundingBox.Union(CalculateCachedTriangleBoundingBox(_triangles, triangleIndex));
+                }
+            }
+
+            return boundingBox;
+        }
+
+        virtual IntersectionResult IntersectEntrance(const Ray& ray) const override
+        {
+            return Intersect(ray);
+        }
+
+        virtual bool IntersectAny(const Ray& ray, real maximumDistance) const override
+        {
+            for (size_t i = 0; i < _blockCount; i++)
+            {
+                if (std::get<0>(_blocks[i].Vertices.Intersect(ray)) < maximumDistance)
+                {
+                    return true;
+                }
+            }
+
+            return false;
+        }
+
+        virtual IntersectionResult IntersectExit(const Ray& ray) const override
+        {
+            return Intersect(ray);
+        }
+
+    private:
+        std::uint32_t GetTriangleIndex(size_t index) const
+        {
+            return _blocks[index / Block::Elements].TriangleIndices[index % Block::Elements];
+        }
+
+        force_inline IntersectionResult Intersect(const Ray& ray) const
+        {
+            IntersectionResult result{nullptr, std::numeric_limits<real>::infinity()};
+
+            for (size_t i = 0; i < _blockCount; i++)
+            {
+                auto [entranceDistance, index] = _blocks[i].Vertices.Intersect(ray);
+
+                if (entranceDistance < result.HitDistance)
+                {
+                    result = IntersectionResult{_mesh, entranceDistance};
+                    result.PrimitiveIndex = _blocks[i].TriangleIndices[index];
+                }
+            }
+
+            return result;
+        }
+    };
+
+    /// @brief A triangle mesh loaded from a cache file. The triangles and the SOA blocks of the leafs are used straight out
+    /// of the mapped file, which the mesh keeps open for as long as it exists. Like IndexedTriangleMesh the mesh is the
+    /// geometry reported for every hit on one of its triangles, the index of the triangle is the primitive index of the hit.
+    class CachedTriangleMesh : public Geometry
+    {
+    private:
+        std::unique_ptr<const MappedFile> _file{};
+        const real* _triangles{nullptr};
+        const Material* _material{nullptr};
+        const IntersectableGeometry* _hierarchy{nullptr};
+
+        // Deques keep the leafs in place as more are created, the hierarchy refers to them by pointer.
+        std::tuple<
+            std::deque<CachedTriangleLeaf<SoaSize::_128>>,
+            std::deque<CachedTriangleLeaf<SoaSize::_256>>,
+            std::deque<CachedTriangleLeaf<SoaSize::_512>>> _leafs{};
+
+    public:
+        CachedTriangleMesh(std::unique_ptr<const MappedFile> file, const real* triangles, const Material* material)
+            : _file{std::move(file)}, _triangles{triangles}, _material{material}
+        {
+
+        }
+
+        template <SoaSize Size>
+        const IntersectableGeometry* CreateLeaf(const std::byte* blocks, size_t blockCount)
+        {
+            return &std::get<std::deque<CachedTriangleLeaf<Size>>>(_leafs).emplace_back(
+                this,
+                _triangles,
+                reinterpret_cast<const MeshCacheBlock<Size>*>(blocks),
+                blockCount);
+        }
+
+        /// @brief Sets the hierarchy over the leafs. Intersecting the mesh itself forwards to it, which materials such as
+        /// RefractiveMaterial rely on when they trace rays through the geometry they hit.
+        void SetHierarchy(const IntersectableGeometry* hierarchy)
+        {
+            _hierarchy = hierarchy;
+        }
+
+        virtual BoundingBox CalculateBoundingBox() const override
+        {
+            return _hierarchy ? _hierarchy->CalculateBoundingBox() : BoundingBox::ReverseInfinity();
+        }
+
+        virtual const Material* GetMaterial() const override
+        {
+            return _material;
+        }
+
+        virtual Vector3 CalculateNormal(const Ray& ray, const Vector3& hitPosition, real additionalData, std::uint32_t primitiveIndex) const override
+        {
+            return InterpolateTriangleNormal(
+                ray,
+                hitPosition,
+                GetCachedTriangleVector(_triangles, primitiveIndex, 0),
+                GetCachedTriangleVector(_triangles, primitiveIndex, 1),
+                GetCachedTriangleVector(_triangles, primitiveIndex, 2),
+                GetCachedTriangleVector(_triangles, primitiveIndex, 3),
+                GetCachedTriangleVector(_triangles, primitiveIndex, 4),
+                GetCachedTriangleVector(_triangles, primitiveIndex, 5));
+        }
+
+        virtual IntersectionResult IntersectEntrance(const Ray& ray) const override
+        {
+            return _hierarchy ? _hierarchy->IntersectEntrance(ray) : IntersectionResult{nullptr, std::numeric_limits<real>::infinity()};
+        }
+
+        virtual IntersectionResult IntersectEntrance(const Ray& ray, real maximumDistance) const override
+        {
+            return _hierarchy ? _hierarchy->IntersectEntrance(ray, maximumDistance) : IntersectionResult{nullptr, std::numeric_limits<real>::infinity()};
+        }
+
+        virtual IntersectionResult IntersectExit(const Ray& ray) const override
+        {
+            return _hierarchy ? _hierarchy->IntersectExit(ray) : IntersectionResult{nullptr, std::numeric_limits<real>::infinity()};
+        }
+
+        virtual bool IntersectAny(const Ray& ray, real maximumDistance) const override
+        {
+            return _hierarchy && _hierarchy->IntersectAny(ray, maximumDistance);
+        }
+    };
+
+    /// @brief Calculates the key of a cached mesh from the contents of its obj file and everything that affects how it is
+    /// turned into triangles and a hierarchy. Returns zero if the obj file can not be read.
+    export std::uint64_t CalculateMeshCacheKey(const std::string& objFilename, const Matrix4x4& transformation, const BoundingBoxBuildParameters& parameters)
+    {
+        MappedFile objFile{objFilename};
+        if (!objFile.GetData())
+        {
+            return 0;
+        }
+
+        std::uint64_t hash = HashOffsetBasis;
+        hash = HashValue(hash, MeshCacheVersion);
+        hash = HashBytes(hash, objFile.GetData(), objFile.GetSize());
+
+        for (size_t i = 0; i < 16; i++)
+        {
+            hash = HashValue(hash, transformation[i]);
+        }
+
+        hash = HashValue(hash, parameters.Strategy);
+        hash = HashValue(hash, parameters.PreferredNodeSize.X);
+        hash = HashValue(hash, parameters.PreferredNodeSize.Y);
+        hash = HashValue(hash, parameters.MaxDepth);
+        hash = HashValue(hash, parameters.BinCount);
+        hash = HashValue(hash, parameters.TraversalCost);
+        hash = HashValue(hash, parameters.IntersectionCost);
+        hash = HashValue(hash, parameters.SpatialSplitBudget);
+        hash = HashValue(hash, parameters.SpatialSplitOverlapThreshold);
+        hash = HashValue(hash, parameters.Quantize);
+
+        // The SOA blocks of the leafs depend on the build of the engine that wrote them.
+        hash = HashValue(hash, DefaultTriangleIntersectionKernel);
+        hash = HashValue(hash, GetMaximumSoaSize());
+
+        // Zero is reserved for failures.
+        return hash == 0 ? 1 : hash;
+    }
+
+    /// @brief Gets the name of the cache file for a mesh. The key is part of the name so differently built copies of the
+    /// same obj file do not evict each other.
+    export std::string GetMeshCacheFilename(const std::string& objFilename, std::uint64_t key)
+    {
+        char keyText[17]{};
+        std::snprintf(keyText, sizeof(keyText), "%016llx", static_cast<unsigned long long>(key));
+
+        return objFilename + "." + keyText + ".yartcache";
+    }
+
+    /// @brief Whether count elements of elementSize bytes starting at offset lie within a file of fileSize bytes. Written so
+    /// that offsets and counts read from a corrupt file can not overflow.
+    bool IsMeshCacheSectionInFile(std::uint64_t offset, std::uint64_t count, std::uint64_t elementSize, std::uint64_t fileSize)
+    {
+        return offset <= fileSize && count <= (fileSize - offset) / elementSize;
+    }
+
+    /// @brief Whether every child of every node refers to a node after its parent or to an existing leaf. Traversal follows
+    /// the children without any checks, and children after their parent rule out cycles.
+    template <typename TNode>
+    bool AreMeshCacheNodesValid(const TNode* nodes, std::uint64_t nodeCount, std::uint64_t leafCount)
+    {
+        for (std::uint64_t nodeIndex = 0; nodeIndex < nodeCount; nodeIndex++)
+        {
+            for (size_t i = 0; i < TNode::NumberOfLeafs; i++)
+            {
+                std::uint32_t child = nodes[nodeIndex].Children[i];
+
+                if (child == TNode::EmptyChild)
+                {
+                    continue;
+                }
+
+                bool isValid = (child & TNode::LeafFlag)
+                    ? (child & ~TNode::LeafFlag) < leafCount
+                    : child > nodeIndex && child < nodeCount;
+
+                if (!isValid)
+                {
+                    return false;
+                }
+            }
+        }
+
+        return true;
+    }
+
+    template <typename TNode>
+    const IntersectableGeometry* LoadMeshCacheHierarchy(
+        const std::byte* data,
+        const MeshCacheHeader& header,
+        std::vector<const IntersectableGeometry*> leafs,
+        std::vector<std::shared_ptr<IntersectableGeometry>>& geometryPointers)
+    {
+        if (header.NodeSize != sizeof(TNode) || header.NodesOffset % alignof(TNode) != 0)
+        {
+            return nullptr;
+        }
+
+        if (!AreMeshCacheNodesValid(reinterpret_cast<const TNode*>(data + header.NodesOffset), header.NodeCount, header.LeafCount))
+        {
+            return nullptr;
+        }
+
+        // The nodes are copied in one piece, the hierarchy keeps them in an aligned array of its own.
+        auto hierarchy = std::make_shared<LinearBoundingBoxHierarchyT<real, TNode>>(
+            reinterpret_cast<const TNode*>(data + header.NodesOffset),
+            static_cast<size_t>(header.NodeCount),
+            std::move(leafs));
+
+        geometryPointers.push_back(hierarchy);
+
+        return hierarchy.get();
+    }
+
+    /// @brief Whether every triangle index stored in the blocks of a leaf is empty or refers to a cached triangle.
+    template <SoaSize Size>
+    bool AreMeshCacheBlocksValid(const std::byte* blocks, size_t blockCount, std::uint64_t triangleCount)
+    {
+        const auto* typedBlocks = reinterpret_cast<const MeshCacheBlock<Size>*>(blocks);
+
+        for (size_t i = 0; i < blockCount; i++)
+        {
+            for (std::uint32_t triangleIndex : typedBlocks[i].TriangleIndices)
+            {
+                if (triangleIndex != MeshCacheBlock<Size>::EmptyTriangle && triangleIndex >= triangleCount)
+                {
+                    return false;
+                }
+            }
+        }
+
+        return true;
+    }
+
+    bool AreMeshCacheBlocksValid(const std::byte* blocks, const MeshCacheLeaf& leaf, std::uint64_t triangleCount)
+    {
+        if (leaf.Size == SoaSize::_128)
+        {
+            return AreMeshCacheBlocksValid<SoaSize::_128>(blocks, leaf.BlockCount, triangleCount);
+        }
+        else if (leaf.Size == SoaSize::_256)
+        {
+            return AreMeshCacheBlocksValid<SoaSize::_256>(blocks, leaf.BlockCount, triangleCount);
+        }
+        else
+        {
+            return AreMeshCacheBlocksValid<SoaSize::_512>(blocks, leaf.BlockCount, triangleCount);
+        }
+    }
+
+    const IntersectableGeometry* CreateMeshCacheLeaf(CachedTriangleMesh& mesh, const std::byte* blocks, const MeshCacheLeaf& leaf)
+    {
+        if (leaf.Size == SoaSize::_128)
+        {
+            return mesh.CreateLeaf<SoaSize::_128>(blocks, leaf.BlockCount);
+        }
+        else if (leaf.Size == SoaSize::_256)
+        {
+            return mesh.CreateLeaf<SoaSize::_256>(blocks, leaf.BlockCount);
+        }
+        else
+        {
+            return mesh.CreateLeaf<SoaSize::_512>(blocks, leaf.BlockCount);
+        }
+    }
+
+    /// @brief Loads a mesh written by SaveMeshCache. The file stays mapped for as long as the mesh exists, its triangles
+    /// and the SOA blocks of its leafs are used straight out of the view. Only the nodes are copied. Every section and index
+    /// is checked against the file first, so a stale or corrupt cache is rejected rather than read out of bounds.
+    /// @return The root of the hierarchy and its SAH cost, or nullptr if there is no valid cache for the key.
+    export std::tuple<const IntersectableGeometry*, real> LoadMeshCache(
+        const std::string& filename,
+        std::uint64_t key,
+        const Material* material,
+        std::vector<std::shared_ptr<IntersectableGeometry>>& geometryPointers)
+    {
+        auto file = std::make_unique<const MappedFile>(filename);
+        const std::byte* data = file->GetData();
+
+        if (!data || file->GetSize() < sizeof(MeshCacheHeader))
+        {
+            return {nullptr, real{0}};
+        }
+
+        MeshCacheHeader header{};
+        std::memcpy(&header, data, sizeof(MeshCacheHeader));
+
+        if (header.Magic != MeshCacheMagic ||
+            header.Version != MeshCacheVersion ||
+            header.RealSize != sizeof(real) ||
+            header.Key != key ||
+            header.Kernel != DefaultTriangleIntersectionKernel ||
+            header.NodeCount == 0 ||
+            header.LeafCount >= LinearBoundingBoxHierarchy::Node::LeafFlag ||
+            header.NodeCount >= LinearBoundingBoxHierarchy::Node::LeafFlag ||
+            header.NodeSize == 0)
+        {
+            return {nullptr, real{0}};
+        }
+
+        size_t fileSize = file->GetSize();
+
+        if (!IsMeshCacheSectionInFile(header.TrianglesOffset, header.TriangleCount, CachedTriangleReals * sizeof(real), fileSize) ||
+            !IsMeshCacheSectionInFile(header.NodesOffset, header.NodeCount, header.NodeSize, fileSize) ||
+            !IsMeshCacheSectionInFile(header.LeafsOffset, header.LeafCount, sizeof(MeshCacheLeaf), fileSize) ||
+            !IsMeshCacheSectionInFile(header.BlocksOffset, header.BlockDataSize, 1, fileSize) ||
+            header.TrianglesOffset % alignof(real) != 0 ||
+            header.LeafsOffset % alignof(MeshCacheLeaf) != 0 ||
+            header.BlocksOffset % 64 != 0)
+        {
+            return {nullptr, real{0}};
+        }
+
+        const auto* triangles = reinterpret_cast<const real*>(data + header.TrianglesOffset);
+        const auto* leafs = reinterpret_cast<const MeshCacheLeaf*>(data + header.LeafsOffset);
+        const std::byte* blockData = data + header.BlocksOffset;
+
+        for (size_t i = 0; i < header.LeafCount; i++)
+        {
+            size_t blockSize = GetMeshCacheBlockSize(leafs[i].Size);
+
+            if (blockSize == 0 ||
+                leafs[i].BlockOffset % 64 != 0 ||
+                !IsMeshCacheSectionInFile(leafs[i].BlockOffset, leafs[i].BlockCount, blockSize, header.BlockDataSize) ||
+                !AreMeshCacheBlocksValid(blockData + leafs[i].BlockOffset, leafs[i], header.TriangleCount))
+            {
+                return {nullptr, real{0}};
+            }
+        }
+
+        // The mesh owns the mapped file from here on, nothing is added to geometryPointers until the whole cache turned out
+        // to be usable.
+        auto mesh = std::make_shared<CachedTriangleMesh>(std::move(file), triangles, material);
+
+        std::vector<const IntersectableGeometry*> leafGeometries{};
+        leafGeometries.reserve(header.LeafCount);
+
+        for (size_t i = 0; i < header.LeafCount; i++)
+        {
+            leafGeometries.push_back(CreateMeshCacheLeaf(*mesh, blockData + leafs[i].BlockOffset, leafs[i]));
+        }
+
+        std::vector<std::shared_ptr<IntersectableGeometry>> hierarchyPointers{};
+        const IntersectableGeometry* root = header.NodeFormat == MeshCacheNodeFormat::Quantized
+            ? LoadMeshCacheHierarchy<QuantizedBoundingBoxHierarchy::Node>(data, header, std::move(leafGeometries), hierarchyPointers)
+            : LoadMeshCacheHierarchy<LinearBoundingBoxHierarchy::Node>(data, header, std::move(leafGeometries), hierarchyPointers);
+
+        if (!root)
+        {
+            return {nullptr, real{0}};
+        }
+
+        mesh->SetHierarchy(root);
+
+        geometryPointers.push_back(mesh);
+        geometryPointers.insert(geometryPointers.end(), hierarchyPointers.begin(), hierarchyPointers.end());
+
+        return {root, header.SahCost};
+    }
+
+    /// @brief Collects the triangles of a leaf grouped by the SOA structure that holds them, a lone triangle is a group of
+    /// its own. capacity is raised to the capacity of the widest SOA structure in the leaf.
+    /// @return False if the leaf holds anything other than triangles.
+    bool CollectLeafTriangleGroups(const IntersectableGeometry* geometry, std::vector<std::vector<const Triangle*>>& groups, size_t& capacity)
+    {
+        if (auto geometryCollection = dynamic_cast<const GeometryCollection*>(geometry))
+        {
+            for (const IntersectableGeometry* child : geometryCollection->GetChildren())
+            {
+                if (!CollectLeafTriangleGroups(child, groups, capacity))
+                {
+                    return false;
+                }
+            }
+        }
+        else if (auto geometrySoa = dynamic_cast<const GeometrySoaBase*>(geometry))
+        {
+            capacity = Math::max(capacity, geometrySoa->GetCapacity());
+
+            auto& group = groups.emplace_back();
+
+            for (size_t i = 0; i < geometrySoa->GetCapacity(); i++)
+            {
+                if (const Geometry* child = geometrySoa->GetGeometry(i))
+                {
+                    auto triangle = dynamic_cast<const Triangle*>(child);
+                    if (!triangle)
+                    {
+                        return false;
+                    }
+
+                    group.push_back(triangle);
+                }
+            }
+        }
+        else if (auto triangle = dynamic_cast<const Triangle*>(geometry))
+        {
+            groups.push_back({triangle});
+        }
+        else
+        {
+            return false;
+        }
+
+        return true;
+    }
+
+    /// @brief Picks the size of the blocks of a leaf, the same size as the SOA structures the leaf was built with.
+    SoaSize SelectMeshCacheBlockSize(size_t capacity)
+    {
+        if (capacity > SoaElements<SoaSize::_256>)
+        {
+            return SoaSize::_512;
+        }
+        else if (capacity > SoaElements<SoaSize::_128>)
+        {
+            return SoaSize::_256;
+        }
+        else
+        {
+            return SoaSize::_128;
+        }
+    }
+
+    /// @brief Packs every group of triangles into blocks of its own and appends them to blockData.
+    /// @return The number of blocks appended, or zero if a triangle is not part of the cached mesh.
+    template <SoaSize Size>
+    size_t AppendMeshCacheBlocks(
+        std::vector<std::byte>& blockData,
+        const std::vector<std::vector<const Triangle*>>& groups,
+        const std::unordered_map<const Triangle*, std::uint32_t>& triangleIndices)
+    {
+        using Block = MeshCacheBlock<Size>;
+
+        size_t blockCount = 0;
+
+        for (const auto& group : groups)
+        {
+            for (size_t start = 0; start < group.size(); start += Block::Elements)
+            {
+                Block block{};
+
+                for (size_t index = 0; index < Block::Elements && start + index < group.size(); index++)
+                {
+                    const Triangle* triangle = group[start + index];
+
+                    auto triangleIndex = triangleIndices.find(triangle);
+                    if (triangleIndex == triangleIndices.end())
+                    {
+                        return 0;
+                    }
+
+                    block.Vertices.Set(index, triangle->Vertex0, triangle->Vertex1, triangle->Vertex2);
+                    block.TriangleIndices[index] = triangleIndex->second;
+                }
+
+                const auto* bytes = reinterpret_cast<const std::byte*>(&block);
+                blockData.insert(blockData.end(), bytes, bytes + sizeof(Block));
+
+                blockCount++;
+            }
+        }
+
+        return blockCount;
+    }
+
+    size_t AppendMeshCacheBlocks(
+        std::vector<std::byte>& blockData,
+        SoaSize size,
+        const std::vector<std::vector<const Triangle*>>& groups,
+        const std::unordered_map<const Triangle*, std::uint32_t>& triangleIndices)
+    {
+        if (size == SoaSize::_128)
+        {
+            return AppendMeshCacheBlocks<SoaSize::_128>(blockData, groups, triangleIndices);
+        }
+        else if (size == SoaSize::_256)
+        {
+            return AppendMeshCacheBlocks<SoaSize::_256>(blockData, groups, triangleIndices);
+        }
+        else
+        {
+            return AppendMeshCacheBlocks<SoaSize::_512>(blockData, groups, triangleIndices);
+        }
+    }
+
+    template <typename TNode>
+    bool SaveMeshCache(
+        const std::string& filename,
+        std::uint64_t key,
+        const std::vector<const Triangle*>& triangles,
+        const LinearBoundingBoxHierarchyT<real, TNode>& hierarchy,
+        MeshCacheNodeFormat nodeFormat,
+        real sahCost)
+    {
+        std::unordered_map<const Triangle*, std::uint32_t> triangleIndices{};
+        for (size_t i = 0; i < triangles.size(); i++)
+        {
+            triangleIndices[triangles[i]] = static_cast<std::uint32_t>(i);
+        }
+
+        std::vector<MeshCacheLeaf> leafs{};
+        std::vector<std::byte> blockData{};
+
+        for (const IntersectableGeometry* leaf : hierarchy.GetLeafs())
+        {
+            // Sub-hierarchies that were too deep to be flattened can not be cached.
+            if (dynamic_cast<const BoundingBoxHierarchy*>(leaf))
+            {
+                return false;
+            }
+
+            std::vector<std::vector<const Triangle*>> groups{};
+            size_t capacity = 0;
+
+            if (!CollectLeafTriangleGroups(leaf, groups, capacity))
+            {
+                return false;
+            }
+
+            MeshCacheLeaf cachedLeaf{};
+            cachedLeaf.BlockOffset = blockData.size();
+            cachedLeaf.Size = SelectMeshCacheBlockSize(capacity);
+
+            size_t blockCount = AppendMeshCacheBlocks(blockData, cachedLeaf.Size, groups, triangleIndices);
+            if (blockCount == 0)
+            {
+                return false;
+            }
+
+            cachedLeaf.BlockCount = static_cast<std::uint32_t>(blockCount);
+            leafs.push_back(cachedLeaf);
+        }
+
+        MeshCacheHeader header{};
+        header.Key = key;
+        header.NodeFormat = nodeFormat;
+        header.NodeSize = sizeof(TNode);
+        header.TriangleCount = triangles.size();
+        header.NodeCount = hierarchy.GetNodeCount();
+        header.LeafCount = leafs.size();
+        header.BlockDataSize = blockData.size();
+        header.SahCost = sahCost;
+
+        header.TrianglesOffset = AlignCacheOffset(sizeof(MeshCacheHeader));
+        header.NodesOffset = AlignCacheOffset(header.TrianglesOffset + header.TriangleCount * CachedTriangleReals * sizeof(real));
+        header.LeafsOffset = AlignCacheOffset(header.NodesOffset + header.NodeCount * sizeof(TNode));
+        header.BlocksOffset = AlignCacheOffset(header.LeafsOffset + header.LeafCount * sizeof(MeshCacheLeaf));
+
+        // Write to a temporary file first so an interrupted write never leaves a cache behind that looks valid.
+        std::string temporaryFilename = filename + ".tmp";
+
+        {
+            std::ofstream stream{temporaryFilename, std::ios::binary | std::ios::trunc};
+            if (!stream)
+            {
+                return false;
+            }
+
+            auto writeAt = [&stream](std::uint64_t offset, const void* data, size_t size)
+            {
+                static constexpr char padding[64]{};
+
+                std::uint64_t position = static_cast<std::uint64_t>(stream.tellp());
+                stream.write(padding, static_cast<std::streamsize>(offset - position));
+                stream.write(static_cast<const char*>(data), static_cast<std::streamsize>(size));
+            };
+
+            writeAt(0, &header, sizeof(MeshCacheHeader));
+
+            std::vector<real> triangleData{};
+            triangleData.reserve(triangles.size() * CachedTriangleReals);
+
+            for (const Triangle* triangle : triangles)
+            {
+                for (const Vector3* vector : {&triangle->Vertex0, &triangle->Vertex1, &triangle->Vertex2, &triangle->Normal0, &triangle->Normal1, &triangle->Normal2})
+                {
+                    triangleData.push_back(vector->X);
+                    triangleData.push_back(vector->Y);
+                    triangleData.push_back(vector->Z);
+                }
+            }
+
+            writeAt(header.TrianglesOffset, triangleData.data(), triangleData.size() * sizeof(real));
+            writeAt(header.NodesOffset, hierarchy.GetNodes(), header.NodeCount * sizeof(TNode));
+            writeAt(header.LeafsOffset, leafs.data(), leafs.size() * sizeof(MeshCacheLeaf));
+            writeAt(header.BlocksOffset, blockData.data(), blockData.size());
+
+            if (!stream)
+            {
+                return false;
+            }
+        }
+
+        std::error_code error{};
+        std::filesystem::rename(temporaryFilename, filename, error);
+
+        return !error;
+    }
+
+    /// @brief Writes a flattened mesh hierarchy, the SOA blocks of its leafs and its triangles to a cache file that
+    /// LoadMeshCache can map on a later start. Meshes whose hierarchy is not a (quantized) LinearBoundingBoxHierarchy built over exactly the given
+    /// triangles are not cached.
+    /// @return True if the cache file was written.
+    export bool SaveMeshCache(
+        const std::string& filename,
+        std::uint64_t key,
+        const std::vector<const Triangle*>& triangles,
+        const IntersectableGeometry* root,
+        real sahCost)
+    {
+        if (auto linearHierarchy = dynamic_cast<const LinearBoundingBoxHierarchy*>(root))
+        {
+            return SaveMeshCache(filename, key, triangles, *linearHierarchy, MeshCacheNodeFormat::Linear, sahCost);
+        }
+
+        if (auto quantizedHierarchy = dynamic_cast<const QuantizedBoundingBoxHierarchy*>(root))
+        {
+            return SaveMeshCache(filename, key, triangles, *quantizedHierarchy, MeshCacheNodeFormat::Quantized, sahCost);
+        }
+
+        return false;
+    }
+}
\ No newline at end of file
@@ -49,5 +49,21 @@ namespace Yart
                 return leftColor * (real{1} - mixAmount) + rightColor * mixAmount;
             }
         }
+
+        /// @brief Scatters off one of the two materials, picked with the probability of its mix amount, so a single path
+        /// still continues.
+        virtual ScatterResult Scatter(
+            const Scene& scene,
+            const Random& random,
+            int currentDepth,
+            const Geometry* hitGeometry,
+            const Vector3& hitPosition,
+            const Vector3& hitNormal,
+            const Vector3& incomingDirection,
+            real mixAmount) const override
+        {
+            const Material* material = random.GetNormalized() < mixAmount ? RightMaterial : LeftMaterial;
+            return material->Scatter(scene, random, currentDepth, hitGeometry, hitPosition, hitNormal, incomingDirection, real{0});
+        }
     };
 }
\ No newline at end of file
@@ -11,13 +11,28 @@ namespace Yart
     {
         // Source: https://www.scratchapixel.com/code.php?id=34&origin=/lessons/3d-basic-rendering/global-illumination-path-tracing
 
-        T sinTheta = Math::sqrt(T{1} - random1 * random1);
+        // The cosine of the angle to the normal is the square root of a uniform number, which makes the pdf cos(theta) / pi.
+        T cosTheta = Math::sqrt(random1);
+        T sinTheta = Math::sqrt(T{1} - random1);
         T phi = TwoPi * random2;
 
         T z = sinTheta * Math::sin(phi);
         T x = sinTheta * Math::cos(phi);
 
-        return Vector3T<T>{x, random1, z};
+        return Vector3T<T>{x, cosTheta, z};
+    }
+
+    /// @brief The power heuristic with an exponent of two, weighs a sample of one of two sampling strategies for multiple
+    /// importance sampling.
+    /// @param pdf The pdf of the strategy that took the sample.
+    /// @param otherPdf The pdf of the other strategy for the same sample.
+    export template <std::floating_point T = real>
+    inline constexpr T PowerHeuristic(T pdf, T otherPdf)
+    {
+        T pdfSquared = pdf * pdf;
+        T sum = pdfSquared + otherPdf * otherPdf;
+
+        return sum > T{0} ? pdfSquared / sum : T{0};
     }
 
     export template <std::floating_point T = real>
@@ -11,6 +11,7 @@ import "Common.h";
 
 import Alignment;
 import BoundingBox;
+import Geometry;
 import GeometrySoa;
 import IntersectionResult;
 import IntersectionResultType;
@@ -26,10 +27,10 @@ namespace Yart
         class alignas(64) ParallelogramSoa : public GeometrySoa<Parallelogram>
     {
     public:
-        static constexpr size_t Elements = std::same_as<real, float> ? (Size == SoaSize::_256 ? 8 : 4) : (Size == SoaSize::_256 ? 4 : 2);
+        static constexpr size_t Elements = SoaElements<Size>;
 
     private:
-        using VclVec = std::conditional_t<std::same_as<real, float>, std::conditional_t<Size == SoaSize::_256, Vec8f, Vec4f>, std::conditional_t<Size == SoaSize::_256, Vec4d, Vec2d>>;
+        using VclVec = SoaVector<Size>;
 
         alignas(Elements * sizeof(real)) real _positionX[Elements];
         alignas(Elements * sizeof(real)) real _positionY[Elements];
@@ -101,6 +102,34 @@ namespace Yart
             _geometries[index] = geometry;
         }
 
+        virtual size_t GetCapacity() const override
+        {
+            return Elements;
+        }
+
+        virtual const Geometry* GetGeometry(size_t index) const override
+        {
+            assert(index >= 0 && index < Elements);
+
+            return _geometries[index];
+        }
+
+        virtual size_t CalculateMemoryUsage() const override
+        {
+            return sizeof(*this);
+        }
+
+        virtual void Refit() override
+        {
+            for (size_t i = 0; i < Elements; i++)
+            {
+                if (_geometries[i])
+                {
+                    Insert(i, _geometries[i]);
+                }
+            }
+        }
+
         virtual BoundingBox CalculateBoundingBox() const override
         {
             BoundingBox boundingBox = BoundingBox::ReverseInfinity();
@@ -123,6 +152,11 @@ namespace Yart
             return Intersect(ray);
         }
 
+        virtual bool IntersectAny(const Ray& ray, real maximumDistance) const override
+        {
+            return Intersect(ray).HitDistance < maximumDistance;
+        }
+
         virtual IntersectionResult IntersectExit(const Ray& ray) const override
         {
             return Intersect(ray);
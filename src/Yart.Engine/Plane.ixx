@@ -1,8 +1,11 @@
 export module Plane;
 
+import <cstdint>;
+
 import "Common.h";
 
 import Geometry;
+import GeometryVisitor;
 import IntersectionResult;
 import IntersectionResultType;
 import Material;
@@ -37,11 +40,16 @@ namespace Yart
             return AppliedMaterial;
         }
 
-        virtual Vector3 CalculateNormal(const Ray& ray, const Vector3& hitPosition, real additionalData) const override
+        virtual Vector3 CalculateNormal(const Ray& ray, const Vector3& hitPosition, real additionalData, std::uint32_t primitiveIndex) const override
         {
             return (ray.Direction * Normal) < real{0.0} ? Normal : -Normal;
         }
 
+        virtual void Accept(GeometryVisitor& visitor) const override
+        {
+            visitor.Visit(this);
+        }
+
         virtual IntersectionResult IntersectEntrance(const Ray& ray) const override
         {
             return {this, Intersect(ray)};
@@ -11,6 +11,7 @@ import <limits>;
 import "Common.h";
 
 import Alignment;
+import Geometry;
 import GeometrySoa;
 import IntersectionResult;
 import IntersectionResultType;
@@ -26,10 +27,10 @@ namespace Yart
         class __declspec(dllexport) alignas(64) PlaneSoa : public GeometrySoa<Plane>
     {
     public:
-        static constexpr size_t Elements = std::same_as<real, float> ? (Size == SoaSize::_256 ? 8 : 4) : (Size == SoaSize::_256 ? 4 : 2);
+        static constexpr size_t Elements = SoaElements<Size>;
 
     private:
-        using VclVec = std::conditional_t<std::same_as<real, float>, std::conditional_t<Size == SoaSize::_256, Vec8f, Vec4f>, std::conditional_t<Size == SoaSize::_256, Vec4d, Vec2d>>;
+        using VclVec = SoaVector<Size>;
 
         alignas(Elements * sizeof(real)) real _normalX[Elements];
         alignas(Elements * sizeof(real)) real _normalY[Elements];
@@ -80,11 +81,44 @@ namespace Yart
             _geometries[index] = geometry;
         }
 
+        virtual size_t GetCapacity() const override
+        {
+            return Elements;
+        }
+
+        virtual const Geometry* GetGeometry(size_t index) const override
+        {
+            assert(index >= 0 && index < Elements);
+
+            return _geometries[index];
+        }
+
+        virtual size_t CalculateMemoryUsage() const override
+        {
+            return sizeof(*this);
+        }
+
+        virtual void Refit() override
+        {
+            for (size_t i = 0; i < Elements; i++)
+            {
+                if (_geometries[i])
+                {
+                    Insert(i, _geometries[i]);
+                }
+            }
+        }
+
         virtual IntersectionResult IntersectEntrance(const Ray& ray) const override
         {
             return Intersect(ray);
         }
 
+        virtual bool IntersectAny(const Ray& ray, real maximumDistance) const override
+        {
+            return Intersect(ray).HitDistance < maximumDistance;
+        }
+
         virtual IntersectionResult IntersectExit(const Ray& ray) const override
         {
             return Intersect(ray);
@@ -28,14 +28,12 @@ namespace Yart
         virtual bool IsInShadow(const Scene& scene, const Vector3& hitPosition, const Vector3& hitNormal, const Vector3& directionToLight) const override
         {
             Vector3 directionToLight2 = Position - hitPosition;
-            real distanceToLightSquared = directionToLight2.Length();
+            real distanceToLight = directionToLight2.Length();
 
             directionToLight2.Normalize();
 
             Ray ray{hitPosition, directionToLight2};
-            real distance = scene.CastRayDistance(ray);
-
-            return distance >= distanceToLightSquared - real{0.01} ? false : true;
+            return scene.IsOccluded(ray, distanceToLight - real{0.01});
         }
     };
 }
\ No newline at end of file
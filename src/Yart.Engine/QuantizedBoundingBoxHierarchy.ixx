@@ -0,0 +1,247 @@
+module;
+
+#include "Vcl.h"
+
+export module QuantizedBoundingBoxHierarchy;
+
+import <cmath>;
+import <cstdint>;
+
+import "Common.h";
+
+import BoundingBox;
+import BoundingBoxHierarchy;
+import LinearBoundingBoxHierarchy;
+import Math;
+
+using namespace vcl;
+
+namespace Yart
+{
+    export template <typename T>
+    concept QuantizedCoordinate = std::same_as<T, std::uint8_t> || std::same_as<T, std::uint16_t>;
+
+    /// @brief A wide node whose child bounds are stored as 8 or 16 bit steps on a grid spanning the bounds of the node itself.
+    /// Child bounds are always rounded outwards so the decoded boxes enclose the exact ones and traversal stays correct, it
+    /// merely visits a few more children than the full precision layout would.
+    ///
+    /// With 8 bit steps a node takes a quarter (double) or half (float) of the memory of a LinearBoundingBoxNodeT.
+    export template <real_number T, QuantizedCoordinate TQuantized>
+        class alignas(64) QuantizedBoundingBoxNodeT
+    {
+    public:
+        using VclVec = typename std::conditional<std::same_as<T, float>, Vec8f, Vec4d>::type;
+
+        static constexpr size_t NumberOfLeafs = BoundingBoxHierarchyT<T>::NumberOfLeafs;
+
+        static constexpr std::uint32_t LeafFlag = LinearBoundingBoxNodeT<T>::LeafFlag;
+        static constexpr std::uint32_t EmptyChild = LinearBoundingBoxNodeT<T>::EmptyChild;
+
+        static constexpr T MaximumStep = static_cast<T>(std::numeric_limits<TQuantized>::max());
+
+        // The grid is stored in single precision whatever T is, the rounding below keeps it conservative.
+        float OriginX{};
+        float OriginY{};
+        float OriginZ{};
+
+        float ScaleX{};
+        float ScaleY{};
+        float ScaleZ{};
+
+        alignas(sizeof(TQuantized) * NumberOfLeafs) TQuantized MinimumX[NumberOfLeafs];
+        alignas(sizeof(TQuantized) * NumberOfLeafs) TQuantized MinimumY[NumberOfLeafs];
+        alignas(sizeof(TQuantized) * NumberOfLeafs) TQuantized MinimumZ[NumberOfLeafs];
+
+        alignas(sizeof(TQuantized) * NumberOfLeafs) TQuantized MaximumX[NumberOfLeafs];
+        alignas(sizeof(TQuantized) * NumberOfLeafs) TQuantized MaximumY[NumberOfLeafs];
+        alignas(sizeof(TQuantized) * NumberOfLeafs) TQuantized MaximumZ[NumberOfLeafs];
+
+        std::uint32_t Children[NumberOfLeafs];
+
+        QuantizedBoundingBoxNodeT()
+        {
+            for (size_t i = 0; i < NumberOfLeafs; i++)
+            {
+                MinimumX[i] = 0;
+                MinimumY[i] = 0;
+                MinimumZ[i] = 0;
+
+                MaximumX[i] = 0;
+                MaximumY[i] = 0;
+                MaximumZ[i] = 0;
+
+                Children[i] = EmptyChild;
+            }
+        }
+
+        /// @brief Fits the grid of the node to the union of the bounds of its children and quantizes them. The children
+        /// must be assigned first, the bounds of empty children are ignored. The bounds must be finite.
+        void SetChildBoundingBoxes(const BoundingBoxT<T>* boundingBoxes)
+        {
+            BoundingBoxT<T> nodeBoundingBox = BoundingBoxT<T>::ReverseInfinity();
+
+            for (size_t i = 0; i < NumberOfLeafs; i++)
+            {
+                if (Children[i] != EmptyChild)
+                {
+                    nodeBoundingBox = nodeBoundingBox.Union(boundingBoxes[i]);
+                }
+            }
+
+            if (nodeBoundingBox.IsEmpty())
+            {
+                return;
+            }
+
+            std::tie(OriginX, ScaleX) = CalculateGrid(nodeBoundingBox.Minimum.X, nodeBoundingBox.Maximum.X);
+            std::tie(OriginY, ScaleY) = CalculateGrid(nodeBoundingBox.Minimum.Y, nodeBoundingBox.Maximum.Y);
+            std::tie(OriginZ, ScaleZ) = CalculateGrid(nodeBoundingBox.Minimum.Z, nodeBoundingBox.Maximum.Z);
+
+            for (size_t i = 0; i < NumberOfLeafs; i++)
+            {
+                if (Children[i] == EmptyChild)
+                {
+                    continue;
+                }
+
+                MinimumX[i] = QuantizeMinimum(boundingBoxes[i].Minimum.X, OriginX, ScaleX);
+                MinimumY[i] = QuantizeMinimum(boundingBoxes[i].Minimum.Y, OriginY, ScaleY);
+                MinimumZ[i] = QuantizeMinimum(boundingBoxes[i].Minimum.Z, OriginZ, ScaleZ);
+
+                MaximumX[i] = QuantizeMaximum(boundingBoxes[i].Maximum.X, OriginX, ScaleX);
+                MaximumY[i] = QuantizeMaximum(boundingBoxes[i].Maximum.Y, OriginY, ScaleY);
+                MaximumZ[i] = QuantizeMaximum(boundingBoxes[i].Maximum.Z, OriginZ, ScaleZ);
+            }
+        }
+
+        BoundingBoxT<T> GetChildBoundingBox(size_t leafIndex) const
+        {
+            return BoundingBoxT<T>{
+                Vector3T<T>{Dequantize(MinimumX[leafIndex], OriginX, ScaleX), Dequantize(MinimumY[leafIndex], OriginY, ScaleY), Dequantize(MinimumZ[leafIndex], OriginZ, ScaleZ)},
+                Vector3T<T>{Dequantize(MaximumX[leafIndex], OriginX, ScaleX), Dequantize(MaximumY[leafIndex], OriginY, ScaleY), Dequantize(MaximumZ[leafIndex], OriginZ, ScaleZ)},
+            };
+        }
+
+        force_inline void CalculateChildEntranceDistances(
+            const VectorVec3<VclVec>& rayPosition,
+            const VectorVec3<VclVec>& rayInverseDirection,
+            T* distances) const
+        {
+            // Decoding uses a separate multiply and add, exactly like Dequantize, so the traversal sees the same
+            // conservative bounds the quantization was checked against.
+            VclVec originX{static_cast<T>(OriginX)};
+            VclVec originY{static_cast<T>(OriginY)};
+            VclVec originZ{static_cast<T>(OriginZ)};
+
+            VclVec scaleX{static_cast<T>(ScaleX)};
+            VclVec scaleY{static_cast<T>(ScaleY)};
+            VclVec scaleZ{static_cast<T>(ScaleZ)};
+
+            VclVec minX = ConvertNanToInf(((LoadSteps(MinimumX) * scaleX + originX) - rayPosition.X) * rayInverseDirection.X);
+            VclVec minY = ConvertNanToInf(((LoadSteps(MinimumY) * scaleY + originY) - rayPosition.Y) * rayInverseDirection.Y);
+            VclVec minZ = ConvertNanToInf(((LoadSteps(MinimumZ) * scaleZ + originZ) - rayPosition.Z) * rayInverseDirection.Z);
+
+            VclVec maxX = ConvertNanToInf(((LoadSteps(MaximumX) * scaleX + originX) - rayPosition.X) * rayInverseDirection.X);
+            VclVec maxY = ConvertNanToInf(((LoadSteps(MaximumY) * scaleY + originY) - rayPosition.Y) * rayInverseDirection.Y);
+            VclVec maxZ = ConvertNanToInf(((LoadSteps(MaximumZ) * scaleZ + originZ) - rayPosition.Z) * rayInverseDirection.Z);
+
+            VclVec exitDistance = vcl::min(vcl::min(vcl::max(minX, maxX), vcl::max(minY, maxY)), vcl::max(minZ, maxZ));
+            VclVec entranceDistance = vcl::max(vcl::max(vcl::min(minX, maxX), vcl::min(minY, maxY)), vcl::min(minZ, maxZ));
+
+            VclVec clampedEntranceDistance = select(exitDistance >= VclVec{T{0.0}} & entranceDistance <= exitDistance, entranceDistance, VclVec{std::numeric_limits<T>::infinity()});
+
+            clampedEntranceDistance.store_a(distances);
+        }
+
+    private:
+        static force_inline VclVec LoadSteps(const TQuantized* steps)
+        {
+            // Widen the steps to 32 bit integers and convert them to the traversal precision.
+            Vec8us wideSteps;
+
+            if constexpr (std::same_as<TQuantized, std::uint8_t>)
+            {
+                wideSteps = extend_low(Vec16uc{}.load_partial(NumberOfLeafs, steps));
+            }
+            else
+            {
+                wideSteps = Vec8us{}.load_partial(NumberOfLeafs, steps);
+            }
+
+            if constexpr (std::same_as<T, float>)
+            {
+                return to_float(Vec8i{extend(wideSteps)});
+            }
+            else
+            {
+                return to_double(Vec4i{extend_low(wideSteps)});
+            }
+        }
+
+        static T Dequantize(TQuantized step, float origin, float scale)
+        {
+            return static_cast<T>(step) * static_cast<T>(scale) + static_cast<T>(origin);
+        }
+
+        static std::tuple<float, float> CalculateGrid(T minimum, T maximum)
+        {
+            float origin = static_cast<float>(minimum);
+            if (static_cast<T>(origin) > minimum)
+            {
+                origin = std::nextafter(origin, -std::numeric_limits<float>::infinity());
+            }
+
+            float scale = static_cast<float>((maximum - static_cast<T>(origin)) / MaximumStep);
+            while (Dequantize(std::numeric_limits<TQuantized>::max(), origin, scale) < maximum)
+            {
+                scale = std::nextafter(scale, std::numeric_limits<float>::infinity());
+            }
+
+            return {origin, scale};
+        }
+
+        static TQuantized QuantizeMinimum(T value, float origin, float scale)
+        {
+            if (!(scale > 0.0f))
+            {
+                return 0;
+            }
+
+            T step = Math::max(T{0}, Math::min(MaximumStep, std::floor((value - static_cast<T>(origin)) / static_cast<T>(scale))));
+            TQuantized quantized = static_cast<TQuantized>(step);
+
+            // Rounding in the division can land one step too high.
+            while (quantized > 0 && Dequantize(quantized, origin, scale) > value)
+            {
+                quantized--;
+            }
+
+            return quantized;
+        }
+
+        static TQuantized QuantizeMaximum(T value, float origin, float scale)
+        {
+            if (!(scale > 0.0f))
+            {
+                return 0;
+            }
+
+            T step = Math::max(T{0}, Math::min(MaximumStep, std::ceil((value - static_cast<T>(origin)) / static_cast<T>(scale))));
+            TQuantized quantized = static_cast<TQuantized>(step);
+
+            while (quantized < std::numeric_limits<TQuantized>::max() && Dequantize(quantized, origin, scale) < value)
+            {
+                quantized++;
+            }
+
+            return quantized;
+        }
+    };
+
+    /// @brief A LinearBoundingBoxHierarchyT that stores its child bounds quantized, trading a little traversal precision for
+    /// much less memory traffic per node.
+    export template <real_number T, QuantizedCoordinate TQuantized = std::uint8_t>
+    using QuantizedBoundingBoxHierarchyT = LinearBoundingBoxHierarchyT<T, QuantizedBoundingBoxNodeT<T, TQuantized>>;
+
+    export using QuantizedBoundingBoxHierarchy = QuantizedBoundingBoxHierarchyT<real>;
+}
\ No newline at end of file
@@ -1,5 +1,7 @@
 export module RayMarcher;
 
+import <cstdint>;
+
 import "Common.h";
 
 import Geometry;
@@ -49,7 +51,7 @@ namespace Yart
             return nullptr;
         }
 
-        Vector3 CalculateNormal(const Ray& ray, const Vector3& hitPosition, real additionalData) const override
+        Vector3 CalculateNormal(const Ray& ray, const Vector3& hitPosition, real additionalData, std::uint32_t primitiveIndex) const override
         {
             Vector3 sampleX = SampleXCoordinates * std::get<0>(ClosestDistance(hitPosition + SampleXCoordinates)).Distance;
             Vector3 sampleY = SampleYCoordinates * std::get<0>(ClosestDistance(hitPosition + SampleYCoordinates)).Distance;
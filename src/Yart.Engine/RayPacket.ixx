@@ -0,0 +1,126 @@
+module;
+
+#include "Vcl.h"
+
+export module RayPacket;
+
+import <bit>;
+import <cassert>;
+import <cstdint>;
+
+import "Common.h";
+
+import BoundingBox;
+import Math;
+import Ray;
+
+using namespace vcl;
+
+namespace Yart
+{
+    /// @brief Up to Size coherent rays, such as the primary rays of one pixel, that traverse a hierarchy together. Each
+    /// node is tested against every ray of the packet with a single SIMD intersection. Traversal works on a lane mask, a
+    /// bit per ray, so rays that miss a node simply drop out of the packet below it.
+    export class alignas(64) RayPacket
+    {
+    public:
+        static constexpr size_t Size = 8;
+        static constexpr std::uint32_t FullMask = (1u << Size) - 1;
+
+        /// @brief Subtrees entered by fewer rays than this are traversed one ray at a time, testing a node for every lane
+        /// costs more than it saves once the rays have diverged.
+        static constexpr int MinimumActiveLanes = 3;
+
+        using VclVec = std::conditional_t<std::same_as<real, float>, Vec8f, Vec8d>;
+
+    private:
+        alignas(64) real _positionX[Size];
+        alignas(64) real _positionY[Size];
+        alignas(64) real _positionZ[Size];
+
+        alignas(64) real _inverseDirectionX[Size];
+        alignas(64) real _inverseDirectionY[Size];
+        alignas(64) real _inverseDirectionZ[Size];
+
+        const Ray* _rays{};
+        size_t _count{};
+
+    public:
+        /// @param rays The rays of the packet, they must outlive it.
+        RayPacket(const Ray* rays, size_t count)
+            : _rays{rays}, _count{count}
+        {
+            assert(count > 0 && count <= Size);
+
+            // Unused lanes repeat the first ray so they never produce anything the used lanes would not. They are masked
+            // out by GetActiveMask either way.
+            for (size_t i = 0; i < Size; i++)
+            {
+                const Ray& ray = rays[i < count ? i : 0];
+
+                _positionX[i] = ray.Position.X;
+                _positionY[i] = ray.Position.Y;
+                _positionZ[i] = ray.Position.Z;
+
+                _inverseDirectionX[i] = ray.InverseDirection.X;
+                _inverseDirectionY[i] = ray.InverseDirection.Y;
+                _inverseDirectionZ[i] = ray.InverseDirection.Z;
+            }
+        }
+
+        const Ray& GetRay(size_t lane) const
+        {
+            assert(lane < _count);
+
+            return _rays[lane];
+        }
+
+        size_t GetCount() const
+        {
+            return _count;
+        }
+
+        std::uint32_t GetActiveMask() const
+        {
+            return FullMask >> (Size - _count);
+        }
+
+        /// @brief Tests a bounding box against every ray in laneMask at once.
+        /// @param maximumDistances The distance of the closest hit found so far for each lane, aligned to 64 bytes.
+        /// @param minimumEntranceDistance Receives the nearest entrance distance of the rays that hit the box.
+        /// @return The lanes of laneMask whose ray enters the box before its maximum distance.
+        force_inline std::uint32_t IntersectBoundingBox(
+            const BoundingBox& boundingBox,
+            const real* maximumDistances,
+            std::uint32_t laneMask,
+            real& minimumEntranceDistance) const
+        {
+            VclVec minX = ConvertNanToInf((VclVec{boundingBox.Minimum.X} - VclVec{}.load_a(_positionX)) * VclVec{}.load_a(_inverseDirectionX));
+            VclVec minY = ConvertNanToInf((VclVec{boundingBox.Minimum.Y} - VclVec{}.load_a(_positionY)) * VclVec{}.load_a(_inverseDirectionY));
+            VclVec minZ = ConvertNanToInf((VclVec{boundingBox.Minimum.Z} - VclVec{}.load_a(_positionZ)) * VclVec{}.load_a(_inverseDirectionZ));
+
+            VclVec maxX = ConvertNanToInf((VclVec{boundingBox.Maximum.X} - VclVec{}.load_a(_positionX)) * VclVec{}.load_a(_inverseDirectionX));
+            VclVec maxY = ConvertNanToInf((VclVec{boundingBox.Maximum.Y} - VclVec{}.load_a(_positionY)) * VclVec{}.load_a(_inverseDirectionY));
+            VclVec maxZ = ConvertNanToInf((VclVec{boundingBox.Maximum.Z} - VclVec{}.load_a(_positionZ)) * VclVec{}.load_a(_inverseDirectionZ));
+
+            VclVec exitDistance = vcl::min(vcl::min(vcl::max(minX, maxX), vcl::max(minY, maxY)), vcl::max(minZ, maxZ));
+            VclVec entranceDistance = vcl::max(vcl::max(vcl::min(minX, maxX), vcl::min(minY, maxY)), vcl::min(minZ, maxZ));
+
+            auto hit = exitDistance >= VclVec{real{0.0}} & entranceDistance <= exitDistance & entranceDistance < VclVec{}.load_a(maximumDistances);
+            std::uint32_t hitMask = static_cast<std::uint32_t>(to_bits(hit)) & laneMask;
+
+            // Lanes outside of laneMask must not pull the distance used to order the children forward.
+            VclVec laneEntranceDistance = vcl::max(entranceDistance, VclVec{real{0.0}});
+            alignas(64) real entranceDistances[Size];
+            laneEntranceDistance.store_a(entranceDistances);
+
+            minimumEntranceDistance = std::numeric_limits<real>::infinity();
+            for (std::uint32_t mask = hitMask; mask != 0; mask &= mask - 1)
+            {
+                minimumEntranceDistance = Math::min(minimumEntranceDistance, entranceDistances[std::countr_zero(mask)]);
+            }
+
+            return hitMask;
+        }
+    };
+}
\ No newline at end of file
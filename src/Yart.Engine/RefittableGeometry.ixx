@@ -0,0 +1,53 @@
+export module RefittableGeometry;
+
+import <span>;
+import <unordered_map>;
+
+import "Common.h";
+
+import IntersectableGeometry;
+
+namespace Yart
+{
+    /// @brief A geometry that keeps the bounds of the geometries below it. Everything else only ever sees geometries as
+    /// const, refitting goes through the mutable pointers of their owners, see FindRefittableGeometries.
+    export class RefittableGeometry
+    {
+    public:
+        virtual ~RefittableGeometry() = default;
+
+        /// @brief Recalculates the bounds kept of the geometries below. Must be called after they have changed, children
+        /// before their parents.
+        virtual void Refit() = 0;
+    };
+
+    /// @brief Looks up the refittable owners of geometries, in the same order. Geometries that are not refittable or not
+    /// owned by geometryPointers are skipped.
+    export std::vector<RefittableGeometry*> FindRefittableGeometries(
+        std::span<const IntersectableGeometry* const> geometries,
+        const std::vector<std::shared_ptr<IntersectableGeometry>>& geometryPointers)
+    {
+        std::unordered_map<const IntersectableGeometry*, RefittableGeometry*> refittableGeometries{};
+
+        for (const auto& geometryPointer : geometryPointers)
+        {
+            if (auto refittableGeometry = dynamic_cast<RefittableGeometry*>(geometryPointer.get()))
+            {
+                refittableGeometries.emplace(geometryPointer.get(), refittableGeometry);
+            }
+        }
+
+        std::vector<RefittableGeometry*> result{};
+        result.reserve(geometries.size());
+
+        for (const IntersectableGeometry* geometry : geometries)
+        {
+            if (auto iterator = refittableGeometries.find(geometry); iterator != refittableGeometries.end())
+            {
+                result.push_back(iterator->second);
+            }
+        }
+
+        return result;
+    }
+}
\ No newline at end of file
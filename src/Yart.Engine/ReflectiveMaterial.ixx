@@ -23,12 +23,28 @@ namespace Yart
             const Vector3& hitNormal,
             const Vector3& incomingDirection,
             real mixAmount) const override
+        {
+            return scene.CastScatterColor(Scatter(scene, random, currentDepth, hitGeometry, hitPosition, hitNormal, incomingDirection, mixAmount), currentDepth, random);
+        }
+
+        virtual ScatterResult Scatter(
+            const Scene& scene,
+            const Random& random,
+            int currentDepth,
+            const Geometry* hitGeometry,
+            const Vector3& hitPosition,
+            const Vector3& hitNormal,
+            const Vector3& incomingDirection,
+            real mixAmount) const override
         {
             Vector3 reflectedDirection = incomingDirection.Reflect(hitNormal).Normalize();
-            Ray outgoingRay = Ray{hitPosition, reflectedDirection};
 
-            Color3 outputColor = scene.CastRayColor(outgoingRay, currentDepth + 1, random);
-            return outputColor;
+            ScatterResult result{};
+            result.Attenuation = Color3{real{1.0}};
+            result.OutgoingRay = Ray{hitPosition, reflectedDirection};
+            result.Continues = true;
+
+            return result;
         }
     };
 }
\ No newline at end of file
@@ -32,11 +32,24 @@ namespace Yart
             const Vector3& hitNormal,
             const Vector3& incomingDirection,
             real mixAmount) const override
+        {
+            return scene.CastScatterColor(Scatter(scene, random, currentDepth, hitGeometry, hitPosition, hitNormal, incomingDirection, mixAmount), currentDepth, random);
+        }
+
+        virtual ScatterResult Scatter(
+            const Scene& scene,
+            const Random& random,
+            int currentDepth,
+            const Geometry* hitGeometry,
+            const Vector3& hitPosition,
+            const Vector3& hitNormal,
+            const Vector3& incomingDirection,
+            real mixAmount) const override
         {
             Vector3 refractionDirection = Vector3::Refract(incomingDirection, hitNormal, real{1.0}, RefractionIndex);
             if (refractionDirection.LengthSquared() < real{0.01})
             {
-                return Color3{};
+                return ScatterResult{};
             }
 
             refractionDirection.Normalize();
@@ -52,7 +65,7 @@ namespace Yart
 
             // Because we flipped the refraction direction, the normal should be pointing away
             // from the geometry.
-            Vector3 exitNormal = hitGeometry->CalculateNormal(refractionRay, exitPosition, exitIntersection.AdditionalData);
+            Vector3 exitNormal = hitGeometry->CalculateNormal(refractionRay, exitPosition, exitIntersection.AdditionalData, exitIntersection.PrimitiveIndex);
             exitPosition += exitNormal * NormalBump;
 
             // Create the outgoing ray. Use the non reversed refraction direction and the reversed
@@ -60,15 +73,17 @@ namespace Yart
             Vector3 outgoingDirection = Vector3::Refract(refractionDirection, -exitNormal, RefractionIndex, real{1.0});
             if (outgoingDirection.LengthSquared() < real{0.01})
             {
-                return Color3{};
+                return ScatterResult{};
             }
 
             outgoingDirection.Normalize();
 
-            Ray outgoingRay{exitPosition, outgoingDirection};
-            Color3 outputColor = scene.CastRayColor(outgoingRay, currentDepth + 1, random);
+            ScatterResult result{};
+            result.Attenuation = Color3{real{1.0}};
+            result.OutgoingRay = Ray{exitPosition, outgoingDirection};
+            result.Continues = true;
 
-            return outputColor;
+            return result;
         }
     };
 }
\ No newline at end of file
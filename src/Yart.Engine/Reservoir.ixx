@@ -0,0 +1,62 @@
+export module Reservoir;
+
+import "Common.h";
+
+import Math;
+import Random;
+
+namespace Yart
+{
+    /// @brief Weighted reservoir sampling: keeps one of a stream of candidates, each with a probability proportional to
+    /// its weight, without storing the others. Used for resampled importance sampling.
+    export template <typename TSample>
+    class Reservoir
+    {
+    private:
+        TSample _sample{};
+        real _weightSum{};
+        size_t _count{};
+        bool _hasSample{};
+
+    public:
+        /// @brief Streams a candidate through the reservoir. Candidates without a positive weight are only counted.
+        void Update(const TSample& sample, real weight, const Random& random)
+        {
+            _count++;
+
+            if (!(weight > real{0.0}) || !Math::isfinite(weight))
+            {
+                return;
+            }
+
+            _weightSum += weight;
+
+            if (random.GetNormalized() * _weightSum < weight)
+            {
+                _sample = sample;
+                _hasSample = true;
+            }
+        }
+
+        bool HasSample() const
+        {
+            return _hasSample;
+        }
+
+        const TSample& GetSample() const
+        {
+            return _sample;
+        }
+
+        real GetWeightSum() const
+        {
+            return _weightSum;
+        }
+
+        /// @brief Gets the number of candidates streamed through the reservoir, including the ones without weight.
+        size_t GetCount() const
+        {
+            return _count;
+        }
+    };
+}
\ No newline at end of file
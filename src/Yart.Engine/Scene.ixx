@@ -4,34 +4,81 @@ module;
 
 export module Scene;
 
+import <cassert>;
+import <unordered_map>;
 import <utility>;
 
 import "Common.h";
 
+import AliasTable;
 import Alignment;
 import AreaLight;
 import Geometry;
+import GeometryInstance;
 import IntersectableGeometry;
+import LightHierarchy;
 import Light;
 import Material;
 import Math;
 import MissShader;
+import MonteCarlo;
 import Random;
 import Ray;
+import RayPacket;
+import Reservoir;
 
 namespace Yart
 {
     export class Scene
     {
     private:
+        /// @brief A light sample of next event estimation before its shadow ray is traced.
+        class LightCandidate
+        {
+        public:
+            size_t AreaLightIndex{};
+            Vector3 PositionOnLight{};
+
+            /// @brief The BSDF times the cosine term times the emission of the light, without visibility.
+            Color3 Contribution{};
+
+            real LightPdf{};
+            real ScatteringPdf{};
+        };
+
         const MissShader* _missShader{};
 
+        /// @brief The indices of the area lights by their geometry, to recognize the lights that BSDF sampled rays hit.
+        std::unordered_map<const Geometry*, size_t> _areaLightIndices{};
+
+        /// @brief Picks area lights in proportion to the power they emit, see BuildAreaLightSampling.
+        AliasTable _areaLightTable{};
+
+        /// @brief Picks area lights by their estimated contribution to a position, used instead of the table when
+        /// UseLightHierarchy is set.
+        LightHierarchy _areaLightHierarchy{};
+
     public:
         const IntersectableGeometry* RootGeometry{};
         std::vector<const Light*> Lights{};
         std::vector<const AreaLight*> AreaLights{};
 
-        inline constexpr Scene(const IntersectableGeometry* rootGeometry, const MissShader* missShader)
+        /// @brief The deepest bounce that is still shaded, paths are cut off below it.
+        int MaximumDepth{7};
+
+        /// @brief Paths that continue past this depth are subject to Russian roulette on their throughput, see
+        /// ApplyRussianRoulette.
+        int RouletteDepth{3};
+
+        /// @brief Whether next event estimation picks the area lights with a LightHierarchy. Takes effect in
+        /// BuildAreaLightSampling.
+        bool UseLightHierarchy{};
+
+        /// @brief The number of light candidates next event estimation resamples to pick the one it traces a shadow ray
+        /// to. One disables resampling.
+        int DirectLightCandidates{1};
+
+        inline Scene(const IntersectableGeometry* rootGeometry, const MissShader* missShader)
             : RootGeometry{rootGeometry}, _missShader{missShader}
         {
 
@@ -45,6 +92,33 @@ namespace Yart
         inline void AddAreaLight(const AreaLight* areaLight)
         {
             AreaLights.push_back(areaLight);
+            _areaLightIndices[areaLight] = AreaLights.size() - 1;
+        }
+
+        /// @brief Builds the table next event estimation picks the area lights from. A light is picked in proportion to
+        /// the power it emits, its area times the luminance of its emissive color. With UseLightHierarchy the lights are
+        /// picked from a LightHierarchy over the same powers instead. Must be called after the last AddAreaLight.
+        void BuildAreaLightSampling()
+        {
+            std::vector<real> powers(AreaLights.size());
+
+            for (size_t i = 0; i < AreaLights.size(); i++)
+            {
+                const Material* material = AreaLights[i]->GetMaterial();
+                powers[i] = material ? material->GetEmissiveColor().Luminance() * AreaLights[i]->GetArea() : real{0.0};
+            }
+
+            _areaLightTable = AliasTable{powers};
+            _areaLightHierarchy = UseLightHierarchy ? LightHierarchy{AreaLights, powers} : LightHierarchy{};
+        }
+
+        /// @brief Gets the probability with which next event estimation picks the area light at index for a hit at
+        /// hitPosition.
+        real GetAreaLightSelectionProbability(size_t index, const Vector3& hitPosition) const
+        {
+            return UseLightHierarchy
+                ? _areaLightHierarchy.CalculateProbability(index, hitPosition)
+                : _areaLightTable.GetProbability(index);
         }
 
         inline Color3 CastRayColor(const Ray& ray, const Random& random) const
@@ -52,34 +126,356 @@ namespace Yart
             return CastRayColor(ray, 1, random);
         }
 
-        Color3 CastRayColor(const Ray& ray, int depth, const Random& random) const
+        /// @param scatterPdf The Pdf of the ScatterResult the ray came from, see ScatterResult::Pdf.
+        Color3 CastRayColor(const Ray& ray, int depth, const Random& random, real scatterPdf = real{0.0}) const
         {
-            if (depth > 7)
+            if (depth > MaximumDepth)
             {
                 return Color3{};
             }
 
+            return ShadeIntersection(ray, RootGeometry->IntersectEntrance(ray), depth, random, scatterPdf);
+        }
+
+        /// @brief Traces up to RayPacket::Size coherent rays, such as the primary rays of one pixel. The first intersection
+        /// of the rays is found with a single packet traversal, the paths that continue from there are traced one ray at a
+        /// time.
+        void CastRayPacketColor(const Ray* rays, size_t count, Color3* colors, const Random& random) const
+        {
+            RayPacket packet{rays, count};
+
+            IntersectionResult intersections[RayPacket::Size];
+            for (size_t i = 0; i < count; i++)
+            {
+                intersections[i] = IntersectionResult{nullptr, std::numeric_limits<real>::infinity()};
+            }
+
+            RootGeometry->IntersectPacketEntrance(packet, packet.GetActiveMask(), intersections);
+
+            for (size_t i = 0; i < count; i++)
+            {
+                colors[i] = ShadeIntersection(rays[i], intersections[i], 1, random);
+            }
+        }
+
+        /// @brief Traces the outgoing ray of a ScatterResult, used by materials that implement CalculateRenderingEquation
+        /// through Material::Scatter.
+        Color3 CastScatterColor(const ScatterResult& scatter, int currentDepth, const Random& random) const
+        {
+            if (!scatter.Continues)
+            {
+                return scatter.Emitted;
+            }
+
+            return scatter.Emitted + scatter.Attenuation * CastRayColor(scatter.OutgoingRay, currentDepth + 1, random, scatter.Pdf);
+        }
+
+        /// @brief Traces the path of a ray in a loop that carries the throughput of the path, instead of recursing
+        /// through CastRayColor. Every bounce past RouletteDepth is subject to Russian roulette.
+        Color3 TracePath(const Ray& ray, const Random& random) const
+        {
+            Color3 radiance{};
+            Color3 throughput{real{1.0}};
+            Ray currentRay = ray;
+            real scatterPdf{real{0.0}};
+
+            for (int depth = 1; depth <= MaximumDepth; depth++)
+            {
+                ScatterResult scatter = ScatterIntersection(currentRay, RootGeometry->IntersectEntrance(currentRay), depth, random, scatterPdf);
+                radiance += throughput * scatter.Emitted;
+
+                if (!scatter.Continues)
+                {
+                    break;
+                }
+
+                throughput *= scatter.Attenuation;
+                if (!ApplyRussianRoulette(throughput, depth, random))
+                {
+                    break;
+                }
+
+                currentRay = scatter.OutgoingRay;
+                scatterPdf = scatter.Pdf;
+            }
+
+            return radiance;
+        }
+
+        /// @brief Decides whether a path continues past depth. Past RouletteDepth a path survives with a probability equal
+        /// to its largest throughput component, survivors have their throughput divided by that probability so the
+        /// estimate stays unbiased.
+        /// @return False if the path should end.
+        bool ApplyRussianRoulette(Color3& throughput, int depth, const Random& random) const
+        {
+            if (depth <= RouletteDepth)
+            {
+                return true;
+            }
+
+            real survivalProbability = Math::min(real{1.0}, Math::max(throughput.R, Math::max(throughput.G, throughput.B)));
+            if (random.GetNormalized() >= survivalProbability)
+            {
+                return false;
+            }
+
+            throughput /= survivalProbability;
+            return true;
+        }
+
+        real CastRayDistance(const Ray& ray) const
+        {
             IntersectionResult intersection = RootGeometry->IntersectEntrance(ray);
+            return Math::max(real{0.0}, intersection.HitDistance);
+        }
+
+        bool IsOccluded(const Ray& ray, real maximumDistance) const
+        {
+            return RootGeometry->IntersectAny(ray, maximumDistance);
+        }
+
+        /// @brief Next event estimation: connects a hit to a point on a random area light with a shadow ray. The result
+        /// is weighed against BSDF sampling with the power heuristic, materials that call this must set
+        /// ScatterResult::Pdf so the emission their BSDF sampled rays find gets the complementary weight.
+        Color3 EstimateDirectLight(
+            const Material& material,
+            const Random& random,
+            const Vector3& hitPosition,
+            const Vector3& hitNormal,
+            const Vector3& incomingDirection) const
+        {
+            if (AreaLights.empty())
+            {
+                return Color3{};
+            }
+
+            assert(_areaLightTable.GetSize() == AreaLights.size());
+
+            if (DirectLightCandidates > 1)
+            {
+                return EstimateResampledDirectLight(material, random, hitPosition, hitNormal, incomingDirection);
+            }
+
+            LightCandidate candidate{};
+            if (!SampleLightCandidate(material, random, hitPosition, hitNormal, incomingDirection, candidate))
+            {
+                return Color3{};
+            }
+
+            if (AreaLights[candidate.AreaLightIndex]->IsInShadow(*this, hitPosition, hitNormal, candidate.PositionOnLight))
+            {
+                return Color3{};
+            }
+
+            real weight = PowerHeuristic(candidate.LightPdf, candidate.ScatteringPdf);
+            return candidate.Contribution * (weight / candidate.LightPdf);
+        }
+
+        /// @brief Next event estimation with resampled importance sampling. DirectLightCandidates light samples are
+        /// weighed by their unshadowed contribution and streamed through a reservoir, only the one that survives gets a
+        /// shadow ray. The result is not weighed against BSDF sampling, emission found by BSDF sampled rays is ignored
+        /// instead.
+        Color3 EstimateResampledDirectLight(
+            const Material& material,
+            const Random& random,
+            const Vector3& hitPosition,
+            const Vector3& hitNormal,
+            const Vector3& incomingDirection) const
+        {
+            Reservoir<LightCandidate> reservoir{};
+
+            for (int i = 0; i < DirectLightCandidates; i++)
+            {
+                // Candidates that cannot contribute still count towards the number of candidates.
+                LightCandidate candidate{};
+                bool isSampled = SampleLightCandidate(material, random, hitPosition, hitNormal, incomingDirection, candidate);
+
+                reservoir.Update(candidate, isSampled ? candidate.Contribution.Luminance() / candidate.LightPdf : real{0.0}, random);
+            }
+
+            if (!reservoir.HasSample())
+            {
+                return Color3{};
+            }
+
+            const LightCandidate& candidate = reservoir.GetSample();
+
+            if (AreaLights[candidate.AreaLightIndex]->IsInShadow(*this, hitPosition, hitNormal, candidate.PositionOnLight))
+            {
+                return Color3{};
+            }
+
+            // The survivor is weighed by the average candidate weight divided by its own target function.
+            real targetFunction = candidate.Contribution.Luminance();
+            return candidate.Contribution * (reservoir.GetWeightSum() / (static_cast<real>(reservoir.GetCount()) * targetFunction));
+        }
+
+        /// @brief Calculates the solid angle pdf with which EstimateDirectLight samples the direction from hitPosition to
+        /// positionOnLight, including the probability of picking the area light at areaLightIndex.
+        real CalculateAreaLightPdf(size_t areaLightIndex, const Vector3& hitPosition, const Vector3& positionOnLight) const
+        {
+            return GetAreaLightSelectionProbability(areaLightIndex, hitPosition) * AreaLights[areaLightIndex]->CalculateSolidAnglePdf(hitPosition, positionOnLight);
+        }
+
+        /// @brief Gets the material shading an intersection, nullptr for a miss.
+        const Material* GetIntersectionMaterial(const IntersectionResult& intersection) const
+        {
+            if (!intersection.HitGeometry)
+            {
+                return nullptr;
+            }
+
+            // TODO: The material override feels a bit hacky. It's used to support signed distance field ray marching results.
+            return intersection.MaterialOverride != nullptr ? intersection.MaterialOverride : intersection.HitGeometry->GetMaterial();
+        }
+
+        /// @brief Samples how the path of a ray continues from its intersection without tracing the outgoing ray. A miss
+        /// ends the path with the color of the miss shader.
+        /// @param scatterPdf The Pdf of the ScatterResult the ray came from, see ScatterResult::Pdf.
+        ScatterResult ScatterIntersection(const Ray& ray, const IntersectionResult& intersection, int depth, const Random& random, real scatterPdf = real{0.0}) const
+        {
+            const Material* material = GetIntersectionMaterial(intersection);
+
+            if (!material)
+            {
+                ScatterResult result{};
+                result.Emitted = _missShader->CalculateColor(ray, random);
+
+                return result;
+            }
+
+            auto [hitPosition, hitNormal] = CalculateHitPositionAndNormal(ray, intersection);
+
+            InstancedGeometry instancedGeometry{intersection.Instance, intersection.HitGeometry};
+
+            ScatterResult result = material->Scatter(
+                *this,
+                random,
+                depth,
+                GetMaterialHitGeometry(intersection, instancedGeometry),
+                hitPosition,
+                hitNormal,
+                ray.Direction,
+                intersection.AdditionalData);
+
+            result.Emitted += CalculateEmissionCorrection(ray, intersection, material, scatterPdf);
+            return result;
+        }
+
+    private:
+        /// @brief Picks an area light and a point on it and evaluates its unshadowed contribution.
+        /// @return False if the candidate cannot contribute.
+        bool SampleLightCandidate(
+            const Material& material,
+            const Random& random,
+            const Vector3& hitPosition,
+            const Vector3& hitNormal,
+            const Vector3& incomingDirection,
+            LightCandidate& candidate) const
+        {
+            if (!SelectAreaLight(random, hitPosition, candidate.AreaLightIndex))
+            {
+                return false;
+            }
+
+            const AreaLight* areaLight = AreaLights[candidate.AreaLightIndex];
+
+            candidate.PositionOnLight = areaLight->GetPointOnLight(random, hitPosition, hitNormal);
+            Vector3 directionToLight = (candidate.PositionOnLight - hitPosition).Normalize();
+
+            candidate.LightPdf = CalculateAreaLightPdf(candidate.AreaLightIndex, hitPosition, candidate.PositionOnLight);
+            if (!(candidate.LightPdf > real{0.0}) || !Math::isfinite(candidate.LightPdf))
+            {
+                return false;
+            }
+
+            Color3 scattering = material.EvaluateScattering(hitNormal, incomingDirection, directionToLight, candidate.ScatteringPdf);
+            candidate.Contribution = scattering * areaLight->GetMaterial()->GetEmissiveColor();
+
+            return candidate.Contribution.R > real{0.0} || candidate.Contribution.G > real{0.0} || candidate.Contribution.B > real{0.0};
+        }
+
+        /// @return False if no area light can light hitPosition.
+        bool SelectAreaLight(const Random& random, const Vector3& hitPosition, size_t& areaLightIndex) const
+        {
+            if (!UseLightHierarchy)
+            {
+                areaLightIndex = _areaLightTable.Sample(random);
+                return true;
+            }
+
+            real probability{};
+            return _areaLightHierarchy.Sample(random, hitPosition, areaLightIndex, probability);
+        }
+
+        /// @brief Gets the geometry a material is given for an intersection. Materials work in world space, so a geometry
+        /// hit inside of an instance is passed as instancedGeometry, which transforms the rays traced through it.
+        static const Geometry* GetMaterialHitGeometry(const IntersectionResult& intersection, const InstancedGeometry& instancedGeometry)
+        {
+            return intersection.Instance ? &instancedGeometry : intersection.HitGeometry;
+        }
+
+        std::pair<Vector3, Vector3> CalculateHitPositionAndNormal(const Ray& ray, const IntersectionResult& intersection) const
+        {
+            Vector3 hitPosition = ray.Position + intersection.HitDistance * ray.Direction;
+            Vector3 hitNormal = intersection.Instance
+                ? intersection.Instance->CalculateNormal(intersection.HitGeometry, ray, hitPosition, intersection.AdditionalData, intersection.PrimitiveIndex)
+                : intersection.HitGeometry->CalculateNormal(ray, hitPosition, intersection.AdditionalData, intersection.PrimitiveIndex);
+            hitPosition += hitNormal * NormalBump;
+
+            return {hitPosition, hitNormal};
+        }
+
+        /// @brief The emission a BSDF sampled ray finds on an area light was already partly accounted for by next event
+        /// estimation at the previous hit. Calculates what to add to the full emission so it gets its power heuristic
+        /// weight instead.
+        Color3 CalculateEmissionCorrection(const Ray& ray, const IntersectionResult& intersection, const Material* material, real scatterPdf) const
+        {
+            // Lights inside of instances are not registered as area lights.
+            if (!(scatterPdf > real{0.0}) || intersection.Instance)
+            {
+                return Color3{};
+            }
+
+            auto areaLightIndex = _areaLightIndices.find(intersection.HitGeometry);
+            if (areaLightIndex == _areaLightIndices.end())
+            {
+                return Color3{};
+            }
+
+            // Resampled next event estimation is not combined with BSDF sampling, it accounts for all of the emission.
+            if (DirectLightCandidates > 1)
+            {
+                return -material->GetEmissiveColor();
+            }
+
+            real lightPdf = CalculateAreaLightPdf(areaLightIndex->second, ray.Position, ray.Position + intersection.HitDistance * ray.Direction);
+            real weight = PowerHeuristic(scatterPdf, lightPdf);
+
+            return (weight - real{1.0}) * material->GetEmissiveColor();
+        }
+
+        Color3 ShadeIntersection(const Ray& ray, const IntersectionResult& intersection, int depth, const Random& random, real scatterPdf = real{0.0}) const
+        {
             Color3 outputColor{};
 
-            if (intersection.HitGeometry)
+            if (const Material* material = GetIntersectionMaterial(intersection))
             {
-                // TODO: The material override feels a bit hacky. It's used to support signed distance field ray marching results.
-                const Material* material = intersection.MaterialOverride != nullptr ? intersection.MaterialOverride : intersection.HitGeometry->GetMaterial();
+                auto [hitPosition, hitNormal] = CalculateHitPositionAndNormal(ray, intersection);
 
-                Vector3 hitPosition = ray.Position + intersection.HitDistance * ray.Direction;
-                Vector3 hitNormal = intersection.HitGeometry->CalculateNormal(ray, hitPosition, intersection.AdditionalData);
-                hitPosition += hitNormal * NormalBump;
+                InstancedGeometry instancedGeometry{intersection.Instance, intersection.HitGeometry};
 
                 outputColor = material->CalculateRenderingEquation(
                     *this,
                     random,
                     depth,
-                    intersection.HitGeometry,
+                    GetMaterialHitGeometry(intersection, instancedGeometry),
                     hitPosition,
                     hitNormal,
                     ray.Direction,
                     intersection.AdditionalData);
+
+                outputColor += CalculateEmissionCorrection(ray, intersection, material, scatterPdf);
             }
             else
             {
@@ -88,11 +484,5 @@ namespace Yart
 
             return outputColor;
         }
-
-        real CastRayDistance(const Ray& ray) const
-        {
-            IntersectionResult intersection = RootGeometry->IntersectEntrance(ray);
-            return Math::max(real{0.0}, intersection.HitDistance);
-        }
     };
 }
\ No newline at end of file
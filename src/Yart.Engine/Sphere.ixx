@@ -1,9 +1,12 @@
 export module Sphere;
 
+import <cstdint>;
+
 import "Common.h";
 
 import BoundingBox;
 import Geometry;
+import GeometryVisitor;
 import IntersectionResult;
 import IntersectionResultType;
 import Material;
@@ -42,11 +45,16 @@ namespace Yart
             return AppliedMaterial;
         }
 
-        virtual Vector3 CalculateNormal(const Ray& ray, const Vector3& hitPosition, real additionalData) const override
+        virtual Vector3 CalculateNormal(const Ray& ray, const Vector3& hitPosition, real additionalData, std::uint32_t primitiveIndex) const override
         {
             return (hitPosition - Position).Normalize();
         }
 
+        virtual void Accept(GeometryVisitor& visitor) const override
+        {
+            visitor.Visit(this);
+        }
+
         virtual IntersectionResult IntersectEntrance(const Ray& ray) const override
         {
             return {this, Intersect<IntersectionResultType::Entrance>(ray)};
@@ -1,7 +1,10 @@
 export module TransformedGeometry;
 
+import <cstdint>;
+
 import "Common.h";
 
+import BoundingBox;
 import Geometry;
 import IntersectionResult;
 import IntersectionResultType;
@@ -15,6 +18,7 @@ namespace Yart
 	{
 	protected:
 		const Geometry* ChildGeometry{nullptr};
+		Matrix4x4 Transform{};
 		Matrix4x4 InversedTransform{};
 		Matrix4x4 InverseTransposedTransform{};
 
@@ -22,6 +26,7 @@ namespace Yart
 		TransformedGeometry(const Geometry* childGeometry, const Matrix4x4& transform)
 			:
 			ChildGeometry{childGeometry},
+			Transform{transform},
 			InversedTransform{transform.InvertConst()},
 			InverseTransposedTransform{transform.InvertConst().TransposeConst()}
 		{
@@ -33,14 +38,19 @@ namespace Yart
 			return ChildGeometry->GetMaterial();
 		}
 
-        virtual Vector3 CalculateNormal(const Ray& ray, const Vector3& hitPosition, real additionalData) const override
+        virtual Vector3 CalculateNormal(const Ray& ray, const Vector3& hitPosition, real additionalData, std::uint32_t primitiveIndex) const override
 		{
-			Vector3 hitNormal = ChildGeometry->CalculateNormal(ray, hitPosition, additionalData);
+			Vector3 hitNormal = ChildGeometry->CalculateNormal(ray, hitPosition, additionalData, primitiveIndex);
 			Vector4 transformedHitNormal = Vector4{hitNormal, real{0.0}} *InverseTransposedTransform;
 
 			return Vector3{transformedHitNormal.X, transformedHitNormal.Y, transformedHitNormal.Z}.Normalize();
 		}
 
+        virtual BoundingBox CalculateBoundingBox() const override
+		{
+			return ChildGeometry->CalculateBoundingBox().Transform(Transform);
+		}
+
         virtual IntersectionResult IntersectEntrance(const Ray& ray) const override
 		{
 			return {this, Intersect<IntersectionResultType::Entrance>(ray)};
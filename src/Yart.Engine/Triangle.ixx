@@ -1,11 +1,13 @@
 export module Triangle;
 
+import <cstdint>;
 import <limits>;
 
 import "Common.h";
 
 import BoundingBox;
 import Geometry;
+import GeometryVisitor;
 import IntersectionResult;
 import IntersectionResultType;
 import Material;
@@ -14,6 +16,39 @@ import Ray;
 
 namespace Yart
 {
+    /// @brief Interpolates the vertex normals of a triangle at a position on it. The normal is flipped to face the ray.
+    export Vector3 InterpolateTriangleNormal(
+        const Ray& ray,
+        const Vector3& hitPosition,
+        const Vector3& vertex0,
+        const Vector3& vertex1,
+        const Vector3& vertex2,
+        const Vector3& normal0,
+        const Vector3& normal1,
+        const Vector3& normal2)
+    {
+        // Barycentric coordinate calculations from: https://gamedev.stackexchange.com/a/23745
+        Vector3 v0 = vertex1 - vertex0;
+        Vector3 v1 = vertex2 - vertex0;
+        Vector3 v2 = hitPosition - vertex0;
+
+        real d00 = v0 * v0;
+        real d01 = v0 * v1;
+        real d11 = v1 * v1;
+        real d20 = v2 * v0;
+        real d21 = v2 * v1;
+
+        real inverseDenom = Math::rcp(d00 * d11 - d01 * d01);
+
+        real v = (d11 * d20 - d01 * d21) * inverseDenom;
+        real w = (d00 * d21 - d01 * d20) * inverseDenom;
+        real u = real{1.0} - v - w;
+
+        Vector3 normal = (normal0 * u + normal1 * v + normal2 * w).Normalize();
+
+        return (ray.Direction * normal) < real{0.0} ? normal : -normal;
+    }
+
     export class alignas(32) Triangle : public Geometry
     {
     public:
@@ -79,28 +114,14 @@ namespace Yart
             return AppliedMaterial;
         }
 
-        virtual Vector3 CalculateNormal(const Ray& ray, const Vector3& hitPosition, real additionalData) const override
+        virtual Vector3 CalculateNormal(const Ray& ray, const Vector3& hitPosition, real additionalData, std::uint32_t primitiveIndex) const override
         {
-            // Barycentric coordinate calculations from: https://gamedev.stackexchange.com/a/23745
-            Vector3 v0 = Vertex1 - Vertex0;
-            Vector3 v1 = Vertex2 - Vertex0;
-            Vector3 v2 = hitPosition - Vertex0;
-
-            real d00 = v0 * v0;
-            real d01 = v0 * v1;
-            real d11 = v1 * v1;
-            real d20 = v2 * v0;
-            real d21 = v2 * v1;
-
-            real inverseDenom = Math::rcp(d00 * d11 - d01 * d01);
-
-            real v = (d11 * d20 - d01 * d21) * inverseDenom;
-            real w = (d00 * d21 - d01 * d20) * inverseDenom;
-            real u = real{1.0} - v - w;
-
-            Vector3 normal = (Normal0 * u + Normal1 * v + Normal2 * w).Normalize();
+            return InterpolateTriangleNormal(ray, hitPosition, Vertex0, Vertex1, Vertex2, Normal0, Normal1, Normal2);
+        }
 
-            return (ray.Direction * normal) < real{0.0} ? normal : -normal;
+        virtual void Accept(GeometryVisitor& visitor) const override
+        {
+            visitor.Visit(this);
         }
 
         virtual IntersectionResult IntersectEntrance(const Ray& ray) const override
@@ -11,6 +11,7 @@ import <limits>;
 import "Common.h";
 
 import BoundingBox;
+import Geometry;
 import GeometrySoa;
 import IntersectionResult;
 import IntersectionResultType;
@@ -22,31 +23,55 @@ using namespace vcl;
 
 namespace Yart
 {
-    export template<SoaSize Size>
-        class __declspec(dllexport) alignas(64) TriangleSoa : public GeometrySoa<Triangle>
+    export enum class TriangleIntersectionKernel
+    {
+        /// @brief Möller-Trumbore on the raw vertices with the edges recomputed for every ray and an approximate
+        /// reciprocal of the determinant. Rays parallel to a triangle are not rejected.
+        MollerTrumbore,
+
+        /// @brief Möller-Trumbore on vertex0 and the two edges leaving it, which are computed once when the triangle is
+        /// inserted. Uses an exact division and rejects rays parallel to the triangle.
+        PrecomputedEdges,
+
+        /// @brief The watertight test from "Watertight Ray/Triangle Intersection" by Woop, Benthin and Wald. Rays that hit
+        /// an edge or vertex shared by several triangles always hit at least one of them, so meshes have no cracks.
+        Watertight,
+    };
+
+    /// @brief The kernel used by the triangle SOA structures unless another one is asked for. Also the kernel of the
+    /// triangles stored in mesh caches, so cached meshes render the same as freshly built ones.
+    export constexpr TriangleIntersectionKernel DefaultTriangleIntersectionKernel = TriangleIntersectionKernel::PrecomputedEdges;
+
+    /// @brief The vertex data of up to Elements triangles laid out for the SIMD intersection kernels. Shared by the SOA
+    /// structures that differ only in how they refer back to the triangles they hold.
+    export template<SoaSize Size, TriangleIntersectionKernel Kernel>
+        class alignas(64) TriangleSoaVertices
     {
     public:
-        static constexpr size_t Elements = std::same_as<real, float> ? (Size == SoaSize::_256 ? 8 : 4) : (Size == SoaSize::_256 ? 4 : 2);
+        static constexpr size_t Elements = SoaElements<Size>;
 
     private:
-        using VclVec = std::conditional_t<std::same_as<real, float>, std::conditional_t<Size == SoaSize::_256, Vec8f, Vec4f>, std::conditional_t<Size == SoaSize::_256, Vec4d, Vec2d>>;
+        using VclVec = SoaVector<Size>;
+
+        static constexpr bool StoresEdges = Kernel == TriangleIntersectionKernel::PrecomputedEdges;
 
         alignas(Elements * sizeof(real)) real _vertex0X[Elements];
         alignas(Elements * sizeof(real)) real _vertex0Y[Elements];
         alignas(Elements * sizeof(real)) real _vertex0Z[Elements];
 
-        alignas(Elements * sizeof(real)) real _vertex1X[Elements];
-        alignas(Elements * sizeof(real)) real _vertex1Y[Elements];
-        alignas(Elements * sizeof(real)) real _vertex1Z[Elements];
-
-        alignas(Elements * sizeof(real)) real _vertex2X[Elements];
-        alignas(Elements * sizeof(real)) real _vertex2Y[Elements];
-        alignas(Elements * sizeof(real)) real _vertex2Z[Elements];
+        // The precomputed edge kernel stores the edges leaving vertex0 in place of the other two vertices. The watertight
+        // kernel needs the vertices themselves, edges rebuilt from them would round differently for every triangle that
+        // shares them.
+        union { alignas(Elements * sizeof(real)) real _vertex1X[Elements]; real _edge1X[Elements]; };
+        union { alignas(Elements * sizeof(real)) real _vertex1Y[Elements]; real _edge1Y[Elements]; };
+        union { alignas(Elements * sizeof(real)) real _vertex1Z[Elements]; real _edge1Z[Elements]; };
 
-        const Triangle* _geometries[Elements];
+        union { alignas(Elements * sizeof(real)) real _vertex2X[Elements]; real _edge2X[Elements]; };
+        union { alignas(Elements * sizeof(real)) real _vertex2Y[Elements]; real _edge2Y[Elements]; };
+        union { alignas(Elements * sizeof(real)) real _vertex2Z[Elements]; real _edge2Z[Elements]; };
 
     public:
-        TriangleSoa()
+        TriangleSoaVertices()
         {
             for (int i = 0; i < Elements; i++)
             {
@@ -61,7 +86,261 @@ namespace Yart
                 _vertex2X[i] = std::numeric_limits<real>::infinity();
                 _vertex2Y[i] = std::numeric_limits<real>::infinity();
                 _vertex2Z[i] = std::numeric_limits<real>::infinity();
+            }
+        }
+
+        void Set(size_t index, const Vector3& vertex0, const Vector3& vertex1, const Vector3& vertex2)
+        {
+            assert(index >= 0 && index < Elements);
+
+            _vertex0X[index] = vertex0.X;
+            _vertex0Y[index] = vertex0.Y;
+            _vertex0Z[index] = vertex0.Z;
+
+            if constexpr (StoresEdges)
+            {
+                Vector3 edge1 = vertex1 - vertex0;
+                Vector3 edge2 = vertex2 - vertex0;
+
+                _edge1X[index] = edge1.X;
+                _edge1Y[index] = edge1.Y;
+                _edge1Z[index] = edge1.Z;
+
+                _edge2X[index] = edge2.X;
+                _edge2Y[index] = edge2.Y;
+                _edge2Z[index] = edge2.Z;
+            }
+            else
+            {
+                _vertex1X[index] = vertex1.X;
+                _vertex1Y[index] = vertex1.Y;
+                _vertex1Z[index] = vertex1.Z;
+
+                _vertex2X[index] = vertex2.X;
+                _vertex2Y[index] = vertex2.Y;
+                _vertex2Z[index] = vertex2.Z;
+            }
+        }
+
+        /// @brief Finds the closest triangle hit by the ray.
+        /// @return The distance to the closest hit, or infinity, and the index of the triangle that was hit or -1.
+        force_inline std::tuple<real, int> Intersect(const Ray& ray) const
+        {
+            VclVec entranceDistance;
+
+            if constexpr (Kernel == TriangleIntersectionKernel::MollerTrumbore)
+            {
+                entranceDistance = IntersectMollerTrumbore(ray);
+            }
+            else if constexpr (Kernel == TriangleIntersectionKernel::PrecomputedEdges)
+            {
+                entranceDistance = IntersectPrecomputedEdges(ray);
+            }
+            else
+            {
+                entranceDistance = IntersectWatertight(ray);
+            }
+
+            real minimumEntranceDistance = horizontal_min1(entranceDistance);
+            int minimumIndex = horizontal_find_first(VclVec{minimumEntranceDistance} == entranceDistance);
+
+            return {minimumEntranceDistance, minimumIndex};
+        }
+
+    private:
+        force_inline VclVec IntersectMollerTrumbore(const Ray& ray) const
+        {
+            VectorVec3<VclVec> vertex0{_vertex0X, _vertex0Y, _vertex0Z};
+            VectorVec3<VclVec> vertex1{_vertex1X, _vertex1Y, _vertex1Z};
+            VectorVec3<VclVec> vertex2{_vertex2X, _vertex2Y, _vertex2Z};
+
+            VectorVec3<VclVec> edge1 = vertex1 - vertex0;
+            VectorVec3<VclVec> edge2 = vertex2 - vertex0;
+
+            VectorVec3<VclVec> rayDirection{ray.Direction};
+            VectorVec3<VclVec> rayPosition{ray.Position};
+
+            VectorVec3<VclVec> h = rayDirection % edge2;
+            VclVec a = VectorVec3<VclVec>::Dot(edge1, h);
+
+            // Normally you would check for a parallel ray here but we'll skip that check.
+
+            VclVec f = approx_recipr(a);
+
+            VectorVec3<VclVec> s = rayPosition - vertex0;
+
+            VclVec u = f * VectorVec3<VclVec>::Dot(s, h);
+            VectorVec3<VclVec> q = s % edge1;
+            VclVec v = f * VectorVec3<VclVec>::Dot(rayDirection, q);
+
+            VclVec entranceDistance = f * VectorVec3<VclVec>::Dot(edge2, q);
+
+            // Make sure infinity is second so nans are replaced with inf.
+            return select(
+                u >= VclVec{0.0f} && u <= VclVec{1.0f} && v >= VclVec{0.0f} && u + v <= VclVec{1.0f} && entranceDistance >= VclVec{0.0f},
+                entranceDistance,
+                VclVec{std::numeric_limits<real>::infinity()});
+        }
+
+        force_inline VclVec IntersectPrecomputedEdges(const Ray& ray) const
+        {
+            VectorVec3<VclVec> vertex0{_vertex0X, _vertex0Y, _vertex0Z};
+            VectorVec3<VclVec> edge1{_edge1X, _edge1Y, _edge1Z};
+            VectorVec3<VclVec> edge2{_edge2X, _edge2Y, _edge2Z};
+
+            VectorVec3<VclVec> rayDirection{ray.Direction};
+            VectorVec3<VclVec> rayPosition{ray.Position};
+
+            VectorVec3<VclVec> h = rayDirection % edge2;
+            VclVec a = VectorVec3<VclVec>::Dot(edge1, h);
+
+            // a is zero when the ray is parallel to the triangle. The division then makes u, v and the distance infinite,
+            // or nan where 0 * inf occurs, which already fails the range checks below; a != 0 rejects those lanes
+            // explicitly instead of relying on that.
+            VclVec f = VclVec{1.0f} / a;
+
+            VectorVec3<VclVec> s = rayPosition - vertex0;
+
+            VclVec u = f * VectorVec3<VclVec>::Dot(s, h);
+            VectorVec3<VclVec> q = s % edge1;
+            VclVec v = f * VectorVec3<VclVec>::Dot(rayDirection, q);
+
+            VclVec entranceDistance = f * VectorVec3<VclVec>::Dot(edge2, q);
+
+            return select(
+                a != VclVec{0.0f} && u >= VclVec{0.0f} && v >= VclVec{0.0f} && u + v <= VclVec{1.0f} && entranceDistance >= VclVec{0.0f},
+                entranceDistance,
+                VclVec{std::numeric_limits<real>::infinity()});
+        }
+
+        force_inline VclVec IntersectWatertight(const Ray& ray) const
+        {
+            // Permute the axes so the largest component of the direction becomes z and shear the triangle so the ray
+            // points straight along it. The hit test then reduces to 2D edge functions around the origin.
+            Vector3 absoluteDirection = Vector3{ray.Direction}.Abs();
+
+            size_t kz = absoluteDirection.X > absoluteDirection.Y
+                ? (absoluteDirection.X > absoluteDirection.Z ? 0 : 2)
+                : (absoluteDirection.Y > absoluteDirection.Z ? 1 : 2);
 
+            size_t kx = kz == 2 ? 0 : kz + 1;
+            size_t ky = kx == 2 ? 0 : kx + 1;
+
+            // Keep the winding of the triangle the same after the permutation.
+            if (ray.Direction[kz] < real{0})
+            {
+                std::swap(kx, ky);
+            }
+
+            real shearX = ray.Direction[kx] / ray.Direction[kz];
+            real shearY = ray.Direction[ky] / ray.Direction[kz];
+            real shearZ = real{1} / ray.Direction[kz];
+
+            const real* vertex0[3]{_vertex0X, _vertex0Y, _vertex0Z};
+            const real* vertex1[3]{_vertex1X, _vertex1Y, _vertex1Z};
+            const real* vertex2[3]{_vertex2X, _vertex2Y, _vertex2Z};
+
+            VclVec ax = VclVec{}.load_a(vertex0[kx]) - VclVec{ray.Position[kx]};
+            VclVec ay = VclVec{}.load_a(vertex0[ky]) - VclVec{ray.Position[ky]};
+            VclVec az = VclVec{}.load_a(vertex0[kz]) - VclVec{ray.Position[kz]};
+
+            VclVec bx = VclVec{}.load_a(vertex1[kx]) - VclVec{ray.Position[kx]};
+            VclVec by = VclVec{}.load_a(vertex1[ky]) - VclVec{ray.Position[ky]};
+            VclVec bz = VclVec{}.load_a(vertex1[kz]) - VclVec{ray.Position[kz]};
+
+            VclVec cx = VclVec{}.load_a(vertex2[kx]) - VclVec{ray.Position[kx]};
+            VclVec cy = VclVec{}.load_a(vertex2[ky]) - VclVec{ray.Position[ky]};
+            VclVec cz = VclVec{}.load_a(vertex2[kz]) - VclVec{ray.Position[kz]};
+
+            ax -= VclVec{shearX} * az;
+            ay -= VclVec{shearY} * az;
+            bx -= VclVec{shearX} * bz;
+            by -= VclVec{shearY} * bz;
+            cx -= VclVec{shearX} * cz;
+            cy -= VclVec{shearY} * cz;
+
+            VclVec u = cx * by - cy * bx;
+            VclVec v = ax * cy - ay * cx;
+            VclVec w = bx * ay - by * ax;
+
+            // An edge function of exactly zero is where single precision can disagree between neighboring triangles, so
+            // those lanes are recomputed in double precision.
+            if constexpr (std::same_as<real, float>)
+            {
+                auto zero = u == VclVec{0.0f} | v == VclVec{0.0f} | w == VclVec{0.0f};
+                if (horizontal_or(zero))
+                {
+                    RecomputeEdgeFunctions(zero, ax, ay, bx, by, cx, cy, u, v, w);
+                }
+            }
+
+            VclVec zeroVector{0.0f};
+            auto outside = (u < zeroVector | v < zeroVector | w < zeroVector) & (u > zeroVector | v > zeroVector | w > zeroVector);
+
+            VclVec determinant = u + v + w;
+            VclVec scaledDistance = u * (VclVec{shearZ} * az) + v * (VclVec{shearZ} * bz) + w * (VclVec{shearZ} * cz);
+
+            VclVec entranceDistance = scaledDistance / determinant;
+
+            return select(
+                !outside && determinant != zeroVector && entranceDistance >= zeroVector,
+                entranceDistance,
+                VclVec{std::numeric_limits<real>::infinity()});
+        }
+
+        template <typename TMask>
+        static void RecomputeEdgeFunctions(
+            const TMask& lanes,
+            const VclVec& ax, const VclVec& ay,
+            const VclVec& bx, const VclVec& by,
+            const VclVec& cx, const VclVec& cy,
+            VclVec& u, VclVec& v, VclVec& w)
+        {
+            alignas(64) real values[9][Elements];
+
+            ax.store_a(values[0]);
+            ay.store_a(values[1]);
+            bx.store_a(values[2]);
+            by.store_a(values[3]);
+            cx.store_a(values[4]);
+            cy.store_a(values[5]);
+            u.store_a(values[6]);
+            v.store_a(values[7]);
+            w.store_a(values[8]);
+
+            for (int i = 0; i < static_cast<int>(Elements); i++)
+            {
+                if (!lanes[i])
+                {
+                    continue;
+                }
+
+                values[6][i] = static_cast<real>(static_cast<double>(values[4][i]) * values[3][i] - static_cast<double>(values[5][i]) * values[2][i]);
+                values[7][i] = static_cast<real>(static_cast<double>(values[0][i]) * values[5][i] - static_cast<double>(values[1][i]) * values[4][i]);
+                values[8][i] = static_cast<real>(static_cast<double>(values[2][i]) * values[1][i] - static_cast<double>(values[3][i]) * values[0][i]);
+            }
+
+            u.load_a(values[6]);
+            v.load_a(values[7]);
+            w.load_a(values[8]);
+        }
+    };
+
+    export template<SoaSize Size, TriangleIntersectionKernel Kernel = DefaultTriangleIntersectionKernel>
+        class __declspec(dllexport) alignas(64) TriangleSoa : public GeometrySoa<Triangle>
+    {
+    public:
+        static constexpr size_t Elements = TriangleSoaVertices<Size, Kernel>::Elements;
+
+    private:
+        TriangleSoaVertices<Size, Kernel> _vertices{};
+        const Triangle* _geometries[Elements];
+
+    public:
+        TriangleSoa()
+        {
+            for (int i = 0; i < Elements; i++)
+            {
                 _geometries[i] = nullptr;
             }
         }
@@ -86,19 +365,36 @@ namespace Yart
         {
             assert(index >= 0 && index < Elements);
 
-            _vertex0X[index] = geometry->Vertex0.X;
-            _vertex0Y[index] = geometry->Vertex0.Y;
-            _vertex0Z[index] = geometry->Vertex0.Z;
+            _vertices.Set(index, geometry->Vertex0, geometry->Vertex1, geometry->Vertex2);
+            _geometries[index] = geometry;
+        }
 
-            _vertex1X[index] = geometry->Vertex1.X;
-            _vertex1Y[index] = geometry->Vertex1.Y;
-            _vertex1Z[index] = geometry->Vertex1.Z;
+        virtual size_t GetCapacity() const override
+        {
+            return Elements;
+        }
+
+        virtual const Geometry* GetGeometry(size_t index) const override
+        {
+            assert(index >= 0 && index < Elements);
 
-            _vertex2X[index] = geometry->Vertex2.X;
-            _vertex2Y[index] = geometry->Vertex2.Y;
-            _vertex2Z[index] = geometry->Vertex2.Z;
+            return _geometries[index];
+        }
 
-            _geometries[index] = geometry;
+        virtual size_t CalculateMemoryUsage() const override
+        {
+            return sizeof(*this);
+        }
+
+        virtual void Refit() override
+        {
+            for (size_t i = 0; i < Elements; i++)
+            {
+                if (_geometries[i])
+                {
+                    Insert(i, _geometries[i]);
+                }
+            }
         }
 
         virtual BoundingBox CalculateBoundingBox() const override
@@ -123,6 +419,11 @@ namespace Yart
             return Intersect(ray);
         }
 
+        virtual bool IntersectAny(const Ray& ray, real maximumDistance) const override
+        {
+            return Intersect(ray).HitDistance < maximumDistance;
+        }
+
         virtual IntersectionResult IntersectExit(const Ray& ray) const override
         {
             return Intersect(ray);
@@ -131,39 +432,7 @@ namespace Yart
     private:
         force_inline IntersectionResult Intersect(const Ray& ray) const
         {
-            VectorVec3<VclVec> vertex0{_vertex0X, _vertex0Y, _vertex0Z};
-            VectorVec3<VclVec> vertex1{_vertex1X, _vertex1Y, _vertex1Z};
-            VectorVec3<VclVec> vertex2{_vertex2X, _vertex2Y, _vertex2Z};
-
-            VectorVec3<VclVec> edge1 = vertex1 - vertex0;
-            VectorVec3<VclVec> edge2 = vertex2 - vertex0;
-
-            VectorVec3<VclVec> rayDirection{ray.Direction};
-            VectorVec3<VclVec> rayPosition{ray.Position};
-
-            VectorVec3<VclVec> h = rayDirection % edge2;
-            VclVec a = VectorVec3<VclVec>::Dot(edge1, h);
-
-            // Normally you would check for a parallel ray here but we'll skip that check.
-
-            VclVec f = approx_recipr(a);
-
-            VectorVec3<VclVec> s = rayPosition - vertex0;
-
-            VclVec u = f * VectorVec3<VclVec>::Dot(s, h);
-            VectorVec3<VclVec> q = s % edge1;
-            VclVec v = f * VectorVec3<VclVec>::Dot(rayDirection, q);
-
-            VclVec entranceDistance = f * VectorVec3<VclVec>::Dot(edge2, q);
-
-            // Make sure infinity is second so nans are replaced with inf.
-            VclVec clampedEntranceDistance = select(
-                u >= VclVec{0.0f} && u <= VclVec{1.0f} && v >= VclVec{0.0f} && u + v <= VclVec{1.0f} && entranceDistance >= VclVec{0.0f},
-                entranceDistance,
-                VclVec{std::numeric_limits<real>::infinity()});
-
-            real minimumEntranceDistance = horizontal_min1(clampedEntranceDistance);
-            int minimumIndex = horizontal_find_first(VclVec{minimumEntranceDistance} == clampedEntranceDistance);
+            auto [minimumEntranceDistance, minimumIndex] = _vertices.Intersect(ray);
 
             return {
                 _geometries[minimumIndex == -1 ? 0 : minimumIndex],
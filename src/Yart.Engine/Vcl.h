@@ -3,7 +3,7 @@
 #include <concepts>
 
 #define VCL_NAMESPACE vcl
-#define MAX_VECTOR_SIZE 256
+#define MAX_VECTOR_SIZE 512
 
 #include "vectorclass.h"
 #include "vectormath_exp.h"
@@ -21,6 +21,11 @@ namespace vcl
         return Vec4d{1.0} / a;
     }
 
+    static inline Vec8d approx_recipr(Vec8d const a)
+    {
+        return Vec8d{1.0} / a;
+    }
+
     static inline Vec2d approx_rsqrt(Vec2d const a)
     {
         return Vec2d{1.0} / sqrt(a);
@@ -33,7 +38,7 @@ namespace vcl
 }
 
 template <typename T>
-concept vec_type = std::same_as<vcl::Vec4f, T> || std::same_as<vcl::Vec8f, T> || std::same_as<vcl::Vec2d, T> || std::same_as<vcl::Vec4d, T>;
+concept vec_type = std::same_as<vcl::Vec4f, T> || std::same_as<vcl::Vec8f, T> || std::same_as<vcl::Vec16f, T> || std::same_as<vcl::Vec2d, T> || std::same_as<vcl::Vec4d, T> || std::same_as<vcl::Vec8d, T>;
 
 #ifdef USE_DOUBLE
 using real_vec = vcl::Vec4d;
@@ -0,0 +1,295 @@
+export module WavefrontIntegrator;
+
+import <algorithm>;
+import <cstdint>;
+import <functional>;
+import <span>;
+import <vector>;
+
+import "Common.h";
+
+import Camera;
+import GeometryDecl;
+import IntersectableGeometry;
+import IntersectionResult;
+import Material;
+import Math;
+import Random;
+import Ray;
+import Scene;
+
+namespace Yart
+{
+    /// @brief The rays of one bounce of a batch of paths, stored as structure of arrays.
+    class WavefrontRayQueue
+    {
+    public:
+        std::vector<real> PositionX{};
+        std::vector<real> PositionY{};
+        std::vector<real> PositionZ{};
+
+        std::vector<real> DirectionX{};
+        std::vector<real> DirectionY{};
+        std::vector<real> DirectionZ{};
+
+        /// @brief The product of the attenuations along the path so far.
+        std::vector<real> ThroughputR{};
+        std::vector<real> ThroughputG{};
+        std::vector<real> ThroughputB{};
+
+        /// @brief The pdf of the ScatterResult each ray came from, see ScatterResult::Pdf.
+        std::vector<real> ScatterPdf{};
+
+        /// @brief The path each ray belongs to.
+        std::vector<std::uint32_t> Path{};
+
+        size_t GetSize() const
+        {
+            return Path.size();
+        }
+
+        void Clear()
+        {
+            PositionX.clear();
+            PositionY.clear();
+            PositionZ.clear();
+
+            DirectionX.clear();
+            DirectionY.clear();
+            DirectionZ.clear();
+
+            ThroughputR.clear();
+            ThroughputG.clear();
+            ThroughputB.clear();
+
+            ScatterPdf.clear();
+            Path.clear();
+        }
+
+        void Push(const Ray& ray, const Color3& throughput, real scatterPdf, std::uint32_t path)
+        {
+            PositionX.push_back(ray.Position.X);
+            PositionY.push_back(ray.Position.Y);
+            PositionZ.push_back(ray.Position.Z);
+
+            DirectionX.push_back(ray.Direction.X);
+            DirectionY.push_back(ray.Direction.Y);
+            DirectionZ.push_back(ray.Direction.Z);
+
+            ThroughputR.push_back(throughput.R);
+            ThroughputG.push_back(throughput.G);
+            ThroughputB.push_back(throughput.B);
+
+            ScatterPdf.push_back(scatterPdf);
+            Path.push_back(path);
+        }
+
+        Ray GetRay(size_t index) const
+        {
+            return Ray{
+                Vector3{PositionX[index], PositionY[index], PositionZ[index]},
+                Vector3{DirectionX[index], DirectionY[index], DirectionZ[index]},
+            };
+        }
+
+        Color3 GetThroughput(size_t index) const
+        {
+            return Color3{ThroughputR[index], ThroughputG[index], ThroughputB[index]};
+        }
+    };
+
+    /// @brief The closest hits of a WavefrontRayQueue, stored as structure of arrays. Misses have a null HitMaterial.
+    class WavefrontHitBuffer
+    {
+    public:
+        std::vector<const Geometry*> HitGeometry{};
+        std::vector<real> HitDistance{};
+        std::vector<real> AdditionalData{};
+        std::vector<std::uint32_t> PrimitiveIndex{};
+        std::vector<const Material*> MaterialOverride{};
+        std::vector<const GeometryInstance*> Instance{};
+
+        std::vector<const Material*> HitMaterial{};
+
+        void Resize(size_t size)
+        {
+            HitGeometry.resize(size);
+            HitDistance.resize(size);
+            AdditionalData.resize(size);
+            PrimitiveIndex.resize(size);
+            MaterialOverride.resize(size);
+            Instance.resize(size);
+
+            HitMaterial.resize(size);
+        }
+
+        void Set(size_t index, const IntersectionResult& intersection, const Material* material)
+        {
+            HitGeometry[index] = intersection.HitGeometry;
+            HitDistance[index] = intersection.HitDistance;
+            AdditionalData[index] = intersection.AdditionalData;
+            PrimitiveIndex[index] = intersection.PrimitiveIndex;
+            MaterialOverride[index] = intersection.MaterialOverride;
+            Instance[index] = intersection.Instance;
+
+            HitMaterial[index] = material;
+        }
+
+        IntersectionResult Get(size_t index) const
+        {
+            IntersectionResult intersection{HitGeometry[index], HitDistance[index], AdditionalData[index], MaterialOverride[index]};
+            intersection.PrimitiveIndex = PrimitiveIndex[index];
+            intersection.Instance = Instance[index];
+
+            return intersection;
+        }
+    };
+
+    /// @brief Traces batches of paths one bounce at a time instead of one path at a time. Every bounce runs in stages,
+    /// each a loop over the whole batch: intersect all rays, sort the hits by material, shade them and queue the rays of
+    /// the next bounce. Shading hits of the same material back to back keeps its code and data hot.
+    ///
+    /// Materials take part through Material::Scatter. Materials that do not override it are evaluated recursively with
+    /// CalculateRenderingEquation and end their path in the wavefront.
+    export class WavefrontIntegrator
+    {
+    public:
+        /// @brief The number of paths a batch should not exceed, bounds the memory used by the queues.
+        static constexpr size_t MaximumBatchSize = 1 << 16;
+
+    private:
+        const Scene* _scene{};
+
+        WavefrontRayQueue _currentQueue{};
+        WavefrontRayQueue _nextQueue{};
+        WavefrontHitBuffer _hits{};
+        std::vector<std::uint32_t> _shadingOrder{};
+
+        /// @brief The pixel of every path, as an index into the pixels passed to Generate.
+        std::vector<std::uint32_t> _pathPixels{};
+        std::vector<Color3> _pathRadiances{};
+
+    public:
+        explicit WavefrontIntegrator(const Scene* scene)
+            : _scene{scene}
+        {
+
+        }
+
+        /// @brief Starts a new batch with a path for every subpixel of pixels. The pixels do not have to be contiguous, which
+        /// lets adaptive sampling trace only the pixels that have not converged.
+        void Generate(const Camera& camera, std::span<const UIntVector2> pixels, const Random& random)
+        {
+            _currentQueue.Clear();
+            _pathPixels.clear();
+            _pathRadiances.clear();
+
+            for (size_t pixelIndex = 0; pixelIndex < pixels.size(); pixelIndex++)
+            {
+                UIntVector2 pixel = pixels[pixelIndex];
+
+                for (unsigned int subpixelY = 0; subpixelY < camera.SubpixelCount; subpixelY++)
+                {
+                    for (unsigned int subpixelX = 0; subpixelX < camera.SubpixelCount; subpixelX++)
+                    {
+                        std::uint32_t path = static_cast<std::uint32_t>(_pathPixels.size());
+
+                        _pathPixels.push_back(static_cast<std::uint32_t>(pixelIndex));
+                        _pathRadiances.push_back(Color3{});
+
+                        _currentQueue.Push(camera.CreateRay(pixel, {subpixelX, subpixelY}, random), Color3{real{1.0}}, real{0.0}, path);
+                    }
+                }
+            }
+        }
+
+        /// @brief Traces the paths of the batch until all of them have ended, reached Scene::MaximumDepth or were cut by
+        /// Russian roulette.
+        void Trace(const Random& random)
+        {
+            for (int depth = 1; depth <= _scene->MaximumDepth && _currentQueue.GetSize() > 0; depth++)
+            {
+                Intersect();
+                SortByMaterial();
+                Shade(depth, random);
+
+                std::swap(_currentQueue, _nextQueue);
+            }
+
+            _currentQueue.Clear();
+        }
+
+        size_t GetPathCount() const
+        {
+            return _pathPixels.size();
+        }
+
+        /// @brief Gets the index of the path's pixel in the pixels passed to Generate.
+        size_t GetPathPixelIndex(size_t path) const
+        {
+            return _pathPixels[path];
+        }
+
+        const Color3& GetPathRadiance(size_t path) const
+        {
+            return _pathRadiances[path];
+        }
+
+    private:
+        void Intersect()
+        {
+            size_t size = _currentQueue.GetSize();
+            _hits.Resize(size);
+
+            for (size_t i = 0; i < size; i++)
+            {
+                IntersectionResult intersection = _scene->RootGeometry->IntersectEntrance(_currentQueue.GetRay(i));
+                _hits.Set(i, intersection, _scene->GetIntersectionMaterial(intersection));
+            }
+        }
+
+        void SortByMaterial()
+        {
+            size_t size = _currentQueue.GetSize();
+
+            _shadingOrder.resize(size);
+            for (size_t i = 0; i < size; i++)
+            {
+                _shadingOrder[i] = static_cast<std::uint32_t>(i);
+            }
+
+            // Misses sort first with their null material, they are all shaded by the miss shader.
+            std::sort(_shadingOrder.begin(), _shadingOrder.end(), [this](std::uint32_t left, std::uint32_t right)
+            {
+                return std::less<const Material*>{}(_hits.HitMaterial[left], _hits.HitMaterial[right]);
+            });
+        }
+
+        void Shade(int depth, const Random& random)
+        {
+            _nextQueue.Clear();
+
+            for (std::uint32_t i : _shadingOrder)
+            {
+                Ray ray = _currentQueue.GetRay(i);
+                Color3 throughput = _currentQueue.GetThroughput(i);
+                std::uint32_t path = _currentQueue.Path[i];
+
+                ScatterResult scatter = _scene->ScatterIntersection(ray, _hits.Get(i), depth, random, _currentQueue.ScatterPdf[i]);
+                _pathRadiances[path] += throughput * scatter.Emitted;
+
+                if (!scatter.Continues)
+                {
+                    continue;
+                }
+
+                // Rays past the maximum depth would not be shaded, there is no point in tracing them.
+                Color3 nextThroughput = throughput * scatter.Attenuation;
+                if (depth < _scene->MaximumDepth && _scene->ApplyRussianRoulette(nextThroughput, depth, random))
+                {
+                    _nextQueue.Push(scatter.OutgoingRay, nextThroughput, scatter.Pdf, path);
+                }
+            }
+        }
+    };
+}
\ No newline at end of file
@@ -18,13 +18,64 @@ namespace Yart::Yaml
 	public:
 		unsigned int Iterations{};
         Vector2 ColorClamp{};
+
+        /// @brief Whether the primary rays of a pixel are traced as packets, see Scene::CastRayPacketColor.
+        bool PacketTracing{};
+
+        /// @brief Whether the paths are traced in batches by the WavefrontIntegrator. Takes precedence over PacketTracing.
+        bool WavefrontTracing{};
+
+        /// @brief Whether the paths are traced in a loop by Scene::TracePath instead of recursively. Has no effect with
+        /// PacketTracing, the wavefront integrator always traces in a loop.
+        bool IterativeTracing{};
+
+        /// @brief The deepest bounce that is still shaded, see Scene::MaximumDepth.
+        int MaximumDepth{};
+
+        /// @brief The depth past which paths are subject to Russian roulette, see Scene::RouletteDepth.
+        int RouletteDepth{};
+
+        /// @brief Whether area lights are picked with a light hierarchy instead of by their power alone, see
+        /// Scene::UseLightHierarchy.
+        bool LightHierarchy{};
+
+        /// @brief The number of light candidates resampled for every shadow ray, see Scene::DirectLightCandidates.
+        int DirectLightCandidates{};
+
+        /// @brief Whether pixels stop receiving samples once their estimate has converged, which frees their share of the
+        /// Iterations for the pixels that are still noisy.
+        bool AdaptiveSampling{};
+
+        /// @brief The standard error of a pixel's mean luminance, relative to the mean, below which the pixel counts as
+        /// converged.
+        real AdaptiveErrorThreshold{};
+
+        /// @brief The number of iterations every pixel receives before it may count as converged.
+        unsigned int MinimumIterations{};
+
+        /// @brief The number of iterations a noisy pixel may receive at most with adaptive sampling. Defaults to four times
+        /// Iterations, values below Iterations are raised to it.
+        unsigned int MaximumIterations{};
 	};
 
     export std::shared_ptr<Config> ParseConfigNode(const Node& node)
     {
+        unsigned int iterations = node["iterations"].as<unsigned int>();
+
         auto config = std::shared_ptr<Config>{new Config{
-            .Iterations = node["iterations"].as<unsigned int>(),
+            .Iterations = iterations,
             .ColorClamp = ParseVector2(node["colorClamp"]),
+            .PacketTracing = node["packetTracing"].as<bool>(false),
+            .WavefrontTracing = node["wavefrontTracing"].as<bool>(false),
+            .IterativeTracing = node["iterativeTracing"].as<bool>(false),
+            .MaximumDepth = node["maximumDepth"].as<int>(7),
+            .RouletteDepth = node["rouletteDepth"].as<int>(3),
+            .LightHierarchy = node["lightHierarchy"].as<bool>(false),
+            .DirectLightCandidates = node["directLightCandidates"].as<int>(1),
+            .AdaptiveSampling = node["adaptiveSampling"].as<bool>(false),
+            .AdaptiveErrorThreshold = node["adaptiveErrorThreshold"].as<real>(real{0.01}),
+            .MinimumIterations = node["minimumIterations"].as<unsigned int>(2),
+            .MaximumIterations = node["maximumIterations"].as<unsigned int>(iterations * 4),
         }};
 
         return config;
@@ -11,7 +11,9 @@ module;
 
 export module YamlLoader:Geometry;
 
+import <cstdint>;
 import <functional>;
+import <unordered_map>;
 
 import "Common.h";
 
@@ -24,17 +26,23 @@ import AxisAlignedBoxSoa;
 import BoundingBoxHierarchy;
 import BoundingGeometry;
 import Disc;
+import DynamicMesh;
 import GeometryCollection;
+import GeometryInstance;
 import GeometrySoa;
 import GeometrySoaUtilities;
+import IndexedTriangleMesh;
 import IntersectableGeometry;
+import LinearBoundingBoxHierarchy;
 import Material;
 import Math;
+import MeshCache;
 import MixedMaterial;
 import Parallelogram;
 import ParallelogramSoa;
 import Plane;
 import PlaneSoa;
+import QuantizedBoundingBoxHierarchy;
 import RayMarcher;
 import SignedDistance;
 import SignedDistanceBinaryOperation;
@@ -54,12 +62,18 @@ namespace Yart::Yaml
     export class ParseGeometryResults
     {
     public:
-        std::vector<std::shared_ptr<const IntersectableGeometry>> Geometries{};
+        std::vector<std::shared_ptr<IntersectableGeometry>> Geometries{};
         std::vector<const AreaLight*> AreaLights{};
 
         std::vector<std::shared_ptr<const SignedDistance>> SignedDistances{};
         std::vector<std::shared_ptr<const Material>> AdditionalMaterials{};
 
+        std::vector<BoundingBoxHierarchyReport> HierarchyReports{};
+        std::vector<std::shared_ptr<DynamicMesh>> DynamicMeshes{};
+
+        // Meshes declared with a mesh node, by name, so instances can refer to them.
+        std::unordered_map<std::string, const IntersectableGeometry*> Meshes{};
+
         const IntersectableGeometry* Geometry{};
     };
 
@@ -77,7 +91,7 @@ namespace Yart::Yaml
         auto position = ParseVector3(node["position"]);
         auto radius = node["radius"].as<real>();
 
-        auto geometry = std::make_shared<const Sphere>(position, radius, material);
+        auto geometry = std::make_shared<Sphere>(position, radius, material);
         parseGeometryResults.Geometries.push_back(geometry);
 
         if (sequenceGeometries)
@@ -96,7 +110,7 @@ namespace Yart::Yaml
         auto normal = ParseVector3(node["normal"]);
         auto point = ParseVector3(node["point"]);
 
-        auto geometry = std::make_shared<const Plane>(normal, point, material);
+        auto geometry = std::make_shared<Plane>(normal, point, material);
         parseGeometryResults.Geometries.push_back(geometry);
 
         if (sequenceGeometries)
@@ -118,7 +132,7 @@ namespace Yart::Yaml
         auto edge1 = ParseVector3(node["edge1"]);
         auto edge2 = ParseVector3(node["edge2"]);
 
-        auto geometry = std::make_shared<const Parallelogram>(position, edge1, edge2, material);
+        auto geometry = std::make_shared<Parallelogram>(position, edge1, edge2, material);
         parseGeometryResults.Geometries.push_back(geometry);
 
         if (areaLight)
@@ -143,7 +157,7 @@ namespace Yart::Yaml
         auto vertex1 = ParseVector3(node["vertex1"]);
         auto vertex2 = ParseVector3(node["vertex2"]);
 
-        std::shared_ptr<const Triangle> geometry;
+        std::shared_ptr<Triangle> geometry;
 
         auto normalNode0 = node["normal0"];
         auto normalNode1 = node["normal1"];
@@ -155,11 +169,11 @@ namespace Yart::Yaml
             auto normal1 = ParseVector3(normalNode1);
             auto normal2 = ParseVector3(normalNode2);
 
-            geometry = std::make_shared<const Triangle>(vertex0, vertex1, vertex2, normal0, normal1, normal2, material);
+            geometry = std::make_shared<Triangle>(vertex0, vertex1, vertex2, normal0, normal1, normal2, material);
         }
         else
         {
-            geometry = std::make_shared<const Triangle>(vertex0, vertex1, vertex2, material);
+            geometry = std::make_shared<Triangle>(vertex0, vertex1, vertex2, material);
         }
 
         parseGeometryResults.Geometries.push_back(geometry);
@@ -183,7 +197,7 @@ namespace Yart::Yaml
         auto normal = ParseVector3(node["normal"]);
         auto radius = node["radius"].as<real>();
 
-        auto geometry = std::make_shared<const Disc>(position, normal, radius, material);
+        auto geometry = std::make_shared<Disc>(position, normal, radius, material);
         parseGeometryResults.Geometries.push_back(geometry);
 
         if (areaLight)
@@ -191,6 +205,11 @@ namespace Yart::Yaml
             parseGeometryResults.AreaLights.push_back(geometry.get());
         }
 
+        if (sequenceGeometries)
+        {
+            sequenceGeometries->push_back(geometry.get());
+        }
+
         return geometry.get();
     }
 
@@ -202,7 +221,7 @@ namespace Yart::Yaml
         auto minimum = ParseVector3(node["minimum"]);
         auto maximum = ParseVector3(node["maximum"]);
 
-        auto geometry = std::make_shared<const AxisAlignedBox>(minimum, maximum, material);
+        auto geometry = std::make_shared<AxisAlignedBox>(minimum, maximum, material);
         parseGeometryResults.Geometries.push_back(geometry);
 
         if (sequenceGeometries)
@@ -217,7 +236,7 @@ namespace Yart::Yaml
     {
         auto children = ParseGeometrySequenceNode(node["children"], materialMap, parseGeometryResults);
 
-        auto geometry = std::make_shared<const GeometryCollection>(*children);
+        auto geometry = std::make_shared<GeometryCollection>(*children);
         parseGeometryResults.Geometries.push_back(geometry);
 
         return geometry.get();
@@ -232,7 +251,7 @@ namespace Yart::Yaml
         {
             auto [boundingVolume, ignored2] = ParseGeometryNode(boundingVolumeNode, materialMap, parseGeometryResults, nullptr, false);
 
-            auto geometry = std::make_shared<const BoundingGeometry>(boundingVolume, child);
+            auto geometry = std::make_shared<BoundingGeometry>(boundingVolume, child);
             parseGeometryResults.Geometries.push_back(geometry);
 
             return geometry.get();
@@ -248,12 +267,202 @@ namespace Yart::Yaml
         auto [childGeometry, ignored] = ParseGeometryNode(node["child"], materialMap, parseGeometryResults, nullptr, true);
         auto matrix = ParseMatrix4x4(node["transformation"]);
 
-        auto geometry = std::make_shared<const TransformedGeometry>(reinterpret_cast<const Geometry*>(childGeometry), matrix);
+        auto geometry = std::make_shared<TransformedGeometry>(reinterpret_cast<const Geometry*>(childGeometry), matrix);
         parseGeometryResults.Geometries.push_back(geometry);
 
         return geometry.get();
     }
 
+    static std::vector<std::tuple<std::string, BoundingBoxBuildStrategy>> BoundingBoxBuildStrategyMap
+    {
+        {"splitByLongAxis", BoundingBoxBuildStrategy::SplitByLongAxis},
+        {"uniform", BoundingBoxBuildStrategy::Uniform},
+        {"binnedSah", BoundingBoxBuildStrategy::BinnedSah},
+        {"spatialSplit", BoundingBoxBuildStrategy::SpatialSplit},
+    };
+
+    BoundingBoxBuildParameters ParseBoundingBoxBuildParametersNode(const Node& node, BoundingBoxBuildParameters parameters = {})
+    {
+        if (!node)
+        {
+            return parameters;
+        }
+
+        auto strategyNode = node["strategy"];
+        if (strategyNode)
+        {
+            auto strategyName = strategyNode.as<std::string>();
+
+            for (const auto& [name, strategy] : BoundingBoxBuildStrategyMap)
+            {
+                if (name == strategyName)
+                {
+                    parameters.Strategy = strategy;
+                    break;
+                }
+            }
+        }
+
+        auto preferredNodeSizeNode = node["preferredNodeSize"];
+        if (preferredNodeSizeNode)
+        {
+            parameters.PreferredNodeSize = ParseVector2<unsigned int>(preferredNodeSizeNode);
+        }
+
+        auto maxDepthNode = node["maxDepth"];
+        if (maxDepthNode)
+        {
+            parameters.MaxDepth = maxDepthNode.as<size_t>();
+        }
+
+        auto binCountNode = node["binCount"];
+        if (binCountNode)
+        {
+            parameters.BinCount = binCountNode.as<size_t>();
+        }
+
+        auto spatialSplitBudgetNode = node["spatialSplitBudget"];
+        if (spatialSplitBudgetNode)
+        {
+            parameters.SpatialSplitBudget = spatialSplitBudgetNode.as<real>();
+        }
+
+        auto parallelSubtreeSizeNode = node["parallelSubtreeSize"];
+        if (parallelSubtreeSizeNode)
+        {
+            parameters.ParallelSubtreeSize = parallelSubtreeSizeNode.as<size_t>();
+        }
+
+        auto parallelDepthNode = node["parallelDepth"];
+        if (parallelDepthNode)
+        {
+            parameters.ParallelDepth = parallelDepthNode.as<size_t>();
+        }
+
+        auto flattenNode = node["flatten"];
+        if (flattenNode)
+        {
+            parameters.Flatten = flattenNode.as<bool>();
+        }
+
+        auto quantizeNode = node["quantize"];
+        if (quantizeNode)
+        {
+            parameters.Quantize = quantizeNode.as<bool>();
+        }
+
+        return parameters;
+    }
+
+    const IntersectableGeometry* FlattenBoundingBoxHierarchy(const BoundingBoxBuildParameters& parameters, const BoundingBoxHierarchy* hierarchy, ParseGeometryResults& parseGeometryResults)
+    {
+        if (!parameters.Flatten)
+        {
+            return hierarchy;
+        }
+
+        if (parameters.Quantize)
+        {
+            auto quantizedHierarchy = std::make_shared<QuantizedBoundingBoxHierarchy>(hierarchy);
+            parseGeometryResults.Geometries.push_back(quantizedHierarchy);
+
+            return quantizedHierarchy.get();
+        }
+
+        auto linearHierarchy = std::make_shared<LinearBoundingBoxHierarchy>(hierarchy);
+        parseGeometryResults.Geometries.push_back(linearHierarchy);
+
+        return linearHierarchy.get();
+    }
+
+    const IntersectableGeometry* LoadIndexedTriangleMeshObj(
+        const std::string& objFilename,
+        const Matrix4x4& transformation,
+        const Material* material,
+        const BoundingBoxBuildParameters& parameters,
+        ParseGeometryResults& parseGeometryResults)
+    {
+        tinyobj::ObjReader reader{};
+        reader.ParseFromFile(objFilename);
+
+        auto& attributes = reader.GetAttrib();
+        auto& shapes = reader.GetShapes();
+
+        std::vector<Vector3> vertices{};
+        std::vector<Vector3> normals{};
+        std::vector<std::uint32_t> indices{};
+
+        // Obj files index positions and normals separately, every distinct pair of them becomes one vertex of the mesh.
+        std::unordered_map<std::uint64_t, std::uint32_t> vertexIndices{};
+
+        for (auto& shape : shapes)
+        {
+            size_t indexOffset = 0;
+            for (auto& faceVertexCount : shape.mesh.num_face_vertices)
+            {
+                if (faceVertexCount != 3)
+                {
+                    break;
+                }
+
+                for (size_t i = 0; i < 3; i++)
+                {
+                    auto objIndices = shape.mesh.indices[indexOffset + i];
+
+                    std::uint64_t key =
+                        (static_cast<std::uint64_t>(static_cast<std::uint32_t>(objIndices.vertex_index)) << 32) |
+                        static_cast<std::uint64_t>(static_cast<std::uint32_t>(objIndices.normal_index));
+
+                    auto [vertexIndex, isNewVertex] = vertexIndices.try_emplace(key, static_cast<std::uint32_t>(vertices.size()));
+                    if (isNewVertex)
+                    {
+                        size_t positionOffset = 3 * static_cast<size_t>(objIndices.vertex_index);
+                        size_t normalOffset = 3 * static_cast<size_t>(objIndices.normal_index);
+
+                        Vector3 vertex{
+                            static_cast<real>(attributes.vertices[positionOffset + 0]),
+                            static_cast<real>(attributes.vertices[positionOffset + 1]),
+                            static_cast<real>(attributes.vertices[positionOffset + 2]),
+                        };
+
+                        Vector3 normal{
+                            static_cast<real>(attributes.normals[normalOffset + 0]),
+                            static_cast<real>(attributes.normals[normalOffset + 1]),
+                            static_cast<real>(attributes.normals[normalOffset + 2]),
+                        };
+
+                        vertices.push_back(Matrix4x4::Multiply(vertex, real{1.0}, transformation));
+                        normals.push_back(Matrix4x4::Multiply(normal, real{0.0}, transformation));
+                    }
+
+                    indices.push_back(vertexIndex->second);
+                }
+
+                indexOffset += faceVertexCount;
+            }
+        }
+
+        auto mesh = std::make_shared<IndexedTriangleMesh>(std::move(vertices), std::move(normals), std::move(indices), material);
+        parseGeometryResults.Geometries.push_back(mesh);
+
+        // The IndexedTriangle objects are only needed by the builder, the leafs of the hierarchy refer to the mesh.
+        std::vector<IndexedTriangle> triangles = CreateIndexedTriangles(mesh.get());
+
+        std::vector<const IntersectableGeometry*> geometries(triangles.size());
+        for (size_t i = 0; i < triangles.size(); i++)
+        {
+            geometries[i] = &triangles[i];
+        }
+
+        auto hierarchy = BuildBoundingBoxHierarchy(parameters, geometries, parseGeometryResults.Geometries);
+        auto root = FlattenBoundingBoxHierarchy(parameters, hierarchy, parseGeometryResults);
+        mesh->SetHierarchy(root);
+
+        parseGeometryResults.HierarchyReports.push_back(BoundingBoxHierarchyReport{objFilename, parameters.Strategy, CalculateSahCost(hierarchy, parameters), root, parameters});
+
+        return root;
+    }
+
     const IntersectableGeometry* ParseTriangleMeshObjNode(const Node& node, MaterialMap& materialMap, ParseGeometryResults& parseGeometryResults, std::vector<const IntersectableGeometry*>* sequenceGeometries)
     {
         auto materialName = node["material"].as<std::string>();
@@ -267,9 +476,44 @@ namespace Yart::Yaml
             transformation = ParseMatrix4x4(node["transformation"]);
         }
 
-        // Read the geometry from the obj file.
         auto objFilename = node["objFile"].as<std::string>();
+        BoundingBoxBuildParameters parameters = ParseBoundingBoxBuildParametersNode(node["hierarchy"]);
+
+        auto dynamicNode = node["dynamic"];
+        bool isDynamic = dynamicNode && dynamicNode.as<bool>();
+
+        // Dynamic meshes move their Triangle objects, they can not be indexed.
+        auto indexedNode = node["indexed"];
+        bool isIndexed = indexedNode && indexedNode.as<bool>() && !isDynamic;
 
+        // Static meshes can be cached on disk next to the obj file so later runs skip parsing and building altogether.
+        std::uint64_t cacheKey{0};
+        std::string cacheFilename{};
+
+        auto cacheNode = node["cache"];
+        if (cacheNode && cacheNode.as<bool>() && !isDynamic && !isIndexed && parameters.Flatten)
+        {
+            cacheKey = CalculateMeshCacheKey(objFilename, transformation, parameters);
+        }
+
+        if (cacheKey != 0)
+        {
+            cacheFilename = GetMeshCacheFilename(objFilename, cacheKey);
+
+            auto [cachedRoot, cachedSahCost] = LoadMeshCache(cacheFilename, cacheKey, material, parseGeometryResults.Geometries);
+            if (cachedRoot)
+            {
+                parseGeometryResults.HierarchyReports.push_back(BoundingBoxHierarchyReport{objFilename, parameters.Strategy, cachedSahCost, cachedRoot, parameters});
+                return cachedRoot;
+            }
+        }
+
+        if (isIndexed)
+        {
+            return LoadIndexedTriangleMeshObj(objFilename, transformation, material, parameters, parseGeometryResults);
+        }
+
+        // Read the geometry from the obj file.
         tinyobj::ObjReader reader{};
         reader.ParseFromFile(objFilename);
 
@@ -277,6 +521,8 @@ namespace Yart::Yaml
         auto& shapes = reader.GetShapes();
 
         std::vector<const IntersectableGeometry*> triangles{};
+        std::vector<std::shared_ptr<Triangle>> meshTriangles{};
+
         for (auto& shape : shapes)
         {
             size_t indexOffset = 0;
@@ -333,27 +579,123 @@ namespace Yart::Yaml
                 normal1 = Matrix4x4::Multiply(normal1, 0.0f, transformation);
                 normal2 = Matrix4x4::Multiply(normal2, 0.0f, transformation);
 
-                auto triangle = std::make_shared<const Triangle>(vertex0, vertex1, vertex2, normal0, normal1, normal2, material);
+                auto triangle = std::make_shared<Triangle>(vertex0, vertex1, vertex2, normal0, normal1, normal2, material);
                 parseGeometryResults.Geometries.push_back(triangle);
 
                 triangles.push_back(triangle.get());
+                meshTriangles.push_back(triangle);
 
                 indexOffset += faceVertexCount;
             }
         }
 
+        // Dynamic meshes own their hierarchy so it can be refit or rebuilt when their vertices are updated.
+        if (isDynamic)
+        {
+            auto nameNode = node["name"];
+            auto name = nameNode ? nameNode.as<std::string>() : objFilename;
+
+            real rebuildThreshold{1.5};
+
+            auto rebuildThresholdNode = node["rebuildThreshold"];
+            if (rebuildThresholdNode)
+            {
+                rebuildThreshold = rebuildThresholdNode.as<real>();
+            }
+
+            auto dynamicMesh = std::make_shared<DynamicMesh>(name, parameters, meshTriangles, rebuildThreshold);
+
+            parseGeometryResults.Geometries.push_back(dynamicMesh);
+            parseGeometryResults.DynamicMeshes.push_back(dynamicMesh);
+            parseGeometryResults.HierarchyReports.push_back(BoundingBoxHierarchyReport{name, parameters.Strategy, dynamicMesh->GetBuildSahCost(), dynamicMesh.get(), parameters});
+
+            return dynamicMesh.get();
+        }
+
         // Create the bounding box hierarchy.
-        BoundingBoxBuildParameters parameters{};
+        auto hierarchy = BuildBoundingBoxHierarchy(parameters, triangles, parseGeometryResults.Geometries);
+        real sahCost = CalculateSahCost(hierarchy, parameters);
+
+        auto root = FlattenBoundingBoxHierarchy(parameters, hierarchy, parseGeometryResults);
+
+        parseGeometryResults.HierarchyReports.push_back(BoundingBoxHierarchyReport{objFilename, parameters.Strategy, sahCost, root, parameters});
+
+        if (cacheKey != 0)
+        {
+            std::vector<const Triangle*> cachedTriangles(meshTriangles.size());
+            for (size_t i = 0; i < meshTriangles.size(); i++)
+            {
+                cachedTriangles[i] = meshTriangles[i].get();
+            }
+
+            SaveMeshCache(cacheFilename, cacheKey, cachedTriangles, root, sahCost);
+        }
+
+        return root;
+    }
+
+    const IntersectableGeometry* ParseMeshNode(const Node& node, MaterialMap& materialMap, ParseGeometryResults& parseGeometryResults, std::vector<const IntersectableGeometry*>* sequenceGeometries)
+    {
+        // A mesh is only declared here, it becomes part of the scene through the instances that refer to it.
+        auto name = node["name"].as<std::string>();
+        auto [geometry, ignored] = ParseGeometryNode(node["child"], materialMap, parseGeometryResults, nullptr, false);
+
+        parseGeometryResults.Meshes[name] = geometry;
+
+        return geometry;
+    }
+
+    const GeometryInstance* CreateGeometryInstance(const Node& node, ParseGeometryResults& parseGeometryResults)
+    {
+        auto meshName = node["mesh"].as<std::string>();
+        auto mesh = parseGeometryResults.Meshes.at(meshName);
+
+        auto transformation = Matrix4x4::CreateIdentity();
+
+        auto transformationNode = node["transformation"];
+        if (transformationNode)
+        {
+            transformation = ParseMatrix4x4(transformationNode);
+        }
+
+        auto geometry = std::make_shared<GeometryInstance>(mesh, transformation);
+        parseGeometryResults.Geometries.push_back(geometry);
+
+        return geometry.get();
+    }
+
+    const GeometryInstance* ParseInstanceNode(const Node& node, MaterialMap& materialMap, ParseGeometryResults& parseGeometryResults, std::vector<const IntersectableGeometry*>* sequenceGeometries)
+    {
+        return CreateGeometryInstance(node, parseGeometryResults);
+    }
+
+    const IntersectableGeometry* ParseInstancesNode(const Node& node, MaterialMap& materialMap, ParseGeometryResults& parseGeometryResults, std::vector<const IntersectableGeometry*>* sequenceGeometries)
+    {
+        std::vector<const IntersectableGeometry*> instances{};
+
+        for (const Node& instanceNode : node["items"])
+        {
+            instances.push_back(CreateGeometryInstance(instanceNode, parseGeometryResults));
+        }
+
+        // Every instance is a hierarchy of its own so the top level hierarchy uses much smaller leafs than a mesh does.
+        BoundingBoxBuildParameters parameters = ParseBoundingBoxBuildParametersNode(
+            node["hierarchy"],
+            BoundingBoxBuildParameters{BoundingBoxBuildStrategy::BinnedSah, {1, 4}, 32});
+
+        auto hierarchy = BuildBoundingBoxHierarchy(parameters, instances, parseGeometryResults.Geometries);
+        auto root = FlattenBoundingBoxHierarchy(parameters, hierarchy, parseGeometryResults);
+
+        parseGeometryResults.HierarchyReports.push_back(BoundingBoxHierarchyReport{"instances", parameters.Strategy, CalculateSahCost(hierarchy, parameters), root, parameters});
 
-        return BuildSplitByLongAxisBoundingBoxHierarchy(parameters, triangles, parseGeometryResults.Geometries);
-        //return BuildUniformBoundingBoxHierarchy(parameters, triangles, parseGeometryResults.Geometries);
+        return root;
     }
 
     const RayMarcher* ParseRayMarcherNode(const Node& node, MaterialMap& materialMap, ParseGeometryResults& parseGeometryResults, std::vector<const IntersectableGeometry*>* sequenceGeometries)
     {
         auto children = ParseSignedDistanceGeometrySequenceNode(node["children"], materialMap, parseGeometryResults);
 
-        auto geometry = std::make_shared<const RayMarcher>(*children);
+        auto geometry = std::make_shared<RayMarcher>(*children);
         parseGeometryResults.Geometries.push_back(geometry);
 
         return geometry.get();
@@ -473,12 +815,15 @@ namespace Yart::Yaml
         {"plane", true, false, &ParsePlaneNode},
         {"parallelogram", true, false, &ParseParallelogramNode},
         {"triangle", true, false, &ParseTriangleNode},
-        {"disc", true, true, &ParseDiscNode},
+        {"disc", true, false, &ParseDiscNode},
         {"axisAlignedBox", true, false, &ParseAxisAlignedBoxNode},
         {"geometryCollection", false, true, &ParseGeometryCollectionNode},
         {"boundingGeometry", false, true, &ParseBoundingGeometryNode},
         {"transformed", true, true, &ParseTransformedGeometryNode},
         {"triangleMeshObj", true, true, &ParseTriangleMeshObjNode},
+        {"mesh", false, false, &ParseMeshNode},
+        {"instance", false, true, &ParseInstanceNode},
+        {"instances", false, true, &ParseInstancesNode},
         {"rayMarcher", false, true, ParseRayMarcherNode},
     };
 
@@ -32,9 +32,9 @@ namespace Yart::Yaml
         std::shared_ptr<ParseGeometryResults> GeometryData{};
     };
 
-    export std::shared_ptr<YamlData> LoadYaml()
+    export std::shared_ptr<YamlData> LoadYaml(const std::string& filename)
     {
-        Node node = LoadFile("../../../../Yart.Engine/dice.yaml");
+        Node node = LoadFile(filename);
 
         std::shared_ptr<Config> config = ParseConfigNode(node["config"]);
         std::shared_ptr<Camera> camera = ParseCameraNode(node["camera"]);
@@ -51,4 +51,9 @@ namespace Yart::Yaml
             lights,
             geometryDataPointer);
     }
+
+    export std::shared_ptr<YamlData> LoadYaml()
+    {
+        return LoadYaml("../../../../Yart.Engine/dice.yaml");
+    }
 }
\ No newline at end of file